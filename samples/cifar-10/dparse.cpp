@@ -6,6 +6,9 @@
 // Step 4. g++ dparse.cpp -o dparse -lnetcdf -lnetcdf_c++4 --std=c++0x
 // Step 5. ./dparse
 // Step 6. Use the network in config.json with cifar-10-training.nc and cifar-10-test.nc, P@1~=81%
+//
+// The network also trains on machines without a GPU with DSSTNE built by make HOST=1, set OMP_NUM_THREADS
+// to the number of cores
 
 #include <cstdio>
 #include <algorithm>
@@ -342,6 +342,10 @@ void GpuContext::Startup(int argc, char** argv)
         delete[] pDevice;
         delete[] pUnifiedAddressing;
     }
+#ifdef HOST_ONLY
+    // Host processes never share an address space so always exchange through MPI
+    bP2P                                            = false;
+#endif
     _bSingleNode                                    = bSingleNode;
     _bP2P                                           = bP2P;
     printf("GpuContext::Startup: P2P support flags on GPU for process %d are %d %d\n", _device, _bP2P, _bSingleNode);  
@@ -17,6 +17,9 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#ifdef HOST_ONLY
+#include "HostDevice.h"
+#else
 #include <cuda.h>
 #include <cublas_v2.h>
 #include <curand.h>
@@ -24,6 +27,7 @@
 #include <vector_functions.h>
 #include <cuda_runtime_api.h>
 #include <builtin_types.h>
+#endif
 #include <cstring>
 #include <cstdint>
 #include <assert.h>
@@ -0,0 +1,211 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include <limits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOST_BITONIC_X86
+#endif
+
+#ifdef HOST_BITONIC_X86
+// Networks are compiled once per instruction set with function level target options so the library
+// builds without -march flags, the widest one the CPU supports is picked at runtime
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace bitonic_avx512
+{
+struct V
+{
+    typedef __m512              K;
+    typedef __m512i             I;
+    typedef __mmask16           M;
+    static const uint32_t       W = 16;
+
+    static inline K LoadKey(const NNFloat* p) { return _mm512_load_ps(p); }
+    static inline I LoadValue(const uint32_t* p) { return _mm512_load_si512(p); }
+    static inline void StoreKey(NNFloat* p, K k) { _mm512_store_ps(p, k); }
+    static inline void StoreValue(uint32_t* p, I v) { _mm512_store_si512(p, v); }
+    static inline I ExchangeIndex(uint32_t j) { return _mm512_xor_si512(_mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_epi32(j)); }
+    static inline K Exchange(K k, uint32_t j) { return _mm512_permutexvar_ps(ExchangeIndex(j), k); }
+    static inline I Exchange(I v, uint32_t j) { return _mm512_permutexvar_epi32(ExchangeIndex(j), v); }
+    static inline I ReverseIndex() { return _mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); }
+    static inline K Reverse(K k) { return _mm512_permutexvar_ps(ReverseIndex(), k); }
+    static inline I Reverse(I v) { return _mm512_permutexvar_epi32(ReverseIndex(), v); }
+    static inline M LT(K a, K b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static inline M GT(K a, K b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static inline K Blend(M m, K a, K b) { return _mm512_mask_blend_ps(m, a, b); }
+    static inline I Blend(M m, I a, I b) { return _mm512_mask_blend_epi32(m, a, b); }
+    static inline M Select(M m, M a, M b) { return (M)((a & m) | (b & ~m)); }
+    static inline M LaneMask(uint32_t bits) { return (M)bits; }
+};
+#include "HostBitonic.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace bitonic_avx2
+{
+struct V
+{
+    typedef __m256              K;
+    typedef __m256i             I;
+    typedef __m256              M;
+    static const uint32_t       W = 8;
+
+    static inline K LoadKey(const NNFloat* p) { return _mm256_load_ps(p); }
+    static inline I LoadValue(const uint32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+    static inline void StoreKey(NNFloat* p, K k) { _mm256_store_ps(p, k); }
+    static inline void StoreValue(uint32_t* p, I v) { _mm256_store_si256((__m256i*)p, v); }
+    static inline I ExchangeIndex(uint32_t j) { return _mm256_xor_si256(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(j)); }
+    static inline K Exchange(K k, uint32_t j) { return _mm256_permutevar8x32_ps(k, ExchangeIndex(j)); }
+    static inline I Exchange(I v, uint32_t j) { return _mm256_permutevar8x32_epi32(v, ExchangeIndex(j)); }
+    static inline I ReverseIndex() { return _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0); }
+    static inline K Reverse(K k) { return _mm256_permutevar8x32_ps(k, ReverseIndex()); }
+    static inline I Reverse(I v) { return _mm256_permutevar8x32_epi32(v, ReverseIndex()); }
+    static inline M LT(K a, K b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static inline M GT(K a, K b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline K Blend(M m, K a, K b) { return _mm256_blendv_ps(a, b, m); }
+    static inline I Blend(M m, I a, I b) { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), m)); }
+    static inline M Select(M m, M a, M b) { return _mm256_or_ps(_mm256_and_ps(m, a), _mm256_andnot_ps(m, b)); }
+    static inline M LaneMask(uint32_t bits)
+    {
+        __m256i laneBits        = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), laneBits));
+    }
+};
+#include "HostBitonic.h"
+}
+#pragma GCC pop_options
+#endif
+
+enum BitonicISA
+{
+    BitonicScalar,
+    BitonicAVX2,
+    BitonicAVX512,
+};
+
+// Widest instruction set the CPU supports, DSSTNE_HOST_SIMD=avx2 or scalar caps it for testing and benchmarking
+static BitonicISA DetectBitonicISA()
+{
+#ifdef HOST_BITONIC_X86
+    const char* pLimit                          = getenv("DSSTNE_HOST_SIMD");
+    bool bAVX512                                = __builtin_cpu_supports("avx512f") && !pLimit;
+    bool bAVX2                                  = __builtin_cpu_supports("avx2") && (!pLimit || !strcmp(pLimit, "avx2"));
+    return bAVX512 ? BitonicAVX512 : (bAVX2 ? BitonicAVX2 : BitonicScalar);
+#else
+    return BitonicScalar;
+#endif
+}
+
+static BitonicISA GetBitonicISA()
+{
+    static const BitonicISA isa                 = DetectBitonicISA();
+    return isa;
+}
+
+// Networks pad blocks with +infinity, so inputs holding +infinity or NaN take the scalar path
+static BitonicISA GetBitonicISA(const NNFloat* pKey, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (!(pKey[i] < numeric_limits<NNFloat>::infinity()))
+            return BitonicScalar;
+    }
+    return GetBitonicISA();
+}
+
+static bool CompareKey(const pair<NNFloat, uint32_t>& a, const pair<NNFloat, uint32_t>& b)
+{
+    return a.first < b.first;
+}
+
+void hBitonicSort(NNFloat* pKey, uint32_t* pValue, uint32_t n, bool bDescending)
+{
+    if (n <= 1)
+        return;
+
+    switch (GetBitonicISA(pKey, n))
+    {
+#ifdef HOST_BITONIC_X86
+        case BitonicAVX512:
+            bitonic_avx512::BitonicSort<bitonic_avx512::V>(pKey, pValue, n);
+            break;
+
+        case BitonicAVX2:
+            bitonic_avx2::BitonicSort<bitonic_avx2::V>(pKey, pValue, n);
+            break;
+#endif
+
+        default:
+        {
+            vector<pair<NNFloat, uint32_t> > vPair(n);
+            for (uint32_t i = 0; i < n; i++)
+                vPair[i]                        = make_pair(pKey[i], pValue[i]);
+            sort(vPair.begin(), vPair.end(), CompareKey);
+            for (uint32_t i = 0; i < n; i++)
+            {
+                pKey[i]                         = vPair[i].first;
+                pValue[i]                       = vPair[i].second;
+            }
+        }
+        break;
+    }
+
+    if (bDescending)
+    {
+        reverse(pKey, pKey + n);
+        reverse(pValue, pValue + n);
+    }
+}
+
+void hBitonicMerge(const NNFloat* pKeyA, const uint32_t* pValueA, uint32_t na, const NNFloat* pKeyB, const uint32_t* pValueB, uint32_t nb, NNFloat* pKey, uint32_t* pValue)
+{
+    BitonicISA isa                              = GetBitonicISA(pKeyA, na);
+    if (isa != BitonicScalar)
+        isa                                     = GetBitonicISA(pKeyB, nb);
+    switch (isa)
+    {
+#ifdef HOST_BITONIC_X86
+        case BitonicAVX512:
+            bitonic_avx512::BitonicMerge<bitonic_avx512::V>(pKeyA, pValueA, na, pKeyB, pValueB, nb, pKey, pValue);
+            break;
+
+        case BitonicAVX2:
+            bitonic_avx2::BitonicMerge<bitonic_avx2::V>(pKeyA, pValueA, na, pKeyB, pValueB, nb, pKey, pValue);
+            break;
+#endif
+
+        default:
+        {
+            uint32_t a                          = 0;
+            uint32_t b                          = 0;
+            for (uint32_t i = 0; i < na + nb; i++)
+            {
+                if ((b >= nb) || ((a < na) && (pKeyA[a] <= pKeyB[b])))
+                {
+                    pKey[i]                     = pKeyA[a];
+                    pValue[i]                   = pValueA[a++];
+                }
+                else
+                {
+                    pKey[i]                     = pKeyB[b];
+                    pValue[i]                   = pValueB[b++];
+                }
+            }
+        }
+        break;
+    }
+}
@@ -0,0 +1,322 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+// Register resident bitonic sort and merge networks for key/value pairs, the host counterpart of
+// the warp networks in bitonic.h.  Registers play the part of warp lanes: a block of R * V::W pairs
+// lives in R key and R value registers, lane exchanges are permutes instead of __shfl.
+//
+// Deliberately has no include guard: HostBitonic.cpp includes it once per instruction set, inside
+// a namespace and #pragma GCC target region, with V the matching vector traits.
+//
+// V must provide:
+//   K, I, M                    key register, value register and lane mask types
+//   W                          lanes per register
+//   Exchange(j)                swaps lanes i and i ^ j
+//   Reverse                    reverses lane order
+//   LT/GT                      per lane key compares
+//   Blend(m, a, b)             b where m is set, a elsewhere
+//   Select(m, a, b)            (a & m) | (b & ~m) for masks
+//   LaneMask(bits)             mask from the low W bits of bits
+
+// Compare and exchange two whole registers, the smaller keys go to (k0, v0) when bAscending
+template<typename V> static inline void BitonicExchangeRegisters(typename V::K& k0, typename V::I& v0, typename V::K& k1, typename V::I& v1, bool bAscending)
+{
+    typename V::M m                             = bAscending ? V::LT(k1, k0) : V::GT(k1, k0);
+    typename V::K k                             = V::Blend(m, k0, k1);
+    typename V::I v                             = V::Blend(m, v0, v1);
+    k1                                          = V::Blend(m, k1, k0);
+    v1                                          = V::Blend(m, v1, v0);
+    k0                                          = k;
+    v0                                          = v;
+}
+
+// Compare and exchange lanes i and i ^ j within a register, lanes set in minLanes keep the smaller key
+template<typename V> static inline void BitonicExchangeLanes(typename V::K& k, typename V::I& v, uint32_t j, typename V::M minLanes)
+{
+    typename V::K pk                            = V::Exchange(k, j);
+    typename V::I pv                            = V::Exchange(v, j);
+    typename V::M m                             = V::Select(minLanes, V::LT(pk, k), V::GT(pk, k));
+    k                                           = V::Blend(m, k, pk);
+    v                                           = V::Blend(m, v, pv);
+}
+
+// Lanes whose index has bit x clear, x < W
+static inline uint32_t BitonicLanePattern(uint32_t x)
+{
+    switch (x)
+    {
+        case 1:
+            return 0x55555555;
+
+        case 2:
+            return 0x33333333;
+
+        case 4:
+            return 0x0f0f0f0f;
+
+        case 8:
+            return 0x00ff00ff;
+
+        default:
+            return 0x0000ffff;
+    }
+}
+
+// Lanes of register r that keep the smaller key for stage (size, j) of an ascending bitonic sort: lane g
+// of the block keeps the minimum when bit j and bit size of g agree
+template<typename V> static inline uint32_t BitonicMinLanes(uint32_t r, uint32_t size, uint32_t j)
+{
+    uint32_t sizePattern                        = (size < V::W) ? BitonicLanePattern(size) : ((((r * V::W) & size) == 0) ? 0xffffffff : 0);
+    return ~(BitonicLanePattern(j) ^ sizePattern) & ((1 << V::W) - 1);
+}
+
+// Ascending sort of R registers of pairs
+template<typename V, uint32_t R> static inline void BitonicSortRegisters(typename V::K* k, typename V::I* v)
+{
+    for (uint32_t size = 2; size <= R * V::W; size <<= 1)
+    {
+        for (uint32_t j = size >> 1; j > 0; j >>= 1)
+        {
+            if (j >= V::W)
+            {
+                uint32_t rj                     = j / V::W;
+                for (uint32_t r = 0; r < R; r++)
+                {
+                    if ((r & rj) == 0)
+                        BitonicExchangeRegisters<V>(k[r], v[r], k[r | rj], v[r | rj], ((r * V::W) & size) == 0);
+                }
+            }
+            else
+            {
+                for (uint32_t r = 0; r < R; r++)
+                    BitonicExchangeLanes<V>(k[r], v[r], j, V::LaneMask(BitonicMinLanes<V>(r, size, j)));
+            }
+        }
+    }
+}
+
+// Sorts a bitonic register ascending
+template<typename V> static inline void BitonicCleanRegister(typename V::K& k, typename V::I& v)
+{
+    for (uint32_t j = V::W >> 1; j > 0; j >>= 1)
+        BitonicExchangeLanes<V>(k, v, j, V::LaneMask(BitonicMinLanes<V>(0, 2 * V::W, j)));
+}
+
+// Merges two ascending registers, the lower half ends up ascending in (k0, v0) and the upper in (k1, v1)
+template<typename V> static inline void BitonicMergeRegisters(typename V::K& k0, typename V::I& v0, typename V::K& k1, typename V::I& v1)
+{
+    k1                                          = V::Reverse(k1);
+    v1                                          = V::Reverse(v1);
+    BitonicExchangeRegisters<V>(k0, v0, k1, v1, true);
+    BitonicCleanRegister<V>(k0, v0);
+    BitonicCleanRegister<V>(k1, v1);
+}
+
+// Sorts R * W pairs in place, pointers must be aligned to the register size
+template<typename V, uint32_t R> static void BitonicSortBlock(NNFloat* pKey, uint32_t* pValue)
+{
+    typename V::K k[R];
+    typename V::I v[R];
+    for (uint32_t r = 0; r < R; r++)
+    {
+        k[r]                                    = V::LoadKey(pKey + r * V::W);
+        v[r]                                    = V::LoadValue(pValue + r * V::W);
+    }
+    BitonicSortRegisters<V, R>(k, v);
+    for (uint32_t r = 0; r < R; r++)
+    {
+        V::StoreKey(pKey + r * V::W, k[r]);
+        V::StoreValue(pValue + r * V::W, v[r]);
+    }
+}
+
+// Merges two ascending runs whose lengths are multiples of W into pKey/pValue, one register at a time
+template<typename V> static void BitonicMergeRuns(const NNFloat* pKeyA, const uint32_t* pValueA, uint32_t na,
+                                                  const NNFloat* pKeyB, const uint32_t* pValueB, uint32_t nb,
+                                                  NNFloat* pKey, uint32_t* pValue)
+{
+    typename V::K k0                            = V::LoadKey(pKeyA);
+    typename V::I v0                            = V::LoadValue(pValueA);
+    typename V::K k1                            = V::LoadKey(pKeyB);
+    typename V::I v1                            = V::LoadValue(pValueB);
+    uint32_t a                                  = V::W;
+    uint32_t b                                  = V::W;
+    BitonicMergeRegisters<V>(k0, v0, k1, v1);
+    V::StoreKey(pKey, k0);
+    V::StoreValue(pValue, v0);
+    pKey                                       += V::W;
+    pValue                                     += V::W;
+
+    // (k1, v1) holds the largest W pairs seen so far, merge it with the next register from whichever
+    // run has the smaller head
+    while ((a < na) || (b < nb))
+    {
+        if ((b >= nb) || ((a < na) && (pKeyA[a] <= pKeyB[b])))
+        {
+            k0                                  = V::LoadKey(pKeyA + a);
+            v0                                  = V::LoadValue(pValueA + a);
+            a                                  += V::W;
+        }
+        else
+        {
+            k0                                  = V::LoadKey(pKeyB + b);
+            v0                                  = V::LoadValue(pValueB + b);
+            b                                  += V::W;
+        }
+        BitonicMergeRegisters<V>(k0, v0, k1, v1);
+        V::StoreKey(pKey, k0);
+        V::StoreValue(pValue, v0);
+        pKey                                   += V::W;
+        pValue                                 += V::W;
+    }
+    V::StoreKey(pKey, k1);
+    V::StoreValue(pValue, v1);
+}
+
+// Sorts n pairs, n a power of two between W and 256, in place
+template<typename V> static void BitonicSortPowerOfTwo(NNFloat* pKey, uint32_t* pValue, uint32_t n)
+{
+    switch (n / V::W)
+    {
+        case 1:
+            BitonicSortBlock<V, 1>(pKey, pValue);
+            break;
+
+        case 2:
+            BitonicSortBlock<V, 2>(pKey, pValue);
+            break;
+
+        case 4:
+            BitonicSortBlock<V, 4>(pKey, pValue);
+            break;
+
+        case 8:
+            BitonicSortBlock<V, 8>(pKey, pValue);
+            break;
+
+        case 16:
+            BitonicSortBlock<V, 16>(pKey, pValue);
+            break;
+
+        case 32:
+            BitonicSortBlock<V, 32>(pKey, pValue);
+            break;
+    }
+}
+
+// Largest block sorted entirely in registers, the same 256 pairs as the BITONICSORT256_256 warp network
+static const uint32_t BITONIC_BLOCK             = 256;
+
+template<typename V> static void BitonicPad(NNFloat* pKey, uint32_t* pValue, uint32_t n, uint32_t padded)
+{
+    for (uint32_t i = n; i < padded; i++)
+    {
+        pKey[i]                                 = numeric_limits<NNFloat>::infinity();
+        pValue[i]                               = 0;
+    }
+}
+
+// Ascending sort of any number of pairs: blocks of up to 256 are sorted in registers, longer inputs are
+// sorted as 256 pair blocks and merged pairwise
+template<typename V> static void BitonicSort(NNFloat* pKey, uint32_t* pValue, uint32_t n)
+{
+    if (n <= BITONIC_BLOCK)
+    {
+        NNFloat key[BITONIC_BLOCK] __attribute__((aligned(64)));
+        uint32_t value[BITONIC_BLOCK] __attribute__((aligned(64)));
+        uint32_t padded                         = V::W;
+        while (padded < n)
+            padded                            <<= 1;
+        memcpy(key, pKey, n * sizeof(NNFloat));
+        memcpy(value, pValue, n * sizeof(uint32_t));
+        BitonicPad<V>(key, value, n, padded);
+        BitonicSortPowerOfTwo<V>(key, value, padded);
+        memcpy(pKey, key, n * sizeof(NNFloat));
+        memcpy(pValue, value, n * sizeof(uint32_t));
+        return;
+    }
+
+    uint32_t padded                             = ((n + BITONIC_BLOCK - 1) / BITONIC_BLOCK) * BITONIC_BLOCK;
+    NNFloat* pKeyBuffer;
+    uint32_t* pValueBuffer;
+    if (posix_memalign((void**)&pKeyBuffer, 64, 2 * padded * sizeof(NNFloat)) ||
+        posix_memalign((void**)&pValueBuffer, 64, 2 * padded * sizeof(uint32_t)))
+    {
+        printf("hBitonicSort: Failed to allocate scratch buffers.\n");
+        exit(-1);
+    }
+    NNFloat* pKeySrc                            = pKeyBuffer;
+    uint32_t* pValueSrc                         = pValueBuffer;
+    NNFloat* pKeyDst                            = pKeyBuffer + padded;
+    uint32_t* pValueDst                         = pValueBuffer + padded;
+    memcpy(pKeySrc, pKey, n * sizeof(NNFloat));
+    memcpy(pValueSrc, pValue, n * sizeof(uint32_t));
+    BitonicPad<V>(pKeySrc, pValueSrc, n, padded);
+    for (uint32_t pos = 0; pos < padded; pos += BITONIC_BLOCK)
+        BitonicSortPowerOfTwo<V>(pKeySrc + pos, pValueSrc + pos, BITONIC_BLOCK);
+
+    for (uint32_t run = BITONIC_BLOCK; run < padded; run <<= 1)
+    {
+        for (uint32_t pos = 0; pos < padded; pos += 2 * run)
+        {
+            uint32_t na                         = min(run, padded - pos);
+            uint32_t nb                         = min(run, padded - pos - na);
+            if (nb == 0)
+            {
+                memcpy(pKeyDst + pos, pKeySrc + pos, na * sizeof(NNFloat));
+                memcpy(pValueDst + pos, pValueSrc + pos, na * sizeof(uint32_t));
+            }
+            else
+                BitonicMergeRuns<V>(pKeySrc + pos, pValueSrc + pos, na, pKeySrc + pos + na, pValueSrc + pos + na, nb, pKeyDst + pos, pValueDst + pos);
+        }
+        swap(pKeySrc, pKeyDst);
+        swap(pValueSrc, pValueDst);
+    }
+    memcpy(pKey, pKeySrc, n * sizeof(NNFloat));
+    memcpy(pValue, pValueSrc, n * sizeof(uint32_t));
+    free(pKeyBuffer);
+    free(pValueBuffer);
+}
+
+// Merges two ascending runs of any length
+template<typename V> static void BitonicMerge(const NNFloat* pKeyA, const uint32_t* pValueA, uint32_t na,
+                                              const NNFloat* pKeyB, const uint32_t* pValueB, uint32_t nb,
+                                              NNFloat* pKey, uint32_t* pValue)
+{
+    uint32_t pa                                 = ((na + V::W - 1) / V::W) * V::W;
+    uint32_t pb                                 = ((nb + V::W - 1) / V::W) * V::W;
+    NNFloat* pKeyBuffer;
+    uint32_t* pValueBuffer;
+    if (posix_memalign((void**)&pKeyBuffer, 64, 2 * (pa + pb) * sizeof(NNFloat)) ||
+        posix_memalign((void**)&pValueBuffer, 64, 2 * (pa + pb) * sizeof(uint32_t)))
+    {
+        printf("hBitonicMerge: Failed to allocate scratch buffers.\n");
+        exit(-1);
+    }
+    memcpy(pKeyBuffer, pKeyA, na * sizeof(NNFloat));
+    memcpy(pValueBuffer, pValueA, na * sizeof(uint32_t));
+    BitonicPad<V>(pKeyBuffer, pValueBuffer, na, pa);
+    memcpy(pKeyBuffer + pa, pKeyB, nb * sizeof(NNFloat));
+    memcpy(pValueBuffer + pa, pValueB, nb * sizeof(uint32_t));
+    BitonicPad<V>(pKeyBuffer + pa, pValueBuffer + pa, nb, pb);
+    if ((pa == 0) || (pb == 0))
+    {
+        memcpy(pKeyBuffer + pa + pb, pKeyBuffer, (pa + pb) * sizeof(NNFloat));
+        memcpy(pValueBuffer + pa + pb, pValueBuffer, (pa + pb) * sizeof(uint32_t));
+    }
+    else
+        BitonicMergeRuns<V>(pKeyBuffer, pValueBuffer, pa, pKeyBuffer + pa, pValueBuffer + pa, pb, pKeyBuffer + pa + pb, pValueBuffer + pa + pb);
+    memcpy(pKey, pKeyBuffer + pa + pb, (na + nb) * sizeof(NNFloat));
+    memcpy(pValue, pValueBuffer + pa + pb, (na + nb) * sizeof(uint32_t));
+    free(pKeyBuffer);
+    free(pValueBuffer);
+}
@@ -0,0 +1,1764 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "HostDevice.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <unistd.h>
+#include <omp.h>
+extern "C"
+{
+    #include <cblas.h>
+}
+
+// Sticky error for cudaGetLastError, nothing is asynchronous so only the
+// failing call itself can set it
+static cudaError_t sLastError                       = cudaSuccess;
+
+static cudaError_t SetError(cudaError_t error)
+{
+    if (error != cudaSuccess)
+        sLastError                                  = error;
+    return error;
+}
+
+// CUDA runtime
+cudaError_t cudaMalloc(void** devPtr, size_t size)
+{
+    if (posix_memalign(devPtr, HOST_DEVICE_ALIGNMENT, (size + HOST_DEVICE_ALIGNMENT - 1) & ~(HOST_DEVICE_ALIGNMENT - 1)))
+    {
+        *devPtr                                     = NULL;
+        return SetError(cudaErrorMemoryAllocation);
+    }
+    return cudaSuccess;
+}
+
+cudaError_t cudaFree(void* devPtr)
+{
+    free(devPtr);
+    return cudaSuccess;
+}
+
+cudaError_t cudaHostAlloc(void** pHost, size_t size, unsigned int flags)
+{
+    return cudaMalloc(pHost, size);
+}
+
+cudaError_t cudaHostGetDevicePointer(void** pDevice, void* pHost, unsigned int flags)
+{
+    *pDevice                                        = pHost;
+    return cudaSuccess;
+}
+
+cudaError_t cudaFreeHost(void* ptr)
+{
+    free(ptr);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemset(void* devPtr, int value, size_t count)
+{
+    memset(devPtr, value, count);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemcpy(void* dst, const void* src, size_t count, cudaMemcpyKind kind)
+{
+    if (dst != src)
+        memmove(dst, src, count);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemcpy2D(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height, cudaMemcpyKind kind)
+{
+    if ((width > dpitch) || (width > spitch))
+        return SetError(cudaErrorInvalidValue);
+    for (size_t row = 0; row < height; row++)
+        memmove((char*)dst + row * dpitch, (const char*)src + row * spitch, width);
+    return cudaSuccess;
+}
+
+cudaError_t cudaDeviceSynchronize()
+{
+    return cudaSuccess;
+}
+
+cudaError_t cudaThreadSynchronize()
+{
+    return cudaSuccess;
+}
+
+cudaError_t cudaThreadExit()
+{
+    return cudaSuccess;
+}
+
+cudaError_t cudaGetLastError()
+{
+    cudaError_t error                               = sLastError;
+    sLastError                                      = cudaSuccess;
+    return error;
+}
+
+const char* cudaGetErrorString(cudaError_t error)
+{
+    switch (error)
+    {
+        case cudaSuccess:
+            return "no error";
+
+        case cudaErrorMemoryAllocation:
+            return "out of memory";
+
+        case cudaErrorInvalidValue:
+            return "invalid argument";
+
+        case cudaErrorNotSupported:
+            return "operation not supported on host device";
+
+        case cudaErrorPeerAccessAlreadyEnabled:
+            return "peer access is already enabled";
+    }
+    return "unknown error";
+}
+
+cudaError_t cudaGetDeviceCount(int* count)
+{
+    *count                                          = 1;
+    return cudaSuccess;
+}
+
+cudaError_t cudaGetDeviceProperties(cudaDeviceProp* prop, int device)
+{
+    if (device != 0)
+        return SetError(cudaErrorInvalidValue);
+    memset(prop, 0, sizeof(cudaDeviceProp));
+    strcpy(prop->name, "Host CPU");
+    prop->totalGlobalMem                            = (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+    prop->warpSize                                  = 32;
+    prop->major                                     = 5;
+    prop->minor                                     = 0;
+    prop->canMapHostMemory                          = 1;
+    prop->unifiedAddressing                         = 1;
+    prop->multiProcessorCount                       = omp_get_max_threads();
+    return cudaSuccess;
+}
+
+cudaError_t cudaSetDeviceFlags(unsigned int flags)
+{
+    return cudaSuccess;
+}
+
+cudaError_t cudaSetValidDevices(int* pDevice, int len)
+{
+    return (len > 0) ? cudaSuccess : SetError(cudaErrorInvalidValue);
+}
+
+cudaError_t cudaGetDevice(int* device)
+{
+    *device                                         = 0;
+    return cudaSuccess;
+}
+
+cudaError_t cudaSetDevice(int device)
+{
+    return (device == 0) ? cudaSuccess : SetError(cudaErrorInvalidValue);
+}
+
+cudaError_t cudaDeviceCanAccessPeer(int* canAccessPeer, int device, int peerDevice)
+{
+    *canAccessPeer                                  = 0;
+    return cudaSuccess;
+}
+
+cudaError_t cudaDeviceEnablePeerAccess(int peerDevice, unsigned int flags)
+{
+    return SetError(cudaErrorNotSupported);
+}
+
+// Processes never share an address space, so there is no IPC
+cudaError_t cudaIpcGetMemHandle(cudaIpcMemHandle_t* handle, void* devPtr)
+{
+    return SetError(cudaErrorNotSupported);
+}
+
+cudaError_t cudaIpcOpenMemHandle(void** devPtr, cudaIpcMemHandle_t handle, unsigned int flags)
+{
+    return SetError(cudaErrorNotSupported);
+}
+
+cudaError_t cudaIpcCloseMemHandle(void* devPtr)
+{
+    return SetError(cudaErrorNotSupported);
+}
+
+// cuBLAS
+struct cublasContext
+{
+    int                     _device;
+};
+
+cublasStatus_t cublasCreate(cublasHandle_t* handle)
+{
+    *handle                                         = new cublasContext();
+    (*handle)->_device                              = 0;
+    return CUBLAS_STATUS_SUCCESS;
+}
+
+cublasStatus_t cublasDestroy(cublasHandle_t handle)
+{
+    if (handle == NULL)
+        return CUBLAS_STATUS_NOT_INITIALIZED;
+    delete handle;
+    return CUBLAS_STATUS_SUCCESS;
+}
+
+// cuBLAS is column-major, which cblas supports directly
+cublasStatus_t cublasSgemm(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k,
+                           const float* alpha, const float* A, int lda, const float* B, int ldb, const float* beta, float* C, int ldc)
+{
+    if (handle == NULL)
+        return CUBLAS_STATUS_NOT_INITIALIZED;
+    if ((m < 0) || (n < 0) || (k < 0))
+        return CUBLAS_STATUS_INVALID_VALUE;
+    cblas_sgemm(CblasColMajor,
+                (transa == CUBLAS_OP_T) ? CblasTrans : CblasNoTrans,
+                (transb == CUBLAS_OP_T) ? CblasTrans : CblasNoTrans,
+                m, n, k, *alpha, A, lda, B, ldb, *beta, C, ldc);
+    return CUBLAS_STATUS_SUCCESS;
+}
+
+// cuRAND
+struct curandGenerator_st
+{
+    std::mt19937            _engine;
+};
+
+curandStatus_t curandCreateGenerator(curandGenerator_t* generator, curandRngType_t rng_type)
+{
+    *generator                                      = new curandGenerator_st();
+    return CURAND_STATUS_SUCCESS;
+}
+
+curandStatus_t curandDestroyGenerator(curandGenerator_t generator)
+{
+    if (generator == NULL)
+        return CURAND_STATUS_NOT_INITIALIZED;
+    delete generator;
+    return CURAND_STATUS_SUCCESS;
+}
+
+curandStatus_t curandSetPseudoRandomGeneratorSeed(curandGenerator_t generator, unsigned long long seed)
+{
+    if (generator == NULL)
+        return CURAND_STATUS_NOT_INITIALIZED;
+    generator->_engine.seed((std::mt19937::result_type)(seed ^ (seed >> 32)));
+    return CURAND_STATUS_SUCCESS;
+}
+
+curandStatus_t curandGenerate(curandGenerator_t generator, unsigned int* outputPtr, size_t num)
+{
+    if (generator == NULL)
+        return CURAND_STATUS_NOT_INITIALIZED;
+    for (size_t i = 0; i < num; i++)
+        outputPtr[i]                                = generator->_engine();
+    return CURAND_STATUS_SUCCESS;
+}
+
+// Same range as cuRAND, (0, 1]
+curandStatus_t curandGenerateUniform(curandGenerator_t generator, float* outputPtr, size_t num)
+{
+    if (generator == NULL)
+        return CURAND_STATUS_NOT_INITIALIZED;
+    for (size_t i = 0; i < num; i++)
+        outputPtr[i]                                = ((float)(generator->_engine() >> 8) + 1.0f) * (1.0f / 16777216.0f);
+    return CURAND_STATUS_SUCCESS;
+}
+
+curandStatus_t curandGenerateNormal(curandGenerator_t generator, float* outputPtr, size_t n, float mean, float stddev)
+{
+    if (generator == NULL)
+        return CURAND_STATUS_NOT_INITIALIZED;
+    std::normal_distribution<float> normal(mean, stddev);
+    for (size_t i = 0; i < n; i++)
+        outputPtr[i]                                = normal(generator->_engine);
+    return CURAND_STATUS_SUCCESS;
+}
+
+// cuDNN
+struct cudnnContext
+{
+    int                     _device;
+};
+
+cudnnStatus_t cudnnCreate(cudnnHandle_t* handle)
+{
+    *handle                                         = new cudnnContext();
+    (*handle)->_device                              = 0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnDestroy(cudnnHandle_t handle)
+{
+    if (handle == NULL)
+        return CUDNN_STATUS_NOT_INITIALIZED;
+    delete handle;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+const char* cudnnGetErrorString(cudnnStatus_t status)
+{
+    switch (status)
+    {
+        case CUDNN_STATUS_SUCCESS:
+            return "CUDNN_STATUS_SUCCESS";
+
+        case CUDNN_STATUS_NOT_INITIALIZED:
+            return "CUDNN_STATUS_NOT_INITIALIZED";
+
+        case CUDNN_STATUS_ALLOC_FAILED:
+            return "CUDNN_STATUS_ALLOC_FAILED";
+
+        case CUDNN_STATUS_BAD_PARAM:
+            return "CUDNN_STATUS_BAD_PARAM";
+
+        case CUDNN_STATUS_NOT_SUPPORTED:
+            return "CUDNN_STATUS_NOT_SUPPORTED";
+    }
+    return "CUDNN_STATUS_UNKNOWN";
+}
+
+cudnnStatus_t cudnnCreateTensorDescriptor(cudnnTensorDescriptor_t* tensorDesc)
+{
+    *tensorDesc                                     = new cudnnTensorStruct();
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnDestroyTensorDescriptor(cudnnTensorDescriptor_t tensorDesc)
+{
+    delete tensorDesc;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnSetTensor4dDescriptor(cudnnTensorDescriptor_t tensorDesc, cudnnTensorFormat_t format, cudnnDataType_t dataType, int n, int c, int h, int w)
+{
+    int dim[4]                                      = { n, c, h, w };
+    int stride[4]                                   = { c * h * w, h * w, w, 1 };
+    return cudnnSetTensorNdDescriptor(tensorDesc, dataType, 4, dim, stride);
+}
+
+cudnnStatus_t cudnnSetTensorNdDescriptor(cudnnTensorDescriptor_t tensorDesc, cudnnDataType_t dataType, int nbDims, const int* dimA, const int* strideA)
+{
+    if ((nbDims < 1) || (nbDims > HOST_CUDNN_DIM_MAX))
+        return CUDNN_STATUS_BAD_PARAM;
+    tensorDesc->_dataType                           = dataType;
+    tensorDesc->_nbDims                             = nbDims;
+    for (int i = 0; i < nbDims; i++)
+    {
+        if ((dimA[i] <= 0) || (strideA[i] <= 0))
+            return CUDNN_STATUS_BAD_PARAM;
+        tensorDesc->_dim[i]                         = dimA[i];
+        tensorDesc->_stride[i]                      = strideA[i];
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetTensorNdDescriptor(const cudnnTensorDescriptor_t tensorDesc, int nbDimsRequested, cudnnDataType_t* dataType, int* nbDims, int* dimA, int* strideA)
+{
+    *dataType                                       = tensorDesc->_dataType;
+    *nbDims                                         = tensorDesc->_nbDims;
+    for (int i = 0; (i < nbDimsRequested) && (i < tensorDesc->_nbDims); i++)
+    {
+        dimA[i]                                     = tensorDesc->_dim[i];
+        strideA[i]                                  = tensorDesc->_stride[i];
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnCreateFilterDescriptor(cudnnFilterDescriptor_t* filterDesc)
+{
+    *filterDesc                                     = new cudnnFilterStruct();
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnDestroyFilterDescriptor(cudnnFilterDescriptor_t filterDesc)
+{
+    delete filterDesc;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnSetFilterNdDescriptor(cudnnFilterDescriptor_t filterDesc, cudnnDataType_t dataType, cudnnTensorFormat_t format, int nbDims, const int* filterDimA)
+{
+    if ((nbDims < 1) || (nbDims > HOST_CUDNN_DIM_MAX))
+        return CUDNN_STATUS_BAD_PARAM;
+    filterDesc->_dataType                           = dataType;
+    filterDesc->_format                             = format;
+    filterDesc->_nbDims                             = nbDims;
+    for (int i = 0; i < nbDims; i++)
+        filterDesc->_dim[i]                         = filterDimA[i];
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnCreateConvolutionDescriptor(cudnnConvolutionDescriptor_t* convDesc)
+{
+    *convDesc                                       = new cudnnConvolutionStruct();
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnDestroyConvolutionDescriptor(cudnnConvolutionDescriptor_t convDesc)
+{
+    delete convDesc;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnSetConvolutionNdDescriptor(cudnnConvolutionDescriptor_t convDesc, int arrayLength, const int* padA, const int* filterStrideA, const int* upscaleA, cudnnConvolutionMode_t mode, cudnnDataType_t dataType)
+{
+    if ((arrayLength < 1) || (arrayLength > HOST_CUDNN_DIM_MAX - 2))
+        return CUDNN_STATUS_BAD_PARAM;
+    convDesc->_arrayLength                          = arrayLength;
+    for (int i = 0; i < arrayLength; i++)
+    {
+        if ((padA[i] < 0) || (filterStrideA[i] <= 0) || (upscaleA[i] <= 0))
+            return CUDNN_STATUS_BAD_PARAM;
+        convDesc->_pad[i]                           = padA[i];
+        convDesc->_stride[i]                        = filterStrideA[i];
+        convDesc->_upscale[i]                       = upscaleA[i];
+    }
+    convDesc->_mode                                 = mode;
+    convDesc->_dataType                             = dataType;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionNdForwardOutputDim(const cudnnConvolutionDescriptor_t convDesc, const cudnnTensorDescriptor_t inputTensorDesc, const cudnnFilterDescriptor_t filterDesc, int nbDims, int* tensorOutputDimA)
+{
+    if ((nbDims != inputTensorDesc->_nbDims) || (nbDims != filterDesc->_nbDims) || (nbDims != convDesc->_arrayLength + 2))
+        return CUDNN_STATUS_BAD_PARAM;
+    tensorOutputDimA[0]                             = inputTensorDesc->_dim[0];
+    tensorOutputDimA[1]                             = filterDesc->_dim[0];
+    for (int i = 0; i < convDesc->_arrayLength; i++)
+    {
+        int filter                                  = (filterDesc->_dim[i + 2] - 1) * convDesc->_upscale[i] + 1;
+        tensorOutputDimA[i + 2]                     = 1 + (inputTensorDesc->_dim[i + 2] + 2 * convDesc->_pad[i] - filter) / convDesc->_stride[i];
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnCreatePoolingDescriptor(cudnnPoolingDescriptor_t* poolingDesc)
+{
+    *poolingDesc                                    = new cudnnPoolingStruct();
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnDestroyPoolingDescriptor(cudnnPoolingDescriptor_t poolingDesc)
+{
+    delete poolingDesc;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnSetPoolingNdDescriptor(cudnnPoolingDescriptor_t poolingDesc, cudnnPoolingMode_t mode, cudnnNanPropagation_t maxpoolingNanOpt, int nbDims, const int* windowDimA, const int* paddingA, const int* strideA)
+{
+    if ((nbDims < 1) || (nbDims > HOST_CUDNN_DIM_MAX - 2))
+        return CUDNN_STATUS_BAD_PARAM;
+    poolingDesc->_mode                              = mode;
+    poolingDesc->_nanOpt                            = maxpoolingNanOpt;
+    poolingDesc->_nbDims                            = nbDims;
+    for (int i = 0; i < nbDims; i++)
+    {
+        poolingDesc->_window[i]                     = windowDimA[i];
+        poolingDesc->_padding[i]                    = paddingA[i];
+        poolingDesc->_stride[i]                     = strideA[i];
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnCreateLRNDescriptor(cudnnLRNDescriptor_t* normDesc)
+{
+    *normDesc                                       = new cudnnLRNStruct();
+    return cudnnSetLRNDescriptor(*normDesc, 5, 1.0e-4, 0.75, 2.0);
+}
+
+cudnnStatus_t cudnnDestroyLRNDescriptor(cudnnLRNDescriptor_t lrnDesc)
+{
+    delete lrnDesc;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnSetLRNDescriptor(cudnnLRNDescriptor_t normDesc, unsigned int lrnN, double lrnAlpha, double lrnBeta, double lrnK)
+{
+    normDesc->_n                                    = lrnN;
+    normDesc->_alpha                                = lrnAlpha;
+    normDesc->_beta                                 = lrnBeta;
+    normDesc->_k                                    = lrnK;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Returns the element offset of linear position pos within the last nbDims dimensions of a tensor
+static inline size_t TensorOffset(size_t pos, int nbDims, const int* dim, const int* stride)
+{
+    size_t offset                                   = 0;
+    for (int i = nbDims - 1; i >= 0; i--)
+    {
+        offset                                     += (pos % dim[i]) * stride[i];
+        pos                                        /= dim[i];
+    }
+    return offset;
+}
+
+static inline size_t TensorSize(const cudnnTensorDescriptor_t desc)
+{
+    size_t size                                     = 1;
+    for (int i = 0; i < desc->_nbDims; i++)
+        size                                       *= desc->_dim[i];
+    return size;
+}
+
+// C = alpha * A + beta * C, broadcasting any dimension of A that is 1
+cudnnStatus_t cudnnAddTensor(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t aDesc, const void* A, const void* beta, const cudnnTensorDescriptor_t cDesc, void* C)
+{
+    if ((aDesc->_nbDims != cDesc->_nbDims) || (aDesc->_dataType != CUDNN_DATA_FLOAT) || (cDesc->_dataType != CUDNN_DATA_FLOAT))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    int nbDims                                      = cDesc->_nbDims;
+    int aStride[HOST_CUDNN_DIM_MAX];
+    for (int i = 0; i < nbDims; i++)
+    {
+        if ((aDesc->_dim[i] != 1) && (aDesc->_dim[i] != cDesc->_dim[i]))
+            return CUDNN_STATUS_BAD_PARAM;
+        aStride[i]                                  = (aDesc->_dim[i] == 1) ? 0 : aDesc->_stride[i];
+    }
+
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+    const float* pA                                 = (const float*)A;
+    float* pC                                       = (float*)C;
+    const int64_t size                              = TensorSize(cDesc);
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < size; pos++)
+    {
+        float& c                                    = pC[TensorOffset(pos, nbDims, cDesc->_dim, cDesc->_stride)];
+        float v                                     = a * pA[TensorOffset(pos, nbDims, cDesc->_dim, aStride)];
+        c                                           = (b == 0.0f) ? v : v + b * c;
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// db = alpha * sum of dy over all dimensions but the channel + beta * db
+cudnnStatus_t cudnnConvolutionBackwardBias(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t dyDesc, const void* dy, const void* beta, const cudnnTensorDescriptor_t dbDesc, void* db)
+{
+    if ((dyDesc->_nbDims < 2) || (dbDesc->_nbDims != dyDesc->_nbDims) || (dbDesc->_dim[1] != dyDesc->_dim[1]))
+        return CUDNN_STATUS_BAD_PARAM;
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+    const float* pDy                                = (const float*)dy;
+    float* pDb                                      = (float*)db;
+    const int spatialDims                           = dyDesc->_nbDims - 2;
+    size_t spatial                                  = 1;
+    for (int i = 2; i < dyDesc->_nbDims; i++)
+        spatial                                    *= dyDesc->_dim[i];
+    const int64_t channels                          = dyDesc->_dim[1];
+#pragma omp parallel for
+    for (int64_t c = 0; c < channels; c++)
+    {
+        double sum                                  = 0.0;
+        for (int n = 0; n < dyDesc->_dim[0]; n++)
+        {
+            const float* pPlane                     = pDy + n * dyDesc->_stride[0] + c * dyDesc->_stride[1];
+            for (size_t pos = 0; pos < spatial; pos++)
+                sum                                += pPlane[TensorOffset(pos, spatialDims, dyDesc->_dim + 2, dyDesc->_stride + 2)];
+        }
+        float& d                                    = pDb[c * dbDesc->_stride[1]];
+        d                                           = (b == 0.0f) ? a * (float)sum : a * (float)sum + b * d;
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Convolution works on up to 3 spatial dimensions, 1D and 2D convolutions are padded out to 3D with
+// unit filters just like pooling.  Filters are packed [out channel][in channel][depth][height][width]
+static const int HOST_CONV_DIM                      = 3;
+
+// Largest filter volume for which direct convolution is worth timing against im2col + GEMM
+static const int HOST_CONV_DIRECT_MAX_FILTER        = 9;
+
+// Target size of the im2col workspace, the GEMM path processes as many images at a time as fit
+static const size_t HOST_CONV_WORKSPACE             = 64 * 1024 * 1024;
+
+// Batch size the algorithms are timed on
+static const int HOST_CONV_TUNE_BATCH               = 4;
+
+struct HostConvolutionShape
+{
+    int                     _batch;
+    int                     _inChannels;
+    int                     _outChannels;
+    int                     _in[HOST_CONV_DIM];
+    int                     _out[HOST_CONV_DIM];
+    int                     _filter[HOST_CONV_DIM];
+    int                     _pad[HOST_CONV_DIM];
+    int                     _stride[HOST_CONV_DIM];
+    int                     _upscale[HOST_CONV_DIM];
+    bool                    _bFlip;                 // CUDNN_CONVOLUTION mirrors the filter
+    int64_t                 _xStride[HOST_CONV_DIM + 2];
+    int64_t                 _yStride[HOST_CONV_DIM + 2];
+
+    int64_t FilterSize() const { return (int64_t)_filter[0] * _filter[1] * _filter[2]; }
+    int64_t Rows() const { return _inChannels * FilterSize(); }
+    int64_t InSize() const { return (int64_t)_in[0] * _in[1] * _in[2]; }
+    int64_t OutSize() const { return (int64_t)_out[0] * _out[1] * _out[2]; }
+
+    // Offset of filter tap f from the first input position of an output along dimension d
+    int TapOffset(int d, int f) const { return (_bFlip ? _filter[d] - 1 - f : f) * _upscale[d] - _pad[d]; }
+};
+
+// x is the input side of the convolution (x or dx) and y the output side (y or dy)
+static cudnnStatus_t GetConvolutionShape(const cudnnTensorDescriptor_t xDesc, const cudnnFilterDescriptor_t wDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                         const cudnnTensorDescriptor_t yDesc, HostConvolutionShape& shape)
+{
+    const int spatialDims                           = convDesc->_arrayLength;
+    if ((spatialDims > HOST_CONV_DIM) || (xDesc->_nbDims != spatialDims + 2) || (yDesc->_nbDims != spatialDims + 2) || (wDesc->_nbDims != spatialDims + 2))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    if ((xDesc->_dataType != CUDNN_DATA_FLOAT) || (yDesc->_dataType != CUDNN_DATA_FLOAT) || (wDesc->_dataType != CUDNN_DATA_FLOAT))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    if ((xDesc->_dim[0] != yDesc->_dim[0]) || (xDesc->_dim[1] != wDesc->_dim[1]) || (yDesc->_dim[1] != wDesc->_dim[0]))
+        return CUDNN_STATUS_BAD_PARAM;
+    shape._batch                                    = xDesc->_dim[0];
+    shape._inChannels                               = xDesc->_dim[1];
+    shape._outChannels                              = yDesc->_dim[1];
+    shape._bFlip                                    = (convDesc->_mode == CUDNN_CONVOLUTION);
+    shape._xStride[0]                               = xDesc->_stride[0];
+    shape._xStride[1]                               = xDesc->_stride[1];
+    shape._yStride[0]                               = yDesc->_stride[0];
+    shape._yStride[1]                               = yDesc->_stride[1];
+    for (int i = 0; i < HOST_CONV_DIM; i++)
+    {
+        int s                                       = i - (HOST_CONV_DIM - spatialDims);
+        bool bSpatial                               = (s >= 0);
+        shape._in[i]                                = bSpatial ? xDesc->_dim[s + 2] : 1;
+        shape._out[i]                               = bSpatial ? yDesc->_dim[s + 2] : 1;
+        shape._filter[i]                            = bSpatial ? wDesc->_dim[s + 2] : 1;
+        shape._pad[i]                               = bSpatial ? convDesc->_pad[s] : 0;
+        shape._stride[i]                            = bSpatial ? convDesc->_stride[s] : 1;
+        shape._upscale[i]                           = bSpatial ? convDesc->_upscale[s] : 1;
+        shape._xStride[i + 2]                       = bSpatial ? xDesc->_stride[s + 2] : 0;
+        shape._yStride[i + 2]                       = bSpatial ? yDesc->_stride[s + 2] : 0;
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Outputs [lo, hi) along dimension d whose tap at offset lands inside the input
+static inline void ConvolutionRange(const HostConvolutionShape& shape, int d, int offset, int& lo, int& hi)
+{
+    const int stride                                = shape._stride[d];
+    const int in                                    = shape._in[d];
+    lo                                              = (offset < 0) ? (-offset + stride - 1) / stride : 0;
+    hi                                              = (in - offset > 0) ? std::min(shape._out[d], (in - offset + stride - 1) / stride) : 0;
+    hi                                              = std::max(hi, lo);
+}
+
+// Images per GEMM pass that fit in workSpaceSizeInBytes, 0 if not even one does
+static int64_t ConvolutionChunk(const HostConvolutionShape& shape, size_t workSpaceSizeInBytes)
+{
+    size_t image                                    = (shape.Rows() + shape._outChannels) * shape.OutSize() * sizeof(float);
+    return std::min((int64_t)shape._batch, (int64_t)(workSpaceSizeInBytes / image));
+}
+
+static size_t ConvolutionGemmWorkspaceSize(const HostConvolutionShape& shape)
+{
+    size_t image                                    = (shape.Rows() + shape._outChannels) * shape.OutSize() * sizeof(float);
+    size_t images                                   = std::max((size_t)1, std::min((size_t)shape._batch, HOST_CONV_WORKSPACE / image));
+    return images * image;
+}
+
+// Unrolls images n0 to n0 + images - 1 of x into pCol, one row per (in channel, filter tap) and one
+// column per (image, output position)
+static void Im2Col(const HostConvolutionShape& shape, const float* pX, int64_t n0, int64_t images, float* pCol)
+{
+    const int64_t rows                              = shape.Rows();
+    const int64_t outSize                           = shape.OutSize();
+    const int64_t ld                                = images * outSize;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t task = 0; task < images * rows; task++)
+    {
+        int64_t image                               = task / rows;
+        int64_t row                                 = task % rows;
+        int f2                                      = row % shape._filter[2];
+        int f1                                      = (row / shape._filter[2]) % shape._filter[1];
+        int f0                                      = (row / (shape._filter[2] * shape._filter[1])) % shape._filter[0];
+        int64_t c                                   = row / shape.FilterSize();
+        int offset0                                 = shape.TapOffset(0, f0);
+        int offset1                                 = shape.TapOffset(1, f1);
+        int offset2                                 = shape.TapOffset(2, f2);
+        int lo2, hi2;
+        ConvolutionRange(shape, 2, offset2, lo2, hi2);
+        const float* pPlane                         = pX + (n0 + image) * shape._xStride[0] + c * shape._xStride[1];
+        float* pOut                                 = pCol + row * ld + image * outSize;
+        for (int od = 0; od < shape._out[0]; od++)
+        {
+            int id                                  = od * shape._stride[0] + offset0;
+            for (int oh = 0; oh < shape._out[1]; oh++, pOut += shape._out[2])
+            {
+                int ih                              = oh * shape._stride[1] + offset1;
+                if ((id < 0) || (id >= shape._in[0]) || (ih < 0) || (ih >= shape._in[1]))
+                {
+                    memset(pOut, 0, shape._out[2] * sizeof(float));
+                    continue;
+                }
+                const float* pRow                   = pPlane + id * shape._xStride[2] + ih * shape._xStride[3];
+                for (int ow = 0; ow < lo2; ow++)
+                    pOut[ow]                        = 0.0f;
+                for (int ow = lo2; ow < hi2; ow++)
+                    pOut[ow]                        = pRow[(ow * shape._stride[2] + offset2) * shape._xStride[4]];
+                for (int ow = hi2; ow < shape._out[2]; ow++)
+                    pOut[ow]                        = 0.0f;
+            }
+        }
+    }
+}
+
+
+// Offset of output row (od, oh) within an output plane
+static inline int64_t ConvolutionOutputRow(const HostConvolutionShape& shape, int od, int oh)
+{
+    return od * shape._yStride[2] + oh * shape._yStride[3];
+}
+
+// Copies dy of images n0 to n0 + images - 1 into pOut as [out channel][image][output position]
+static void GatherOutput(const HostConvolutionShape& shape, const float* pY, int64_t n0, int64_t images, float* pOut)
+{
+    const int64_t outSize                           = shape.OutSize();
+#pragma omp parallel for
+    for (int64_t task = 0; task < images * shape._outChannels; task++)
+    {
+        int64_t c                                   = task / images;
+        int64_t image                               = task % images;
+        const float* pPlane                         = pY + (n0 + image) * shape._yStride[0] + c * shape._yStride[1];
+        float* pDst                                 = pOut + task * outSize;
+        for (int od = 0; od < shape._out[0]; od++)
+        {
+            for (int oh = 0; oh < shape._out[1]; oh++, pDst += shape._out[2])
+            {
+                const float* pRow                   = pPlane + ConvolutionOutputRow(shape, od, oh);
+                for (int ow = 0; ow < shape._out[2]; ow++)
+                    pDst[ow]                        = pRow[ow * shape._yStride[4]];
+            }
+        }
+    }
+}
+
+// y = alpha * pOut + beta * y for images n0 to n0 + images - 1, pOut laid out as in GatherOutput
+static void ScatterOutput(const HostConvolutionShape& shape, const float* pOut, int64_t n0, int64_t images, float a, float b, float* pY)
+{
+    const int64_t outSize                           = shape.OutSize();
+#pragma omp parallel for
+    for (int64_t task = 0; task < images * shape._outChannels; task++)
+    {
+        int64_t c                                   = task / images;
+        int64_t image                               = task % images;
+        float* pPlane                               = pY + (n0 + image) * shape._yStride[0] + c * shape._yStride[1];
+        const float* pSrc                           = pOut + task * outSize;
+        for (int od = 0; od < shape._out[0]; od++)
+        {
+            for (int oh = 0; oh < shape._out[1]; oh++, pSrc += shape._out[2])
+            {
+                float* pRow                         = pPlane + ConvolutionOutputRow(shape, od, oh);
+                for (int ow = 0; ow < shape._out[2]; ow++)
+                {
+                    float& out                      = pRow[ow * shape._yStride[4]];
+                    out                             = (b == 0.0f) ? a * pSrc[ow] : a * pSrc[ow] + b * out;
+                }
+            }
+        }
+    }
+}
+
+// dx = alpha * (pCol folded back onto the input) + beta * dx, the inverse of Im2Col.  Each task
+// owns one input plane so overlapping filter taps never race
+static void Col2Im(const HostConvolutionShape& shape, const float* pCol, int64_t n0, int64_t images, float a, float b, float* pX)
+{
+    const int64_t filterSize                        = shape.FilterSize();
+    const int64_t outSize                           = shape.OutSize();
+    const int64_t ld                                = images * outSize;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t task = 0; task < images * shape._inChannels; task++)
+    {
+        int64_t image                               = task / shape._inChannels;
+        int64_t c                                   = task % shape._inChannels;
+        float* pPlane                               = pX + (n0 + image) * shape._xStride[0] + c * shape._xStride[1];
+        for (int d = 0; d < shape._in[0]; d++)
+        {
+            for (int h = 0; h < shape._in[1]; h++)
+            {
+                float* pRow                         = pPlane + d * shape._xStride[2] + h * shape._xStride[3];
+                for (int w = 0; w < shape._in[2]; w++)
+                    pRow[w * shape._xStride[4]]     = (b == 0.0f) ? 0.0f : b * pRow[w * shape._xStride[4]];
+            }
+        }
+
+        for (int64_t tap = 0; tap < filterSize; tap++)
+        {
+            int f2                                  = tap % shape._filter[2];
+            int f1                                  = (tap / shape._filter[2]) % shape._filter[1];
+            int f0                                  = tap / (shape._filter[2] * shape._filter[1]);
+            int offset0                             = shape.TapOffset(0, f0);
+            int offset1                             = shape.TapOffset(1, f1);
+            int offset2                             = shape.TapOffset(2, f2);
+            int lo0, hi0, lo1, hi1, lo2, hi2;
+            ConvolutionRange(shape, 0, offset0, lo0, hi0);
+            ConvolutionRange(shape, 1, offset1, lo1, hi1);
+            ConvolutionRange(shape, 2, offset2, lo2, hi2);
+            const float* pSrc                       = pCol + (c * filterSize + tap) * ld + image * outSize;
+            for (int od = lo0; od < hi0; od++)
+            {
+                int id                              = od * shape._stride[0] + offset0;
+                for (int oh = lo1; oh < hi1; oh++)
+                {
+                    int ih                          = oh * shape._stride[1] + offset1;
+                    float* pRow                     = pPlane + id * shape._xStride[2] + ih * shape._xStride[3];
+                    const float* pIn                = pSrc + (od * shape._out[1] + oh) * shape._out[2];
+                    for (int ow = lo2; ow < hi2; ow++)
+                        pRow[(ow * shape._stride[2] + offset2) * shape._xStride[4]] += a * pIn[ow];
+                }
+            }
+        }
+    }
+}
+
+// im2col + GEMM, chunk images at a time.  The GEMM itself is blocked and threaded by cblas
+static void ConvolutionForwardGemm(const HostConvolutionShape& shape, float a, const float* pX, const float* pW, float b, float* pY, float* pWork, int64_t chunk)
+{
+    const int64_t rows                              = shape.Rows();
+    for (int64_t n0 = 0; n0 < shape._batch; n0 += chunk)
+    {
+        int64_t images                              = std::min(chunk, shape._batch - n0);
+        int64_t ld                                  = images * shape.OutSize();
+        float* pCol                                 = pWork;
+        float* pOut                                 = pWork + rows * ld;
+        Im2Col(shape, pX, n0, images, pCol);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, shape._outChannels, ld, rows, 1.0f, pW, rows, pCol, ld, 0.0f, pOut, ld);
+        ScatterOutput(shape, pOut, n0, images, a, b, pY);
+    }
+}
+
+static void ConvolutionBackwardFilterGemm(const HostConvolutionShape& shape, float a, const float* pX, const float* pDy, float b, float* pDw, float* pWork, int64_t chunk)
+{
+    const int64_t rows                              = shape.Rows();
+    for (int64_t n0 = 0; n0 < shape._batch; n0 += chunk)
+    {
+        int64_t images                              = std::min(chunk, shape._batch - n0);
+        int64_t ld                                  = images * shape.OutSize();
+        float* pCol                                 = pWork;
+        float* pOut                                 = pWork + rows * ld;
+        Im2Col(shape, pX, n0, images, pCol);
+        GatherOutput(shape, pDy, n0, images, pOut);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, shape._outChannels, rows, ld, a, pOut, ld, pCol, ld, (n0 == 0) ? b : 1.0f, pDw, rows);
+    }
+}
+
+static void ConvolutionBackwardDataGemm(const HostConvolutionShape& shape, float a, const float* pW, const float* pDy, float b, float* pDx, float* pWork, int64_t chunk)
+{
+    const int64_t rows                              = shape.Rows();
+    for (int64_t n0 = 0; n0 < shape._batch; n0 += chunk)
+    {
+        int64_t images                              = std::min(chunk, shape._batch - n0);
+        int64_t ld                                  = images * shape.OutSize();
+        float* pCol                                 = pWork;
+        float* pOut                                 = pWork + rows * ld;
+        GatherOutput(shape, pDy, n0, images, pOut);
+        cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, rows, ld, shape._outChannels, 1.0f, pW, rows, pOut, ld, 0.0f, pCol, ld);
+        Col2Im(shape, pCol, n0, images, a, b, pDx);
+    }
+}
+
+// Direct convolution, one output plane per task.  Every filter tap is a scaled add of an input row
+// into an output row, which vectorizes for unit strides
+static void ConvolutionForwardDirect(const HostConvolutionShape& shape, float a, const float* pX, const float* pW, float b, float* pY)
+{
+    const int64_t filterSize                        = shape.FilterSize();
+    const int64_t outSize                           = shape.OutSize();
+#pragma omp parallel
+    {
+        std::vector<float> vAcc(outSize);
+#pragma omp for schedule(dynamic, 1)
+        for (int64_t task = 0; task < (int64_t)shape._batch * shape._outChannels; task++)
+        {
+            int64_t n                               = task / shape._outChannels;
+            int64_t k                               = task % shape._outChannels;
+            float* pAcc                             = vAcc.data();
+            memset(pAcc, 0, outSize * sizeof(float));
+            for (int64_t c = 0; c < shape._inChannels; c++)
+            {
+                const float* pPlane                 = pX + n * shape._xStride[0] + c * shape._xStride[1];
+                const float* pFilter                = pW + (k * shape._inChannels + c) * filterSize;
+                for (int64_t tap = 0; tap < filterSize; tap++)
+                {
+                    int f2                          = tap % shape._filter[2];
+                    int f1                          = (tap / shape._filter[2]) % shape._filter[1];
+                    int f0                          = tap / (shape._filter[2] * shape._filter[1]);
+                    int offset0                     = shape.TapOffset(0, f0);
+                    int offset1                     = shape.TapOffset(1, f1);
+                    int offset2                     = shape.TapOffset(2, f2);
+                    int lo0, hi0, lo1, hi1, lo2, hi2;
+                    ConvolutionRange(shape, 0, offset0, lo0, hi0);
+                    ConvolutionRange(shape, 1, offset1, lo1, hi1);
+                    ConvolutionRange(shape, 2, offset2, lo2, hi2);
+                    const float w                   = pFilter[tap];
+                    const bool bUnit                = (shape._stride[2] == 1) && (shape._xStride[4] == 1);
+                    for (int od = lo0; od < hi0; od++)
+                    {
+                        int id                      = od * shape._stride[0] + offset0;
+                        for (int oh = lo1; oh < hi1; oh++)
+                        {
+                            int ih                  = oh * shape._stride[1] + offset1;
+                            const float* pRow       = pPlane + id * shape._xStride[2] + ih * shape._xStride[3];
+                            float* pOut             = pAcc + (od * shape._out[1] + oh) * shape._out[2];
+                            if (bUnit)
+                            {
+                                const float* pIn    = pRow + offset2;
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    pOut[ow]       += w * pIn[ow];
+                            }
+                            else
+                            {
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    pOut[ow]       += w * pRow[(ow * shape._stride[2] + offset2) * shape._xStride[4]];
+                            }
+                        }
+                    }
+                }
+            }
+
+            float* pPlane                           = pY + n * shape._yStride[0] + k * shape._yStride[1];
+            for (int od = 0; od < shape._out[0]; od++)
+            {
+                for (int oh = 0; oh < shape._out[1]; oh++)
+                {
+                    float* pRow                     = pPlane + ConvolutionOutputRow(shape, od, oh);
+                    const float* pSrc               = pAcc + (od * shape._out[1] + oh) * shape._out[2];
+                    for (int ow = 0; ow < shape._out[2]; ow++)
+                    {
+                        float& out                  = pRow[ow * shape._yStride[4]];
+                        out                         = (b == 0.0f) ? a * pSrc[ow] : a * pSrc[ow] + b * out;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// One filter slice (out channel, in channel) per task, so the weight gradient needs no reduction
+// across threads
+static void ConvolutionBackwardFilterDirect(const HostConvolutionShape& shape, float a, const float* pX, const float* pDy, float b, float* pDw)
+{
+    const int64_t filterSize                        = shape.FilterSize();
+#pragma omp parallel
+    {
+        std::vector<double> vSum(filterSize);
+#pragma omp for schedule(dynamic, 1)
+        for (int64_t task = 0; task < (int64_t)shape._outChannels * shape._inChannels; task++)
+        {
+            int64_t k                               = task / shape._inChannels;
+            int64_t c                               = task % shape._inChannels;
+            std::fill(vSum.begin(), vSum.end(), 0.0);
+            for (int64_t n = 0; n < shape._batch; n++)
+            {
+                const float* pPlane                 = pX + n * shape._xStride[0] + c * shape._xStride[1];
+                const float* pDyPlane               = pDy + n * shape._yStride[0] + k * shape._yStride[1];
+                for (int64_t tap = 0; tap < filterSize; tap++)
+                {
+                    int f2                          = tap % shape._filter[2];
+                    int f1                          = (tap / shape._filter[2]) % shape._filter[1];
+                    int f0                          = tap / (shape._filter[2] * shape._filter[1]);
+                    int offset0                     = shape.TapOffset(0, f0);
+                    int offset1                     = shape.TapOffset(1, f1);
+                    int offset2                     = shape.TapOffset(2, f2);
+                    int lo0, hi0, lo1, hi1, lo2, hi2;
+                    ConvolutionRange(shape, 0, offset0, lo0, hi0);
+                    ConvolutionRange(shape, 1, offset1, lo1, hi1);
+                    ConvolutionRange(shape, 2, offset2, lo2, hi2);
+                    const bool bUnit                = (shape._stride[2] == 1) && (shape._xStride[4] == 1) && (shape._yStride[4] == 1);
+                    float sum                       = 0.0f;
+                    for (int od = lo0; od < hi0; od++)
+                    {
+                        int id                      = od * shape._stride[0] + offset0;
+                        for (int oh = lo1; oh < hi1; oh++)
+                        {
+                            int ih                  = oh * shape._stride[1] + offset1;
+                            const float* pRow       = pPlane + id * shape._xStride[2] + ih * shape._xStride[3];
+                            const float* pDyRow     = pDyPlane + ConvolutionOutputRow(shape, od, oh);
+                            if (bUnit)
+                            {
+                                const float* pIn    = pRow + offset2;
+#pragma omp simd reduction(+:sum)
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    sum            += pDyRow[ow] * pIn[ow];
+                            }
+                            else
+                            {
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    sum            += pDyRow[ow * shape._yStride[4]] * pRow[(ow * shape._stride[2] + offset2) * shape._xStride[4]];
+                            }
+                        }
+                    }
+                    vSum[tap]                      += sum;
+                }
+            }
+
+            float* pFilter                          = pDw + (k * shape._inChannels + c) * filterSize;
+            for (int64_t tap = 0; tap < filterSize; tap++)
+                pFilter[tap]                        = (b == 0.0f) ? a * (float)vSum[tap] : a * (float)vSum[tap] + b * pFilter[tap];
+        }
+    }
+}
+
+// One input plane per task, each filter tap scatters a scaled output row back onto an input row
+static void ConvolutionBackwardDataDirect(const HostConvolutionShape& shape, float a, const float* pW, const float* pDy, float b, float* pDx)
+{
+    const int64_t filterSize                        = shape.FilterSize();
+    const int64_t inSize                            = shape.InSize();
+#pragma omp parallel
+    {
+        std::vector<float> vAcc(inSize);
+#pragma omp for schedule(dynamic, 1)
+        for (int64_t task = 0; task < (int64_t)shape._batch * shape._inChannels; task++)
+        {
+            int64_t n                               = task / shape._inChannels;
+            int64_t c                               = task % shape._inChannels;
+            float* pAcc                             = vAcc.data();
+            memset(pAcc, 0, inSize * sizeof(float));
+            for (int64_t k = 0; k < shape._outChannels; k++)
+            {
+                const float* pDyPlane               = pDy + n * shape._yStride[0] + k * shape._yStride[1];
+                const float* pFilter                = pW + (k * shape._inChannels + c) * filterSize;
+                for (int64_t tap = 0; tap < filterSize; tap++)
+                {
+                    int f2                          = tap % shape._filter[2];
+                    int f1                          = (tap / shape._filter[2]) % shape._filter[1];
+                    int f0                          = tap / (shape._filter[2] * shape._filter[1]);
+                    int offset0                     = shape.TapOffset(0, f0);
+                    int offset1                     = shape.TapOffset(1, f1);
+                    int offset2                     = shape.TapOffset(2, f2);
+                    int lo0, hi0, lo1, hi1, lo2, hi2;
+                    ConvolutionRange(shape, 0, offset0, lo0, hi0);
+                    ConvolutionRange(shape, 1, offset1, lo1, hi1);
+                    ConvolutionRange(shape, 2, offset2, lo2, hi2);
+                    const float w                   = pFilter[tap];
+                    for (int od = lo0; od < hi0; od++)
+                    {
+                        int id                      = od * shape._stride[0] + offset0;
+                        for (int oh = lo1; oh < hi1; oh++)
+                        {
+                            int ih                  = oh * shape._stride[1] + offset1;
+                            const float* pDyRow     = pDyPlane + ConvolutionOutputRow(shape, od, oh);
+                            float* pIn              = pAcc + (id * shape._in[1] + ih) * shape._in[2] + offset2;
+                            if ((shape._stride[2] == 1) && (shape._yStride[4] == 1))
+                            {
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    pIn[ow]        += w * pDyRow[ow];
+                            }
+                            else
+                            {
+                                for (int ow = lo2; ow < hi2; ow++)
+                                    pIn[ow * shape._stride[2]] += w * pDyRow[ow * shape._yStride[4]];
+                            }
+                        }
+                    }
+                }
+            }
+
+            float* pPlane                           = pDx + n * shape._xStride[0] + c * shape._xStride[1];
+            for (int d = 0; d < shape._in[0]; d++)
+            {
+                for (int h = 0; h < shape._in[1]; h++)
+                {
+                    float* pRow                     = pPlane + d * shape._xStride[2] + h * shape._xStride[3];
+                    const float* pSrc               = pAcc + (d * shape._in[1] + h) * shape._in[2];
+                    for (int w = 0; w < shape._in[2]; w++)
+                    {
+                        float& out                  = pRow[w * shape._xStride[4]];
+                        out                         = (b == 0.0f) ? a * pSrc[w] : a * pSrc[w] + b * out;
+                    }
+                }
+            }
+        }
+    }
+}
+
+enum HostConvolutionPass
+{
+    HostConvolutionForward,
+    HostConvolutionBackwardFilter,
+    HostConvolutionBackwardData,
+};
+
+// Runs one pass with x, w and y in their forward roles (dx, dw and dy for the backward passes),
+// falling back to direct convolution if the workspace cannot hold a single image
+static void RunConvolution(HostConvolutionPass pass, bool bGemm, const HostConvolutionShape& shape, float a, float b, float* pX, float* pW, float* pY, void* workSpace, size_t workSpaceSizeInBytes)
+{
+    int64_t chunk                                   = bGemm ? ConvolutionChunk(shape, workSpaceSizeInBytes) : 0;
+    switch (pass)
+    {
+        case HostConvolutionForward:
+            if (chunk > 0)
+                ConvolutionForwardGemm(shape, a, pX, pW, b, pY, (float*)workSpace, chunk);
+            else
+                ConvolutionForwardDirect(shape, a, pX, pW, b, pY);
+            break;
+
+        case HostConvolutionBackwardFilter:
+            if (chunk > 0)
+                ConvolutionBackwardFilterGemm(shape, a, pX, pY, b, pW, (float*)workSpace, chunk);
+            else
+                ConvolutionBackwardFilterDirect(shape, a, pX, pY, b, pW);
+            break;
+
+        case HostConvolutionBackwardData:
+            if (chunk > 0)
+                ConvolutionBackwardDataGemm(shape, a, pW, pY, b, pX, (float*)workSpace, chunk);
+            else
+                ConvolutionBackwardDataDirect(shape, a, pW, pY, b, pX);
+            break;
+    }
+}
+
+// Times both algorithms on a few images of the layer's shape, true if im2col + GEMM wins
+static bool TuneConvolution(HostConvolutionPass pass, const HostConvolutionShape& layerShape)
+{
+    HostConvolutionShape shape                      = layerShape;
+    shape._batch                                    = std::min(shape._batch, HOST_CONV_TUNE_BATCH);
+    shape._xStride[4]                               = 1;
+    shape._yStride[4]                               = 1;
+    shape._xStride[3]                               = shape._in[2];
+    shape._xStride[2]                               = shape._in[2] * shape._in[1];
+    shape._xStride[1]                               = shape.InSize();
+    shape._xStride[0]                               = shape.InSize() * shape._inChannels;
+    shape._yStride[3]                               = shape._out[2];
+    shape._yStride[2]                               = shape._out[2] * shape._out[1];
+    shape._yStride[1]                               = shape.OutSize();
+    shape._yStride[0]                               = shape.OutSize() * shape._outChannels;
+
+    std::vector<float> vX(shape._batch * shape._xStride[0]);
+    std::vector<float> vW(shape._outChannels * shape.Rows());
+    std::vector<float> vY(shape._batch * shape._yStride[0]);
+    std::vector<float> vWork(ConvolutionGemmWorkspaceSize(shape) / sizeof(float));
+    for (size_t i = 0; i < vX.size(); i++)
+        vX[i]                                       = (float)(i % 17) * 0.0625f - 0.5f;
+    for (size_t i = 0; i < vW.size(); i++)
+        vW[i]                                       = (float)(i % 13) * 0.0625f - 0.375f;
+    for (size_t i = 0; i < vY.size(); i++)
+        vY[i]                                       = (float)(i % 11) * 0.0625f - 0.3125f;
+
+    double time[2];
+    for (int algo = 0; algo < 2; algo++)
+    {
+        time[algo]                                  = std::numeric_limits<double>::max();
+        for (int run = 0; run < 2; run++)
+        {
+            double start                            = omp_get_wtime();
+            RunConvolution(pass, algo == 1, shape, 1.0f, 0.0f, vX.data(), vW.data(), vY.data(), vWork.data(), vWork.size() * sizeof(float));
+            time[algo]                              = std::min(time[algo], omp_get_wtime() - start);
+        }
+    }
+    return time[1] < time[0];
+}
+
+// Picks im2col + GEMM or direct convolution for one pass over a layer shape.  Direct convolution is
+// only a candidate for small filters, the winner of a one-time timing run is cached per shape.
+// DSSTNE_HOST_CONV=gemm or direct forces either one for testing and benchmarking
+static bool UseConvolutionGemm(HostConvolutionPass pass, const HostConvolutionShape& shape)
+{
+    const char* pAlgo                               = getenv("DSSTNE_HOST_CONV");
+    if (pAlgo)
+        return strcmp(pAlgo, "direct") != 0;
+    if (shape.FilterSize() > HOST_CONV_DIRECT_MAX_FILTER)
+        return true;
+
+    static std::map<std::vector<int>, bool> sAlgorithm;
+    std::vector<int> vKey;
+    vKey.push_back(pass);
+    vKey.push_back(shape._inChannels);
+    vKey.push_back(shape._outChannels);
+    vKey.push_back(shape._bFlip);
+    for (int i = 0; i < HOST_CONV_DIM; i++)
+    {
+        vKey.push_back(shape._in[i]);
+        vKey.push_back(shape._out[i]);
+        vKey.push_back(shape._filter[i]);
+        vKey.push_back(shape._pad[i]);
+        vKey.push_back(shape._stride[i]);
+        vKey.push_back(shape._upscale[i]);
+    }
+    std::map<std::vector<int>, bool>::iterator it   = sAlgorithm.find(vKey);
+    if (it != sAlgorithm.end())
+        return it->second;
+    bool bGemm                                      = TuneConvolution(pass, shape);
+    sAlgorithm[vKey]                                = bGemm;
+    return bGemm;
+}
+
+cudnnStatus_t cudnnGetConvolutionForwardAlgorithm(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnFilterDescriptor_t wDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                  const cudnnTensorDescriptor_t yDesc, cudnnConvolutionFwdPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionFwdAlgo_t* algo)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, wDesc, convDesc, yDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *algo                                           = UseConvolutionGemm(HostConvolutionForward, shape) ? CUDNN_CONVOLUTION_FWD_ALGO_GEMM : CUDNN_CONVOLUTION_FWD_ALGO_DIRECT;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionForwardWorkspaceSize(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnFilterDescriptor_t wDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                      const cudnnTensorDescriptor_t yDesc, cudnnConvolutionFwdAlgo_t algo, size_t* sizeInBytes)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, wDesc, convDesc, yDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *sizeInBytes                                    = (algo == CUDNN_CONVOLUTION_FWD_ALGO_GEMM) ? ConvolutionGemmWorkspaceSize(shape) : 0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionBackwardFilterAlgorithm(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                         const cudnnFilterDescriptor_t dwDesc, cudnnConvolutionBwdFilterPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionBwdFilterAlgo_t* algo)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, dwDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *algo                                           = UseConvolutionGemm(HostConvolutionBackwardFilter, shape) ? CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1 : CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionBackwardFilterWorkspaceSize(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                             const cudnnFilterDescriptor_t gradDesc, cudnnConvolutionBwdFilterAlgo_t algo, size_t* sizeInBytes)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, gradDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *sizeInBytes                                    = (algo == CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1) ? ConvolutionGemmWorkspaceSize(shape) : 0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionBackwardDataAlgorithm(cudnnHandle_t handle, const cudnnFilterDescriptor_t wDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                       const cudnnTensorDescriptor_t dxDesc, cudnnConvolutionBwdDataPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionBwdDataAlgo_t* algo)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(dxDesc, wDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *algo                                           = UseConvolutionGemm(HostConvolutionBackwardData, shape) ? CUDNN_CONVOLUTION_BWD_DATA_ALGO_1 : CUDNN_CONVOLUTION_BWD_DATA_ALGO_0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+cudnnStatus_t cudnnGetConvolutionBackwardDataWorkspaceSize(cudnnHandle_t handle, const cudnnFilterDescriptor_t wDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                           const cudnnTensorDescriptor_t dxDesc, cudnnConvolutionBwdDataAlgo_t algo, size_t* sizeInBytes)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(dxDesc, wDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    *sizeInBytes                                    = (algo == CUDNN_CONVOLUTION_BWD_DATA_ALGO_1) ? ConvolutionGemmWorkspaceSize(shape) : 0;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// y = alpha * conv(x, w) + beta * y
+cudnnStatus_t cudnnConvolutionForward(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x, const cudnnFilterDescriptor_t wDesc, const void* w,
+                                      const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionFwdAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                      const void* beta, const cudnnTensorDescriptor_t yDesc, void* y)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, wDesc, convDesc, yDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    RunConvolution(HostConvolutionForward, algo == CUDNN_CONVOLUTION_FWD_ALGO_GEMM, shape, *(const float*)alpha, *(const float*)beta,
+                   (float*)x, (float*)w, (float*)y, workSpace, workSpaceSizeInBytes);
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// dw = alpha * sum over the batch of the correlation of x with dy + beta * dw
+cudnnStatus_t cudnnConvolutionBackwardFilter(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x, const cudnnTensorDescriptor_t dyDesc, const void* dy,
+                                             const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionBwdFilterAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                             const void* beta, const cudnnFilterDescriptor_t dwDesc, void* dw)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(xDesc, dwDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    RunConvolution(HostConvolutionBackwardFilter, algo == CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1, shape, *(const float*)alpha, *(const float*)beta,
+                   (float*)x, (float*)dw, (float*)dy, workSpace, workSpaceSizeInBytes);
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// dx = alpha * (dy convolved back through w) + beta * dx
+cudnnStatus_t cudnnConvolutionBackwardData(cudnnHandle_t handle, const void* alpha, const cudnnFilterDescriptor_t wDesc, const void* w, const cudnnTensorDescriptor_t dyDesc, const void* dy,
+                                           const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionBwdDataAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                           const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx)
+{
+    HostConvolutionShape shape;
+    cudnnStatus_t status                            = GetConvolutionShape(dxDesc, wDesc, convDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    RunConvolution(HostConvolutionBackwardData, algo == CUDNN_CONVOLUTION_BWD_DATA_ALGO_1, shape, *(const float*)alpha, *(const float*)beta,
+                   (float*)dx, (float*)w, (float*)dy, workSpace, workSpaceSizeInBytes);
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Pooling and LRN work on one [depth][height][width] plane at a time, the leading tensor dimensions
+// (batch, channels) just enumerate planes.  1D and 2D pooling are padded out to 3D with unit windows
+static const int HOST_POOLING_DIM                   = 3;
+
+struct HostPoolingShape
+{
+    int                     _planeDims;
+    int64_t                 _planes;
+    int                     _in[HOST_POOLING_DIM];
+    int                     _out[HOST_POOLING_DIM];
+    int                     _window[HOST_POOLING_DIM];
+    int                     _padding[HOST_POOLING_DIM];
+    int                     _stride[HOST_POOLING_DIM];
+};
+
+static cudnnStatus_t GetPoolingShape(const cudnnPoolingDescriptor_t poolingDesc, const cudnnTensorDescriptor_t xDesc, const cudnnTensorDescriptor_t yDesc, HostPoolingShape& shape)
+{
+    const int spatialDims                           = poolingDesc->_nbDims;
+    if ((spatialDims > HOST_POOLING_DIM) || (xDesc->_nbDims != yDesc->_nbDims) || (xDesc->_nbDims <= spatialDims))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    if ((xDesc->_dataType != CUDNN_DATA_FLOAT) || (yDesc->_dataType != CUDNN_DATA_FLOAT))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    shape._planeDims                                = xDesc->_nbDims - spatialDims;
+    shape._planes                                   = 1;
+    for (int i = 0; i < shape._planeDims; i++)
+    {
+        if (xDesc->_dim[i] != yDesc->_dim[i])
+            return CUDNN_STATUS_BAD_PARAM;
+        shape._planes                              *= xDesc->_dim[i];
+    }
+    for (int i = 0; i < HOST_POOLING_DIM; i++)
+    {
+        int s                                       = i - (HOST_POOLING_DIM - spatialDims);
+        bool bSpatial                               = (s >= 0);
+        shape._in[i]                                = bSpatial ? xDesc->_dim[shape._planeDims + s] : 1;
+        shape._out[i]                               = bSpatial ? yDesc->_dim[shape._planeDims + s] : 1;
+        shape._window[i]                            = bSpatial ? poolingDesc->_window[s] : 1;
+        shape._padding[i]                           = bSpatial ? poolingDesc->_padding[s] : 0;
+        shape._stride[i]                            = bSpatial ? poolingDesc->_stride[s] : 1;
+        if ((shape._window[i] < 1) || (shape._stride[i] < 1))
+            return CUDNN_STATUS_BAD_PARAM;
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Strides of the pooled dimensions of a tensor, unit windows get a stride of 0
+static void GetPoolingStrides(const cudnnTensorDescriptor_t desc, const HostPoolingShape& shape, int64_t* pStride)
+{
+    const int spatialDims                           = desc->_nbDims - shape._planeDims;
+    for (int i = 0; i < HOST_POOLING_DIM; i++)
+    {
+        int s                                       = i - (HOST_POOLING_DIM - spatialDims);
+        pStride[i]                                  = (s >= 0) ? desc->_stride[shape._planeDims + s] : 0;
+    }
+}
+
+// Window of output position o along dimension d, clipped to the unpadded input
+static inline void PoolingWindow(const HostPoolingShape& shape, int d, int o, int& lo, int& hi)
+{
+    int start                                       = o * shape._stride[d] - shape._padding[d];
+    lo                                              = std::max(start, 0);
+    hi                                              = std::min(start + shape._window[d], shape._in[d]);
+}
+
+// Position of the first maximum of the window (for NaN propagation, the first NaN), ties go to the
+// lowest position exactly as in cuDNN.  Returns false if the window lies entirely in the padding
+static inline bool PoolingArgMax(const float* pX, const int64_t* pXStride, const int* lo, const int* hi, int* pos, float& maximum)
+{
+    bool bFound                                     = false;
+    maximum                                         = -std::numeric_limits<float>::infinity();
+    for (int d = lo[0]; d < hi[0]; d++)
+    {
+        for (int h = lo[1]; h < hi[1]; h++)
+        {
+            const float* pRow                       = pX + d * pXStride[0] + h * pXStride[1];
+            for (int w = lo[2]; w < hi[2]; w++)
+            {
+                float v                             = pRow[w * pXStride[2]];
+                if (!bFound || (v > maximum) || ((v != v) && (maximum == maximum)))
+                {
+                    maximum                         = v;
+                    pos[0]                          = d;
+                    pos[1]                          = h;
+                    pos[2]                          = w;
+                    bFound                          = true;
+                }
+            }
+        }
+    }
+    return bFound;
+}
+
+static inline int PoolingCount(const HostPoolingShape& shape, cudnnPoolingMode_t mode, const int* lo, const int* hi)
+{
+    if (mode == CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING)
+        return shape._window[0] * shape._window[1] * shape._window[2];
+    return (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+}
+
+// y = alpha * pool(x) + beta * y, one plane per task so every thread streams through its own input
+cudnnStatus_t cudnnPoolingForward(cudnnHandle_t handle, const cudnnPoolingDescriptor_t poolingDesc, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                  const void* beta, const cudnnTensorDescriptor_t yDesc, void* y)
+{
+    HostPoolingShape shape;
+    cudnnStatus_t status                            = GetPoolingShape(poolingDesc, xDesc, yDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    int64_t xStride[HOST_POOLING_DIM];
+    int64_t yStride[HOST_POOLING_DIM];
+    GetPoolingStrides(xDesc, shape, xStride);
+    GetPoolingStrides(yDesc, shape, yStride);
+
+    const cudnnPoolingMode_t mode                   = poolingDesc->_mode;
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t plane = 0; plane < shape._planes; plane++)
+    {
+        const float* pX                             = (const float*)x + TensorOffset(plane, shape._planeDims, xDesc->_dim, xDesc->_stride);
+        float* pY                                   = (float*)y + TensorOffset(plane, shape._planeDims, yDesc->_dim, yDesc->_stride);
+        int lo[HOST_POOLING_DIM], hi[HOST_POOLING_DIM];
+        for (int od = 0; od < shape._out[0]; od++)
+        {
+            PoolingWindow(shape, 0, od, lo[0], hi[0]);
+            for (int oh = 0; oh < shape._out[1]; oh++)
+            {
+                PoolingWindow(shape, 1, oh, lo[1], hi[1]);
+                for (int ow = 0; ow < shape._out[2]; ow++)
+                {
+                    PoolingWindow(shape, 2, ow, lo[2], hi[2]);
+                    float v;
+                    if (mode == CUDNN_POOLING_MAX)
+                    {
+                        int pos[HOST_POOLING_DIM];
+                        PoolingArgMax(pX, xStride, lo, hi, pos, v);
+                    }
+                    else
+                    {
+                        float sum                   = 0.0f;
+                        for (int d = lo[0]; d < hi[0]; d++)
+                        {
+                            for (int h = lo[1]; h < hi[1]; h++)
+                            {
+                                const float* pRow   = pX + d * xStride[0] + h * xStride[1];
+                                for (int w = lo[2]; w < hi[2]; w++)
+                                    sum            += pRow[w * xStride[2]];
+                            }
+                        }
+                        int count                   = PoolingCount(shape, mode, lo, hi);
+                        v                           = (count > 0) ? sum / (float)count : 0.0f;
+                    }
+                    float& out                      = pY[od * yStride[0] + oh * yStride[1] + ow * yStride[2]];
+                    out                             = (b == 0.0f) ? a * v : a * v + b * out;
+                }
+            }
+        }
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// dx = alpha * (dy routed back through the pooling windows) + beta * dx.  Max pooling sends each
+// delta to the first maximum of its window, recomputed from x, average pooling spreads it evenly
+cudnnStatus_t cudnnPoolingBackward(cudnnHandle_t handle, const cudnnPoolingDescriptor_t poolingDesc, const void* alpha, const cudnnTensorDescriptor_t yDesc, const void* y,
+                                   const cudnnTensorDescriptor_t dyDesc, const void* dy, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                   const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx)
+{
+    HostPoolingShape shape;
+    cudnnStatus_t status                            = GetPoolingShape(poolingDesc, xDesc, dyDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    if ((dxDesc->_nbDims != xDesc->_nbDims) || (dxDesc->_dataType != CUDNN_DATA_FLOAT))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    int64_t xStride[HOST_POOLING_DIM];
+    int64_t dxStride[HOST_POOLING_DIM];
+    int64_t dyStride[HOST_POOLING_DIM];
+    GetPoolingStrides(xDesc, shape, xStride);
+    GetPoolingStrides(dxDesc, shape, dxStride);
+    GetPoolingStrides(dyDesc, shape, dyStride);
+
+    const cudnnPoolingMode_t mode                   = poolingDesc->_mode;
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t plane = 0; plane < shape._planes; plane++)
+    {
+        const float* pX                             = (const float*)x + TensorOffset(plane, shape._planeDims, xDesc->_dim, xDesc->_stride);
+        const float* pDy                            = (const float*)dy + TensorOffset(plane, shape._planeDims, dyDesc->_dim, dyDesc->_stride);
+        float* pDx                                  = (float*)dx + TensorOffset(plane, shape._planeDims, dxDesc->_dim, dxDesc->_stride);
+
+        // Scale the old deltas first, then accumulate the gradient of every window on top
+        for (int d = 0; d < shape._in[0]; d++)
+        {
+            for (int h = 0; h < shape._in[1]; h++)
+            {
+                float* pRow                         = pDx + d * dxStride[0] + h * dxStride[1];
+                for (int w = 0; w < shape._in[2]; w++)
+                    pRow[w * dxStride[2]]           = (b == 0.0f) ? 0.0f : b * pRow[w * dxStride[2]];
+            }
+        }
+
+        int lo[HOST_POOLING_DIM], hi[HOST_POOLING_DIM];
+        for (int od = 0; od < shape._out[0]; od++)
+        {
+            PoolingWindow(shape, 0, od, lo[0], hi[0]);
+            for (int oh = 0; oh < shape._out[1]; oh++)
+            {
+                PoolingWindow(shape, 1, oh, lo[1], hi[1]);
+                for (int ow = 0; ow < shape._out[2]; ow++)
+                {
+                    PoolingWindow(shape, 2, ow, lo[2], hi[2]);
+                    float delta                     = a * pDy[od * dyStride[0] + oh * dyStride[1] + ow * dyStride[2]];
+                    if (mode == CUDNN_POOLING_MAX)
+                    {
+                        float maximum;
+                        int pos[HOST_POOLING_DIM];
+                        if (PoolingArgMax(pX, xStride, lo, hi, pos, maximum))
+                            pDx[pos[0] * dxStride[0] + pos[1] * dxStride[1] + pos[2] * dxStride[2]] += delta;
+                    }
+                    else
+                    {
+                        int count                   = PoolingCount(shape, mode, lo, hi);
+                        if (count == 0)
+                            continue;
+                        delta                      /= (float)count;
+                        for (int d = lo[0]; d < hi[0]; d++)
+                        {
+                            for (int h = lo[1]; h < hi[1]; h++)
+                            {
+                                float* pRow         = pDx + d * dxStride[0] + h * dxStride[1];
+                                for (int w = lo[2]; w < hi[2]; w++)
+                                    pRow[w * dxStride[2]] += delta;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Cross channel LRN runs on blocks of adjacent spatial positions so each channel step touches one
+// contiguous run per tensor, with a running sum over the channel window
+static const int64_t HOST_LRN_BLOCK                 = 64;
+
+struct HostLRNShape
+{
+    int64_t                 _batch;
+    int64_t                 _channels;
+    int64_t                 _spatial;
+    int64_t                 _blocks;
+    int                     _lo;                    // Channels before the center of the window
+    int                     _hi;                    // Channels after the center of the window
+};
+
+static cudnnStatus_t GetLRNShape(const cudnnLRNDescriptor_t normDesc, const cudnnTensorDescriptor_t xDesc, HostLRNShape& shape)
+{
+    if ((xDesc->_nbDims < 2) || (xDesc->_dataType != CUDNN_DATA_FLOAT) || (normDesc->_n < 1))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+    shape._batch                                    = xDesc->_dim[0];
+    shape._channels                                 = xDesc->_dim[1];
+    shape._spatial                                  = 1;
+    for (int i = 2; i < xDesc->_nbDims; i++)
+        shape._spatial                             *= xDesc->_dim[i];
+    shape._blocks                                   = (shape._spatial + HOST_LRN_BLOCK - 1) / HOST_LRN_BLOCK;
+    shape._lo                                       = (normDesc->_n - 1) / 2;
+    shape._hi                                       = normDesc->_n / 2;
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// Offsets of the spatial positions of one block, the channel plane is added per channel
+static int64_t GetLRNOffsets(const cudnnTensorDescriptor_t desc, const HostLRNShape& shape, int64_t n, int64_t block, int64_t* pOffset)
+{
+    int64_t start                                   = block * HOST_LRN_BLOCK;
+    int64_t size                                    = std::min(HOST_LRN_BLOCK, shape._spatial - start);
+    for (int64_t i = 0; i < size; i++)
+        pOffset[i]                                  = n * desc->_stride[0] + TensorOffset(start + i, desc->_nbDims - 2, desc->_dim + 2, desc->_stride + 2);
+    return size;
+}
+
+// scale[c] = k + alpha / n * sum of x^2 over the channel window, for every channel of a block
+static void LRNScale(const cudnnLRNDescriptor_t normDesc, const HostLRNShape& shape, const float* pX, int64_t xChannelStride, const int64_t* pXOffset, int64_t size, float* pScale)
+{
+    const double scale                              = normDesc->_alpha / normDesc->_n;
+    double sum[HOST_LRN_BLOCK];
+    for (int64_t i = 0; i < size; i++)
+        sum[i]                                      = 0.0;
+    for (int64_t c = 0; c < std::min((int64_t)shape._hi, shape._channels); c++)
+    {
+        const float* pChannel                       = pX + c * xChannelStride;
+        for (int64_t i = 0; i < size; i++)
+            sum[i]                                 += (double)pChannel[pXOffset[i]] * pChannel[pXOffset[i]];
+    }
+    for (int64_t c = 0; c < shape._channels; c++)
+    {
+        int64_t add                                 = c + shape._hi;
+        int64_t remove                              = c - shape._lo - 1;
+        if (add < shape._channels)
+        {
+            const float* pChannel                   = pX + add * xChannelStride;
+            for (int64_t i = 0; i < size; i++)
+                sum[i]                             += (double)pChannel[pXOffset[i]] * pChannel[pXOffset[i]];
+        }
+        if (remove >= 0)
+        {
+            const float* pChannel                   = pX + remove * xChannelStride;
+            for (int64_t i = 0; i < size; i++)
+                sum[i]                             -= (double)pChannel[pXOffset[i]] * pChannel[pXOffset[i]];
+        }
+        float* pOut                                 = pScale + c * HOST_LRN_BLOCK;
+        for (int64_t i = 0; i < size; i++)
+            pOut[i]                                 = (float)(normDesc->_k + scale * std::max(sum[i], 0.0));
+    }
+}
+
+// y = alpha * x / (k + alpha / n * sum of x^2 over the channel window)^beta + beta * y
+cudnnStatus_t cudnnLRNCrossChannelForward(cudnnHandle_t handle, cudnnLRNDescriptor_t normDesc, cudnnLRNMode_t lrnMode, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                          const void* beta, const cudnnTensorDescriptor_t yDesc, void* y)
+{
+    HostLRNShape shape;
+    cudnnStatus_t status                            = GetLRNShape(normDesc, xDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    if ((yDesc->_nbDims != xDesc->_nbDims) || (yDesc->_dataType != CUDNN_DATA_FLOAT))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+    const float lrnBeta                             = (float)normDesc->_beta;
+#pragma omp parallel
+    {
+        std::vector<float> vScale(shape._channels * HOST_LRN_BLOCK);
+        int64_t xOffset[HOST_LRN_BLOCK];
+        int64_t yOffset[HOST_LRN_BLOCK];
+#pragma omp for schedule(dynamic, 1)
+        for (int64_t task = 0; task < shape._batch * shape._blocks; task++)
+        {
+            int64_t n                               = task / shape._blocks;
+            int64_t block                           = task % shape._blocks;
+            int64_t size                            = GetLRNOffsets(xDesc, shape, n, block, xOffset);
+            GetLRNOffsets(yDesc, shape, n, block, yOffset);
+            LRNScale(normDesc, shape, (const float*)x, xDesc->_stride[1], xOffset, size, vScale.data());
+            for (int64_t c = 0; c < shape._channels; c++)
+            {
+                const float* pX                     = (const float*)x + c * xDesc->_stride[1];
+                float* pY                           = (float*)y + c * yDesc->_stride[1];
+                const float* pScale                 = vScale.data() + c * HOST_LRN_BLOCK;
+                for (int64_t i = 0; i < size; i++)
+                {
+                    float v                         = a * pX[xOffset[i]] * powf(pScale[i], -lrnBeta);
+                    float& out                      = pY[yOffset[i]];
+                    out                             = (b == 0.0f) ? v : v + b * out;
+                }
+            }
+        }
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
+
+// dx = alpha * (dy * scale^-beta - 2 * alpha * beta / n * x * sum of dy * y / scale over every window
+// holding the channel) + beta * dx
+cudnnStatus_t cudnnLRNCrossChannelBackward(cudnnHandle_t handle, cudnnLRNDescriptor_t normDesc, cudnnLRNMode_t lrnMode, const void* alpha, const cudnnTensorDescriptor_t yDesc, const void* y,
+                                           const cudnnTensorDescriptor_t dyDesc, const void* dy, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                           const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx)
+{
+    HostLRNShape shape;
+    cudnnStatus_t status                            = GetLRNShape(normDesc, xDesc, shape);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    if ((yDesc->_nbDims != xDesc->_nbDims) || (dyDesc->_nbDims != xDesc->_nbDims) || (dxDesc->_nbDims != xDesc->_nbDims))
+        return CUDNN_STATUS_NOT_SUPPORTED;
+
+    const float a                                   = *(const float*)alpha;
+    const float b                                   = *(const float*)beta;
+    const float lrnBeta                             = (float)normDesc->_beta;
+    const float ratioScale                          = (float)(2.0 * normDesc->_alpha * normDesc->_beta / normDesc->_n);
+#pragma omp parallel
+    {
+        std::vector<float> vScale(shape._channels * HOST_LRN_BLOCK);
+        std::vector<float> vRatio(shape._channels * HOST_LRN_BLOCK);
+        int64_t xOffset[HOST_LRN_BLOCK];
+        int64_t yOffset[HOST_LRN_BLOCK];
+        int64_t dyOffset[HOST_LRN_BLOCK];
+        int64_t dxOffset[HOST_LRN_BLOCK];
+#pragma omp for schedule(dynamic, 1)
+        for (int64_t task = 0; task < shape._batch * shape._blocks; task++)
+        {
+            int64_t n                               = task / shape._blocks;
+            int64_t block                           = task % shape._blocks;
+            int64_t size                            = GetLRNOffsets(xDesc, shape, n, block, xOffset);
+            GetLRNOffsets(yDesc, shape, n, block, yOffset);
+            GetLRNOffsets(dyDesc, shape, n, block, dyOffset);
+            GetLRNOffsets(dxDesc, shape, n, block, dxOffset);
+            LRNScale(normDesc, shape, (const float*)x, xDesc->_stride[1], xOffset, size, vScale.data());
+
+            // dy * y / scale for every channel, summed below over the mirrored window
+            for (int64_t c = 0; c < shape._channels; c++)
+            {
+                const float* pY                     = (const float*)y + c * yDesc->_stride[1];
+                const float* pDy                    = (const float*)dy + c * dyDesc->_stride[1];
+                const float* pScale                 = vScale.data() + c * HOST_LRN_BLOCK;
+                float* pRatio                       = vRatio.data() + c * HOST_LRN_BLOCK;
+                for (int64_t i = 0; i < size; i++)
+                    pRatio[i]                       = pDy[dyOffset[i]] * pY[yOffset[i]] / pScale[i];
+            }
+
+            // Channel c is in the window of channels c - hi to c + lo
+            double sum[HOST_LRN_BLOCK];
+            for (int64_t i = 0; i < size; i++)
+                sum[i]                              = 0.0;
+            for (int64_t c = 0; c < std::min((int64_t)shape._lo, shape._channels); c++)
+            {
+                const float* pRatio                 = vRatio.data() + c * HOST_LRN_BLOCK;
+                for (int64_t i = 0; i < size; i++)
+                    sum[i]                         += pRatio[i];
+            }
+            for (int64_t c = 0; c < shape._channels; c++)
+            {
+                int64_t add                         = c + shape._lo;
+                int64_t remove                      = c - shape._hi - 1;
+                if (add < shape._channels)
+                {
+                    const float* pRatio             = vRatio.data() + add * HOST_LRN_BLOCK;
+                    for (int64_t i = 0; i < size; i++)
+                        sum[i]                     += pRatio[i];
+                }
+                if (remove >= 0)
+                {
+                    const float* pRatio             = vRatio.data() + remove * HOST_LRN_BLOCK;
+                    for (int64_t i = 0; i < size; i++)
+                        sum[i]                     -= pRatio[i];
+                }
+                const float* pX                     = (const float*)x + c * xDesc->_stride[1];
+                const float* pDy                    = (const float*)dy + c * dyDesc->_stride[1];
+                float* pDx                          = (float*)dx + c * dxDesc->_stride[1];
+                const float* pScale                 = vScale.data() + c * HOST_LRN_BLOCK;
+                for (int64_t i = 0; i < size; i++)
+                {
+                    float v                         = a * (pDy[dyOffset[i]] * powf(pScale[i], -lrnBeta) - ratioScale * pX[xOffset[i]] * (float)sum[i]);
+                    float& out                      = pDx[dxOffset[i]];
+                    out                             = (b == 0.0f) ? v : v + b * out;
+                }
+            }
+        }
+    }
+    return CUDNN_STATUS_SUCCESS;
+}
@@ -0,0 +1,345 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __HOSTDEVICE_H__
+#define __HOSTDEVICE_H__
+
+// Host device layer for HOST_ONLY builds.  Stands in for the subset of the CUDA runtime, cuBLAS, cuRAND
+// and cuDNN used by the engine so GpuContext and GpuBuffer compile unchanged against system memory:
+// "device" memory is 64-byte aligned host memory, device and host pointers are the same address, and
+// there is a single device whose stream is the OpenMP thread team.  Every call is synchronous, so
+// synchronization is a no-op.  The kernels in kernels.h are supplied by the h*.cpp files.
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+
+#define __align__(n)                        __attribute__((aligned(n)))
+#define __launch_bounds__(...)
+
+// Alignment of all host device allocations, a full cache line so rows can be vectorized
+static const size_t HOST_DEVICE_ALIGNMENT   = 64;
+
+// Vector types
+struct float2  { float x, y; };
+struct float4  { float x, y, z, w; };
+struct double2 { double x, y; };
+struct double4 { double x, y, z, w; };
+
+// CUDA runtime
+enum cudaError_t
+{
+    cudaSuccess                             = 0,
+    cudaErrorMemoryAllocation               = 2,
+    cudaErrorInvalidValue                   = 11,
+    cudaErrorNotSupported                   = 71,
+    cudaErrorPeerAccessAlreadyEnabled       = 50,
+};
+
+enum cudaMemcpyKind
+{
+    cudaMemcpyHostToHost                    = 0,
+    cudaMemcpyHostToDevice                  = 1,
+    cudaMemcpyDeviceToHost                  = 2,
+    cudaMemcpyDeviceToDevice                = 3,
+    cudaMemcpyDefault                       = 4,
+};
+
+static const unsigned int cudaHostAllocMapped               = 0x02;
+static const unsigned int cudaDeviceMapHost                 = 0x08;
+static const unsigned int cudaIpcMemLazyEnablePeerAccess    = 0x01;
+
+struct cudaDeviceProp
+{
+    char                    name[256];
+    size_t                  totalGlobalMem;
+    int                     warpSize;
+    int                     major;
+    int                     minor;
+    int                     canMapHostMemory;
+    int                     unifiedAddressing;
+    int                     ECCEnabled;
+    int                     tccDriver;
+    int                     multiProcessorCount;
+};
+
+struct cudaIpcMemHandle_t
+{
+    char                    reserved[64];
+};
+
+cudaError_t cudaMalloc(void** devPtr, size_t size);
+cudaError_t cudaFree(void* devPtr);
+cudaError_t cudaHostAlloc(void** pHost, size_t size, unsigned int flags);
+cudaError_t cudaHostGetDevicePointer(void** pDevice, void* pHost, unsigned int flags);
+cudaError_t cudaFreeHost(void* ptr);
+cudaError_t cudaMemset(void* devPtr, int value, size_t count);
+cudaError_t cudaMemcpy(void* dst, const void* src, size_t count, cudaMemcpyKind kind);
+cudaError_t cudaMemcpy2D(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height, cudaMemcpyKind kind);
+cudaError_t cudaDeviceSynchronize();
+cudaError_t cudaThreadSynchronize();
+cudaError_t cudaThreadExit();
+cudaError_t cudaGetLastError();
+const char* cudaGetErrorString(cudaError_t error);
+cudaError_t cudaGetDeviceCount(int* count);
+cudaError_t cudaGetDeviceProperties(cudaDeviceProp* prop, int device);
+cudaError_t cudaSetDeviceFlags(unsigned int flags);
+cudaError_t cudaSetValidDevices(int* pDevice, int len);
+cudaError_t cudaGetDevice(int* device);
+cudaError_t cudaSetDevice(int device);
+cudaError_t cudaDeviceCanAccessPeer(int* canAccessPeer, int device, int peerDevice);
+cudaError_t cudaDeviceEnablePeerAccess(int peerDevice, unsigned int flags);
+cudaError_t cudaIpcGetMemHandle(cudaIpcMemHandle_t* handle, void* devPtr);
+cudaError_t cudaIpcOpenMemHandle(void** devPtr, cudaIpcMemHandle_t handle, unsigned int flags);
+cudaError_t cudaIpcCloseMemHandle(void* devPtr);
+
+// cuBLAS, backed by cblas
+enum cublasStatus_t
+{
+    CUBLAS_STATUS_SUCCESS                   = 0,
+    CUBLAS_STATUS_NOT_INITIALIZED           = 1,
+    CUBLAS_STATUS_INVALID_VALUE             = 7,
+};
+
+enum cublasOperation_t
+{
+    CUBLAS_OP_N                             = 0,
+    CUBLAS_OP_T                             = 1,
+};
+
+struct cublasContext;
+typedef cublasContext*                      cublasHandle_t;
+
+cublasStatus_t cublasCreate(cublasHandle_t* handle);
+cublasStatus_t cublasDestroy(cublasHandle_t handle);
+cublasStatus_t cublasSgemm(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k,
+                           const float* alpha, const float* A, int lda, const float* B, int ldb, const float* beta, float* C, int ldc);
+
+// cuRAND, backed by a per-generator Mersenne Twister
+enum curandStatus_t
+{
+    CURAND_STATUS_SUCCESS                   = 0,
+    CURAND_STATUS_NOT_INITIALIZED           = 101,
+};
+
+enum curandRngType_t
+{
+    CURAND_RNG_PSEUDO_DEFAULT               = 100,
+};
+
+struct curandGenerator_st;
+typedef curandGenerator_st*                 curandGenerator_t;
+
+curandStatus_t curandCreateGenerator(curandGenerator_t* generator, curandRngType_t rng_type);
+curandStatus_t curandDestroyGenerator(curandGenerator_t generator);
+curandStatus_t curandSetPseudoRandomGeneratorSeed(curandGenerator_t generator, unsigned long long seed);
+curandStatus_t curandGenerate(curandGenerator_t generator, unsigned int* outputPtr, size_t num);
+curandStatus_t curandGenerateUniform(curandGenerator_t generator, float* outputPtr, size_t num);
+curandStatus_t curandGenerateNormal(curandGenerator_t generator, float* outputPtr, size_t n, float mean, float stddev);
+
+// cuDNN, descriptors are plain structs
+enum cudnnStatus_t
+{
+    CUDNN_STATUS_SUCCESS                    = 0,
+    CUDNN_STATUS_NOT_INITIALIZED            = 1,
+    CUDNN_STATUS_ALLOC_FAILED               = 2,
+    CUDNN_STATUS_BAD_PARAM                  = 3,
+    CUDNN_STATUS_NOT_SUPPORTED              = 9,
+};
+
+enum cudnnDataType_t
+{
+    CUDNN_DATA_FLOAT                        = 0,
+    CUDNN_DATA_DOUBLE                       = 1,
+};
+
+enum cudnnTensorFormat_t
+{
+    CUDNN_TENSOR_NCHW                       = 0,
+};
+
+enum cudnnNanPropagation_t
+{
+    CUDNN_NOT_PROPAGATE_NAN                 = 0,
+    CUDNN_PROPAGATE_NAN                     = 1,
+};
+
+enum cudnnPoolingMode_t
+{
+    CUDNN_POOLING_MAX                       = 0,
+    CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING = 1,
+    CUDNN_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING = 2,
+};
+
+enum cudnnConvolutionMode_t
+{
+    CUDNN_CONVOLUTION                       = 0,
+    CUDNN_CROSS_CORRELATION                 = 1,
+};
+
+enum cudnnLRNMode_t
+{
+    CUDNN_LRN_CROSS_CHANNEL_DIM1            = 0,
+};
+
+enum cudnnConvolutionFwdPreference_t
+{
+    CUDNN_CONVOLUTION_FWD_PREFER_FASTEST    = 1,
+};
+
+enum cudnnConvolutionBwdFilterPreference_t
+{
+    CUDNN_CONVOLUTION_BWD_FILTER_PREFER_FASTEST = 1,
+};
+
+enum cudnnConvolutionBwdDataPreference_t
+{
+    CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST = 1,
+};
+
+enum cudnnConvolutionFwdAlgo_t
+{
+    CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_GEMM = 0,
+    CUDNN_CONVOLUTION_FWD_ALGO_GEMM         = 2,
+    CUDNN_CONVOLUTION_FWD_ALGO_DIRECT       = 3,
+};
+
+enum cudnnConvolutionBwdFilterAlgo_t
+{
+    CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0     = 0,
+    CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1     = 1,
+};
+
+enum cudnnConvolutionBwdDataAlgo_t
+{
+    CUDNN_CONVOLUTION_BWD_DATA_ALGO_0       = 0,
+    CUDNN_CONVOLUTION_BWD_DATA_ALGO_1       = 1,
+};
+
+static const int HOST_CUDNN_DIM_MAX         = 8;
+
+struct cudnnContext;
+typedef cudnnContext*                       cudnnHandle_t;
+
+struct cudnnTensorStruct
+{
+    cudnnDataType_t         _dataType;
+    int                     _nbDims;
+    int                     _dim[HOST_CUDNN_DIM_MAX];
+    int                     _stride[HOST_CUDNN_DIM_MAX];
+};
+typedef cudnnTensorStruct*                  cudnnTensorDescriptor_t;
+
+struct cudnnFilterStruct
+{
+    cudnnDataType_t         _dataType;
+    cudnnTensorFormat_t     _format;
+    int                     _nbDims;
+    int                     _dim[HOST_CUDNN_DIM_MAX];
+};
+typedef cudnnFilterStruct*                  cudnnFilterDescriptor_t;
+
+struct cudnnConvolutionStruct
+{
+    int                     _arrayLength;
+    int                     _pad[HOST_CUDNN_DIM_MAX];
+    int                     _stride[HOST_CUDNN_DIM_MAX];
+    int                     _upscale[HOST_CUDNN_DIM_MAX];
+    cudnnConvolutionMode_t  _mode;
+    cudnnDataType_t         _dataType;
+};
+typedef cudnnConvolutionStruct*             cudnnConvolutionDescriptor_t;
+
+struct cudnnPoolingStruct
+{
+    cudnnPoolingMode_t      _mode;
+    cudnnNanPropagation_t   _nanOpt;
+    int                     _nbDims;
+    int                     _window[HOST_CUDNN_DIM_MAX];
+    int                     _padding[HOST_CUDNN_DIM_MAX];
+    int                     _stride[HOST_CUDNN_DIM_MAX];
+};
+typedef cudnnPoolingStruct*                 cudnnPoolingDescriptor_t;
+
+struct cudnnLRNStruct
+{
+    unsigned int            _n;
+    double                  _alpha;
+    double                  _beta;
+    double                  _k;
+};
+typedef cudnnLRNStruct*                     cudnnLRNDescriptor_t;
+
+cudnnStatus_t cudnnCreate(cudnnHandle_t* handle);
+cudnnStatus_t cudnnDestroy(cudnnHandle_t handle);
+const char* cudnnGetErrorString(cudnnStatus_t status);
+
+cudnnStatus_t cudnnCreateTensorDescriptor(cudnnTensorDescriptor_t* tensorDesc);
+cudnnStatus_t cudnnDestroyTensorDescriptor(cudnnTensorDescriptor_t tensorDesc);
+cudnnStatus_t cudnnSetTensor4dDescriptor(cudnnTensorDescriptor_t tensorDesc, cudnnTensorFormat_t format, cudnnDataType_t dataType, int n, int c, int h, int w);
+cudnnStatus_t cudnnSetTensorNdDescriptor(cudnnTensorDescriptor_t tensorDesc, cudnnDataType_t dataType, int nbDims, const int* dimA, const int* strideA);
+cudnnStatus_t cudnnGetTensorNdDescriptor(const cudnnTensorDescriptor_t tensorDesc, int nbDimsRequested, cudnnDataType_t* dataType, int* nbDims, int* dimA, int* strideA);
+
+cudnnStatus_t cudnnCreateFilterDescriptor(cudnnFilterDescriptor_t* filterDesc);
+cudnnStatus_t cudnnDestroyFilterDescriptor(cudnnFilterDescriptor_t filterDesc);
+cudnnStatus_t cudnnSetFilterNdDescriptor(cudnnFilterDescriptor_t filterDesc, cudnnDataType_t dataType, cudnnTensorFormat_t format, int nbDims, const int* filterDimA);
+
+cudnnStatus_t cudnnCreateConvolutionDescriptor(cudnnConvolutionDescriptor_t* convDesc);
+cudnnStatus_t cudnnDestroyConvolutionDescriptor(cudnnConvolutionDescriptor_t convDesc);
+cudnnStatus_t cudnnSetConvolutionNdDescriptor(cudnnConvolutionDescriptor_t convDesc, int arrayLength, const int* padA, const int* filterStrideA, const int* upscaleA, cudnnConvolutionMode_t mode, cudnnDataType_t dataType);
+cudnnStatus_t cudnnGetConvolutionNdForwardOutputDim(const cudnnConvolutionDescriptor_t convDesc, const cudnnTensorDescriptor_t inputTensorDesc, const cudnnFilterDescriptor_t filterDesc, int nbDims, int* tensorOutputDimA);
+
+cudnnStatus_t cudnnCreatePoolingDescriptor(cudnnPoolingDescriptor_t* poolingDesc);
+cudnnStatus_t cudnnDestroyPoolingDescriptor(cudnnPoolingDescriptor_t poolingDesc);
+cudnnStatus_t cudnnSetPoolingNdDescriptor(cudnnPoolingDescriptor_t poolingDesc, cudnnPoolingMode_t mode, cudnnNanPropagation_t maxpoolingNanOpt, int nbDims, const int* windowDimA, const int* paddingA, const int* strideA);
+
+cudnnStatus_t cudnnCreateLRNDescriptor(cudnnLRNDescriptor_t* normDesc);
+cudnnStatus_t cudnnDestroyLRNDescriptor(cudnnLRNDescriptor_t lrnDesc);
+cudnnStatus_t cudnnSetLRNDescriptor(cudnnLRNDescriptor_t normDesc, unsigned int lrnN, double lrnAlpha, double lrnBeta, double lrnK);
+
+cudnnStatus_t cudnnGetConvolutionForwardAlgorithm(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnFilterDescriptor_t wDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                  const cudnnTensorDescriptor_t yDesc, cudnnConvolutionFwdPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionFwdAlgo_t* algo);
+cudnnStatus_t cudnnGetConvolutionForwardWorkspaceSize(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnFilterDescriptor_t wDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                      const cudnnTensorDescriptor_t yDesc, cudnnConvolutionFwdAlgo_t algo, size_t* sizeInBytes);
+cudnnStatus_t cudnnGetConvolutionBackwardFilterAlgorithm(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                         const cudnnFilterDescriptor_t dwDesc, cudnnConvolutionBwdFilterPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionBwdFilterAlgo_t* algo);
+cudnnStatus_t cudnnGetConvolutionBackwardFilterWorkspaceSize(cudnnHandle_t handle, const cudnnTensorDescriptor_t xDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                             const cudnnFilterDescriptor_t gradDesc, cudnnConvolutionBwdFilterAlgo_t algo, size_t* sizeInBytes);
+cudnnStatus_t cudnnGetConvolutionBackwardDataAlgorithm(cudnnHandle_t handle, const cudnnFilterDescriptor_t wDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                       const cudnnTensorDescriptor_t dxDesc, cudnnConvolutionBwdDataPreference_t preference, size_t memoryLimitInBytes, cudnnConvolutionBwdDataAlgo_t* algo);
+cudnnStatus_t cudnnGetConvolutionBackwardDataWorkspaceSize(cudnnHandle_t handle, const cudnnFilterDescriptor_t wDesc, const cudnnTensorDescriptor_t dyDesc, const cudnnConvolutionDescriptor_t convDesc,
+                                                           const cudnnTensorDescriptor_t dxDesc, cudnnConvolutionBwdDataAlgo_t algo, size_t* sizeInBytes);
+
+cudnnStatus_t cudnnAddTensor(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t aDesc, const void* A, const void* beta, const cudnnTensorDescriptor_t cDesc, void* C);
+cudnnStatus_t cudnnConvolutionForward(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x, const cudnnFilterDescriptor_t wDesc, const void* w,
+                                      const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionFwdAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                      const void* beta, const cudnnTensorDescriptor_t yDesc, void* y);
+cudnnStatus_t cudnnConvolutionBackwardBias(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t dyDesc, const void* dy, const void* beta, const cudnnTensorDescriptor_t dbDesc, void* db);
+cudnnStatus_t cudnnConvolutionBackwardFilter(cudnnHandle_t handle, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x, const cudnnTensorDescriptor_t dyDesc, const void* dy,
+                                             const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionBwdFilterAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                             const void* beta, const cudnnFilterDescriptor_t dwDesc, void* dw);
+cudnnStatus_t cudnnConvolutionBackwardData(cudnnHandle_t handle, const void* alpha, const cudnnFilterDescriptor_t wDesc, const void* w, const cudnnTensorDescriptor_t dyDesc, const void* dy,
+                                           const cudnnConvolutionDescriptor_t convDesc, cudnnConvolutionBwdDataAlgo_t algo, void* workSpace, size_t workSpaceSizeInBytes,
+                                           const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx);
+cudnnStatus_t cudnnPoolingForward(cudnnHandle_t handle, const cudnnPoolingDescriptor_t poolingDesc, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                  const void* beta, const cudnnTensorDescriptor_t yDesc, void* y);
+cudnnStatus_t cudnnPoolingBackward(cudnnHandle_t handle, const cudnnPoolingDescriptor_t poolingDesc, const void* alpha, const cudnnTensorDescriptor_t yDesc, const void* y,
+                                   const cudnnTensorDescriptor_t dyDesc, const void* dy, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                   const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx);
+cudnnStatus_t cudnnLRNCrossChannelForward(cudnnHandle_t handle, cudnnLRNDescriptor_t normDesc, cudnnLRNMode_t lrnMode, const void* alpha, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                          const void* beta, const cudnnTensorDescriptor_t yDesc, void* y);
+cudnnStatus_t cudnnLRNCrossChannelBackward(cudnnHandle_t handle, cudnnLRNDescriptor_t normDesc, cudnnLRNMode_t lrnMode, const void* alpha, const cudnnTensorDescriptor_t yDesc, const void* y,
+                                           const cudnnTensorDescriptor_t dyDesc, const void* dy, const cudnnTensorDescriptor_t xDesc, const void* x,
+                                           const void* beta, const cudnnTensorDescriptor_t dxDesc, void* dx);
+
+#endif
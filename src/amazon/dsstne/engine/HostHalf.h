@@ -0,0 +1,64 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __HOSTHALF_H__
+#define __HOSTHALF_H__
+
+#include <stdint.h>
+#include <cstring>
+
+// IEEE fp16 conversions shared by the half precision host weights and the fp16 recs files.  Floats are
+// rounded to nearest even, overflow to infinity and keep NaNs quiet.  Standalone so the utils can use it
+// without the device headers.
+static inline uint16_t hFloatToHalf(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign                               = (x >> 16) & 0x8000;
+    x                                          &= 0x7fffffff;
+    if (x >= 0x47800000)
+        return sign | ((x > 0x7f800000) ? 0x7e00 : 0x7c00);
+    if (x < 0x38800000)
+    {
+        // Subnormal, let the FPU round by aligning the mantissa against 0.5
+        float v;
+        memcpy(&v, &x, sizeof(v));
+        v                                      += 0.5f;
+        memcpy(&x, &v, sizeof(x));
+        return sign | (x - 0x3f000000);
+    }
+    x                                          += 0xc8000fff + ((x >> 13) & 1);
+    return sign | (x >> 13);
+}
+
+static inline float hHalfToFloat(uint16_t h)
+{
+    uint32_t sign                               = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent                           = (h >> 10) & 0x1f;
+    uint32_t mantissa                           = h & 0x3ff;
+    uint32_t x;
+    if (exponent == 0x1f)
+        x                                       = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        x                                       = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else
+    {
+        float v                                 = (float)mantissa * 5.9604644775390625e-8f;
+        memcpy(&x, &v, sizeof(x));
+        x                                      |= sign;
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+#endif
@@ -0,0 +1,1509 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostHalf.h"
+#include <omp.h>
+#include <random>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOST_BITONIC_X86
+#endif
+
+// Number of keys tested against the current top K threshold at a time, the test
+// itself compiles to a handful of vector compares so most of a row is skipped in bulk
+static const uint32_t TOPK_BLOCK                = 16;
+
+struct TopKEntry
+{
+    NNFloat                     _key;
+    uint32_t                    _pos;
+};
+
+// Heap ordering for top K, the root of the heap is the entry that would be evicted first.  Ties
+// go to the lower position so results are deterministic regardless of thread count
+static inline bool TopKWorse(const TopKEntry& a, const TopKEntry& b)
+{
+    return (a._key < b._key) || ((a._key == b._key) && (a._pos > b._pos));
+}
+
+static inline void TopKSiftDown(TopKEntry* pHeap, uint32_t size, uint32_t pos)
+{
+    TopKEntry e                                 = pHeap[pos];
+    uint32_t child                              = 2 * pos + 1;
+    while (child < size)
+    {
+        if ((child + 1 < size) && TopKWorse(pHeap[child + 1], pHeap[child]))
+            child++;
+        if (!TopKWorse(pHeap[child], e))
+            break;
+        pHeap[pos]                              = pHeap[child];
+        pos                                     = child;
+        child                                   = 2 * pos + 1;
+    }
+    pHeap[pos]                                  = e;
+}
+
+// Offers the key at pos to a full heap of size entries.  Positions are offered in increasing order,
+// so any key equal to the current threshold loses the tie and can be rejected with a single compare.
+static inline void TopKOffer(TopKEntry* pHeap, uint32_t size, NNFloat key, uint32_t pos, NNFloat& threshold)
+{
+    if (key > threshold)
+    {
+        pHeap[0]._key                           = key;
+        pHeap[0]._pos                           = pos;
+        TopKSiftDown(pHeap, size, 0);
+        threshold                               = pHeap[0]._key;
+    }
+}
+
+// Key at pos of a row, multiplied by the row's score mask if it has one
+template<bool bMask> static inline NNFloat TopKKey(const NNFloat* pRow, const NNFloat* pMask, uint32_t pos)
+{
+    return bMask ? pRow[pos] * pMask[pos] : pRow[pos];
+}
+
+// Offers positions pos to end - 1 of a row to a full heap
+template<bool bMask> static void TopKScan(const NNFloat* pRow, const NNFloat* pMask, uint32_t pos, uint32_t end, TopKEntry* pHeap, uint32_t size, NNFloat& threshold)
+{
+    // Scalar loop up to block alignment
+    while ((pos < end) && (pos % TOPK_BLOCK))
+    {
+        TopKOffer(pHeap, size, TopKKey<bMask>(pRow, pMask, pos), pos, threshold);
+        pos++;
+    }
+
+    // Blocked loop, skipping blocks with nothing above the threshold
+    while (pos + TOPK_BLOCK <= end)
+    {
+        NNFloat block[TOPK_BLOCK];
+        bool bHit                               = false;
+        for (uint32_t j = 0; j < TOPK_BLOCK; j++)
+        {
+            block[j]                            = TopKKey<bMask>(pRow, pMask, pos + j);
+            bHit                               |= (block[j] > threshold);
+        }
+        if (bHit)
+        {
+            for (uint32_t j = 0; j < TOPK_BLOCK; j++)
+                TopKOffer(pHeap, size, block[j], pos + j, threshold);
+        }
+        pos                                    += TOPK_BLOCK;
+    }
+
+    // Remainder
+    while (pos < end)
+    {
+        TopKOffer(pHeap, size, TopKKey<bMask>(pRow, pMask, pos), pos, threshold);
+        pos++;
+    }
+}
+
+// Selects the top k keys of a single row into pHeap and returns the number selected (min(k, width)),
+// in heap order.  Keys are multiplied by pMask if it isn't NULL, and the filterCount positions in
+// pFilterIndex (ascending) are also multiplied by pFilterValue, positions at or past width are ignored.
+// The row itself is never written.
+template<bool bMask> static uint32_t TopKRow(const NNFloat* pRow, const NNFloat* pMask, uint32_t width, uint32_t k, TopKEntry* pHeap,
+                                             const uint32_t* pFilterIndex, const NNFloat* pFilterValue, uint64_t filterCount)
+{
+    uint32_t size                               = min(k, width);
+    uint64_t filter                             = 0;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        NNFloat key                             = TopKKey<bMask>(pRow, pMask, i);
+        if ((filter < filterCount) && (pFilterIndex[filter] == i))
+            key                                *= pFilterValue[filter++];
+        pHeap[i]._key                           = key;
+        pHeap[i]._pos                           = i;
+    }
+    for (int64_t i = (int64_t)size / 2 - 1; i >= 0; i--)
+        TopKSiftDown(pHeap, size, i);
+
+    if (size > 0)
+    {
+        uint32_t pos                            = size;
+        NNFloat threshold                       = pHeap[0]._key;
+
+        // Unfiltered runs go through the blocked scan, filtered positions are offered one at a time in between
+        while ((filter < filterCount) && (pFilterIndex[filter] < width))
+        {
+            uint32_t fpos                       = pFilterIndex[filter];
+            if (fpos >= pos)
+            {
+                TopKScan<bMask>(pRow, pMask, pos, fpos, pHeap, size, threshold);
+                TopKOffer(pHeap, size, TopKKey<bMask>(pRow, pMask, fpos) * pFilterValue[filter], fpos, threshold);
+                pos                             = fpos + 1;
+            }
+            filter++;
+        }
+        TopKScan<bMask>(pRow, pMask, pos, width, pHeap, size, threshold);
+    }
+    return size;
+}
+
+// Sorts the selected entries into pKey/pPos by descending key with the SIMD bitonic networks, then
+// puts any tied keys back in ascending position order
+static void TopKSort(const TopKEntry* pHeap, uint32_t size, NNFloat* pKey, uint32_t* pPos)
+{
+    for (uint32_t i = 0; i < size; i++)
+    {
+        pKey[i]                                 = pHeap[i]._key;
+        pPos[i]                                 = pHeap[i]._pos;
+    }
+    hBitonicSort(pKey, pPos, size, true);
+    for (uint32_t i = 1; i < size; i++)
+    {
+        uint32_t pos                            = pPos[i];
+        uint32_t j                              = i;
+        while ((j > 0) && (pKey[j - 1] == pKey[i]) && (pPos[j - 1] > pos))
+        {
+            pPos[j]                             = pPos[j - 1];
+            j--;
+        }
+        pPos[j]                                 = pos;
+    }
+}
+
+// Shared driver for all three overloads, pOutputValue == NULL returns positions within the row as values
+template<typename ValueType> static void hCalculateTopK_kernel(NNFloat* pOutputKey, ValueType* pOutputValue, NNFloat* pKey, ValueType* pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+#pragma omp parallel
+    {
+        vector<TopKEntry> vHeap(k);
+        vector<uint32_t> vPos(k);
+#pragma omp for schedule(dynamic)
+        for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+        {
+            NNFloat* pRow                       = pOutputKey + pos * width;
+            NNFloat* pRowKey                    = pKey + pos * k;
+            ValueType* pRowValue                = pValue + pos * k;
+            uint32_t size                       = TopKRow<false>(pRow, NULL, width, k, vHeap.data(), NULL, NULL, 0);
+            TopKSort(vHeap.data(), size, pRowKey, vPos.data());
+            if (pOutputValue)
+            {
+                ValueType* pRowOutputValue      = pOutputValue + pos * width;
+                for (uint32_t i = 0; i < size; i++)
+                    pRowValue[i]                = pRowOutputValue[vPos[i]];
+            }
+            else
+            {
+                for (uint32_t i = 0; i < size; i++)
+                    pRowValue[i]                = (ValueType)vPos[i];
+            }
+
+            // Pad short rows the same way the GPU kernel does
+            for (uint32_t i = size; i < k; i++)
+            {
+                pRowKey[i]                      = -MAX_VALUE;
+                pRowValue[i]                    = (ValueType)0;
+            }
+        }
+    }
+}
+
+void hCalculateTopK(NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK_kernel<uint32_t>(pOutputKey, NULL, pKey, pValue, batch, width, k);
+}
+
+void hCalculateTopK(NNFloat* pOutputKey, NNFloat* pOutputValue, NNFloat *pKey, NNFloat* pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK_kernel<NNFloat>(pOutputKey, pOutputValue, pKey, pValue, batch, width, k);
+}
+
+void hCalculateTopK(NNFloat* pOutputKey, uint32_t* pOutputValue, NNFloat *pKey, uint32_t * pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK_kernel<uint32_t>(pOutputKey, pOutputValue, pKey, pValue, batch, width, k);
+}
+
+void hCalculateFilteredTopK(const NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k,
+                            const uint64_t* pFilterStart, const uint64_t* pFilterEnd, const uint32_t* pFilterIndex, const NNFloat* pFilterValue,
+                            const NNFloat* pMask, const uint32_t* pMaskRow)
+{
+#pragma omp parallel
+    {
+        vector<TopKEntry> vHeap(k);
+#pragma omp for schedule(dynamic)
+        for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+        {
+            const NNFloat* pRow                 = pOutputKey + pos * width;
+            NNFloat* pRowKey                    = pKey + pos * k;
+            uint32_t* pRowValue                 = pValue + pos * k;
+            uint64_t start                      = pFilterStart ? pFilterStart[pos] : 0;
+            uint64_t count                      = pFilterStart ? pFilterEnd[pos] - start : 0;
+            uint32_t size;
+            if (pMask)
+            {
+                const NNFloat* pRowMask         = pMask + (pMaskRow ? (uint64_t)pMaskRow[pos] * width : 0);
+                size                            = TopKRow<true>(pRow, pRowMask, width, k, vHeap.data(), pFilterIndex + start, pFilterValue + start, count);
+            }
+            else
+                size                            = TopKRow<false>(pRow, NULL, width, k, vHeap.data(), pFilterIndex + start, pFilterValue + start, count);
+            TopKSort(vHeap.data(), size, pRowKey, pRowValue);
+            for (uint32_t i = size; i < k; i++)
+            {
+                pRowKey[i]                      = -MAX_VALUE;
+                pRowValue[i]                    = 0;
+            }
+        }
+    }
+}
+
+// Radix sort digit width, 8 bits keeps the per thread histograms and write combining buffers in L1/L2
+static const uint32_t RADIX_BITS                = 8;
+static const uint32_t RADIX                     = 1 << RADIX_BITS;
+
+// Below this many items sorting and shuffling run on a single thread
+static const uint32_t HOST_SORT_PARALLEL_ITEMS  = 65536;
+
+// Maps keys to unsigned integers with the same ordering
+template<typename KeyType> struct RadixKey
+{
+    static inline uint32_t Bits(KeyType key) { return (uint32_t)key; }
+};
+
+template<> struct RadixKey<NNFloat>
+{
+    static inline uint32_t Bits(NNFloat key)
+    {
+        uint32_t bits;
+        memcpy(&bits, &key, sizeof(bits));
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
+};
+
+// Copies bytes (a multiple of 16) from an aligned buffer to 16 byte aligned memory without pulling the
+// destination into cache.  Scattered radix output is never reread before the next pass.
+static inline void StreamCopy(void* pDst, const void* pSrc, size_t bytes)
+{
+#ifdef __SSE2__
+    __m128i* pD                                 = (__m128i*)pDst;
+    const __m128i* pS                           = (const __m128i*)pSrc;
+    for (size_t i = 0; i < bytes / sizeof(__m128i); i++)
+        _mm_stream_si128(pD + i, _mm_load_si128(pS + i));
+#else
+    memcpy(pDst, pSrc, bytes);
+#endif
+}
+
+// One scatter of a radix pass over [start, end).  Each digit collects a cache line of keys in a write
+// combining buffer which is streamed out once full.  The first flush of each digit is cut short at
+// the next cache line boundary of the output so all later flushes are aligned full lines.
+template<typename KeyType, typename ValueType> static void RadixScatter(const KeyType* pKeySrc, const ValueType* pValueSrc, KeyType* pKeyDst, ValueType* pValueDst,
+                                                                         uint32_t start, uint32_t end, uint32_t shift, uint32_t* pOffset,
+                                                                         KeyType* pKeyBuffer, ValueType* pValueBuffer)
+{
+    const uint32_t lineItems                    = 64 / sizeof(KeyType);
+    const bool bStream                          = (((uintptr_t)pKeyDst % 64) == 0) && (((uintptr_t)pValueDst % 16) == 0) && (((lineItems * sizeof(ValueType)) % 16) == 0);
+    uint32_t fill[RADIX];
+    uint32_t limit[RADIX];
+    for (uint32_t d = 0; d < RADIX; d++)
+    {
+        fill[d]                                 = 0;
+        limit[d]                                = lineItems - (pOffset[d] % lineItems);
+    }
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        KeyType key                             = pKeySrc[i];
+        uint32_t d                              = (RadixKey<KeyType>::Bits(key) >> shift) & (RADIX - 1);
+        uint32_t n                              = fill[d];
+        pKeyBuffer[d * lineItems + n]           = key;
+        pValueBuffer[d * lineItems + n]         = pValueSrc[i];
+        n++;
+        if (n == limit[d])
+        {
+            if (bStream && (n == lineItems))
+            {
+                StreamCopy(pKeyDst + pOffset[d], pKeyBuffer + d * lineItems, lineItems * sizeof(KeyType));
+                StreamCopy(pValueDst + pOffset[d], pValueBuffer + d * lineItems, lineItems * sizeof(ValueType));
+            }
+            else
+            {
+                memcpy(pKeyDst + pOffset[d], pKeyBuffer + d * lineItems, n * sizeof(KeyType));
+                memcpy(pValueDst + pOffset[d], pValueBuffer + d * lineItems, n * sizeof(ValueType));
+            }
+            pOffset[d]                         += n;
+            limit[d]                            = lineItems;
+            n                                   = 0;
+        }
+        fill[d]                                 = n;
+    }
+
+    // Flush partial lines
+    for (uint32_t d = 0; d < RADIX; d++)
+    {
+        if (fill[d] > 0)
+        {
+            memcpy(pKeyDst + pOffset[d], pKeyBuffer + d * lineItems, fill[d] * sizeof(KeyType));
+            memcpy(pValueDst + pOffset[d], pValueBuffer + d * lineItems, fill[d] * sizeof(ValueType));
+            pOffset[d]                         += fill[d];
+        }
+    }
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
+
+// Parallel LSD radix sort.  Every pass each thread histograms its slice of the input, the histograms are
+// scanned digit major/thread minor to give each thread private output ranges, and each thread scatters
+// its slice.  Passes where every key shares the same digit are skipped.
+template<typename KeyType, typename ValueType> bool hSort(uint32_t items, KeyType* pKey0, KeyType* pKey1, ValueType* pValue0, ValueType* pValue1)
+{
+    if (items <= 1)
+        return true;
+
+    const uint32_t lineItems                    = 64 / sizeof(KeyType);
+    int threads                                 = (items >= HOST_SORT_PARALLEL_ITEMS) ? omp_get_max_threads() : 1;
+    vector<uint32_t> vHistogram(threads * RADIX);
+    KeyType* pKeySrc                            = pKey0;
+    KeyType* pKeyDst                            = pKey1;
+    ValueType* pValueSrc                        = pValue0;
+    ValueType* pValueDst                        = pValue1;
+
+    for (uint32_t shift = 0; shift < sizeof(KeyType) * 8; shift += RADIX_BITS)
+    {
+        bool bSkip                              = false;
+#pragma omp parallel num_threads(threads)
+        {
+            int t                               = omp_get_thread_num();
+            int nt                              = omp_get_num_threads();
+            uint32_t start                      = (uint32_t)(((uint64_t)items * t) / nt);
+            uint32_t end                        = (uint32_t)(((uint64_t)items * (t + 1)) / nt);
+            uint32_t* pHistogram                = &vHistogram[t * RADIX];
+            memset(pHistogram, 0, RADIX * sizeof(uint32_t));
+            for (uint32_t i = start; i < end; i++)
+                pHistogram[(RadixKey<KeyType>::Bits(pKeySrc[i]) >> shift) & (RADIX - 1)]++;
+
+#pragma omp barrier
+#pragma omp single
+            {
+                uint32_t sum                    = 0;
+                for (uint32_t d = 0; d < RADIX; d++)
+                {
+                    uint32_t count              = 0;
+                    for (int j = 0; j < nt; j++)
+                    {
+                        uint32_t c              = vHistogram[j * RADIX + d];
+                        vHistogram[j * RADIX + d] = sum;
+                        sum                    += c;
+                        count                  += c;
+                    }
+                    if (count == items)
+                        bSkip                   = true;
+                }
+            }
+
+            if (!bSkip)
+            {
+                KeyType* pKeyBuffer;
+                ValueType* pValueBuffer;
+                if (posix_memalign((void**)&pKeyBuffer, 64, RADIX * lineItems * sizeof(KeyType)) ||
+                    posix_memalign((void**)&pValueBuffer, 64, RADIX * lineItems * sizeof(ValueType)))
+                {
+                    printf("hSort: Failed to allocate write combining buffers.\n");
+                    exit(-1);
+                }
+                RadixScatter(pKeySrc, pValueSrc, pKeyDst, pValueDst, start, end, shift, pHistogram, pKeyBuffer, pValueBuffer);
+                free(pKeyBuffer);
+                free(pValueBuffer);
+            }
+        }
+
+        if (!bSkip)
+        {
+            swap(pKeySrc, pKeyDst);
+            swap(pValueSrc, pValueDst);
+        }
+    }
+
+    // Odd number of scatter passes, move the result back to buffer 0
+    if (pKeySrc != pKey0)
+    {
+        memcpy(pKey0, pKeySrc, items * sizeof(KeyType));
+        memcpy(pValue0, pValueSrc, items * sizeof(ValueType));
+    }
+    return true;
+}
+
+// Independent random streams for each chunk/bucket of a shuffle
+static inline uint64_t ShuffleSeed(uint64_t seed, uint32_t stream)
+{
+    return seed ^ (0x9E3779B97F4A7C15ull * ((uint64_t)stream + 1));
+}
+
+// 32-bit random numbers, two per mt19937_64 draw
+struct ShuffleRNG
+{
+    mt19937_64                  _rng;
+    uint64_t                    _bits;
+    bool                        _bHalf;
+
+    ShuffleRNG(uint64_t seed) : _rng(seed), _bits(0), _bHalf(false) {}
+
+    inline uint32_t Next()
+    {
+        _bHalf                                  = !_bHalf;
+        if (_bHalf)
+        {
+            _bits                               = _rng();
+            return (uint32_t)_bits;
+        }
+        return (uint32_t)(_bits >> 32);
+    }
+
+    // Unbiased random number in [0, range) by multiply and reject (Lemire), almost never divides
+    inline uint32_t Next(uint32_t range)
+    {
+        uint64_t m                              = (uint64_t)Next() * range;
+        uint32_t low                            = (uint32_t)m;
+        if (low < range)
+        {
+            uint32_t threshold                  = (0u - range) % range;
+            while (low < threshold)
+            {
+                m                               = (uint64_t)Next() * range;
+                low                             = (uint32_t)m;
+            }
+        }
+        return (uint32_t)(m >> 32);
+    }
+};
+
+static void FisherYates(uint32_t* pIndex, uint32_t items, uint64_t seed)
+{
+    ShuffleRNG rng(seed);
+    for (uint32_t i = items - 1; i > 0; i--)
+        swap(pIndex[i], pIndex[rng.Next(i + 1)]);
+}
+
+// Number of fixed slices of the index range, independent of thread count so results are reproducible
+static const uint32_t SHUFFLE_CHUNKS            = 256;
+
+// Parallel Fisher-Yates (Rao-Sandelius): each index is sent to a uniformly random bucket, then every bucket
+// is Fisher-Yates shuffled on its own.  Buckets target 64K indices so each shuffle stays in L2.
+void hShuffleIndices(uint32_t* pIndex, uint32_t items, uint64_t seed)
+{
+    if (items < HOST_SORT_PARALLEL_ITEMS)
+    {
+        for (uint32_t i = 0; i < items; i++)
+            pIndex[i]                           = i;
+        if (items > 1)
+            FisherYates(pIndex, items, seed);
+        return;
+    }
+
+    uint32_t bucketBits                         = 8;
+    while ((bucketBits < 12) && (((uint64_t)items >> bucketBits) > 65536))
+        bucketBits++;
+    const uint32_t buckets                      = 1 << bucketBits;
+    vector<uint32_t> vOffset(SHUFFLE_CHUNKS * buckets, 0);
+    vector<uint32_t> vBucketStart(buckets + 1);
+
+    // Count bucket sizes in each chunk
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t c = 0; c < SHUFFLE_CHUNKS; c++)
+    {
+        uint32_t start                          = (uint32_t)(((uint64_t)items * c) / SHUFFLE_CHUNKS);
+        uint32_t end                            = (uint32_t)(((uint64_t)items * (c + 1)) / SHUFFLE_CHUNKS);
+        uint32_t* pCount                        = &vOffset[c * buckets];
+        ShuffleRNG rng(ShuffleSeed(seed, c));
+        for (uint32_t i = start; i < end; i++)
+            pCount[rng.Next() >> (32 - bucketBits)]++;
+    }
+
+    // Convert counts into output offsets, bucket major/chunk minor
+    uint32_t sum                                = 0;
+    for (uint32_t b = 0; b < buckets; b++)
+    {
+        vBucketStart[b]                         = sum;
+        for (uint32_t c = 0; c < SHUFFLE_CHUNKS; c++)
+        {
+            uint32_t count                      = vOffset[c * buckets + b];
+            vOffset[c * buckets + b]            = sum;
+            sum                                += count;
+        }
+    }
+    vBucketStart[buckets]                       = sum;
+
+    // Replay the same draws to scatter each index into its bucket
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t c = 0; c < SHUFFLE_CHUNKS; c++)
+    {
+        uint32_t start                          = (uint32_t)(((uint64_t)items * c) / SHUFFLE_CHUNKS);
+        uint32_t end                            = (uint32_t)(((uint64_t)items * (c + 1)) / SHUFFLE_CHUNKS);
+        uint32_t* pOffset                       = &vOffset[c * buckets];
+        ShuffleRNG rng(ShuffleSeed(seed, c));
+        for (uint32_t i = start; i < end; i++)
+            pIndex[pOffset[rng.Next() >> (32 - bucketBits)]++] = i;
+    }
+
+    // Shuffle each bucket
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t b = 0; b < buckets; b++)
+    {
+        uint32_t size                           = vBucketStart[b + 1] - vBucketStart[b];
+        if (size > 1)
+            FisherYates(pIndex + vBucketStart[b], size, ShuffleSeed(seed, SHUFFLE_CHUNKS + b));
+    }
+}
+
+// INT8 inference.  Weights are quantized symmetrically with one scale per output, so the largest weight of each
+// output maps to +/-127 and zero stays exactly zero.  They are stored as pairs of consecutive inputs interleaved per
+// output ([inputs / 2][stride][2], see hQuantizedStride) so one 16-bit multiply-add covers two inputs
+static const uint32_t QUANT_ROWS                = 8;        // Batch rows per task
+static const uint32_t QUANT_TILE                = 256;      // Outputs per task, a multiple of QUANT_ALIGN
+
+static inline int8_t QuantizeValue(NNFloat v, NNFloat invScale)
+{
+    NNFloat q                                   = nearbyintf(v * invScale);
+    return (int8_t)max((NNFloat)-127.0, min((NNFloat)127.0, q));
+}
+
+void hQuantizeWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, int8_t* pQuantizedWeight, NNFloat* pWeightScale)
+{
+    const uint32_t stride                       = hQuantizedStride(outputs);
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t start = 0; start < outputs; start += QUANT_TILE)
+    {
+        uint32_t end                            = min(outputs, (uint32_t)start + QUANT_TILE);
+        NNFloat vMax[QUANT_TILE]                = { 0 };
+        for (uint32_t i = 0; i < inputs; i++)
+        {
+            const NNFloat* pRow                 = pWeight + (uint64_t)i * outputs;
+            for (uint32_t o = start; o < end; o++)
+                vMax[o - start]                 = max(vMax[o - start], fabsf(pRow[o]));
+        }
+        for (uint32_t o = start; o < end; o++)
+            pWeightScale[o]                     = (vMax[o - start] > (NNFloat)0.0) ? vMax[o - start] / (NNFloat)127.0 : (NNFloat)1.0;
+    }
+    for (uint32_t o = outputs; o < stride; o++)
+        pWeightScale[o]                         = (NNFloat)1.0;
+
+    // Padding outputs and the odd input of the last pair are zero
+#pragma omp parallel for
+    for (int64_t j = 0; j < (inputs + 1) / 2; j++)
+    {
+        int8_t* pPair                           = pQuantizedWeight + (uint64_t)j * stride * 2;
+        memset(pPair, 0, stride * 2);
+        for (uint32_t h = 0; (h < 2) && (2 * j + h < inputs); h++)
+        {
+            const NNFloat* pRow                 = pWeight + (uint64_t)(2 * j + h) * outputs;
+            for (uint32_t o = 0; o < outputs; o++)
+                pPair[2 * o + h]                = QuantizeValue(pRow[o], (NNFloat)1.0 / pWeightScale[o]);
+        }
+    }
+}
+
+// Accumulates rows x cols int32 dot products of quantized input pairs (pInput, rows x pairs) with the quantized
+// weights starting at output pWeight into pAcc (rows x QUANT_TILE).  cols is a multiple of QUANT_ALIGN.  Products
+// widen to int32 so nothing overflows below 2^31 / 127^2 (133K) inputs
+static void QuantizedGemmTile(int32_t* pAcc, const int32_t* pInput, uint32_t rows, uint32_t pairs, const int8_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        int32_t* pA                             = pAcc + r * QUANT_TILE;
+        memset(pA, 0, cols * sizeof(int32_t));
+        for (uint32_t j = 0; j < pairs; j++)
+        {
+            uint32_t a                          = pInput[(uint64_t)r * pairs + j];
+            int32_t a0                          = (int16_t)(a & 0xffff);
+            int32_t a1                          = (int16_t)(a >> 16);
+            if ((a0 | a1) == 0)
+                continue;
+            const int8_t* pW                    = pWeight + (uint64_t)j * stride * 2;
+            for (uint32_t c = 0; c < cols; c++)
+                pA[c]                          += a0 * pW[2 * c] + a1 * pW[2 * c + 1];
+        }
+    }
+}
+
+// Sums weight row k over cols outputs into pAcc, or value times the row into pFAcc if pFAcc is not NULL
+static void QuantizedAccumulate(int32_t* pAcc, NNFloat* pFAcc, NNFloat value, const int8_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const int8_t* pW                            = pWeight + (uint64_t)(k >> 1) * stride * 2 + (k & 1);
+    if (pFAcc)
+    {
+        for (uint32_t c = 0; c < cols; c++)
+            pFAcc[c]                           += value * (NNFloat)pW[2 * c];
+    }
+    else
+    {
+        for (uint32_t c = 0; c < cols; c++)
+            pAcc[c]                            += pW[2 * c];
+    }
+}
+
+#ifdef HOST_BITONIC_X86
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+// R rows (up to 4) x 64 outputs of accumulators live in registers for the whole pass over the inputs
+template<uint32_t R> static void QuantizedGemmBlockAVX512(int32_t* pAcc, const int32_t* pInput, uint32_t pairs, const int8_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t c = 0; c < cols; c += 64)
+    {
+        __m512i acc[R][4];
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                acc[r][q]                       = _mm512_setzero_si512();
+        const int8_t* pW                        = pWeight + 2 * c;
+        for (uint32_t j = 0; j < pairs; j++, pW += 2 * stride)
+        {
+            __m512i w[4];
+            for (uint32_t q = 0; q < 4; q++)
+                w[q]                            = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(pW + 32 * q)));
+            for (uint32_t r = 0; r < R; r++)
+            {
+                __m512i a                       = _mm512_set1_epi32(pInput[(uint64_t)r * pairs + j]);
+                for (uint32_t q = 0; q < 4; q++)
+                    acc[r][q]                   = _mm512_add_epi32(acc[r][q], _mm512_madd_epi16(w[q], a));
+            }
+        }
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                _mm512_storeu_si512((__m512i*)(pAcc + r * QUANT_TILE + c + 16 * q), acc[r][q]);
+    }
+}
+
+static void QuantizedGemmTileAVX512(int32_t* pAcc, const int32_t* pInput, uint32_t rows, uint32_t pairs, const int8_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r += 4)
+    {
+        int32_t* pA                             = pAcc + r * QUANT_TILE;
+        const int32_t* pIn                      = pInput + (uint64_t)r * pairs;
+        switch (min(rows - r, 4u))
+        {
+            case 1: QuantizedGemmBlockAVX512<1>(pA, pIn, pairs, pWeight, stride, cols); break;
+            case 2: QuantizedGemmBlockAVX512<2>(pA, pIn, pairs, pWeight, stride, cols); break;
+            case 3: QuantizedGemmBlockAVX512<3>(pA, pIn, pairs, pWeight, stride, cols); break;
+            default: QuantizedGemmBlockAVX512<4>(pA, pIn, pairs, pWeight, stride, cols); break;
+        }
+    }
+}
+
+// Selecting one input of each pair with a (1, 0) or (0, 1) multiply-add sign extends it to int32 for free
+static void QuantizedAccumulateAVX512(int32_t* pAcc, NNFloat* pFAcc, NNFloat value, const int8_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const int8_t* pW                            = pWeight + (uint64_t)(k >> 1) * stride * 2;
+    const __m512i select                        = _mm512_set1_epi32((k & 1) ? 0x00010000 : 0x00000001);
+    const __m512 v                              = _mm512_set1_ps(value);
+    for (uint32_t c = 0; c < cols; c += 16)
+    {
+        __m512i w                               = _mm512_madd_epi16(_mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(pW + 2 * c))), select);
+        if (pFAcc)
+            _mm512_storeu_ps(pFAcc + c, _mm512_fmadd_ps(v, _mm512_cvtepi32_ps(w), _mm512_loadu_ps(pFAcc + c)));
+        else
+            _mm512_storeu_si512((__m512i*)(pAcc + c), _mm512_add_epi32(w, _mm512_loadu_si512((const __m512i*)(pAcc + c))));
+    }
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+// R rows (up to 2) x 32 outputs of accumulators, AVX2 only has 16 registers
+template<uint32_t R> static void QuantizedGemmBlockAVX2(int32_t* pAcc, const int32_t* pInput, uint32_t pairs, const int8_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t c = 0; c < cols; c += 32)
+    {
+        __m256i acc[R][4];
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                acc[r][q]                       = _mm256_setzero_si256();
+        const int8_t* pW                        = pWeight + 2 * c;
+        for (uint32_t j = 0; j < pairs; j++, pW += 2 * stride)
+        {
+            __m256i w[4];
+            for (uint32_t q = 0; q < 4; q++)
+                w[q]                            = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(pW + 16 * q)));
+            for (uint32_t r = 0; r < R; r++)
+            {
+                __m256i a                       = _mm256_set1_epi32(pInput[(uint64_t)r * pairs + j]);
+                for (uint32_t q = 0; q < 4; q++)
+                    acc[r][q]                   = _mm256_add_epi32(acc[r][q], _mm256_madd_epi16(w[q], a));
+            }
+        }
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                _mm256_storeu_si256((__m256i*)(pAcc + r * QUANT_TILE + c + 8 * q), acc[r][q]);
+    }
+}
+
+static void QuantizedGemmTileAVX2(int32_t* pAcc, const int32_t* pInput, uint32_t rows, uint32_t pairs, const int8_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r += 2)
+    {
+        if (rows - r == 1)
+            QuantizedGemmBlockAVX2<1>(pAcc + r * QUANT_TILE, pInput + (uint64_t)r * pairs, pairs, pWeight, stride, cols);
+        else
+            QuantizedGemmBlockAVX2<2>(pAcc + r * QUANT_TILE, pInput + (uint64_t)r * pairs, pairs, pWeight, stride, cols);
+    }
+}
+
+static void QuantizedAccumulateAVX2(int32_t* pAcc, NNFloat* pFAcc, NNFloat value, const int8_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const int8_t* pW                            = pWeight + (uint64_t)(k >> 1) * stride * 2;
+    const __m256i select                        = _mm256_set1_epi32((k & 1) ? 0x00010000 : 0x00000001);
+    const __m256 v                              = _mm256_set1_ps(value);
+    for (uint32_t c = 0; c < cols; c += 8)
+    {
+        __m256i w                               = _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(pW + 2 * c))), select);
+        if (pFAcc)
+            _mm256_storeu_ps(pFAcc + c, _mm256_fmadd_ps(v, _mm256_cvtepi32_ps(w), _mm256_loadu_ps(pFAcc + c)));
+        else
+            _mm256_storeu_si256((__m256i*)(pAcc + c), _mm256_add_epi32(w, _mm256_loadu_si256((const __m256i*)(pAcc + c))));
+    }
+}
+#pragma GCC pop_options
+#endif
+
+enum HostISA
+{
+    HostScalar,
+    HostAVX2,
+    HostAVX512,
+};
+
+// Same selection as the bitonic networks, DSSTNE_HOST_SIMD=avx2 or scalar caps it
+static HostISA GetHostISA()
+{
+#ifdef HOST_BITONIC_X86
+    static const char* pLimit                   = getenv("DSSTNE_HOST_SIMD");
+    static const HostISA isa                    = (__builtin_cpu_supports("avx512bw") && !pLimit) ? HostAVX512 :
+                                                  ((__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && (!pLimit || !strcmp(pLimit, "avx2"))) ? HostAVX2 : HostScalar);
+    return isa;
+#else
+    return HostScalar;
+#endif
+}
+
+void hQuantizedGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, NNFloat inputScale, const int8_t* pWeight, const NNFloat* pWeightScale, NNFloat* pUnit)
+{
+    // Quantize the activations up front into 16-bit pairs matching the weight layout, every output tile reads them
+    const uint32_t pairs                        = (inputs + 1) / 2;
+    const uint32_t stride                       = hQuantizedStride(outputs);
+    const NNFloat invScale                      = (NNFloat)1.0 / inputScale;
+    vector<int32_t> vInput((uint64_t)batch * pairs);
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < batch; pos++)
+    {
+        const NNFloat* pRow                     = pInput + (uint64_t)pos * inputs;
+        for (uint32_t j = 0; j < pairs; j++)
+        {
+            uint16_t a0                         = (uint16_t)(int16_t)QuantizeValue(pRow[2 * j], invScale);
+            uint16_t a1                         = (2 * j + 1 < inputs) ? (uint16_t)(int16_t)QuantizeValue(pRow[2 * j + 1], invScale) : 0;
+            vInput[(uint64_t)pos * pairs + j]   = (int32_t)(a0 | ((uint32_t)a1 << 16));
+        }
+    }
+
+    // Consecutive tasks share an output tile so its weights are read from memory once and then hit in L2
+    const HostISA isa                           = GetHostISA();
+    const int64_t rowBlocks                     = (batch + QUANT_ROWS - 1) / QUANT_ROWS;
+    const int64_t tiles                         = (outputs + QUANT_TILE - 1) / QUANT_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < rowBlocks * tiles; task++)
+    {
+        alignas(64) int32_t acc[QUANT_ROWS * QUANT_TILE];
+        uint32_t r0                             = (task % rowBlocks) * QUANT_ROWS;
+        uint32_t c0                             = (task / rowBlocks) * QUANT_TILE;
+        uint32_t rows                           = min(batch - r0, QUANT_ROWS);
+        uint32_t cols                           = min(stride - c0, QUANT_TILE);
+        const int32_t* pIn                      = &vInput[(uint64_t)r0 * pairs];
+        switch (isa)
+        {
+#ifdef HOST_BITONIC_X86
+            case HostAVX512:
+                QuantizedGemmTileAVX512(acc, pIn, rows, pairs, pWeight + 2 * c0, stride, cols);
+                break;
+
+            case HostAVX2:
+                QuantizedGemmTileAVX2(acc, pIn, rows, pairs, pWeight + 2 * c0, stride, cols);
+                break;
+#endif
+
+            default:
+                QuantizedGemmTile(acc, pIn, rows, pairs, pWeight + 2 * c0, stride, cols);
+                break;
+        }
+
+        cols                                    = min(outputs - c0, cols);
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            NNFloat* pRow                       = pUnit + (uint64_t)(r0 + r) * outputs + c0;
+            for (uint32_t c = 0; c < cols; c++)
+                pRow[c]                        += inputScale * pWeightScale[c0 + c] * (NNFloat)acc[r * QUANT_TILE + c];
+        }
+    }
+}
+
+// Boolean inputs sum whole int8 weight rows in int32, analog inputs accumulate in float.  Either way the
+// per output scale is applied once per tile at the end
+template<typename T> void hCalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const int8_t* pWeight, const NNFloat* pWeightScale,
+                                                     const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta)
+{
+    const GpuData& data                         = getGpu()._data;
+    const HostISA isa                           = GetHostISA();
+    const uint32_t weightStride                 = hQuantizedStride(stride);
+    const int64_t tiles                         = (stride + QUANT_TILE - 1) / QUANT_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < (int64_t)batch * tiles; task++)
+    {
+        alignas(64) int32_t iAcc[QUANT_TILE];
+        alignas(64) NNFloat fAcc[QUANT_TILE];
+        uint32_t pos                            = task / tiles;
+        uint32_t start                          = (task % tiles) * QUANT_TILE;
+        uint32_t cols                           = min(weightStride - start, QUANT_TILE);
+        uint32_t dpos                           = hDataPosition(data, position + pos);
+        const int8_t* pW                        = pWeight + 2 * start;
+        NNFloat* pFAcc                          = pSparseData ? fAcc : NULL;
+        memset(iAcc, 0, sizeof(iAcc));
+        memset(fAcc, 0, sizeof(fAcc));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            NNFloat value                       = pSparseData ? hDataValue(pSparseData[i]) : (NNFloat)1.0;
+            switch (isa)
+            {
+#ifdef HOST_BITONIC_X86
+                case HostAVX512:
+                    QuantizedAccumulateAVX512(iAcc, pFAcc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+
+                case HostAVX2:
+                    QuantizedAccumulateAVX2(iAcc, pFAcc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+#endif
+
+                default:
+                    QuantizedAccumulate(iAcc, pFAcc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+            }
+        }
+
+        cols                                    = min(stride - start, cols);
+        NNFloat* pRow                           = pUnit + (uint64_t)pos * stride + start;
+        for (uint32_t c = 0; c < cols; c++)
+        {
+            NNFloat z                           = pWeightScale[start + c] * ((NNFloat)iAcc[c] + fAcc[c]);
+            pRow[c]                             = (beta == (NNFloat)0.0) ? z : beta * pRow[c] + z;
+        }
+    }
+}
+
+// Half precision weights.  fp16 and bf16 are converted with round to nearest even, fp16 overflows to infinity
+static const uint32_t HALF_ROWS                 = 8;        // Batch rows per task
+static const uint32_t HALF_TILE                 = 256;      // Outputs per task, a multiple of QUANT_ALIGN
+static const uint32_t HALF_PREFETCH             = 8;        // Weight rows to prefetch ahead, rows are a page or more apart
+
+static inline uint16_t FloatToBF16(NNFloat f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7fffffff) > 0x7f800000)
+        return (x >> 16) | 0x40;
+    return (x + 0x7fff + ((x >> 16) & 1)) >> 16;
+}
+
+static inline NNFloat BF16ToFloat(uint16_t h)
+{
+    uint32_t x                                  = (uint32_t)h << 16;
+    NNFloat f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// The scalar kernels look fp16 values up instead of decoding them bit by bit
+static vector<NNFloat> BuildHalfTable()
+{
+    vector<NNFloat> vTable(65536);
+    for (uint32_t h = 0; h < 65536; h++)
+        vTable[h]                               = hHalfToFloat((uint16_t)h);
+    return vTable;
+}
+
+static const NNFloat* HalfTable()
+{
+    static const vector<NNFloat> vTable         = BuildHalfTable();
+    return vTable.data();
+}
+
+template<HalfFormat F> static inline NNFloat HalfValue(const NNFloat* pTable, uint16_t h)
+{
+    return (F == HalfFP16) ? pTable[h] : BF16ToFloat(h);
+}
+
+void hConvertWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, uint16_t* pHalfWeight, HalfFormat format)
+{
+    const uint32_t stride                       = hQuantizedStride(outputs);
+#pragma omp parallel for
+    for (int64_t i = 0; i < inputs; i++)
+    {
+        const NNFloat* pRow                     = pWeight + (uint64_t)i * outputs;
+        uint16_t* pHalfRow                      = pHalfWeight + (uint64_t)i * stride;
+        for (uint32_t o = 0; o < outputs; o++)
+            pHalfRow[o]                         = (format == HalfFP16) ? hFloatToHalf(pRow[o]) : FloatToBF16(pRow[o]);
+        for (uint32_t o = outputs; o < stride; o++)
+            pHalfRow[o]                         = 0;
+    }
+}
+
+// Accumulates rows x cols fp32 dot products of pInput (rows x inputs) with the half weights starting at output
+// pWeight into pAcc (rows x HALF_TILE).  cols is a multiple of QUANT_ALIGN
+template<HalfFormat F> static void HalfGemmTile(NNFloat* pAcc, const NNFloat* pInput, uint32_t rows, uint32_t inputs, const uint16_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        NNFloat* pA                             = pAcc + r * HALF_TILE;
+        const NNFloat* pTable                   = HalfTable();
+        memset(pA, 0, cols * sizeof(NNFloat));
+        for (uint32_t k = 0; k < inputs; k++)
+        {
+            NNFloat a                           = pInput[(uint64_t)r * inputs + k];
+            if (a == (NNFloat)0.0)
+                continue;
+            const uint16_t* pW                  = pWeight + (uint64_t)k * stride;
+            for (uint32_t c = 0; c < cols; c++)
+                pA[c]                          += a * HalfValue<F>(pTable, pW[c]);
+        }
+    }
+}
+
+template<HalfFormat F> static void HalfAccumulate(NNFloat* pAcc, NNFloat value, const uint16_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const uint16_t* pW                          = pWeight + (uint64_t)k * stride;
+    const NNFloat* pTable                       = HalfTable();
+    for (uint32_t c = 0; c < cols; c++)
+        pAcc[c]                                += value * HalfValue<F>(pTable, pW[c]);
+}
+
+#ifdef HOST_BITONIC_X86
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+template<HalfFormat F> static inline __m512 LoadHalfAVX512(const uint16_t* p)
+{
+    __m256i h                                   = _mm256_loadu_si256((const __m256i*)p);
+    return (F == HalfFP16) ? _mm512_cvtph_ps(h) : _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+}
+
+// R rows (up to 4) x 256 / R outputs of accumulators live in registers for the whole pass over the inputs, a
+// single row streams 512 contiguous bytes of weights per input instead of hopping a row stride every 128
+template<HalfFormat F, uint32_t R> static void HalfGemmBlockAVX512(NNFloat* pAcc, const NNFloat* pInput, uint32_t inputs, const uint16_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    const uint32_t Q                            = 16 / R;
+    for (uint32_t c = 0; c < cols; c += 16 * Q)
+    {
+        const uint32_t n                        = min(Q, (cols - c) / 16);
+        __m512 acc[R][Q];
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < Q; q++)
+                acc[r][q]                       = _mm512_setzero_ps();
+        const uint16_t* pW                      = pWeight + c;
+        for (uint32_t k = 0; k < inputs; k++, pW += stride)
+        {
+            __m512 w[Q];
+            for (uint32_t q = 0; q < Q; q++)
+                if (q < n)
+                {
+                    _mm_prefetch((const char*)(pW + HALF_PREFETCH * stride + 16 * q), _MM_HINT_T0);
+                    w[q]                        = LoadHalfAVX512<F>(pW + 16 * q);
+                }
+            for (uint32_t r = 0; r < R; r++)
+            {
+                __m512 a                        = _mm512_set1_ps(pInput[(uint64_t)r * inputs + k]);
+                for (uint32_t q = 0; q < Q; q++)
+                    if (q < n)
+                        acc[r][q]               = _mm512_fmadd_ps(w[q], a, acc[r][q]);
+            }
+        }
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < n; q++)
+                _mm512_storeu_ps(pAcc + r * HALF_TILE + c + 16 * q, acc[r][q]);
+    }
+}
+
+template<HalfFormat F> static void HalfGemmTileAVX512(NNFloat* pAcc, const NNFloat* pInput, uint32_t rows, uint32_t inputs, const uint16_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r += 4)
+    {
+        NNFloat* pA                             = pAcc + r * HALF_TILE;
+        const NNFloat* pIn                      = pInput + (uint64_t)r * inputs;
+        switch (min(rows - r, 4u))
+        {
+            case 1: HalfGemmBlockAVX512<F, 1>(pA, pIn, inputs, pWeight, stride, cols); break;
+            case 2: HalfGemmBlockAVX512<F, 2>(pA, pIn, inputs, pWeight, stride, cols); break;
+            case 3: HalfGemmBlockAVX512<F, 3>(pA, pIn, inputs, pWeight, stride, cols); break;
+            default: HalfGemmBlockAVX512<F, 4>(pA, pIn, inputs, pWeight, stride, cols); break;
+        }
+    }
+}
+
+template<HalfFormat F> static void HalfAccumulateAVX512(NNFloat* pAcc, NNFloat value, const uint16_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const uint16_t* pW                          = pWeight + (uint64_t)k * stride;
+    const __m512 v                              = _mm512_set1_ps(value);
+    for (uint32_t c = 0; c < cols; c += 16)
+        _mm512_storeu_ps(pAcc + c, _mm512_fmadd_ps(v, LoadHalfAVX512<F>(pW + c), _mm512_loadu_ps(pAcc + c)));
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+template<HalfFormat F> static inline __m256 LoadHalfAVX2(const uint16_t* p)
+{
+    __m128i h                                   = _mm_loadu_si128((const __m128i*)p);
+    return (F == HalfFP16) ? _mm256_cvtph_ps(h) : _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+// R rows (up to 2) x 32 outputs of accumulators
+template<HalfFormat F, uint32_t R> static void HalfGemmBlockAVX2(NNFloat* pAcc, const NNFloat* pInput, uint32_t inputs, const uint16_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t c = 0; c < cols; c += 32)
+    {
+        __m256 acc[R][4];
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                acc[r][q]                       = _mm256_setzero_ps();
+        const uint16_t* pW                      = pWeight + c;
+        for (uint32_t k = 0; k < inputs; k++, pW += stride)
+        {
+            __m256 w[4];
+            _mm_prefetch((const char*)(pW + HALF_PREFETCH * stride), _MM_HINT_T0);
+            for (uint32_t q = 0; q < 4; q++)
+                w[q]                            = LoadHalfAVX2<F>(pW + 8 * q);
+            for (uint32_t r = 0; r < R; r++)
+            {
+                __m256 a                        = _mm256_set1_ps(pInput[(uint64_t)r * inputs + k]);
+                for (uint32_t q = 0; q < 4; q++)
+                    acc[r][q]                   = _mm256_fmadd_ps(w[q], a, acc[r][q]);
+            }
+        }
+        for (uint32_t r = 0; r < R; r++)
+            for (uint32_t q = 0; q < 4; q++)
+                _mm256_storeu_ps(pAcc + r * HALF_TILE + c + 8 * q, acc[r][q]);
+    }
+}
+
+template<HalfFormat F> static void HalfGemmTileAVX2(NNFloat* pAcc, const NNFloat* pInput, uint32_t rows, uint32_t inputs, const uint16_t* pWeight, uint32_t stride, uint32_t cols)
+{
+    for (uint32_t r = 0; r < rows; r += 2)
+    {
+        if (rows - r == 1)
+            HalfGemmBlockAVX2<F, 1>(pAcc + r * HALF_TILE, pInput + (uint64_t)r * inputs, inputs, pWeight, stride, cols);
+        else
+            HalfGemmBlockAVX2<F, 2>(pAcc + r * HALF_TILE, pInput + (uint64_t)r * inputs, inputs, pWeight, stride, cols);
+    }
+}
+
+template<HalfFormat F> static void HalfAccumulateAVX2(NNFloat* pAcc, NNFloat value, const uint16_t* pWeight, uint32_t k, uint32_t stride, uint32_t cols)
+{
+    const uint16_t* pW                          = pWeight + (uint64_t)k * stride;
+    const __m256 v                              = _mm256_set1_ps(value);
+    for (uint32_t c = 0; c < cols; c += 8)
+        _mm256_storeu_ps(pAcc + c, _mm256_fmadd_ps(v, LoadHalfAVX2<F>(pW + c), _mm256_loadu_ps(pAcc + c)));
+}
+#pragma GCC pop_options
+#endif
+
+// Weights are widened to fp32 in registers, so memory traffic for them is halved and nothing else changes
+template<HalfFormat F> static void HalfGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, const uint16_t* pWeight, NNFloat* pUnit)
+{
+    const HostISA isa                           = GetHostISA();
+    const uint32_t stride                       = hQuantizedStride(outputs);
+    const int64_t rowBlocks                     = (batch + HALF_ROWS - 1) / HALF_ROWS;
+    const int64_t tiles                         = (outputs + HALF_TILE - 1) / HALF_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < rowBlocks * tiles; task++)
+    {
+        alignas(64) NNFloat acc[HALF_ROWS * HALF_TILE];
+        uint32_t r0                             = (task % rowBlocks) * HALF_ROWS;
+        uint32_t c0                             = (task / rowBlocks) * HALF_TILE;
+        uint32_t rows                           = min(batch - r0, HALF_ROWS);
+        uint32_t cols                           = min(stride - c0, HALF_TILE);
+        const NNFloat* pIn                      = pInput + (uint64_t)r0 * inputs;
+        switch (isa)
+        {
+#ifdef HOST_BITONIC_X86
+            case HostAVX512:
+                HalfGemmTileAVX512<F>(acc, pIn, rows, inputs, pWeight + c0, stride, cols);
+                break;
+
+            case HostAVX2:
+                HalfGemmTileAVX2<F>(acc, pIn, rows, inputs, pWeight + c0, stride, cols);
+                break;
+#endif
+
+            default:
+                HalfGemmTile<F>(acc, pIn, rows, inputs, pWeight + c0, stride, cols);
+                break;
+        }
+
+        cols                                    = min(outputs - c0, cols);
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            NNFloat* pRow                       = pUnit + (uint64_t)(r0 + r) * outputs + c0;
+            for (uint32_t c = 0; c < cols; c++)
+                pRow[c]                        += acc[r * HALF_TILE + c];
+        }
+    }
+}
+
+void hHalfGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, const uint16_t* pWeight, HalfFormat format, NNFloat* pUnit)
+{
+    if (format == HalfFP16)
+        HalfGemm<HalfFP16>(batch, outputs, inputs, pInput, pWeight, pUnit);
+    else
+        HalfGemm<HalfBF16>(batch, outputs, inputs, pInput, pWeight, pUnit);
+}
+
+template<typename T, HalfFormat F> static void HalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const uint16_t* pWeight,
+                                                           const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta)
+{
+    const GpuData& data                         = getGpu()._data;
+    const HostISA isa                           = GetHostISA();
+    const uint32_t weightStride                 = hQuantizedStride(stride);
+    const int64_t tiles                         = (stride + HALF_TILE - 1) / HALF_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < (int64_t)batch * tiles; task++)
+    {
+        alignas(64) NNFloat acc[HALF_TILE];
+        uint32_t pos                            = task / tiles;
+        uint32_t start                          = (task % tiles) * HALF_TILE;
+        uint32_t cols                           = min(weightStride - start, HALF_TILE);
+        uint32_t dpos                           = hDataPosition(data, position + pos);
+        const uint16_t* pW                      = pWeight + start;
+        memset(acc, 0, sizeof(acc));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            NNFloat value                       = pSparseData ? hDataValue(pSparseData[i]) : (NNFloat)1.0;
+            switch (isa)
+            {
+#ifdef HOST_BITONIC_X86
+                case HostAVX512:
+                    HalfAccumulateAVX512<F>(acc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+
+                case HostAVX2:
+                    HalfAccumulateAVX2<F>(acc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+#endif
+
+                default:
+                    HalfAccumulate<F>(acc, value, pW, pSparseIndex[i], weightStride, cols);
+                    break;
+            }
+        }
+
+        cols                                    = min(stride - start, cols);
+        NNFloat* pRow                           = pUnit + (uint64_t)pos * stride + start;
+        for (uint32_t c = 0; c < cols; c++)
+            pRow[c]                             = (beta == (NNFloat)0.0) ? acc[c] : beta * pRow[c] + acc[c];
+    }
+}
+
+template<typename T> void hCalculateHalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const uint16_t* pWeight, HalfFormat format,
+                                                const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta)
+{
+    if (format == HalfFP16)
+        HalfSparseZ<T, HalfFP16>(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, pUnit, beta);
+    else
+        HalfSparseZ<T, HalfBF16>(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, pUnit, beta);
+}
+
+// Pruned weights.  Blocks are one input by PRUNED_BLOCK outputs, so each kept block is one 8 wide fma per batch row
+// and the CSR adds a 4 byte column per 32 bytes of weights
+static const uint32_t PRUNED_ROWS               = 4;        // Batch rows per task
+
+uint64_t hPruneWeights(uint32_t inputs, uint32_t outputs, NNFloat* pWeight, NNFloat threshold, NNFloat density)
+{
+    const uint32_t columns                      = (outputs + PRUNED_BLOCK - 1) / PRUNED_BLOCK;
+    const uint64_t blocks                       = hPrunedBlocks(inputs, outputs);
+    vector<NNFloat> vNorm(blocks);
+#pragma omp parallel for schedule(static, 4096)
+    for (int64_t b = 0; b < (int64_t)blocks; b++)
+    {
+        NNFloat* pW                             = pWeight + (b / columns) * outputs + (b % columns) * PRUNED_BLOCK;
+        uint32_t width                          = min(PRUNED_BLOCK, outputs - (uint32_t)(b % columns) * PRUNED_BLOCK);
+        NNFloat maxWeight                       = (NNFloat)0.0;
+        NNFloat norm                            = (NNFloat)0.0;
+        for (uint32_t c = 0; c < width; c++)
+        {
+            maxWeight                           = max(maxWeight, fabsf(pW[c]));
+            norm                               += pW[c] * pW[c];
+        }
+        if ((maxWeight == (NNFloat)0.0) || (maxWeight < threshold))
+        {
+            memset(pW, 0, width * sizeof(NNFloat));
+            norm                                = (NNFloat)-1.0;
+        }
+        vNorm[b]                                = norm;
+    }
+
+    // Keep the density fraction of the surviving blocks with the largest norms, ties broken by position
+    vector<pair<NNFloat, uint64_t> > vBlock;
+    for (uint64_t b = 0; b < blocks; b++)
+        if (vNorm[b] >= (NNFloat)0.0)
+            vBlock.push_back(make_pair(-vNorm[b], b));
+    uint64_t kept                               = vBlock.size();
+    if (density < (NNFloat)1.0)
+    {
+        kept                                    = (uint64_t)((double)max(density, (NNFloat)0.0) * vBlock.size() + 0.5);
+        if (kept < vBlock.size())
+        {
+            nth_element(vBlock.begin(), vBlock.begin() + kept, vBlock.end());
+            for (uint64_t i = kept; i < vBlock.size(); i++)
+            {
+                uint64_t b                      = vBlock[i].second;
+                uint32_t width                  = min(PRUNED_BLOCK, outputs - (uint32_t)(b % columns) * PRUNED_BLOCK);
+                memset(pWeight + (b / columns) * outputs + (b % columns) * PRUNED_BLOCK, 0, width * sizeof(NNFloat));
+            }
+        }
+    }
+    return kept;
+}
+
+void hBuildPrunedWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, vector<uint64_t>& vRowStart, vector<uint32_t>& vColumn, vector<NNFloat>& vWeight)
+{
+    const uint32_t tiles                        = (outputs + PRUNED_TILE - 1) / PRUNED_TILE;
+    const uint64_t rows                         = (uint64_t)tiles * inputs;
+    vRowStart.assign(rows + 1, 0);
+
+    // Counts, then offsets, then copies of the non-zero blocks of each tile row
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int64_t row = 0; row < (int64_t)rows; row++)
+        {
+            uint32_t k                          = row % inputs;
+            uint32_t c0                         = (row / inputs) * PRUNED_TILE;
+            uint32_t c1                         = min(outputs, c0 + PRUNED_TILE);
+            const NNFloat* pW                   = pWeight + (uint64_t)k * outputs;
+            uint64_t count                      = 0;
+            for (uint32_t c = c0; c < c1; c += PRUNED_BLOCK)
+            {
+                uint32_t width                  = min(PRUNED_BLOCK, c1 - c);
+                bool bNonZero                   = false;
+                for (uint32_t i = 0; i < width; i++)
+                    bNonZero                   |= (pW[c + i] != (NNFloat)0.0);
+                if (!bNonZero)
+                    continue;
+                if (pass == 1)
+                {
+                    uint64_t b                  = vRowStart[row] + count;
+                    vColumn[b]                  = c;
+                    for (uint32_t i = 0; i < PRUNED_BLOCK; i++)
+                        vWeight[b * PRUNED_BLOCK + i] = (i < width) ? pW[c + i] : (NNFloat)0.0;
+                }
+                count++;
+            }
+            if (pass == 0)
+                vRowStart[row + 1]              = count;
+        }
+
+        if (pass == 0)
+        {
+            for (uint64_t row = 0; row < rows; row++)
+                vRowStart[row + 1]             += vRowStart[row];
+            vColumn.resize(vRowStart[rows]);
+            vWeight.resize(vRowStart[rows] * PRUNED_BLOCK);
+        }
+    }
+}
+
+// Accumulates rows of pInput (rows x inputs) times the pruned weights of the tile starting at output c0 into pAcc
+// (rows x PRUNED_TILE).  pRowStart points at the tile's first row, inputs that are zero in every row are skipped
+static void PrunedGemmTile(NNFloat* pAcc, const NNFloat* pInput, uint32_t rows, uint32_t inputs, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight, uint32_t c0)
+{
+    for (uint32_t k = 0; k < inputs; k++)
+    {
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            NNFloat a                           = pInput[(uint64_t)r * inputs + k];
+            if (a == (NNFloat)0.0)
+                continue;
+            NNFloat* pA                         = pAcc + r * PRUNED_TILE - c0;
+            for (uint64_t b = pRowStart[k]; b < pRowStart[k + 1]; b++)
+                for (uint32_t i = 0; i < PRUNED_BLOCK; i++)
+                    pA[pColumn[b] + i]         += a * pWeight[b * PRUNED_BLOCK + i];
+        }
+    }
+}
+
+static void PrunedAccumulate(NNFloat* pAcc, NNFloat value, uint64_t start, uint64_t end, const uint32_t* pColumn, const NNFloat* pWeight, uint32_t c0)
+{
+    for (uint64_t b = start; b < end; b++)
+        for (uint32_t i = 0; i < PRUNED_BLOCK; i++)
+            pAcc[pColumn[b] - c0 + i]          += value * pWeight[b * PRUNED_BLOCK + i];
+}
+
+#ifdef HOST_BITONIC_X86
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+// One block is exactly one __m256, AVX-512 gains nothing at 8 outputs per block so both ISAs use this path
+template<uint32_t R> static void PrunedGemmBlockAVX2(NNFloat* pAcc, const NNFloat* pInput, uint32_t inputs, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight, uint32_t c0)
+{
+    for (uint32_t k = 0; k < inputs; k++)
+    {
+        __m256 a[R];
+        bool bActive                            = false;
+        for (uint32_t r = 0; r < R; r++)
+        {
+            NNFloat value                       = pInput[(uint64_t)r * inputs + k];
+            bActive                            |= (value != (NNFloat)0.0);
+            a[r]                                = _mm256_set1_ps(value);
+        }
+        if (!bActive)
+            continue;
+        for (uint64_t b = pRowStart[k]; b < pRowStart[k + 1]; b++)
+        {
+            __m256 w                            = _mm256_loadu_ps(pWeight + b * PRUNED_BLOCK);
+            NNFloat* pA                         = pAcc + pColumn[b] - c0;
+            for (uint32_t r = 0; r < R; r++)
+                _mm256_storeu_ps(pA + r * PRUNED_TILE, _mm256_fmadd_ps(a[r], w, _mm256_loadu_ps(pA + r * PRUNED_TILE)));
+        }
+    }
+}
+
+static void PrunedGemmTileAVX2(NNFloat* pAcc, const NNFloat* pInput, uint32_t rows, uint32_t inputs, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight, uint32_t c0)
+{
+    switch (rows)
+    {
+        case 1:  PrunedGemmBlockAVX2<1>(pAcc, pInput, inputs, pRowStart, pColumn, pWeight, c0); break;
+        case 2:  PrunedGemmBlockAVX2<2>(pAcc, pInput, inputs, pRowStart, pColumn, pWeight, c0); break;
+        case 3:  PrunedGemmBlockAVX2<3>(pAcc, pInput, inputs, pRowStart, pColumn, pWeight, c0); break;
+        default: PrunedGemmBlockAVX2<4>(pAcc, pInput, inputs, pRowStart, pColumn, pWeight, c0); break;
+    }
+}
+
+static void PrunedAccumulateAVX2(NNFloat* pAcc, NNFloat value, uint64_t start, uint64_t end, const uint32_t* pColumn, const NNFloat* pWeight, uint32_t c0)
+{
+    __m256 a                                    = _mm256_set1_ps(value);
+    for (uint64_t b = start; b < end; b++)
+    {
+        NNFloat* pA                             = pAcc + pColumn[b] - c0;
+        _mm256_storeu_ps(pA, _mm256_fmadd_ps(a, _mm256_loadu_ps(pWeight + b * PRUNED_BLOCK), _mm256_loadu_ps(pA)));
+    }
+}
+#pragma GCC pop_options
+#endif
+
+void hPrunedGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight, NNFloat* pUnit)
+{
+    const HostISA isa                           = GetHostISA();
+    const int64_t rowBlocks                     = (batch + PRUNED_ROWS - 1) / PRUNED_ROWS;
+    const int64_t tiles                         = (outputs + PRUNED_TILE - 1) / PRUNED_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < rowBlocks * tiles; task++)
+    {
+        alignas(64) NNFloat acc[PRUNED_ROWS * PRUNED_TILE];
+        uint32_t r0                             = (task % rowBlocks) * PRUNED_ROWS;
+        uint32_t tile                           = task / rowBlocks;
+        uint32_t c0                             = tile * PRUNED_TILE;
+        uint32_t rows                           = min(batch - r0, PRUNED_ROWS);
+        uint32_t cols                           = min(outputs - c0, PRUNED_TILE);
+        const NNFloat* pIn                      = pInput + (uint64_t)r0 * inputs;
+        const uint64_t* pStart                  = pRowStart + (uint64_t)tile * inputs;
+        memset(acc, 0, rows * PRUNED_TILE * sizeof(NNFloat));
+        switch (isa)
+        {
+#ifdef HOST_BITONIC_X86
+            case HostAVX512:
+            case HostAVX2:
+                PrunedGemmTileAVX2(acc, pIn, rows, inputs, pStart, pColumn, pWeight, c0);
+                break;
+#endif
+
+            default:
+                PrunedGemmTile(acc, pIn, rows, inputs, pStart, pColumn, pWeight, c0);
+                break;
+        }
+
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            NNFloat* pRow                       = pUnit + (uint64_t)(r0 + r) * outputs + c0;
+            for (uint32_t c = 0; c < cols; c++)
+                pRow[c]                        += acc[r * PRUNED_TILE + c];
+        }
+    }
+}
+
+template<typename T> void hCalculatePrunedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint32_t inputs, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight,
+                                                  const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta)
+{
+    const GpuData& data                         = getGpu()._data;
+    const HostISA isa                           = GetHostISA();
+    const int64_t tiles                         = (stride + PRUNED_TILE - 1) / PRUNED_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < (int64_t)batch * tiles; task++)
+    {
+        alignas(64) NNFloat acc[PRUNED_TILE];
+        uint32_t pos                            = task / tiles;
+        uint32_t tile                           = task % tiles;
+        uint32_t start                          = tile * PRUNED_TILE;
+        uint32_t cols                           = min(stride - start, PRUNED_TILE);
+        uint32_t dpos                           = hDataPosition(data, position + pos);
+        const uint64_t* pStart                  = pRowStart + (uint64_t)tile * inputs;
+        memset(acc, 0, sizeof(acc));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            NNFloat value                       = pSparseData ? hDataValue(pSparseData[i]) : (NNFloat)1.0;
+            uint32_t k                          = pSparseIndex[i];
+            switch (isa)
+            {
+#ifdef HOST_BITONIC_X86
+                case HostAVX512:
+                case HostAVX2:
+                    PrunedAccumulateAVX2(acc, value, pStart[k], pStart[k + 1], pColumn, pWeight, start);
+                    break;
+#endif
+
+                default:
+                    PrunedAccumulate(acc, value, pStart[k], pStart[k + 1], pColumn, pWeight, start);
+                    break;
+            }
+        }
+
+        NNFloat* pRow                           = pUnit + (uint64_t)pos * stride + start;
+        for (uint32_t c = 0; c < cols; c++)
+            pRow[c]                             = (beta == (NNFloat)0.0) ? acc[c] : beta * pRow[c] + acc[c];
+    }
+}
+
+template bool hSort<NNFloat, NNFloat>(uint32_t, NNFloat*, NNFloat*, NNFloat*, NNFloat*);
+template bool hSort<NNFloat, uint32_t>(uint32_t, NNFloat*, NNFloat*, uint32_t*, uint32_t*);
+template bool hSort<uint32_t, NNFloat>(uint32_t, uint32_t*, uint32_t*, NNFloat*, NNFloat*);
+template bool hSort<uint32_t, uint32_t>(uint32_t, uint32_t*, uint32_t*, uint32_t*, uint32_t*);
+template void hCalculateQuantizedSparseZ<NNFloat>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const NNFloat*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<double>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const double*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<unsigned char>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const unsigned char*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<char>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const char*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<uint32_t>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const uint32_t*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<uint64_t>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const uint64_t*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<int32_t>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const int32_t*, NNFloat*, NNFloat);
+template void hCalculateQuantizedSparseZ<int64_t>(uint32_t, uint32_t, uint32_t, const int8_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const int64_t*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<NNFloat>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const NNFloat*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<double>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const double*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<unsigned char>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const unsigned char*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<char>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const char*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<uint32_t>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const uint32_t*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<uint64_t>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const uint64_t*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<int32_t>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const int32_t*, NNFloat*, NNFloat);
+template void hCalculateHalfSparseZ<int64_t>(uint32_t, uint32_t, uint32_t, const uint16_t*, HalfFormat, const uint64_t*, const uint64_t*, const uint32_t*, const int64_t*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<NNFloat>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const NNFloat*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<double>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const double*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<unsigned char>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const unsigned char*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<char>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const char*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<uint32_t>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const uint32_t*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<uint64_t>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const uint64_t*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<int32_t>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const int32_t*, NNFloat*, NNFloat);
+template void hCalculatePrunedSparseZ<int64_t>(uint32_t, uint32_t, uint32_t, uint32_t, const uint64_t*, const uint32_t*, const NNFloat*, const uint64_t*, const uint64_t*, const uint32_t*, const int64_t*, NNFloat*, NNFloat);
@@ -0,0 +1,115 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __HOSTKERNELS_H__
+#define __HOSTKERNELS_H__
+
+// Host (CPU) counterparts of the GPU kernels in kernels.h.  All pointers are system memory,
+// and all calls are multithreaded with OpenMP across the batch.
+
+// Top K selection, identical layout and ordering to kCalculateTopK (keys sorted in descending order,
+// rows shorter than k are padded with -MAX_VALUE and 0), but without any limit on k
+void hCalculateTopK(NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k);
+void hCalculateTopK(NNFloat* pOutputKey, NNFloat* pOutputValue, NNFloat *pKey, NNFloat* pValue, uint32_t batch, uint32_t width, uint32_t k);
+void hCalculateTopK(NNFloat* pOutputKey, uint32_t* pOutputValue, NNFloat *pKey, uint32_t * pValue, uint32_t batch, uint32_t width, uint32_t k);
+
+// Top K selection of the first overload with filters applied during selection: the keys of row i at
+// the positions pFilterIndex[pFilterStart[i]] to pFilterIndex[pFilterEnd[i] - 1] (ascending) are multiplied by
+// the matching pFilterValue, and every key of row i by the score mask pMask + pMaskRow[i] * width (pMask for all
+// rows if pMaskRow is NULL).  Either filter may be NULL.  pOutputKey is left untouched
+void hCalculateFilteredTopK(const NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k,
+                            const uint64_t* pFilterStart, const uint64_t* pFilterEnd, const uint32_t* pFilterIndex, const NNFloat* pFilterValue,
+                            const NNFloat* pMask = NULL, const uint32_t* pMaskRow = NULL);
+
+// Ascending key/value radix sort, same contract as kSort: pKey0/pValue0 hold the input and the sorted
+// output, pKey1/pValue1 are scratch space of at least items entries.  Sorting is stable.
+template<typename KeyType, typename ValueType> bool hSort(uint32_t items, KeyType* pKey0, KeyType* pKey1, ValueType* pValue0, ValueType* pValue1);
+
+// SIMD bitonic sort of n key/value pairs by key, the host counterpart of the bitonic.h warp networks.
+// Uses AVX-512 or AVX2 if the CPU has them, not stable
+void hBitonicSort(NNFloat* pKey, uint32_t* pValue, uint32_t n, bool bDescending = false);
+
+// Merges two ascending runs of key/value pairs into pKey/pValue (na + nb entries) with SIMD bitonic merges
+void hBitonicMerge(const NNFloat* pKeyA, const uint32_t* pValueA, uint32_t na, const NNFloat* pKeyB, const uint32_t* pValueB, uint32_t nb, NNFloat* pKey, uint32_t* pValue);
+
+// Fills pIndex with a uniformly random permutation of 0 to items - 1.  Output depends only on items
+// and seed, never on the number of threads
+void hShuffleIndices(uint32_t* pIndex, uint32_t items, uint64_t seed);
+
+// INT8 inference.  hQuantizeWeights converts an inputs x outputs row major weight matrix to symmetric int8 with
+// one scale per output, pQuantizedWeight needs hQuantizedSize bytes and pWeightScale hQuantizedStride entries.
+// hQuantizedGemm adds pInput * W to pUnit (batch x outputs), quantizing pInput (batch x inputs) with inputScale on
+// the fly.  hCalculateQuantizedSparseZ is kCalculateSparseZ/kCalculateSparseAnalogZ on int8 weights, pSparseData
+// is NULL for boolean data.  Products of int8 values are at most 127 * 127, so layers with more than QUANT_MAX_INPUTS
+// inputs could overflow the int32 sums and stay fp32
+static const uint32_t QUANT_ALIGN               = 64;
+static const uint32_t QUANT_MAX_INPUTS          = INT32_MAX / (127 * 127);
+inline uint32_t hQuantizedStride(uint32_t outputs) { return (outputs + QUANT_ALIGN - 1) & ~(QUANT_ALIGN - 1); }
+inline uint64_t hQuantizedSize(uint32_t inputs, uint32_t outputs) { return (uint64_t)((inputs + 1) / 2) * hQuantizedStride(outputs) * 2; }
+void hQuantizeWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, int8_t* pQuantizedWeight, NNFloat* pWeightScale);
+void hQuantizedGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, NNFloat inputScale, const int8_t* pWeight, const NNFloat* pWeightScale, NNFloat* pUnit);
+template<typename T> void hCalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const int8_t* pWeight, const NNFloat* pWeightScale,
+                                                     const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta);
+
+// Half precision weights.  hConvertWeights stores an inputs x outputs row major weight matrix as fp16 or bf16 with
+// rows padded to hQuantizedStride(outputs), pHalfWeight needs hHalfSize entries.  hHalfGemm and hCalculateHalfSparseZ
+// are the INT8 entry points above on these weights, accumulating in fp32
+enum HalfFormat
+{
+    HalfFP16,
+    HalfBF16,
+};
+inline uint64_t hHalfSize(uint32_t inputs, uint32_t outputs) { return (uint64_t)inputs * hQuantizedStride(outputs); }
+void hConvertWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, uint16_t* pHalfWeight, HalfFormat format);
+void hHalfGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, const uint16_t* pWeight, HalfFormat format, NNFloat* pUnit);
+template<typename T> void hCalculateHalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const uint16_t* pWeight, HalfFormat format,
+                                                const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta);
+
+// Pruned weights.  An inputs x outputs row major weight matrix is cut into blocks of PRUNED_BLOCK consecutive outputs
+// of one input, and only blocks with a non-zero weight are kept.  hPruneWeights zeroes every block whose largest
+// magnitude is below threshold, then all but the fraction density of the remaining blocks with the largest L2 norms,
+// and returns the number of blocks left.  hBuildPrunedWeights stores the non-zero blocks as CSR over
+// PRUNED_TILE output tiles: blocks of tile t and input k are pRowStart[t * inputs + k] to pRowStart[t * inputs + k + 1],
+// with their first output in pColumn and PRUNED_BLOCK weights each in pWeight.  hPrunedGemm and
+// hCalculatePrunedSparseZ are the INT8 entry points above on these weights
+static const uint32_t PRUNED_BLOCK              = 8;
+static const uint32_t PRUNED_TILE               = 256;
+inline uint64_t hPrunedBlocks(uint32_t inputs, uint32_t outputs) { return (uint64_t)inputs * ((outputs + PRUNED_BLOCK - 1) / PRUNED_BLOCK); }
+uint64_t hPruneWeights(uint32_t inputs, uint32_t outputs, NNFloat* pWeight, NNFloat threshold, NNFloat density);
+void hBuildPrunedWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, vector<uint64_t>& vRowStart, vector<uint32_t>& vColumn, vector<NNFloat>& vWeight);
+void hPrunedGemm(uint32_t batch, uint32_t outputs, uint32_t inputs, const NNFloat* pInput, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight, NNFloat* pUnit);
+template<typename T> void hCalculatePrunedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint32_t inputs, const uint64_t* pRowStart, const uint32_t* pColumn, const NNFloat* pWeight,
+                                                  const uint64_t* pSparseStart, const uint64_t* pSparseEnd, const uint32_t* pSparseIndex, const T* pSparseData, NNFloat* pUnit, NNFloat beta);
+
+// Dataset example backing batch position pos, honoring shuffled indices
+inline uint32_t hDataPosition(const GpuData& data, uint32_t pos)
+{
+    return data._bShuffleIndices ? data._pShuffleIndex[pos] : pos;
+}
+
+// Converts an analog data value to NNFloat, 8-bit data is fixed point exactly as in the GPU kernels
+template<typename T> inline NNFloat hDataValue(T value)
+{
+    return (NNFloat)value;
+}
+
+template<> inline NNFloat hDataValue<unsigned char>(unsigned char value)
+{
+    return (NNFloat)value * (NNFloat)(1.0 / 256.0);
+}
+
+template<> inline NNFloat hDataValue<char>(char value)
+{
+    return (NNFloat)value * (NNFloat)(1.0 / 128.0);
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __HOSTSORT_H__
+#define __HOSTSORT_H__
+
+// System memory counterpart of GpuSort: fill GetKeyPointer()/GetValuePointer() with items keys and values,
+// call Sort() and read the results back from the same pointers.
+template<typename KeyType, typename ValueType> class HostSort
+{
+private:
+    unsigned int                    _items;
+    unsigned int                    _itemStride;
+    KeyType*                        _pbKey;
+    KeyType*                        _pKey0;
+    KeyType*                        _pKey1;
+    ValueType*                      _pbValue;
+    ValueType*                      _pValue0;
+    ValueType*                      _pValue1;
+    KeyType*                        _pKey;
+    ValueType*                      _pValue;
+
+    template<typename T> static T* Allocate(size_t length)
+    {
+        void* p                     = NULL;
+        if (posix_memalign(&p, 64, length * sizeof(T)))
+        {
+            printf("HostSort::HostSort: Failed to allocate %lu bytes, exiting.\n", length * sizeof(T));
+            exit(-1);
+        }
+        return (T*)p;
+    }
+
+public:
+    HostSort(unsigned int items) :
+    _items(items),
+    _itemStride(((items + 511) >> 9) << 9),
+    _pbKey(Allocate<KeyType>((size_t)_itemStride * 2)),
+    _pKey0(_pbKey),
+    _pKey1(_pbKey + _itemStride),
+    _pbValue(Allocate<ValueType>((size_t)_itemStride * 2)),
+    _pValue0(_pbValue),
+    _pValue1(_pbValue + _itemStride)
+    {
+        _pKey                       = _pKey0;
+        _pValue                     = _pValue0;
+    }
+
+    ~HostSort()
+    {
+        free(_pbKey);
+        free(_pbValue);
+    }
+    bool Sort() { return hSort(_items, _pKey0, _pKey1, _pValue0, _pValue1); }
+    KeyType* GetKeyPointer() { return _pKey;}
+    ValueType* GetValuePointer() { return _pValue; }
+};
+#endif
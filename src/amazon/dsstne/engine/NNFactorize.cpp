@@ -0,0 +1,245 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include <random>
+
+// Extra range samples beyond rank, and power iterations to sharpen a slowly decaying spectrum
+static const uint32_t FACTOR_OVERSAMPLE             = 10;
+static const uint32_t FACTOR_POWER_ITERATIONS       = 2;
+static const uint32_t FACTOR_JACOBI_SWEEPS          = 50;
+static const uint32_t FACTOR_SEED                   = 12345;
+
+// Row major C = op(A) op(B) with C [m][n], as column major C^T = op(B)^T op(A)^T
+static bool RowMajorSgemm(bool bTransA, bool bTransB, int m, int n, int k, const NNFloat* pA, const NNFloat* pB, NNFloat* pC)
+{
+    const NNFloat alpha                             = (NNFloat)1.0;
+    const NNFloat beta                              = (NNFloat)0.0;
+    cublasStatus_t cstatus                          = cublasSgemm(getGpu()._cuBLASHandle,
+                                                                  bTransB ? CUBLAS_OP_T : CUBLAS_OP_N,
+                                                                  bTransA ? CUBLAS_OP_T : CUBLAS_OP_N,
+                                                                  n, m, k,
+                                                                  &alpha,
+                                                                  pB, bTransB ? k : n,
+                                                                  pA, bTransA ? m : k,
+                                                                  &beta,
+                                                                  pC, n);
+    return (cstatus == CUBLAS_STATUS_SUCCESS);
+}
+
+// Orthonormalizes the columns of the row major [rows][cols] matrix pY in place with two passes of modified
+// Gram-Schmidt.  Columns that vanish (rank deficient samples) are zeroed
+static void Orthonormalize(uint32_t rows, uint32_t cols, NNFloat* pY)
+{
+    vector<double> vQ((size_t)rows * cols);
+    for (uint32_t r = 0; r < rows; r++)
+        for (uint32_t c = 0; c < cols; c++)
+            vQ[(size_t)c * rows + r]                = pY[(size_t)r * cols + c];
+
+    for (uint32_t c = 0; c < cols; c++)
+    {
+        double* pC                                  = &vQ[(size_t)c * rows];
+        double norm0                                = 0.0;
+        for (uint32_t r = 0; r < rows; r++)
+            norm0                                  += pC[r] * pC[r];
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            for (uint32_t p = 0; p < c; p++)
+            {
+                const double* pP                    = &vQ[(size_t)p * rows];
+                double dot                          = 0.0;
+                for (uint32_t r = 0; r < rows; r++)
+                    dot                            += pP[r] * pC[r];
+                for (uint32_t r = 0; r < rows; r++)
+                    pC[r]                          -= dot * pP[r];
+            }
+        }
+        double norm                                 = 0.0;
+        for (uint32_t r = 0; r < rows; r++)
+            norm                                   += pC[r] * pC[r];
+        double scale                                = (norm > 1.0e-20 * norm0) && (norm > 0.0) ? 1.0 / sqrt(norm) : 0.0;
+        for (uint32_t r = 0; r < rows; r++)
+            pC[r]                                  *= scale;
+    }
+
+    for (uint32_t r = 0; r < rows; r++)
+        for (uint32_t c = 0; c < cols; c++)
+            pY[(size_t)r * cols + c]                = (NNFloat)vQ[(size_t)c * rows + r];
+}
+
+// Cyclic Jacobi eigensolver for the symmetric [n][n] matrix vA.  On return the diagonal of vA holds the
+// eigenvalues and the columns of vV the matching eigenvectors
+static void JacobiEigen(uint32_t n, vector<double>& vA, vector<double>& vV)
+{
+    vV.assign((size_t)n * n, 0.0);
+    for (uint32_t i = 0; i < n; i++)
+        vV[(size_t)i * n + i]                       = 1.0;
+
+    double total                                    = 0.0;
+    for (size_t i = 0; i < vA.size(); i++)
+        total                                      += vA[i] * vA[i];
+
+    for (uint32_t sweep = 0; sweep < FACTOR_JACOBI_SWEEPS; sweep++)
+    {
+        double off                                  = 0.0;
+        for (uint32_t p = 0; p < n; p++)
+            for (uint32_t q = p + 1; q < n; q++)
+                off                                += vA[(size_t)p * n + q] * vA[(size_t)p * n + q];
+        if (off <= 1.0e-24 * total)
+            break;
+
+        for (uint32_t p = 0; p < n; p++)
+        {
+            for (uint32_t q = p + 1; q < n; q++)
+            {
+                double apq                          = vA[(size_t)p * n + q];
+                if (apq == 0.0)
+                    continue;
+                double theta                        = (vA[(size_t)q * n + q] - vA[(size_t)p * n + p]) / (2.0 * apq);
+                double t                            = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c                            = 1.0 / sqrt(t * t + 1.0);
+                double s                            = t * c;
+                for (uint32_t k = 0; k < n; k++)
+                {
+                    double akp                      = vA[(size_t)k * n + p];
+                    double akq                      = vA[(size_t)k * n + q];
+                    vA[(size_t)k * n + p]           = c * akp - s * akq;
+                    vA[(size_t)k * n + q]           = s * akp + c * akq;
+                }
+                for (uint32_t k = 0; k < n; k++)
+                {
+                    double apk                      = vA[(size_t)p * n + k];
+                    double aqk                      = vA[(size_t)q * n + k];
+                    vA[(size_t)p * n + k]           = c * apk - s * aqk;
+                    vA[(size_t)q * n + k]           = s * apk + c * aqk;
+                }
+                for (uint32_t k = 0; k < n; k++)
+                {
+                    double vkp                      = vV[(size_t)k * n + p];
+                    double vkq                      = vV[(size_t)k * n + q];
+                    vV[(size_t)k * n + p]           = c * vkp - s * vkq;
+                    vV[(size_t)k * n + q]           = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+bool FactorizeWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, uint32_t rank, vector<NNFloat>& vLeft, vector<NNFloat>& vRight, NNFloat* pEnergy)
+{
+    if ((rank == 0) || (rank > min(inputs, outputs)))
+    {
+        printf("FactorizeWeights: Rank %u must be between 1 and %u.\n", rank, min(inputs, outputs));
+        return false;
+    }
+
+    // Gaussian test matrix Omega [outputs][samples]
+    uint32_t samples                                = min(rank + FACTOR_OVERSAMPLE, min(inputs, outputs));
+    vector<NNFloat> vOmega((size_t)outputs * samples);
+    mt19937 rng(FACTOR_SEED);
+    normal_distribution<NNFloat> normal((NNFloat)0.0, (NNFloat)1.0);
+    for (size_t i = 0; i < vOmega.size(); i++)
+        vOmega[i]                                   = normal(rng);
+
+    GpuBuffer<NNFloat>* pbWeight                    = new GpuBuffer<NNFloat>((uint64_t)inputs * outputs);
+    GpuBuffer<NNFloat>* pbWide                      = new GpuBuffer<NNFloat>((uint64_t)outputs * samples);
+    GpuBuffer<NNFloat>* pbWide1                     = new GpuBuffer<NNFloat>((uint64_t)outputs * samples);
+    GpuBuffer<NNFloat>* pbRange                     = new GpuBuffer<NNFloat>((uint64_t)inputs * samples);
+    GpuBuffer<NNFloat>* pbGram                      = new GpuBuffer<NNFloat>((uint64_t)samples * samples);
+    pbWeight->Upload(const_cast<NNFloat*>(pWeight));
+    pbWide->Upload(vOmega.data());
+
+    // Range Y = (W W^T)^q W Omega, re-orthonormalized after every product with W
+    bool bResult                                    = RowMajorSgemm(false, false, inputs, samples, outputs, pbWeight->_pDevData, pbWide->_pDevData, pbRange->_pDevData);
+    vector<NNFloat> vQ((size_t)inputs * samples);
+    for (uint32_t it = 0; bResult && (it < FACTOR_POWER_ITERATIONS); it++)
+    {
+        pbRange->Download(vQ.data());
+        Orthonormalize(inputs, samples, vQ.data());
+        pbRange->Upload(vQ.data());
+        bResult                                     = RowMajorSgemm(true, false, outputs, samples, inputs, pbWeight->_pDevData, pbRange->_pDevData, pbWide->_pDevData) &&
+                                                      RowMajorSgemm(false, false, inputs, samples, outputs, pbWeight->_pDevData, pbWide->_pDevData, pbRange->_pDevData);
+    }
+    pbRange->Download(vQ.data());
+    Orthonormalize(inputs, samples, vQ.data());
+    pbRange->Upload(vQ.data());
+
+    // B = Q^T W [samples][outputs], and the eigenvectors of B B^T give the left singular vectors Q V
+    vector<NNFloat> vGram((size_t)samples * samples);
+    bResult                                         = bResult &&
+                                                      RowMajorSgemm(true, false, samples, outputs, inputs, pbRange->_pDevData, pbWeight->_pDevData, pbWide->_pDevData) &&
+                                                      RowMajorSgemm(false, true, samples, samples, outputs, pbWide->_pDevData, pbWide->_pDevData, pbGram->_pDevData);
+    if (bResult)
+    {
+        pbGram->Download(vGram.data());
+        vector<double> vA(vGram.begin(), vGram.end());
+        vector<double> vV;
+        JacobiEigen(samples, vA, vV);
+        vector<pair<double, uint32_t> > vEigen(samples);
+        for (uint32_t i = 0; i < samples; i++)
+            vEigen[i]                               = make_pair(-vA[(size_t)i * samples + i], i);
+        sort(vEigen.begin(), vEigen.end());
+
+        // L = Q V_r S^1/2 on the host, R = S^-1/2 V_r^T B through cuBLAS
+        vector<NNFloat> vProject((size_t)rank * samples);
+        vector<double> vScale(rank);
+        double kept                                 = 0.0;
+        for (uint32_t j = 0; j < rank; j++)
+        {
+            double lambda                           = max(-vEigen[j].first, 0.0);
+            kept                                   += lambda;
+            vScale[j]                               = sqrt(sqrt(lambda));
+            uint32_t e                              = vEigen[j].second;
+            for (uint32_t i = 0; i < samples; i++)
+                vProject[(size_t)j * samples + i]   = (vScale[j] > 0.0) ? (NNFloat)(vV[(size_t)i * samples + e] / vScale[j]) : (NNFloat)0.0;
+        }
+        vLeft.assign((size_t)inputs * rank, (NNFloat)0.0);
+#pragma omp parallel for
+        for (int64_t r = 0; r < (int64_t)inputs; r++)
+        {
+            for (uint32_t j = 0; j < rank; j++)
+            {
+                uint32_t e                          = vEigen[j].second;
+                double sum                          = 0.0;
+                for (uint32_t i = 0; i < samples; i++)
+                    sum                            += (double)vQ[(size_t)r * samples + i] * vV[(size_t)i * samples + e];
+                vLeft[(size_t)r * rank + j]         = (NNFloat)(sum * vScale[j]);
+            }
+        }
+
+        GpuBuffer<NNFloat>* pbProject               = new GpuBuffer<NNFloat>((uint64_t)rank * samples);
+        pbProject->Upload(vProject.data());
+        bResult                                     = RowMajorSgemm(false, false, rank, outputs, samples, pbProject->_pDevData, pbWide->_pDevData, pbWide1->_pDevData);
+        delete pbProject;
+        vRight.resize((size_t)rank * outputs);
+        pbWide1->Download(vOmega.data());
+        copy(vOmega.begin(), vOmega.begin() + vRight.size(), vRight.begin());
+
+        if (pEnergy != NULL)
+        {
+            double total                            = 0.0;
+            for (uint64_t i = 0; i < (uint64_t)inputs * outputs; i++)
+                total                              += (double)pWeight[i] * pWeight[i];
+            *pEnergy                                = (total > 0.0) ? (NNFloat)(kept / total) : (NNFloat)1.0;
+        }
+    }
+
+    delete pbWeight;
+    delete pbWide;
+    delete pbWide1;
+    delete pbRange;
+    delete pbGram;
+    if (!bResult)
+        printf("FactorizeWeights: SGEMM failure.\n");
+    return bResult;
+}
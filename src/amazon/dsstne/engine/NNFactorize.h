@@ -0,0 +1,23 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef NNFACTORIZE_H
+
+// Rank r factorization of an [inputs][outputs] fully connected weight matrix W ~= L R, with L [inputs][rank]
+// and R [rank][outputs] row major, from a randomized truncated SVD (Halko, Martinsson and Tropp): the range
+// of W is sampled with a Gaussian test matrix and a few power iterations, and the small projected problem is
+// solved exactly.  Each factor carries the square root of the singular values.  Matrix products run through
+// cuBLAS, which host builds map to BLAS.  pEnergy, if not NULL, receives the fraction of ||W||^2 kept
+bool FactorizeWeights(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, uint32_t rank, vector<NNFloat>& vLeft, vector<NNFloat>& vRight, NNFloat* pEnergy = NULL);
+
+#define NNFACTORIZE_H
+#endif
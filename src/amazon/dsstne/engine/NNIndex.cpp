@@ -0,0 +1,246 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include <random>
+
+// k-means is trained on at most this many sampled outputs per list, then every output is assigned once
+static const uint32_t INDEX_TRAINING_POINTS         = 256;
+static const uint32_t INDEX_MAGIC                   = 0x58444e49;   // "INDX"
+static const uint32_t INDEX_VERSION                 = 1;
+static const uint32_t INDEX_SEED                    = 12345;
+
+NNIndex::NNIndex() :
+_inputs(0),
+_outputs(0),
+_lists(0),
+_probes(0)
+{
+}
+
+// Nearest centroid of each point by L2 distance, ||c||^2 - 2 x.c since ||x||^2 is the same for all lists
+static void AssignLists(uint32_t points, uint32_t dims, const NNFloat* pPoint, uint32_t lists, const NNFloat* pCentroid, uint32_t* pList)
+{
+    vector<NNFloat> vNorm(lists, (NNFloat)0.0);
+    for (uint32_t l = 0; l < lists; l++)
+        for (uint32_t i = 0; i < dims; i++)
+            vNorm[l]                               += pCentroid[(size_t)l * dims + i] * pCentroid[(size_t)l * dims + i];
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t p = 0; p < (int64_t)points; p++)
+    {
+        const NNFloat* pX                           = pPoint + (size_t)p * dims;
+        NNFloat best                                = numeric_limits<NNFloat>::max();
+        uint32_t bestList                           = 0;
+        for (uint32_t l = 0; l < lists; l++)
+        {
+            const NNFloat* pC                       = pCentroid + (size_t)l * dims;
+            NNFloat dot                             = (NNFloat)0.0;
+#pragma omp simd reduction(+:dot)
+            for (uint32_t i = 0; i < dims; i++)
+                dot                                += pX[i] * pC[i];
+            NNFloat distance                        = vNorm[l] - (NNFloat)2.0 * dot;
+            if (distance < best)
+            {
+                best                                = distance;
+                bestList                            = l;
+            }
+        }
+        pList[p]                                    = bestList;
+    }
+}
+
+// pWeight is the [inputs][outputs] weight matrix of a fully connected layer and pBias its outputs biases
+// (NULL for none).  Lists are trained with iterations rounds of k-means on a sample of the outputs
+NNIndex* NNIndex::Build(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, const NNFloat* pBias, uint32_t lists, uint32_t iterations)
+{
+    NNIndex* pIndex                                 = new NNIndex();
+    uint32_t dims                                   = inputs + 1;
+    lists                                           = max(1u, min(lists, outputs));
+    pIndex->_inputs                                 = inputs;
+    pIndex->_outputs                                = outputs;
+    pIndex->_lists                                  = lists;
+    pIndex->_probes                                 = min(DEFAULT_PROBES, lists);
+
+    // One [w; b] vector per output
+    vector<NNFloat> vItem((size_t)outputs * dims);
+#pragma omp parallel for
+    for (int64_t o = 0; o < (int64_t)outputs; o++)
+    {
+        for (uint32_t i = 0; i < inputs; i++)
+            vItem[(size_t)o * dims + i]             = pWeight[(size_t)i * outputs + o];
+        vItem[(size_t)o * dims + inputs]            = pBias ? pBias[o] : (NNFloat)0.0;
+    }
+
+    // Train on a random sample, seeded from the first lists points of it
+    mt19937 rng(INDEX_SEED);
+    vector<uint32_t> vOrder(outputs);
+    for (uint32_t o = 0; o < outputs; o++)
+        vOrder[o]                                   = o;
+    shuffle(vOrder.begin(), vOrder.end(), rng);
+    uint32_t samples                                = (uint32_t)min((uint64_t)outputs, (uint64_t)lists * INDEX_TRAINING_POINTS);
+    vector<NNFloat> vSample((size_t)samples * dims);
+    for (uint32_t s = 0; s < samples; s++)
+        copy(&vItem[(size_t)vOrder[s] * dims], &vItem[(size_t)vOrder[s] * dims] + dims, &vSample[(size_t)s * dims]);
+    pIndex->_vCentroid.assign(vSample.begin(), vSample.begin() + (size_t)lists * dims);
+
+    vector<uint32_t> vAssignment(samples);
+    vector<double> vSum((size_t)lists * dims);
+    vector<uint32_t> vCount(lists);
+    for (uint32_t it = 0; it < iterations; it++)
+    {
+        AssignLists(samples, dims, vSample.data(), lists, pIndex->_vCentroid.data(), vAssignment.data());
+        fill(vSum.begin(), vSum.end(), 0.0);
+        fill(vCount.begin(), vCount.end(), 0);
+        for (uint32_t s = 0; s < samples; s++)
+        {
+            uint32_t l                              = vAssignment[s];
+            vCount[l]++;
+            for (uint32_t i = 0; i < dims; i++)
+                vSum[(size_t)l * dims + i]         += vSample[(size_t)s * dims + i];
+        }
+
+        // Empty lists restart from a random sample
+        for (uint32_t l = 0; l < lists; l++)
+        {
+            NNFloat* pC                             = &pIndex->_vCentroid[(size_t)l * dims];
+            if (vCount[l] == 0)
+            {
+                uint32_t s                          = rng() % samples;
+                copy(&vSample[(size_t)s * dims], &vSample[(size_t)s * dims] + dims, pC);
+                continue;
+            }
+            for (uint32_t i = 0; i < dims; i++)
+                pC[i]                               = (NNFloat)(vSum[(size_t)l * dims + i] / vCount[l]);
+        }
+    }
+
+    // Group every output by its nearest list
+    vector<uint32_t> vList(outputs);
+    AssignLists(outputs, dims, vItem.data(), lists, pIndex->_vCentroid.data(), vList.data());
+    pIndex->_vListStart.assign(lists + 1, 0);
+    for (uint32_t o = 0; o < outputs; o++)
+        pIndex->_vListStart[vList[o] + 1]++;
+    for (uint32_t l = 0; l < lists; l++)
+        pIndex->_vListStart[l + 1]                 += pIndex->_vListStart[l];
+    pIndex->_vListOutput.resize(outputs);
+    vector<uint32_t> vPos(pIndex->_vListStart.begin(), pIndex->_vListStart.end() - 1);
+    for (uint32_t o = 0; o < outputs; o++)
+        pIndex->_vListOutput[vPos[vList[o]]++]      = o;
+
+    uint32_t largest                                = 0;
+    for (uint32_t l = 0; l < lists; l++)
+        largest                                     = max(largest, pIndex->_vListStart[l + 1] - pIndex->_vListStart[l]);
+    printf("NNIndex::Build: Indexed %u outputs in %u lists, largest list %u, %u probes by default\n", outputs, lists, largest, pIndex->_probes);
+    return pIndex;
+}
+
+// Candidate outputs of each query are the contents of its _probes best lists, as CSR lists over the batch
+void NNIndex::Search(uint32_t batch, const NNFloat* pQuery, vector<uint64_t>& vCandidateStart, vector<uint64_t>& vCandidateEnd, vector<uint32_t>& vCandidate)
+{
+    uint32_t dims                                   = _inputs + 1;
+    vector<NNFloat> vScore((size_t)batch * _lists);
+#pragma omp parallel for
+    for (int64_t b = 0; b < (int64_t)batch; b++)
+    {
+        const NNFloat* pX                           = pQuery + (size_t)b * _inputs;
+        for (uint32_t l = 0; l < _lists; l++)
+        {
+            const NNFloat* pC                       = &_vCentroid[(size_t)l * dims];
+            NNFloat dot                             = pC[_inputs];
+#pragma omp simd reduction(+:dot)
+            for (uint32_t i = 0; i < _inputs; i++)
+                dot                                += pX[i] * pC[i];
+            vScore[(size_t)b * _lists + l]          = dot;
+        }
+    }
+
+    vector<NNFloat> vKey((size_t)batch * _probes);
+    vector<uint32_t> vProbe((size_t)batch * _probes);
+    hCalculateTopK(vScore.data(), vKey.data(), vProbe.data(), batch, _lists, _probes);
+
+    vCandidateStart.resize(batch);
+    vCandidateEnd.resize(batch);
+    vCandidate.clear();
+    for (uint32_t b = 0; b < batch; b++)
+    {
+        vCandidateStart[b]                          = vCandidate.size();
+        for (uint32_t p = 0; p < _probes; p++)
+        {
+            uint32_t l                              = vProbe[(size_t)b * _probes + p];
+            vCandidate.insert(vCandidate.end(), _vListOutput.begin() + _vListStart[l], _vListOutput.begin() + _vListStart[l + 1]);
+        }
+        vCandidateEnd[b]                            = vCandidate.size();
+    }
+}
+
+bool NNIndex::Save(const string& fname)
+{
+    FILE* fp                                        = fopen(fname.c_str(), "wb");
+    if (fp == NULL)
+    {
+        printf("NNIndex::Save: Unable to open %s for writing.\n", fname.c_str());
+        return false;
+    }
+
+    uint32_t header[6]                              = { INDEX_MAGIC, INDEX_VERSION, _inputs, _outputs, _lists, _probes };
+    bool bResult                                    = (fwrite(header, sizeof(header), 1, fp) == 1) &&
+                                                      (fwrite(_vCentroid.data(), sizeof(NNFloat), _vCentroid.size(), fp) == _vCentroid.size()) &&
+                                                      (fwrite(_vListStart.data(), sizeof(uint32_t), _vListStart.size(), fp) == _vListStart.size()) &&
+                                                      (fwrite(_vListOutput.data(), sizeof(uint32_t), _vListOutput.size(), fp) == _vListOutput.size());
+    if (fclose(fp) != 0)
+        bResult                                     = false;
+    if (!bResult)
+        printf("NNIndex::Save: Error writing %s.\n", fname.c_str());
+    return bResult;
+}
+
+NNIndex* NNIndex::Load(const string& fname)
+{
+    FILE* fp                                        = fopen(fname.c_str(), "rb");
+    if (fp == NULL)
+    {
+        printf("NNIndex::Load: Unable to open %s.\n", fname.c_str());
+        return NULL;
+    }
+
+    uint32_t header[6];
+    if ((fread(header, sizeof(header), 1, fp) != 1) || (header[0] != INDEX_MAGIC) || (header[1] != INDEX_VERSION) || (header[4] == 0))
+    {
+        printf("NNIndex::Load: %s is not a version %u index.\n", fname.c_str(), INDEX_VERSION);
+        fclose(fp);
+        return NULL;
+    }
+
+    NNIndex* pIndex                                 = new NNIndex();
+    pIndex->_inputs                                 = header[2];
+    pIndex->_outputs                                = header[3];
+    pIndex->_lists                                  = header[4];
+    pIndex->_probes                                 = header[5];
+    pIndex->_vCentroid.resize((size_t)pIndex->_lists * (pIndex->_inputs + 1));
+    pIndex->_vListStart.resize(pIndex->_lists + 1);
+    pIndex->_vListOutput.resize(pIndex->_outputs);
+    bool bResult                                    = (fread(pIndex->_vCentroid.data(), sizeof(NNFloat), pIndex->_vCentroid.size(), fp) == pIndex->_vCentroid.size()) &&
+                                                      (fread(pIndex->_vListStart.data(), sizeof(uint32_t), pIndex->_vListStart.size(), fp) == pIndex->_vListStart.size()) &&
+                                                      (fread(pIndex->_vListOutput.data(), sizeof(uint32_t), pIndex->_vListOutput.size(), fp) == pIndex->_vListOutput.size()) &&
+                                                      (pIndex->_vListStart[pIndex->_lists] == pIndex->_outputs);
+    fclose(fp);
+    if (!bResult)
+    {
+        printf("NNIndex::Load: %s is truncated or corrupt.\n", fname.c_str());
+        delete pIndex;
+        return NULL;
+    }
+    pIndex->SetProbes(pIndex->_probes);
+    return pIndex;
+}
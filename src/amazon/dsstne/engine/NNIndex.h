@@ -0,0 +1,47 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef NNINDEX_H
+
+// Inverted file (IVF) index for approximate maximum inner product search over the output units of a
+// fully connected layer.  Each output's weight column and bias form one vector [w; b], the vectors are
+// clustered with k-means into lists, and a query [x; 1] probes the lists whose centroids have the largest
+// inner products with it.  Only outputs in the probed lists are then scored exactly, so probes trades
+// recall for latency.  Host side only, the index is a few MB even for millions of outputs.
+class NNIndex {
+private:
+    uint32_t                        _inputs;                    // Query length (incoming layer stride)
+    uint32_t                        _outputs;                   // Indexed output units
+    uint32_t                        _lists;                     // Number of k-means lists
+    uint32_t                        _probes;                    // Lists searched per query
+    vector<NNFloat>                 _vCentroid;                 // [lists][inputs + 1] centroids, the last component matches the bias
+    vector<uint32_t>                _vListStart;                // [lists + 1] offsets into _vListOutput
+    vector<uint32_t>                _vListOutput;               // Output units grouped by list
+
+    NNIndex();
+
+public:
+    static const uint32_t           DEFAULT_PROBES              = 8;
+
+    static NNIndex* Build(uint32_t inputs, uint32_t outputs, const NNFloat* pWeight, const NNFloat* pBias, uint32_t lists, uint32_t iterations = 10);
+    static NNIndex* Load(const string& fname);
+    bool Save(const string& fname);
+    void Search(uint32_t batch, const NNFloat* pQuery, vector<uint64_t>& vCandidateStart, vector<uint64_t>& vCandidateEnd, vector<uint32_t>& vCandidate);
+    void SetProbes(uint32_t probes) { _probes = max(1u, min(probes, _lists)); }
+    uint32_t GetProbes() { return _probes; }
+    uint32_t GetLists() { return _lists; }
+    uint32_t GetInputs() { return _inputs; }
+    uint32_t GetOutputs() { return _outputs; }
+};
+
+#define NNINDEX_H
+#endif
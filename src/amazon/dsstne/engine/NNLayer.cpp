@@ -33,6 +33,14 @@ _vSkip(d._vSkip),
 _pbUnit(NULL),
 _pbDelta(NULL),
 _pbDropout(NULL),
+_bSharedCandidates(false),
+_candidateStride(0),
+_pbCandidateStart(NULL),
+_pbCandidateEnd(NULL),
+_pbCandidate(NULL),
+_pbCandidateUnit(NULL),
+_candidatePosition(0),
+_pIndex(NULL),
 _Nx(d._Nx),
 _Ny(d._Ny),
 _Nz(d._Nz),
@@ -138,6 +146,7 @@ _localBatch(batch)
 NNLayer::~NNLayer()
 {
     Deallocate();
+    ClearCandidates();
     // Deallocate cuDNN tensor data if convolutional or pooling layer
     if ((_type == NNLayer::Type::Pooling) || (_type == NNLayer::Type::Convolutional))
     {
@@ -472,11 +481,6 @@ void NNLayer::RefreshState(NNNetwork* pNetwork, bool validate)
                 if (getGpu()._id == 0)
                     printf("NNLayer::RefreshState: Batch size (%u) is too high to use fast sparse kernels on input layer %s\n", _batch, _name.c_str());    
             }
-            else if (_pDataSet->_maxSparseDatapoints > maxSparse)
-            {
-                if (getGpu()._id == 0)
-                    printf("NNLayer::RefreshState: Maximum sparse datapoints per example (%u) is too high to use fast sparse kernels on input layer %s\n", _pDataSet->_maxSparseDatapoints, _name.c_str());  
-            }
             else if (_pDataSet->_sparseDensity > (NNFloat)0.1)
             {
                  if (getGpu()._id == 0)
@@ -531,6 +535,152 @@ void NNLayer::ClearUpdates()
     _deltaUpdateCount               = 0;
 }
 
+// Restricts inference to candidate units given as CSR lists over the examples of the data set, or
+// as a single list shared by every example.  Training always evaluates every unit
+bool NNLayer::SetCandidates(const vector<uint64_t>& vCandidateStart, const vector<uint64_t>& vCandidateEnd, const vector<uint32_t>& vCandidate)
+{
+    if (!ValidateCandidateLayer("SetCandidates"))
+        return false;
+
+    if ((vCandidateStart.size() == 0) || (vCandidateStart.size() != vCandidateEnd.size()))
+    {
+        if (getGpu()._id == 0)
+            printf("NNLayer::SetCandidates: Mismatched candidate list starts and ends for layer %s.\n", _name.c_str());
+        return false;
+    }
+
+    uint32_t candidateStride        = 1;
+    for (size_t i = 0; i < vCandidateStart.size(); i++)
+    {
+        if ((vCandidateEnd[i] < vCandidateStart[i]) || (vCandidateEnd[i] > vCandidate.size()))
+        {
+            if (getGpu()._id == 0)
+                printf("NNLayer::SetCandidates: Invalid candidate list for example %lu of layer %s.\n", i, _name.c_str());
+            return false;
+        }
+        candidateStride             = max(candidateStride, (uint32_t)(vCandidateEnd[i] - vCandidateStart[i]));
+    }
+
+    for (auto c : vCandidate)
+    {
+        if (c >= _stride)
+        {
+            if (getGpu()._id == 0)
+                printf("NNLayer::SetCandidates: Candidate %u is out of range for layer %s.\n", c, _name.c_str());
+            return false;
+        }
+    }
+
+    ClearCandidates();
+    _vCandidateStart                = vCandidateStart;
+    _vCandidateEnd                  = vCandidateEnd;
+    _vCandidate                     = vCandidate;
+    _bSharedCandidates              = (_vCandidateStart.size() == 1);
+    _candidateStride                = candidateStride;
+    UploadCandidates();
+    return true;
+}
+
+// Candidate and index evaluation both need a single unshared FC weight from a hidden layer and no skip layers
+bool NNLayer::ValidateCandidateLayer(const string& method)
+{
+    if ((_kind != Output) || (_type != NNLayer::Type::FullyConnected) || (_vIncomingLayer.size() != 1) || (_vIncomingSkip.size() > 0) ||
+        (_vIncomingLayer[0]->_kind == Input) || _vIncomingWeight[0]->_bShared)
+    {
+        if (getGpu()._id == 0)
+            printf("NNLayer::%s: Layer %s must be a fully connected output layer with a single unshared incoming weight from a hidden layer.\n", method.c_str(), _name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Copies the candidate lists to the GPU, buffers only grow since index searches replace them every batch
+void NNLayer::UploadCandidates()
+{
+    if ((_pbCandidateStart == NULL) || (_pbCandidateStart->_length < _vCandidateStart.size()))
+    {
+        delete _pbCandidateStart;
+        delete _pbCandidateEnd;
+        _pbCandidateStart           = new GpuBuffer<uint64_t>(_vCandidateStart.size());
+        _pbCandidateEnd             = new GpuBuffer<uint64_t>(_vCandidateEnd.size());
+    }
+    if ((_pbCandidate == NULL) || (_pbCandidate->_length < _vCandidate.size()))
+    {
+        delete _pbCandidate;
+        _pbCandidate                = new GpuBuffer<uint32_t>(max(_vCandidate.size(), (size_t)1));
+    }
+
+    cudaError_t status              = cudaMemcpy(_pbCandidateStart->_pDevData, _vCandidateStart.data(), _vCandidateStart.size() * sizeof(uint64_t), cudaMemcpyHostToDevice);
+    RTERROR(status, "NNLayer::UploadCandidates: cudaMemcpy upload failed");
+    status                          = cudaMemcpy(_pbCandidateEnd->_pDevData, _vCandidateEnd.data(), _vCandidateEnd.size() * sizeof(uint64_t), cudaMemcpyHostToDevice);
+    RTERROR(status, "NNLayer::UploadCandidates: cudaMemcpy upload failed");
+    if (_vCandidate.size() > 0)
+    {
+        status                      = cudaMemcpy(_pbCandidate->_pDevData, _vCandidate.data(), _vCandidate.size() * sizeof(uint32_t), cudaMemcpyHostToDevice);
+        RTERROR(status, "NNLayer::UploadCandidates: cudaMemcpy upload failed");
+    }
+}
+
+// Replaces explicit candidate lists with per batch lists retrieved from pIndex, NULL scores every unit again.
+// The index is owned by the caller
+bool NNLayer::SetIndex(NNIndex* pIndex)
+{
+    if (pIndex == NULL)
+    {
+        ClearCandidates();
+        return true;
+    }
+
+    if (!ValidateCandidateLayer("SetIndex"))
+        return false;
+
+    if ((pIndex->GetInputs() != _vIncomingLayer[0]->_stride) || (pIndex->GetOutputs() != _stride))
+    {
+        if (getGpu()._id == 0)
+            printf("NNLayer::SetIndex: Index of %u inputs and %u outputs does not match layer %s with %u inputs and %u units.\n",
+                   pIndex->GetInputs(), pIndex->GetOutputs(), _name.c_str(), _vIncomingLayer[0]->_stride, _stride);
+        return false;
+    }
+
+    ClearCandidates();
+    _pIndex                         = pIndex;
+    return true;
+}
+
+void NNLayer::ClearCandidates()
+{
+    delete _pbCandidateStart;
+    delete _pbCandidateEnd;
+    delete _pbCandidate;
+    delete _pbCandidateUnit;
+    _pbCandidateStart               = NULL;
+    _pbCandidateEnd                 = NULL;
+    _pbCandidate                    = NULL;
+    _pbCandidateUnit                = NULL;
+    _vCandidateStart.clear();
+    _vCandidateEnd.clear();
+    _vCandidate.clear();
+    _bSharedCandidates              = false;
+    _candidateStride                = 0;
+    _candidatePosition              = 0;
+    _pIndex                         = NULL;
+}
+
+// Candidate list of a data set example, in the order of its scores in the candidate unit buffer.  Index
+// lists only cover the examples of the last batch
+const uint32_t* NNLayer::GetCandidates(uint32_t example, uint32_t& count)
+{
+    if (_candidateStride == 0)
+    {
+        count                       = 0;
+        return NULL;
+    }
+
+    uint32_t pos                    = _bSharedCandidates ? 0 : example - _candidatePosition;
+    count                           = _vCandidateEnd[pos] - _vCandidateStart[pos];
+    return _vCandidate.data() + _vCandidateStart[pos];
+}
+
 void NNLayer::LoadPredictionBatch(uint32_t position, uint32_t batch)
 {
 
@@ -638,6 +788,18 @@ void NNLayer::ForwardPropagateFullyConnected(uint32_t position, uint32_t batch,
     {
         if (_kind != Input)
         {         
+            // Restricted candidate evaluation only scores each example's candidate units
+            if (!bTraining && (_pIndex != NULL))
+            {
+                ForwardPropagateIndex(position, batch);
+                return;
+            }
+            if (!bTraining && (_candidateStride > 0))
+            {
+                ForwardPropagateCandidates(position, batch);
+                return;
+            }
+
             // Initialize units to bias values
             switch (_vIncomingLayer.size())
             {
@@ -682,8 +844,37 @@ void NNLayer::ForwardPropagateFullyConnected(uint32_t position, uint32_t batch,
             const NNFloat sgemm_beta                = (NNFloat)1.0;
             for (uint32_t i = 0; i < _vIncomingLayer.size(); i++)
             {
+                // INT8, half precision and pruned inference paths for host networks
+                NNWeight* pIncomingWeight           = _vIncomingWeight[i];
+                if (!bTraining && pIncomingWeight->_bQuantized)
+                {
+                    if (_vIncomingLayer[i]->_bFastSparse)
+                        _vIncomingLayer[i]->_pDataSet->CalculateQuantizedSparseZ(position, batch, _stride, pIncomingWeight->_pbQuantizedWeight->_pDevData, pIncomingWeight->_pbWeightScale->_pDevData, _pbUnit->_pDevData, sgemm_beta);
+                    else
+                        hQuantizedGemm(batch, _localStride, _vIncomingLayer[i]->_stride, _vIncomingLayer[i]->_pbUnit->_pDevData, pIncomingWeight->_inputScale, 
+                                       pIncomingWeight->_pbQuantizedWeight->_pDevData, pIncomingWeight->_pbWeightScale->_pDevData, _pbUnit->_pDevData);
+                }
+                else if (!bTraining && (pIncomingWeight->_precision != NNWeight::FP32))
+                {
+                    pIncomingWeight->RefreshHalfWeights();
+                    HalfFormat format               = (pIncomingWeight->_precision == NNWeight::BF16) ? HalfBF16 : HalfFP16;
+                    if (_vIncomingLayer[i]->_bFastSparse)
+                        _vIncomingLayer[i]->_pDataSet->CalculateHalfSparseZ(position, batch, _stride, pIncomingWeight->_pbHalfWeight->_pDevData, format, _pbUnit->_pDevData, sgemm_beta);
+                    else
+                        hHalfGemm(batch, _localStride, _vIncomingLayer[i]->_stride, _vIncomingLayer[i]->_pbUnit->_pDevData, pIncomingWeight->_pbHalfWeight->_pDevData, format, _pbUnit->_pDevData);
+                }
+                else if (!bTraining && pIncomingWeight->_bPruned && pIncomingWeight->RefreshPrunedWeights())
+                {
+                    uint32_t inputs                 = _vIncomingLayer[i]->_stride;
+                    if (_vIncomingLayer[i]->_bFastSparse)
+                        _vIncomingLayer[i]->_pDataSet->CalculatePrunedSparseZ(position, batch, _stride, inputs, pIncomingWeight->_pbPrunedRowStart->_pDevData, pIncomingWeight->_pbPrunedColumn->_pDevData, 
+                                                                               pIncomingWeight->_pbPrunedWeight->_pDevData, _pbUnit->_pDevData, sgemm_beta);
+                    else
+                        hPrunedGemm(batch, _localStride, inputs, _vIncomingLayer[i]->_pbUnit->_pDevData, pIncomingWeight->_pbPrunedRowStart->_pDevData, 
+                                    pIncomingWeight->_pbPrunedColumn->_pDevData, pIncomingWeight->_pbPrunedWeight->_pDevData, _pbUnit->_pDevData);
+                }
                 // Special case sparse input layers with sparse matrix * matrix kernel
-                if (_vIncomingLayer[i]->_bFastSparse)
+                else if (_vIncomingLayer[i]->_bFastSparse)
                 {
                     NNFloat* pWeight                = _vIncomingWeight[i]->_bShared ? 
                                                       _vIncomingWeight[i]->_pSharedWeight->_pbWeight->_pDevData : 
@@ -1110,23 +1301,28 @@ void NNLayer::ForwardPropagatePooling(uint32_t position, uint32_t batch, bool bT
 
 void NNLayer::CalculateActivation(uint32_t batch)
 {
-    uint64_t size                   = (uint64_t)batch * (uint64_t)_localStride;
+    CalculateActivation(_pbUnit->_pDevData, batch, _localStride);
+}
+
+void NNLayer::CalculateActivation(NNFloat* pUnit, uint32_t batch, uint32_t stride)
+{
+    uint64_t size                   = (uint64_t)batch * (uint64_t)stride;
     switch (_activation)
     {
         case Sigmoid:
-            kCalculateSigmoidActivation(_pbUnit->_pDevData, size);
+            kCalculateSigmoidActivation(pUnit, size);
             break;
 
         case Tanh:
-            kCalculateTanhActivation(_pbUnit->_pDevData, size);
+            kCalculateTanhActivation(pUnit, size);
             break;
 
         case RectifiedLinear:
-            kCalculateReluActivation(_pbUnit->_pDevData, size);
+            kCalculateReluActivation(pUnit, size);
             break;
         
         case SoftMax:
-            kCalculateSoftMaxActivation(_pbUnit->_pDevData, batch, _localStride);
+            kCalculateSoftMaxActivation(pUnit, batch, stride);
             break;
 
         // Stub for no activation needed
@@ -1135,6 +1331,46 @@ void NNLayer::CalculateActivation(uint32_t batch)
     }
 }
 
+// Scores only the candidate units of each example into _pbCandidateUnit from one row of transposed
+// weights per candidate, _pbUnit is left untouched.  SetCandidates guarantees a single unshared
+// FC weight from a hidden layer and no skip layers
+void NNLayer::ForwardPropagateCandidates(uint32_t position, uint32_t batch)
+{
+    uint64_t size                   = (uint64_t)batch * (uint64_t)_candidateStride;
+    if ((_pbCandidateUnit == NULL) || (_pbCandidateUnit->_length < size))
+    {
+        delete _pbCandidateUnit;
+        _pbCandidateUnit            = new GpuBuffer<NNFloat>(size);
+    }
+
+    NNLayer* pInputLayer            = _vIncomingLayer[0];
+    NNWeight* pWeight               = _vIncomingWeight[0];
+    pWeight->RefreshTransposedWeights();
+    kCalculateCandidateZ(position, batch, pInputLayer->_stride, pInputLayer->_pbUnit->_pDevData, pWeight->_pbTransposedWeight->_pDevData, pWeight->_pbBias->_pDevData,
+                         _pbCandidateStart->_pDevData, _pbCandidateEnd->_pDevData, _pbCandidate->_pDevData, _bSharedCandidates, _candidateStride, _pbCandidateUnit->_pDevData);
+    CalculateActivation(_pbCandidateUnit->_pDevData, batch, _candidateStride);
+}
+
+// Retrieves approximate top scoring units of each example from _pIndex and scores them as candidates.  The
+// lists are indexed by batch row, which matches the data set position because inference never shuffles
+void NNLayer::ForwardPropagateIndex(uint32_t position, uint32_t batch)
+{
+    NNLayer* pInputLayer            = _vIncomingLayer[0];
+    vector<NNFloat> vQuery((size_t)batch * pInputLayer->_stride);
+    cudaError_t status              = cudaMemcpy(vQuery.data(), pInputLayer->_pbUnit->_pDevData, vQuery.size() * sizeof(NNFloat), cudaMemcpyDeviceToHost);
+    RTERROR(status, "NNLayer::ForwardPropagateIndex: cudaMemcpy download failed");
+    _pIndex->Search(batch, vQuery.data(), _vCandidateStart, _vCandidateEnd, _vCandidate);
+
+    uint32_t candidateStride        = 1;
+    for (uint32_t i = 0; i < batch; i++)
+        candidateStride             = max(candidateStride, (uint32_t)(_vCandidateEnd[i] - _vCandidateStart[i]));
+    _bSharedCandidates              = false;
+    _candidateStride                = candidateStride;
+    _candidatePosition              = position;
+    UploadCandidates();
+    ForwardPropagateCandidates(0, batch);
+}
+
 void NNLayer::CalculateDropout(uint32_t batch)
 {
     kCalculateDropout(_pbUnit->_pDevData, _pbDropout->_pDevData, batch, _localStride, _pDropout);
@@ -127,6 +127,17 @@ private:
     GpuBuffer<NNFloat>*         _pbUnit;                    // GPU memory for unit activations
     GpuBuffer<NNFloat>*         _pbDelta;                   // GPU memory for unit deltas  
     GpuBuffer<NNFloat>*         _pbDropout;                 // Dropout random values if active
+    bool                        _bSharedCandidates;         // One candidate list is used by every example
+    uint32_t                    _candidateStride;           // Longest candidate list, 0 when all units are evaluated
+    vector<uint64_t>            _vCandidateStart;           // Start of each example's candidate list
+    vector<uint64_t>            _vCandidateEnd;             // End of each example's candidate list
+    vector<uint32_t>            _vCandidate;                // Candidate unit indices
+    GpuBuffer<uint64_t>*        _pbCandidateStart;          // GPU candidate list starts
+    GpuBuffer<uint64_t>*        _pbCandidateEnd;            // GPU candidate list ends
+    GpuBuffer<uint32_t>*        _pbCandidate;               // GPU candidate unit indices
+    GpuBuffer<NNFloat>*         _pbCandidateUnit;           // [batch][_candidateStride] candidate activations
+    uint32_t                    _candidatePosition;         // First example covered by index candidate lists
+    NNIndex*                    _pIndex;                    // Approximate top unit index used at inference, not owned
     int32_t                     _priority;                  // Mutable priority for calculating propagation ordering
     NNLayer(NNLayerDescriptor& l, uint32_t batch);
     ~NNLayer();
@@ -142,7 +153,10 @@ private:
     void ForwardPropagateFullyConnected(uint32_t position, uint32_t batch, bool bTraining);    
     void ForwardPropagateConvolutional(uint32_t position, uint32_t batch, bool bTraining);
     void ForwardPropagatePooling(uint32_t position, uint32_t batch, bool bTraining);
+    void ForwardPropagateCandidates(uint32_t position, uint32_t batch);
+    void ForwardPropagateIndex(uint32_t position, uint32_t batch);
     void CalculateActivation(uint32_t batch);
+    void CalculateActivation(NNFloat* pUnit, uint32_t batch, uint32_t stride);
     void CalculateDropout(uint32_t batch);
     NNFloat CalculateError(uint32_t position, uint32_t batch, ErrorFunction ef);
     void BackPropagate(uint32_t position, uint32_t batch, NNFloat alpha);
@@ -154,6 +168,11 @@ private:
     void Reduce(uint32_t batch, uint32_t stride, NNFloat* pBuffer, uint32_t localStride, uint32_t updateCount);
     void Gather(uint32_t batch, uint32_t stride, NNFloat* pBuffer, uint32_t localStride);
     void ClearUpdates();
+    bool SetCandidates(const vector<uint64_t>& vCandidateStart, const vector<uint64_t>& vCandidateEnd, const vector<uint32_t>& vCandidate);
+    void ClearCandidates();
+    bool ValidateCandidateLayer(const string& method);
+    void UploadCandidates();
+    bool SetIndex(NNIndex* pIndex);
     void Dump(string fname, NNFloat* pData);
     bool WriteNetCDF(netCDF::NcFile& nc, uint32_t index);
     NNFloat* GetUnitBuffer() { return _pbUnit ? _pbUnit->_pDevData : NULL; }
@@ -166,6 +185,9 @@ public:
     tuple<uint32_t, uint32_t, uint32_t, uint32_t> GetLocalDimensions();
     tuple<uint32_t, uint32_t, uint32_t> GetKernelDimensions();
     tuple<uint32_t, uint32_t, uint32_t> GetKernelStride();
+    uint32_t GetCandidateStride() { return _candidateStride; }
+    NNFloat* GetCandidateUnitBuffer() { return _pbCandidateUnit ? _pbCandidateUnit->_pDevData : NULL; }
+    const uint32_t* GetCandidates(uint32_t example, uint32_t& count);
     //NNFloat GetPDropout();
     //NNFloat GetWeightNorm();
     //NNFloat GetDeltaNorm();
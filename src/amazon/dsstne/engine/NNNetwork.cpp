@@ -475,6 +475,7 @@ _pbCUDNNWorkspace(NULL)
         NNLayer* pInputLayer                    = _mLayer[wd._inputLayer];
         NNLayer* pOutputLayer                   = _mLayer[wd._outputLayer];
         NNWeight* pWeight                       = new NNWeight(*pInputLayer, *pOutputLayer, wd._bShared, wd._bTransposed, wd._bLocked, wd._norm);
+        pWeight->_bPruned                       = wd._bPruned;
         _vWeight.push_back(pWeight);
 
         // Initialize weight values if they aren't provided.  In the case of
@@ -740,6 +741,239 @@ bool NNNetwork::UnlockWeights(const string& inputLayer, const string& outputLaye
     return false;    
 } 
 
+// Post-training INT8 quantization of fully connected weights.  Runs PredictBatch over the first
+// calibrationExamples examples to find the largest activation feeding each weight matrix, then
+// builds symmetric per output INT8 weights.  Only used by PredictBatch, training ignores them.
+bool NNNetwork::Quantize(uint32_t calibrationExamples)
+{
+#ifndef HOST_ONLY
+    if (getGpu()._id == 0)
+        printf("NNNetwork::Quantize: INT8 inference is only supported by host builds.\n");
+    return false;
+#else
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::Quantize: INT8 inference is not supported with multiple processes.\n");
+        return false;
+    }
+
+    if (!_bExamplesFound)
+    {
+        printf("NNNetwork::Quantize: Attempt to quantize neural network %s without data sets.\n", _name.c_str());
+        return false;
+    }
+
+    // Calibrate with fp32 weights
+    SetQuantized(false);
+    vector<NNWeight*> vWeight;
+    for (auto w : _vWeight)
+    {
+        if (!w->_bShared && (w->_transform == NNWeight::Linear))
+            vWeight.push_back(w);
+    }
+    vector<NNFloat> vMax(vWeight.size(), (NNFloat)0.0);
+    uint32_t examples                       = min(calibrationExamples, _examples);
+    uint32_t position                       = _position;
+    for (uint32_t pos = 0; pos < examples; pos += _batch)
+    {
+        SetPosition(pos);
+        PredictBatch();
+        uint32_t batch                      = min(_batch, examples - pos);
+        for (size_t i = 0; i < vWeight.size(); i++)
+        {
+            NNLayer& layer                  = vWeight[i]->_inputLayer;
+            if (layer._bFastSparse)
+                continue;
+            const NNFloat* pUnit            = layer._pbUnit->_pDevData;
+            for (size_t j = 0; j < (size_t)batch * layer._stride; j++)
+                vMax[i]                     = max(vMax[i], fabsf(pUnit[j]));
+        }
+    }
+    SetPosition(position);
+
+    // Sparse inputs are used as is, so their scale is only a placeholder
+    uint32_t quantized                      = 0;
+    uint64_t size                           = 0;
+    for (size_t i = 0; i < vWeight.size(); i++)
+    {
+        NNFloat inputScale                  = (vMax[i] > (NNFloat)0.0) ? vMax[i] / (NNFloat)127.0 : (NNFloat)1.0;
+        if (!vWeight[i]->Quantize(inputScale))
+        {
+            printf("NNNetwork::Quantize: Weights between layers %s and %s have %" PRIu64 " inputs, more than INT8 sums allow, and stay fp32\n", vWeight[i]->_inputLayer._name.c_str(), vWeight[i]->_outputLayer._name.c_str(), vWeight[i]->_height);
+            continue;
+        }
+        quantized++;
+        size                               += vWeight[i]->_size;
+        printf("NNNetwork::Quantize: Quantized weights between layers %s and %s, input scale %g\n", vWeight[i]->_inputLayer._name.c_str(), vWeight[i]->_outputLayer._name.c_str(), inputScale);
+    }
+    printf("NNNetwork::Quantize: %u of %lu weight matrices, %" PRIu64 " weights calibrated on %u examples\n", quantized, vWeight.size(), size, examples);
+    return true;
+#endif
+}
+
+void NNNetwork::SetQuantized(bool bQuantized)
+{
+    for (auto w : _vWeight)
+    {
+        if (w->_pbQuantizedWeight != NULL)
+            w->_bQuantized                  = bQuantized;
+    }
+}
+
+bool NNNetwork::SetWeightPrecision(const string& inputLayer, const string& outputLayer, NNWeight::Precision precision)
+{
+#ifndef HOST_ONLY
+    if (getGpu()._id == 0)
+        printf("NNNetwork::SetWeightPrecision: Half precision weights are only supported by host builds.\n");
+    return false;
+#else
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::SetWeightPrecision: Half precision weights are not supported with multiple processes.\n");
+        return false;
+    }
+
+    NNWeight* pWeight           = GetWeight(inputLayer, outputLayer);
+    if (pWeight == NULL)
+        return false;
+
+    if (!pWeight->SetPrecision(precision))
+    {
+        printf("NNNetwork::SetWeightPrecision: Only unshared fully connected weights between layers %s and %s can change precision.\n", inputLayer.c_str(), outputLayer.c_str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool NNNetwork::SetWeightPrecision(NNWeight::Precision precision)
+{
+#ifndef HOST_ONLY
+    if (getGpu()._id == 0)
+        printf("NNNetwork::SetWeightPrecision: Half precision weights are only supported by host builds.\n");
+    return false;
+#else
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::SetWeightPrecision: Half precision weights are not supported with multiple processes.\n");
+        return false;
+    }
+
+    for (auto w : _vWeight)
+    {
+        if (!w->_bShared && (w->_transform == NNWeight::Linear))
+            w->SetPrecision(precision);
+    }
+    return true;
+#endif
+}
+
+// Zeroes blocks of PRUNED_BLOCK outputs whose largest weight is below threshold, then keeps the density fraction
+// of the remaining blocks with the largest norms.  Pruned weights are saved as their non-zero blocks, and host
+// builds run them with block sparse kernels when at most half the blocks are left
+bool NNNetwork::Prune(const string& inputLayer, const string& outputLayer, NNFloat threshold, NNFloat density)
+{
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::Prune: Pruning is not supported with multiple processes.\n");
+        return false;
+    }
+
+    NNWeight* pWeight           = GetWeight(inputLayer, outputLayer);
+    if (pWeight == NULL)
+        return false;
+
+    if (!pWeight->Prune(threshold, density))
+    {
+        printf("NNNetwork::Prune: Only unshared fully connected weights between layers %s and %s can be pruned.\n", inputLayer.c_str(), outputLayer.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool NNNetwork::Prune(NNFloat threshold, NNFloat density)
+{
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::Prune: Pruning is not supported with multiple processes.\n");
+        return false;
+    }
+
+    for (auto w : _vWeight)
+        w->Prune(threshold, density);
+    return true;
+}
+
+// Candidate lists index examples of the loaded data sets, a single list is shared by every example.
+// Predictions then only score the candidates into the layer's candidate unit buffer
+bool NNNetwork::SetCandidates(const string& layer, const vector<uint64_t>& vCandidateStart, const vector<uint64_t>& vCandidateEnd, const vector<uint32_t>& vCandidate)
+{
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::SetCandidates: Candidate evaluation is not supported with multiple processes.\n");
+        return false;
+    }
+
+    NNLayer* pLayer             = GetLayer(layer);
+    if (pLayer == NULL)
+        return false;
+
+    if ((vCandidateStart.size() != 1) && (vCandidateStart.size() != _examples))
+    {
+        printf("NNNetwork::SetCandidates: Expected 1 or %u candidate lists for layer %s, got %lu.\n", _examples, layer.c_str(), vCandidateStart.size());
+        return false;
+    }
+    return pLayer->SetCandidates(vCandidateStart, vCandidateEnd, vCandidate);
+}
+
+bool NNNetwork::ClearCandidates(const string& layer)
+{
+    NNLayer* pLayer             = GetLayer(layer);
+    if (pLayer == NULL)
+        return false;
+
+    pLayer->ClearCandidates();
+    return true;
+}
+
+// Clusters the output units of a candidate capable layer from its current weights and biases, see NNIndex.
+// The caller owns the returned index
+NNIndex* NNNetwork::BuildIndex(const string& layer, uint32_t lists, uint32_t iterations)
+{
+    NNLayer* pLayer             = GetLayer(layer);
+    if ((pLayer == NULL) || !pLayer->ValidateCandidateLayer("BuildIndex"))
+        return NULL;
+
+    NNWeight* pWeight           = pLayer->_vIncomingWeight[0];
+    vector<NNFloat> vWeight(pWeight->_pbWeight->_length);
+    vector<NNFloat> vBias(pWeight->_pbBias->_length);
+    pWeight->_pbWeight->Download(vWeight.data());
+    pWeight->_pbBias->Download(vBias.data());
+    return NNIndex::Build(pLayer->_vIncomingLayer[0]->_stride, pLayer->_stride, vWeight.data(), vBias.data(), lists, iterations);
+}
+
+// Predictions on layer then retrieve candidates from pIndex for every batch, NULL scores every unit again
+bool NNNetwork::SetIndex(const string& layer, NNIndex* pIndex)
+{
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::SetIndex: Index evaluation is not supported with multiple processes.\n");
+        return false;
+    }
+
+    NNLayer* pLayer             = GetLayer(layer);
+    if (pLayer == NULL)
+        return false;
+    return pLayer->SetIndex(pIndex);
+}
+
 void NNNetwork::SetTrainingMode(TrainingMode mode)
 {
     if (_trainingMode != mode)
@@ -766,17 +1000,19 @@ void NNNetwork::RefreshShuffleBuffers()
                 if (getGpu()._id == 0)
                 {
                     delete _pShuffleIndexSort;
+                    _pShuffleIndexSort      = NULL;
                 }
-                else
-                {
-                    delete _pbShuffleIndex;
-                    _pbShuffleIndex         = NULL;       
-                }
+                delete _pbShuffleIndex;
+                _pbShuffleIndex             = NULL;
             
                 
                 _shuffleIndices             = _examples;
                 
-                
+#ifdef HOST_ONLY
+                // Indices are shuffled directly in system memory, no sort buffers needed
+                _pbShuffleIndex             = new GpuBuffer<uint32_t>(_shuffleIndices);
+                _pShuffleIndex              = _pbShuffleIndex->_pDevData;
+#else
                 if (getGpu()._id == 0)
                 {
                     _pShuffleIndexSort          = new GpuSort<unsigned int, unsigned int>(_shuffleIndices);
@@ -798,6 +1034,7 @@ void NNNetwork::RefreshShuffleBuffers()
                     _pbShuffleIndex             = new GpuBuffer<uint32_t>(_shuffleIndices);
                     _pShuffleIndex              = _pbShuffleIndex->_pDevData;
                }
+#endif
             }
         }
     }
@@ -805,6 +1042,15 @@ void NNNetwork::RefreshShuffleBuffers()
 
 void NNNetwork::ShuffleIndices()
 {
+#ifdef HOST_ONLY
+    // Direct parallel Fisher-Yates on process 0, seeded from the network RNG
+    if (getGpu()._id == 0)
+    {
+        uint32_t seed[2];
+        curandGenerate(getGpu()._RNG, seed, 2);
+        hShuffleIndices(_pShuffleIndex, _examples, ((uint64_t)seed[0] << 32) | seed[1]);
+    }
+#else
     // Sort on process 0
     if (getGpu()._id == 0)
     {
@@ -825,6 +1071,7 @@ void NNNetwork::ShuffleIndices()
         // Sort by keys
         _pShuffleIndexSort->Sort();
     }
+#endif
     
     // Broadcast results to all other processes
     if (getGpu()._numprocs > 1)
@@ -3565,11 +3812,9 @@ exit:
     return pNetwork;
 }
 
-NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
+// Reads the network descriptor in fname on process 0 and broadcasts it to every process, exits on errors
+static void LoadNeuralNetworkDescriptorNetCDF(const string& fname, NNNetworkDescriptor& nd)
 {
-    NNNetwork* pNetwork                         = NULL;
-    NNNetworkDescriptor nd;
-
     // Load network data into GPU 0
     bool bResult                                = true;
     NNFloat version                             = (NNFloat)0.0;
@@ -3840,8 +4085,16 @@ NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
         exit(-1);
     }
 
-    // Finally build network from descriptor and return
     MPI_Bcast_NNNetworkDescriptor(nd);
+}
+
+NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
+{
+    NNNetwork* pNetwork                         = NULL;
+    NNNetworkDescriptor nd;
+
+    // Finally build network from descriptor and return
+    LoadNeuralNetworkDescriptorNetCDF(fname, nd);
     
     // Enumerate network
     if (getGpu()._id == 0)
@@ -3856,6 +4109,79 @@ NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
     return pNetwork;
 }
 
+// Loads the network in fname with the fully connected weights into layer replaced by a rank factorization,
+// see FactorizeWeights.  A new Linear hidden layer layer + "_rank<rank>" of rank units sits between the
+// incoming layer and layer, taking the left factor as its incoming weights and the right factor plus the
+// original biases as the weights into layer.  Returns NULL if the layer cannot be factorized
+NNNetwork* LoadFactorizedNeuralNetworkNetCDF(const string& fname, const string& layer, uint32_t rank, const uint32_t batch)
+{
+    if (getGpu()._numprocs > 1)
+    {
+        if (getGpu()._id == 0)
+            printf("LoadFactorizedNeuralNetworkNetCDF: Factorization is not supported with multiple processes.\n");
+        return NULL;
+    }
+
+    NNNetworkDescriptor nd;
+    LoadNeuralNetworkDescriptorNetCDF(fname, nd);
+
+    // Exactly one unshared fully connected weight matrix must feed layer
+    auto pLayer                                 = find_if(nd._vLayerDescriptor.begin(), nd._vLayerDescriptor.end(), [&](const NNLayerDescriptor& l) { return l._name == layer; });
+    vector<size_t> vIncoming;
+    for (size_t i = 0; i < nd._vWeightDescriptor.size(); i++)
+    {
+        if (nd._vWeightDescriptor[i]._outputLayer == layer)
+            vIncoming.push_back(i);
+    }
+    if ((pLayer == nd._vLayerDescriptor.end()) || (pLayer->_type != NNLayer::Type::FullyConnected) || (vIncoming.size() != 1) ||
+        nd._vWeightDescriptor[vIncoming[0]]._bShared || (nd._vWeightDescriptor[vIncoming[0]]._vWeight.size() == 0))
+    {
+        printf("LoadFactorizedNeuralNetworkNetCDF: Layer %s must have a single unshared fully connected incoming weight matrix.\n", layer.c_str());
+        return NULL;
+    }
+
+    NNWeightDescriptor& wd                      = nd._vWeightDescriptor[vIncoming[0]];
+    string inputLayer                           = wd._inputLayer;
+    vector<NNFloat> vLeft, vRight;
+    NNFloat energy;
+    if (!FactorizeWeights(wd._height, wd._width, wd._vWeight.data(), rank, vLeft, vRight, &energy))
+        return NULL;
+    printf("LoadFactorizedNeuralNetworkNetCDF: Factorized %s to %s weights into rank %u, %.2f MB to %.2f MB, %.4f of the energy kept\n",
+           inputLayer.c_str(), layer.c_str(), rank, wd._vWeight.size() * sizeof(NNFloat) / (1024.0 * 1024.0),
+           (vLeft.size() + vRight.size()) * sizeof(NNFloat) / (1024.0 * 1024.0), energy);
+
+    NNLayerDescriptor ld;
+    ld._name                                    = layer + "_rank" + to_string(rank);
+    ld._kind                                    = NNLayer::Kind::Hidden;
+    ld._type                                    = NNLayer::Type::FullyConnected;
+    ld._vSource.push_back(inputLayer);
+    ld._Nx                                      = rank;
+    ld._activation                              = Activation::Linear;
+    ld._weightInit                              = pLayer->_weightInit;
+    ld._weightInitScale                         = pLayer->_weightInitScale;
+    replace(pLayer->_vSource.begin(), pLayer->_vSource.end(), inputLayer, ld._name);
+    nd._vLayerDescriptor.insert(pLayer, ld);
+
+    // The original weights keep their biases and take the right factor
+    wd._inputLayer                              = ld._name;
+    wd._height                                  = rank;
+    wd._vWeight.swap(vRight);
+    wd._bPruned                                 = false;
+
+    NNWeightDescriptor left;
+    left._inputLayer                            = inputLayer;
+    left._outputLayer                           = ld._name;
+    left._width                                 = rank;
+    left._height                                = vLeft.size() / rank;
+    left._vWeight.swap(vLeft);
+    left._vBias.assign(rank, (NNFloat)0.0);
+    nd._vWeightDescriptor.push_back(left);
+
+    NNNetwork* pNetwork                         = new NNNetwork(nd, batch);
+    pNetwork->RefreshState();
+    return pNetwork;
+}
+
 bool NNNetwork::P2P_Bcast(void* pBuffer, size_t size)
 {
     cudaError_t status;
@@ -29,6 +29,7 @@ public:
 private:
     friend NNNetwork* LoadNeuralNetworkJSON(const string& fname, const uint32_t batch, const vector<NNDataSetBase*>& vDataSet);
     friend NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch);
+    friend NNNetwork* LoadFactorizedNeuralNetworkNetCDF(const string& fname, const string& layer, uint32_t rank, const uint32_t batch);
     friend NNNetwork* ImportAutoEncoder(const string& fname, uint32_t batch);
     string                      _name;                      // ASCII name for network
     uint32_t                    _batch;                     // Overall batch size
@@ -134,6 +135,16 @@ public:
     void SaveWeights(const string& fname, const string& inputLayer, const string& outputLayer);
     bool LockWeights(const string& inputLayer, const string& outputLayer);
     bool UnlockWeights(const string& inputLayer, const string& outputLayer); 
+    bool Quantize(uint32_t calibrationExamples = 1024);                                 // INT8 FC weights for host inference, calibrated on the current data
+    void SetQuantized(bool bQuantized);                                                 // Switches between INT8 and fp32 inference
+    bool SetWeightPrecision(const string& inputLayer, const string& outputLayer, NNWeight::Precision precision); // Inference storage precision of one FC weight matrix (host only)
+    bool SetWeightPrecision(NNWeight::Precision precision);                             // Same for every FC weight matrix
+    bool Prune(const string& inputLayer, const string& outputLayer, NNFloat threshold, NNFloat density); // Magnitude prunes one FC weight matrix in blocks, saved block sparse
+    bool Prune(NNFloat threshold, NNFloat density);                                     // Same for every FC weight matrix
+    bool SetCandidates(const string& layer, const vector<uint64_t>& vCandidateStart, const vector<uint64_t>& vCandidateEnd, const vector<uint32_t>& vCandidate); // Per example (or one shared) candidate units to score at inference
+    bool ClearCandidates(const string& layer);                                          // Scores every unit of the layer again
+    NNIndex* BuildIndex(const string& layer, uint32_t lists, uint32_t iterations = 10);  // Approximate top unit index over a candidate capable layer
+    bool SetIndex(const string& layer, NNIndex* pIndex);                                // Retrieves candidates from pIndex at inference, NULL to disable
     uint32_t GetExamples();
     void SetBatch(uint32_t batch);
     unsigned int GetBatch();
@@ -238,6 +249,7 @@ struct NNNetworkDescriptor
 
 ostream& operator<< (ostream& out, NNNetworkDescriptor& d);
 NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch = DefaultBatch);
+NNNetwork* LoadFactorizedNeuralNetworkNetCDF(const string& fname, const string& layer, uint32_t rank, const uint32_t batch = DefaultBatch);
 NNNetwork* LoadNeuralNetworkJSON(const string &fname, const uint32_t batch = DefaultBatch, const vector<NNDataSetBase*>& vDataSet = vector<NNDataSetBase*>());
 bool SaveNeuralNetworkJSON(const NNNetwork& net, const string& fname);
 bool SaveNeuralNetworkNetCDF(const NNNetwork& net, const string& jname);
@@ -856,6 +856,63 @@ _pbSparseTransposedData(NULL)
     }
 }
 
+// Data type stored in the NetCDF attributes of an NNDataSet<T>
+template<typename T> static NNDataSetEnums::DataType DataSetType();
+template<> NNDataSetEnums::DataType DataSetType<uint32_t>() { return NNDataSetEnums::UInt; }
+template<> NNDataSetEnums::DataType DataSetType<long>() { return NNDataSetEnums::Int; }
+template<> NNDataSetEnums::DataType DataSetType<float>() { return NNDataSetEnums::Float; }
+template<> NNDataSetEnums::DataType DataSetType<double>() { return NNDataSetEnums::Double; }
+template<> NNDataSetEnums::DataType DataSetType<char>() { return NNDataSetEnums::Char; }
+template<> NNDataSetEnums::DataType DataSetType<uint8_t>() { return NNDataSetEnums::UChar; }
+
+template<typename T> NNDataSet<T>::NNDataSet(const string& name, uint32_t width, uint32_t attributes, vector<uint64_t>& vSparseStart, vector<uint64_t>& vSparseEnd,
+                                             vector<uint32_t>& vSparseIndex, vector<T>& vSparseData) :
+_pbData(NULL),
+_pbSparseData(NULL),
+_pbSparseTransposedData(NULL)
+{
+    _name                                       = name;
+    _dataType                                   = DataSetType<T>();
+    _attributes                                 = attributes | NNDataSetEnums::Sparse;
+    _examples                                   = vSparseStart.size();
+    _dimensions                                 = 1;
+    _width                                      = width;
+    _height                                     = 1;
+    _length                                     = 1;
+    _sparseDataSize                             = vSparseIndex.size();
+
+    // Same checks as a sparse data set read from NetCDF
+    bool bBoolean                               = _attributes & NNDataSetEnums::Boolean;
+    if ((_examples == 0) || (_width == 0) || (_sparseDataSize == 0) || (vSparseEnd.size() != _examples) || (!bBoolean && (vSparseData.size() != _sparseDataSize)))
+    {
+        if (getGpu()._id == 0)
+        {
+            printf("NNDataSet::NNDataSet: Invalid sparse arrays for data set %s.\n", _name.c_str());
+        }
+        getGpu().Shutdown();
+        exit(-1);
+    }
+
+    // Like a NetCDF data set only process 0 holds the data until it is sharded
+    if (getGpu()._id == 0)
+    {
+        _vSparseStart.swap(vSparseStart);
+        _vSparseEnd.swap(vSparseEnd);
+        _vSparseIndex.swap(vSparseIndex);
+        if (!bBoolean)
+            _vSparseData.swap(vSparseData);
+        cout << "NNDataSet<T>::NNDataSet: " << _name << ", " << _examples << " examples, " << _sparseDataSize << " total datapoints of width " << _width << "." << endl;
+    }
+    CalculateSparseDatapointCounts();
+}
+
+template NNDataSet<uint32_t>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<uint32_t>&);
+template NNDataSet<long>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<long>&);
+template NNDataSet<float>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<float>&);
+template NNDataSet<double>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<double>&);
+template NNDataSet<char>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<char>&);
+template NNDataSet<uint8_t>::NNDataSet(const string&, uint32_t, uint32_t, vector<uint64_t>&, vector<uint64_t>&, vector<uint32_t>&, vector<uint8_t>&);
+
 template<typename T> bool NNDataSet<T>::Rename(const string& name)
 {
     _name                                       = name;
@@ -898,13 +955,13 @@ template<typename T> bool NNDataSet<T>::CalculateSparseDatapointCounts()
         }
         MPI_Allreduce(MPI_IN_PLACE, &_maxSparseDatapoints, 1, MPI_UINT32_T, MPI_MAX, MPI_COMM_WORLD);
 
-        // Print warning message if too many datapoints for sparse kernels
+        // Fast sparse kernels process examples with more datapoints than fit in shared memory in chunks
         uint32_t maxSparse      = (_attributes & NNDataSetEnums::Boolean) ? getGpu()._maxSparse : getGpu()._maxSparseAnalog;
         if (_maxSparseDatapoints > maxSparse)
         {
             if (getGpu()._id == 0)
             {
-                printf("NNDataSet::CalculateSparseDatapointCounts: Maximum sparse datapoints (%u) per example in dataset %s too large for fast sparse kernels.\n", _maxSparseDatapoints, _name.c_str());
+                printf("NNDataSet::CalculateSparseDatapointCounts: Maximum sparse datapoints (%u) per example in dataset %s exceeds %u, heavy examples will be processed in chunks.\n", _maxSparseDatapoints, _name.c_str(), maxSparse);
             }
         }
         
@@ -127,8 +127,12 @@ enum PoolingFunction {
 ostream& operator<< (ostream& out, const PoolingFunction& p);
 
 #include "kernels.h"
+#include "HostKernels.h"
 #include "GpuSort.h"
+#include "HostSort.h"
 #include "NNEnum.h"
+#include "NNIndex.h"
+#include "NNFactorize.h"
 #include "NNWeight.h"
 #include "NNLayer.h"
 #include "NNNetwork.h"
@@ -209,6 +213,9 @@ struct NNDataSetBase {
     virtual bool LoadSparseDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual bool CalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
     virtual bool CalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
+    virtual bool CalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
+    virtual bool CalculateHalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint16_t* pWeight, HalfFormat format, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
+    virtual bool CalculatePrunedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint32_t inputs, uint64_t* pRowStart, uint32_t* pColumn, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
     virtual float CalculateL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual float CalculateL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual float CalculateCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
@@ -267,6 +274,9 @@ private:
     bool LoadSparseDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     bool CalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta);
     bool CalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta);
+    bool CalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta);
+    bool CalculateHalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint16_t* pWeight, HalfFormat format, NNFloat* pUnit, NNFloat beta);
+    bool CalculatePrunedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint32_t inputs, uint64_t* pRowStart, uint32_t* pColumn, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta);
     float CalculateL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     float CalculateL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     float CalculateCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
@@ -282,6 +292,11 @@ private:
 
 public:
 
+    // Sparse data set built from CSR arrays already in memory, such as parsed text, instead of a NetCDF file.
+    // Every process passes the same arrays, process 0 swaps them in and leaves them empty.  vSparseData is
+    // unused for Boolean data
+    NNDataSet(const string& name, uint32_t width, uint32_t attributes, vector<uint64_t>& vSparseStart, vector<uint64_t>& vSparseEnd,
+              vector<uint32_t>& vSparseIndex, vector<T>& vSparseData);
     ~NNDataSet();
     void Shuffle();
     T GetDataPoint(uint32_t n, uint32_t x, uint32_t y = 0, uint32_t z = 0);
@@ -335,6 +350,47 @@ template<typename T> bool NNDataSet<T>::CalculateSparseDenoisedZ(uint32_t positi
     return true;
 }
 
+// INT8 weights only exist on host builds, see NNNetwork::Quantize
+template<typename T> bool NNDataSet<T>::CalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta)
+{
+#ifdef HOST_ONLY
+    if (_attributes & NNDataSetEnums::Boolean)
+        hCalculateQuantizedSparseZ(position, batch, stride, pWeight, pWeightScale, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, (const T*)NULL, pUnit, beta);
+    else
+        hCalculateQuantizedSparseZ(position, batch, stride, pWeight, pWeightScale, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, _pbSparseData->_pDevData, pUnit, beta);
+    return true;
+#else
+    return false;
+#endif
+}
+
+template<typename T> bool NNDataSet<T>::CalculateHalfSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint16_t* pWeight, HalfFormat format, NNFloat* pUnit, NNFloat beta)
+{
+#ifdef HOST_ONLY
+    if (_attributes & NNDataSetEnums::Boolean)
+        hCalculateHalfSparseZ(position, batch, stride, pWeight, format, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, (const T*)NULL, pUnit, beta);
+    else
+        hCalculateHalfSparseZ(position, batch, stride, pWeight, format, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, _pbSparseData->_pDevData, pUnit, beta);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Block sparse weights are only used by host builds, see NNWeight::RefreshPrunedWeights
+template<typename T> bool NNDataSet<T>::CalculatePrunedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, uint32_t inputs, uint64_t* pRowStart, uint32_t* pColumn, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta)
+{
+#ifdef HOST_ONLY
+    if (_attributes & NNDataSetEnums::Boolean)
+        hCalculatePrunedSparseZ(position, batch, stride, inputs, pRowStart, pColumn, pWeight, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, (const T*)NULL, pUnit, beta);
+    else
+        hCalculatePrunedSparseZ(position, batch, stride, inputs, pRowStart, pColumn, pWeight, _pbSparseStart->_pDevData, _pbSparseEnd->_pDevData, _pbSparseIndex->_pDevData, _pbSparseData->_pDevData, pUnit, beta);
+    return true;
+#else
+    return false;
+#endif
+}
+
 template<typename T> bool NNDataSet<T>::CalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, NNLayer* pLayer)
 {
     // Rebuild sparse data table if dataset changed
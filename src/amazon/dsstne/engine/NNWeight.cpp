@@ -28,6 +28,7 @@ _depth(1),
 _bShared(false),
 _bTransposed(false),
 _bLocked(false),
+_bPruned(false),
 _norm((NNFloat)0.0)
 {
     
@@ -151,7 +152,35 @@ bool LoadNNWeightDescriptorNetCDF(const string& fname, netCDF::NcFile& nc, uint3
             wd._vBias.resize(biasDim.getSize()); 
             biasVar.getVar(wd._vBias.data());         
 
-            if (!wd._bShared)
+            NcGroupAtt bPrunedAtt               = nc.getAtt(wstring + "bPruned");
+            if (!bPrunedAtt.isNull())
+            {
+                uint32_t bPruned;
+                bPrunedAtt.getValues(&bPruned);
+                wd._bPruned                     = (bPruned != 0);
+            }
+
+            if (!wd._bShared && wd._bPruned)
+            {
+                // Expand the non-zero blocks of each input row back to dense weights
+                NcDim blockDim                  = nc.getDim(wstring + "prunedBlockDim");
+                vector<uint64_t> vRowStart(wd._height + 1);
+                vector<uint32_t> vColumn(blockDim.getSize());
+                vector<NNFloat> vBlock(blockDim.getSize() * PRUNED_BLOCK);
+                nc.getVar(wstring + "prunedRowStart").getVar(vRowStart.data());
+                nc.getVar(wstring + "prunedColumn").getVar(vColumn.data());
+                nc.getVar(wstring + "prunedWeights").getVar(vBlock.data());
+                wd._vWeight.assign(wd._width * wd._height, (NNFloat)0.0);
+                for (uint64_t k = 0; k < wd._height; k++)
+                {
+                    for (uint64_t b = vRowStart[k]; b < vRowStart[k + 1]; b++)
+                    {
+                        for (uint32_t i = 0; (i < PRUNED_BLOCK) && (vColumn[b] + i < wd._width); i++)
+                            wd._vWeight[k * wd._width + vColumn[b] + i] = vBlock[b * PRUNED_BLOCK + i];
+                    }
+                }
+            }
+            else if (!wd._bShared)
             {
                 NcDim weightDim                 = nc.getDim(wstring + "weightDim");
                 NcVar weightVar                 = nc.getVar(wstring + "weights");
@@ -182,6 +211,7 @@ uint32_t MPI_Bcast_NNWeightDescriptor(NNWeightDescriptor& d)
     MPI_Bcast(&d._bShared, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&d._bTransposed, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&d._bLocked, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&d._bPruned, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&d._norm, 1, MPI_FLOAT, 0, MPI_COMM_WORLD);
     MPI_Bcast_string(d._sourceInputLayer);
     MPI_Bcast_string(d._sourceOutputLayer);
@@ -221,6 +251,7 @@ ostream& operator<< (ostream& out, NNWeightDescriptor& d)
             out << "sourceOutputLayer:  " << d._sourceOutputLayer << endl;
         }
         out << "bLocked:            " << std::boolalpha << d._bLocked << endl;
+        out << "bPruned:            " << std::boolalpha << d._bPruned << endl;
         out << "norm:               " << d._norm << endl;
     }
     return out;
@@ -254,7 +285,18 @@ _pbBiasGradient(NULL),
 _pbWeightVelocity(NULL),
 _pbBiasVelocity(NULL),
 _pbWeightGradientVelocity(NULL),
-_pbBiasGradientVelocity(NULL)
+_pbBiasGradientVelocity(NULL),
+_bQuantized(false),
+_inputScale((NNFloat)1.0),
+_pbQuantizedWeight(NULL),
+_pbWeightScale(NULL),
+_precision(FP32),
+_pbHalfWeight(NULL),
+_pbTransposedWeight(NULL),
+_bPruned(false),
+_pbPrunedRowStart(NULL),
+_pbPrunedColumn(NULL),
+_pbPrunedWeight(NULL)
 {
     // Add to input and output layer lists
     inputLayer._vOutgoingLayer.push_back(&outputLayer);
@@ -427,6 +469,11 @@ NNWeight::~NNWeight()
     delete _pbBiasVelocity;    
     delete _pbBiasGradient;
     delete _pbBiasGradientVelocity;
+    delete _pbQuantizedWeight;
+    delete _pbWeightScale;
+    delete _pbHalfWeight;
+    delete _pbTransposedWeight;
+    ClearPruned();
 }
 
 void NNWeight::ClearVelocity()
@@ -658,6 +705,14 @@ void NNWeight::UpdateWeights(TrainingMode trainingMode, uint32_t batch, NNFloat
     if (_bLocked)
         return; 
 
+    // Any INT8, half precision, transposed or pruned copy is stale once the weights move
+    ClearQuantized();
+    delete _pbHalfWeight;
+    _pbHalfWeight               = NULL;
+    delete _pbTransposedWeight;
+    _pbTransposedWeight         = NULL;
+    ClearPruned();
+
     // Update weights if the original holder or unshared in general
     if (!_bShared)
     {
@@ -773,6 +828,153 @@ void NNWeight::UpdateWeights(TrainingMode trainingMode, uint32_t batch, NNFloat
     }
 }
 
+// Builds INT8 copies of FC weights for host inference, inputScale is the step size of the incoming
+// activations from calibration.  Fails for weights whose int32 sums could overflow
+bool NNWeight::Quantize(NNFloat inputScale)
+{
+    if (_bShared || (_transform != Linear) || (_height > QUANT_MAX_INPUTS))
+        return false;
+
+    ClearQuantized();
+    vector<NNFloat> vWeight(_size);
+    _pbWeight->Download(vWeight.data());
+    vector<int8_t> vQuantizedWeight(hQuantizedSize(_height, _width));
+    vector<NNFloat> vWeightScale(hQuantizedStride(_width));
+    hQuantizeWeights(_height, _width, vWeight.data(), vQuantizedWeight.data(), vWeightScale.data());
+    _pbQuantizedWeight          = new GpuBuffer<int8_t>(vQuantizedWeight.size());
+    _pbQuantizedWeight->Upload(vQuantizedWeight.data());
+    _pbWeightScale              = new GpuBuffer<NNFloat>(vWeightScale.size());
+    _pbWeightScale->Upload(vWeightScale.data());
+    _inputScale                 = inputScale;
+    _bQuantized                 = true;
+    return true;
+}
+
+void NNWeight::ClearQuantized()
+{
+    delete _pbQuantizedWeight;
+    delete _pbWeightScale;
+    _pbQuantizedWeight          = NULL;
+    _pbWeightScale              = NULL;
+    _bQuantized                 = false;
+}
+
+// Stores FC weights as FP16 or BF16 for host inference, the fp32 weights remain the master copy for training
+bool NNWeight::SetPrecision(Precision precision)
+{
+    if ((precision != FP32) && (_bShared || (_transform != Linear)))
+        return false;
+
+    delete _pbHalfWeight;
+    _pbHalfWeight               = NULL;
+    _precision                  = precision;
+    RefreshHalfWeights();
+    return true;
+}
+
+void NNWeight::RefreshHalfWeights()
+{
+    if ((_precision == FP32) || (_pbHalfWeight != NULL))
+        return;
+
+    vector<NNFloat> vWeight(_size);
+    _pbWeight->Download(vWeight.data());
+    vector<uint16_t> vHalfWeight(hHalfSize(_height, _width));
+    hConvertWeights(_height, _width, vWeight.data(), vHalfWeight.data(), (_precision == BF16) ? HalfBF16 : HalfFP16);
+    _pbHalfWeight               = new GpuBuffer<uint16_t>(vHalfWeight.size());
+    _pbHalfWeight->Upload(vHalfWeight.data());
+}
+
+// Candidate evaluation reads one contiguous row of weights per output unit
+void NNWeight::RefreshTransposedWeights()
+{
+    if (_pbTransposedWeight != NULL)
+        return;
+
+    vector<NNFloat> vWeight(_size);
+    _pbWeight->Download(vWeight.data());
+    vector<NNFloat> vTransposedWeight(_size);
+    for (uint64_t i = 0; i < _height; i++)
+        for (uint64_t o = 0; o < _width; o++)
+            vTransposedWeight[o * _height + i] = vWeight[i * _width + o];
+    _pbTransposedWeight         = new GpuBuffer<NNFloat>(vTransposedWeight.size());
+    _pbTransposedWeight->Upload(vTransposedWeight.data());
+}
+
+// Zeroes blocks of PRUNED_BLOCK outputs of one input below threshold, then keeps the density fraction of the rest
+// with the largest norms, see hPruneWeights.  The weights are saved as their non-zero blocks from then on
+bool NNWeight::Prune(NNFloat threshold, NNFloat density)
+{
+    if (_bShared || (_transform != Linear))
+        return false;
+
+    vector<NNFloat> vWeight(_size);
+    _pbWeight->Download(vWeight.data());
+    uint64_t blocks             = hPruneWeights(_height, _width, vWeight.data(), threshold, density);
+    _pbWeight->Upload(vWeight.data());
+    _vWeight                    = vWeight;
+
+    ClearQuantized();
+    delete _pbHalfWeight;
+    _pbHalfWeight               = NULL;
+    delete _pbTransposedWeight;
+    _pbTransposedWeight         = NULL;
+    ClearPruned();
+    _bPruned                    = true;
+
+    // Non-zero blocks plus their column and the row starts, against the dense weights
+    double denseMB              = (double)_size * sizeof(NNFloat) / (1024.0 * 1024.0);
+    double prunedMB             = ((double)blocks * (PRUNED_BLOCK * sizeof(NNFloat) + sizeof(uint32_t)) + (double)(_height + 1) * sizeof(uint64_t)) / (1024.0 * 1024.0);
+    printf("NNWeight::Prune: Kept %" PRIu64 " of %" PRIu64 " blocks between layers %s and %s, %.2f MB dense, %.2f MB pruned\n", blocks, hPrunedBlocks(_height, _width),
+           _inputLayer._name.c_str(), _outputLayer._name.c_str(), denseMB, prunedMB);
+    return true;
+}
+
+void NNWeight::ClearPruned()
+{
+    delete _pbPrunedRowStart;
+    delete _pbPrunedColumn;
+    delete _pbPrunedWeight;
+    _pbPrunedRowStart           = NULL;
+    _pbPrunedColumn             = NULL;
+    _pbPrunedWeight             = NULL;
+}
+
+// Builds the block sparse copy used by hPrunedGemm on first use.  Returns false when inference should stay
+// dense: GPU builds, shared or non FC weights, and matrices with more than half their blocks left, where the
+// sparse kernels stop beating sgemm
+bool NNWeight::RefreshPrunedWeights()
+{
+#ifdef HOST_ONLY
+    if (!_bPruned || _bShared || (_transform != Linear))
+        return false;
+    if (_pbPrunedWeight != NULL)
+        return true;
+
+    vector<NNFloat> vWeight(_size);
+    _pbWeight->Download(vWeight.data());
+    vector<uint64_t> vRowStart;
+    vector<uint32_t> vColumn;
+    vector<NNFloat> vPrunedWeight;
+    hBuildPrunedWeights(_height, _width, vWeight.data(), vRowStart, vColumn, vPrunedWeight);
+    if (2 * vColumn.size() > hPrunedBlocks(_height, _width))
+        return false;
+
+    // Keep buffers non-empty so fully pruned weights still take the sparse path
+    vColumn.resize(max(vColumn.size(), (size_t)1));
+    vPrunedWeight.resize(vColumn.size() * PRUNED_BLOCK);
+    _pbPrunedRowStart           = new GpuBuffer<uint64_t>(vRowStart.size());
+    _pbPrunedRowStart->Upload(vRowStart.data());
+    _pbPrunedColumn             = new GpuBuffer<uint32_t>(vColumn.size());
+    _pbPrunedColumn->Upload(vColumn.data());
+    _pbPrunedWeight             = new GpuBuffer<NNFloat>(vPrunedWeight.size());
+    _pbPrunedWeight->Upload(vPrunedWeight.data());
+    return true;
+#else
+    return false;
+#endif
+}
+
 bool NNWeight::WriteNetCDF(netCDF::NcFile& nc, uint32_t index, NNFloat* pWeight, NNFloat* pBias)
 {
     bool bResult                = true;
@@ -811,11 +1013,51 @@ bool NNWeight::WriteNetCDF(netCDF::NcFile& nc, uint32_t index, NNFloat* pWeight,
         for (int i = 0; i < 20; i++)
             printf("%3d %16.8f %16.8f\n", i, _vWeight[i], _vBias[i]);
 #endif
-            NcDim weightDim     = nc.addDim(wstring + "weightDim", _size);            
-            NcVar weightVar     = nc.addVar(wstring + "weights", ncFloat, weightDim);            
             if (!pWeight)
                 pWeight         = _vWeight.data();
-            weightVar.putVar(pWeight);
+            if (_bPruned)
+            {
+                // CSR of the non-zero blocks of each input row, with at least one block since NetCDF
+                // treats a zero length dimension as unlimited
+                vector<uint64_t> vRowStart(1, 0);
+                vector<uint32_t> vColumn;
+                vector<NNFloat> vBlock;
+                for (uint64_t k = 0; k < _height; k++)
+                {
+                    const NNFloat* pW   = pWeight + k * _width;
+                    for (uint32_t c = 0; c < _width; c += PRUNED_BLOCK)
+                    {
+                        uint32_t width  = min((uint64_t)PRUNED_BLOCK, _width - c);
+                        if (all_of(pW + c, pW + c + width, [](NNFloat w) { return w == (NNFloat)0.0; }))
+                            continue;
+                        vColumn.push_back(c);
+                        for (uint32_t i = 0; i < PRUNED_BLOCK; i++)
+                            vBlock.push_back((i < width) ? pW[c + i] : (NNFloat)0.0);
+                    }
+                    vRowStart.push_back(vColumn.size());
+                }
+                if (vColumn.size() == 0)
+                {
+                    vColumn.push_back(0);
+                    vBlock.resize(PRUNED_BLOCK, (NNFloat)0.0);
+                    for (uint64_t k = 1; k <= _height; k++)
+                        vRowStart[k]    = 1;
+                }
+
+                nc.putAtt(wstring + "bPruned", ncUint, (uint32_t)1);
+                NcDim rowDim    = nc.addDim(wstring + "prunedRowDim", vRowStart.size());
+                NcDim blockDim  = nc.addDim(wstring + "prunedBlockDim", vColumn.size());
+                NcDim prunedDim = nc.addDim(wstring + "prunedWeightDim", vBlock.size());
+                nc.addVar(wstring + "prunedRowStart", ncUint64, rowDim).putVar(vRowStart.data());
+                nc.addVar(wstring + "prunedColumn", ncUint, blockDim).putVar(vColumn.data());
+                nc.addVar(wstring + "prunedWeights", ncFloat, prunedDim).putVar(vBlock.data());
+            }
+            else
+            {
+                NcDim weightDim = nc.addDim(wstring + "weightDim", _size);            
+                NcVar weightVar = nc.addVar(wstring + "weights", ncFloat, weightDim);            
+                weightVar.putVar(pWeight);
+            }
         }
     }
 
@@ -19,6 +19,13 @@ public:
         Convolution,
         Linear
     };
+
+    enum Precision
+    {
+        FP32,
+        FP16,
+        BF16
+    };
     static std::pair<NNWeight::Transform, string> _sTransformPair[];
     static std::map<NNWeight::Transform, string> _sTransformMap;
 
@@ -65,6 +72,17 @@ private:
     GpuBuffer<NNFloat>*             _pbBiasVelocity;            // Velocity used for momentum and RMSProp
     GpuBuffer<NNFloat>*             _pbWeightGradientVelocity;  // Gradient velocity used for AdaDelta and Adam
     GpuBuffer<NNFloat>*             _pbBiasGradientVelocity;    // Gradient velocity used for AdaDelta and Adam    
+    bool                            _bQuantized;                // Use INT8 weights for inference (host only)
+    NNFloat                         _inputScale;                // INT8 scale of incoming activations from calibration
+    GpuBuffer<int8_t>*              _pbQuantizedWeight;         // INT8 weights in hQuantizeWeights layout
+    GpuBuffer<NNFloat>*             _pbWeightScale;             // Per output INT8 weight scales
+    Precision                       _precision;                 // Weight storage precision for inference (host only)
+    GpuBuffer<uint16_t>*            _pbHalfWeight;              // FP16/BF16 copy of the weights, rebuilt after updates
+    GpuBuffer<NNFloat>*             _pbTransposedWeight;        // [outputs][inputs] copy for candidate evaluation, rebuilt after updates
+    bool                            _bPruned;                   // Saved as non-zero blocks, inference uses them when sparse enough (host only)
+    GpuBuffer<uint64_t>*            _pbPrunedRowStart;          // hBuildPrunedWeights CSR row starts, rebuilt after updates
+    GpuBuffer<uint32_t>*            _pbPrunedColumn;            // First output of each non-zero block
+    GpuBuffer<NNFloat>*             _pbPrunedWeight;            // PRUNED_BLOCK weights per non-zero block
     NNWeight(NNLayer& inputLayer, NNLayer& outputLayer, bool bShared = false, bool bTransposed = false, bool bLocked = false, NNFloat maxNorm = 0.0f);
     ~NNWeight();
     void ClearSharedGradient();
@@ -77,6 +95,14 @@ private:
     void Dump(string fname, NNFloat* pBuffer);
     void RefreshState(NNNetwork* pNetwork, TrainingMode trainingMode);
     void UpdateWeights(TrainingMode trainingMode, uint32_t batch, NNFloat alpha, NNFloat lambda, NNFloat mu);
+    bool Quantize(NNFloat inputScale);
+    void ClearQuantized();
+    bool SetPrecision(Precision precision);
+    void RefreshHalfWeights();
+    void RefreshTransposedWeights();
+    bool Prune(NNFloat threshold, NNFloat density);
+    void ClearPruned();
+    bool RefreshPrunedWeights();
     bool WriteNetCDF(netCDF::NcFile& nc, uint32_t index, NNFloat* pWeight = NULL, NNFloat* pBias = NULL);
     NNFloat* GetWeightBuffer() { return _pbWeight ? _pbWeight->_pDevData : NULL; }
     NNFloat* GetWeightGradientBuffer() { return _pbWeightGradient ? _pbWeightGradient->_pDevData : NULL; }
@@ -84,6 +110,7 @@ private:
 public:
     bool CopyWeights(NNWeight* pWeight);
     bool SetNorm(NNFloat norm);
+    bool IsQuantized() { return _bQuantized; }
 };
 
 
@@ -101,6 +128,7 @@ struct NNWeightDescriptor
     bool                    _bShared;
     bool                    _bTransposed;
     bool                    _bLocked;
+    bool                    _bPruned;
     NNFloat                 _norm;
     string                  _sourceInputLayer;     // _sourceInputLayer and _sourceOutputLayer collectively
     string                  _sourceOutputLayer;    // specify which weight matrix will be shared here
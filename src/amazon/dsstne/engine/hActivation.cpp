@@ -0,0 +1,78 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+// Host implementation of kActivation.cu for HOST_ONLY builds
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include <limits>
+#include <omp.h>
+
+static GpuData cData;
+
+void SetKActivationGpuData()
+{
+    cData                                       = getGpu()._data;
+}
+
+void GetKActivationGpuData()
+{
+    getGpu()._data                              = cData;
+}
+
+void kCalculateSigmoidActivation(NNFloat* pData, uint64_t size)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pData[pos]                              = (NNFloat)1.0 / ((NNFloat)1.0 + exp(-pData[pos]));
+}
+
+void kCalculateTanhActivation(NNFloat* pData, uint64_t size)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pData[pos]                              = tanh(pData[pos]);
+}
+
+void kCalculateReluActivation(NNFloat* pData, uint64_t size)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pData[pos]                              = max((NNFloat)0.0, pData[pos]);
+}
+
+void kCalculateSoftMaxActivation(NNFloat* pData, uint32_t batch, uint32_t stride)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        NNFloat* pRow                           = pData + pos * stride;
+
+        // Subtract the maximum value for numerical stability just like the GPU kernel
+        NNFloat maxValue                        = (NNFloat)-9999999999.0;
+        for (uint32_t i = 0; i < stride; i++)
+            maxValue                            = max(maxValue, pRow[i]);
+
+        double sum                              = 0.0;
+        for (uint32_t i = 0; i < stride; i++)
+        {
+            NNFloat a                           = exp(pRow[i] - maxValue);
+            pRow[i]                             = a;
+            sum                                += a;
+        }
+
+        NNFloat norm                            = (NNFloat)(1.0 / sum);
+        for (uint32_t i = 0; i < stride; i++)
+            pRow[i]                             = min((NNFloat)1.0, pRow[i] * norm);
+    }
+}
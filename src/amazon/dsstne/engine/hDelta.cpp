@@ -0,0 +1,513 @@
+/*
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+// Host implementation of kDelta.cu for HOST_ONLY builds
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include <limits>
+#include <omp.h>
+
+static GpuData cData;
+
+void SetKDeltaGpuData()
+{
+    cData                                       = getGpu()._data;
+}
+
+void GetKDeltaGpuData()
+{
+    getGpu()._data                              = cData;
+}
+
+static inline NNFloat Sign(NNFloat x)
+{
+    return (x > (NNFloat)0.0) ? (NNFloat)1.0 : (NNFloat)-1.0;
+}
+
+// Sets each delta of a dense output layer to delta(a, t)
+template<typename T, typename DeltaFunction> static void CalculateDelta(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, T* pData, DeltaFunction delta)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint64_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        NNFloat* pDeltaRow                      = pDelta + pos * stride;
+        T* pDataRow                             = pData + dpos * stride;
+        for (uint32_t i = 0; i < stride; i++)
+            pDeltaRow[i]                        = delta(pRow[i], hDataValue(pDataRow[i]));
+    }
+}
+
+// Sets the deltas of a sparse output layer, raw(a) for units with a zero target (or 0 if zero targets
+// are ignored), then overwrites the units with non-zero targets with nonZero(a, t, count) where t is 1
+// when pSparseData is NULL and count is the number of non-zero targets of the example
+template<typename T, typename RawFunction, typename NonZeroFunction> static void CalculateSparseDelta(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero, RawFunction raw, NonZeroFunction nonZero)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        NNFloat* pDeltaRow                      = pDelta + pos * stride;
+        if (bSparseIgnoreZero)
+        {
+            memset(pDeltaRow, 0, stride * sizeof(NNFloat));
+        }
+        else
+        {
+            for (uint32_t i = 0; i < stride; i++)
+                pDeltaRow[i]                    = raw(pRow[i]);
+        }
+
+        uint64_t start                          = pSparseStart[dpos];
+        uint64_t end                            = pSparseEnd[dpos];
+        NNFloat count                           = (NNFloat)(end - start);
+        for (uint64_t i = start; i < end; i++)
+        {
+            uint32_t pos2                       = pSparseIndex[i];
+            NNFloat t                           = pSparseData ? hDataValue(pSparseData[i]) : (NNFloat)1.0;
+            pDeltaRow[pos2]                     = nonZero(pRow[pos2], t, count);
+        }
+    }
+}
+
+template<typename T> void kCalculateOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, T* pData)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return (a - t) * a * ((NNFloat)1.0 - a); });
+            break;
+
+        case Tanh:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return (a - t) * ((NNFloat)1.0 - a * a); });
+            break;
+
+        case Linear:
+        case SoftMax:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return a - t; });
+            break;
+
+        case RectifiedLinear:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return (a - t) * (a > (NNFloat)0.0); });
+            break;
+    }
+}
+
+static inline NNFloat RawSigmoidOutputDelta(NNFloat a)
+{
+    return cData._deltaBoost_zero * a * a * ((NNFloat)1.0 - a);
+}
+
+static inline NNFloat RawTanhOutputDelta(NNFloat a)
+{
+    return a * ((NNFloat)1.0 - a * a);
+}
+
+static inline NNFloat RawLinearOutputDelta(NNFloat a)
+{
+    return a;
+}
+
+static inline NNFloat RawReluOutputDelta(NNFloat a)
+{
+    return a * (a > (NNFloat)0.0);
+}
+
+static inline NNFloat NonZeroSoftMaxOutputDelta(NNFloat a, NNFloat t, NNFloat count)
+{
+    return a - (NNFloat)1.0 / count;
+}
+
+void kCalculateSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawSigmoidOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return cData._deltaBoost_one * (a - t) * a * ((NNFloat)1.0 - a); });
+            break;
+
+        case Tanh:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawTanhOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a - t) * ((NNFloat)1.0 - a * a); });
+            break;
+
+        case Linear:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawLinearOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return a - t; });
+            break;
+
+        case RectifiedLinear:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawReluOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a - t) * (a > (NNFloat)0.0); });
+            break;
+
+        case SoftMax:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawLinearOutputDelta, NonZeroSoftMaxOutputDelta);
+            break;
+    }
+}
+
+// The sigmoid term matches the GPU kernel, a * (t - a) rather than a * (1 - a)
+template<typename T> void kCalculateSparseAnalogOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawSigmoidOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return cData._deltaBoost_one * (a - t) * a * (t - a); });
+            break;
+
+        case Tanh:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawTanhOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a - t) * ((NNFloat)1.0 - a * a); });
+            break;
+
+        case Linear:
+        case SoftMax:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawLinearOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return a - t; });
+            break;
+
+        case RectifiedLinear:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawReluOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a - t) * (a > (NNFloat)0.0); });
+            break;
+    }
+}
+
+template<typename T> void kCalculateCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, T* pData)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+        case SoftMax:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return a - t; });
+            break;
+    }
+}
+
+void kCalculateSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case SoftMax:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawLinearOutputDelta, NonZeroSoftMaxOutputDelta);
+            break;
+
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero,
+                                 [](NNFloat a) { return cData._deltaBoost_zero * a; },
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return cData._deltaBoost_one * (a - t); });
+            break;
+    }
+}
+
+template<typename T> void kCalculateScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, T* pData)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) -> NNFloat
+            {
+                if ((t == (NNFloat)1.0) && (a < cData._SMCE_oneTarget))
+                    return cData._SMCE_oneScale * (a - t);
+                else if ((t == (NNFloat)0.0) && (a > cData._SMCE_zeroTarget))
+                    return cData._SMCE_zeroScale * (a - t);
+                return (NNFloat)0.0;
+            });
+            break;
+
+        case SoftMax:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) -> NNFloat
+            {
+                if ((t > (NNFloat)0.0) && (a < cData._SMCE_oneTarget))
+                    return cData._SMCE_oneScale * (a - t);
+                else if ((t == (NNFloat)0.0) && (a > cData._SMCE_zeroTarget))
+                    return cData._SMCE_zeroScale * (a - t);
+                return (NNFloat)0.0;
+            });
+            break;
+    }
+}
+
+static inline NNFloat RawScaledMarginalCrossEntropyOutputDelta(NNFloat a)
+{
+    return (a > cData._SMCE_zeroTarget) ? cData._SMCE_zeroScale * a : (NNFloat)0.0;
+}
+
+void kCalculateSparseScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawScaledMarginalCrossEntropyOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a < cData._SMCE_oneTarget) ? cData._SMCE_oneScale * (a - t) : (NNFloat)0.0; });
+            break;
+
+        case SoftMax:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawScaledMarginalCrossEntropyOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a < cData._SMCE_oneTarget) ? cData._SMCE_oneScale * (a - (NNFloat)1.0 / count) : (NNFloat)0.0; });
+            break;
+    }
+}
+
+// Deltas are cleared when ignoring zero targets, which the GPU version leaves to the caller
+template<typename T> void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawScaledMarginalCrossEntropyOutputDelta,
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return (a < cData._SMCE_oneTarget) ? cData._SMCE_oneScale * t * (a - (NNFloat)1.0) : (NNFloat)0.0; });
+            break;
+
+        case SoftMax:
+            cout << "unsupported activation for this cost function" << endl;
+            getGpu().Shutdown();
+            exit(-1);
+            break;
+    }
+}
+
+template<typename T> void kCalculateL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, T* pData)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return Sign(a - t) * a * ((NNFloat)1.0 - a); });
+            break;
+
+        case Tanh:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return Sign(a - t) * ((NNFloat)1.0 - a * a); });
+            break;
+
+        case Linear:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return Sign(a - t); });
+            break;
+
+        case RectifiedLinear:
+            CalculateDelta(position, batch, stride, pUnit, pDelta, pData, [](NNFloat a, NNFloat t) { return Sign(a - t) * (a > (NNFloat)0.0); });
+            break;
+    }
+}
+
+void kCalculateSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero,
+                                 [](NNFloat a) { return Sign(a) * a * ((NNFloat)1.0 - a); },
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return Sign(a - t) * a * ((NNFloat)1.0 - a); });
+            break;
+
+        case Tanh:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero,
+                                 [](NNFloat a) { return Sign(a) * ((NNFloat)1.0 - a * a); },
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return Sign(a - t) * ((NNFloat)1.0 - a * a); });
+            break;
+
+        case Linear:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero,
+                                 [](NNFloat a) { return Sign(a); },
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return Sign(a - t); });
+            break;
+
+        case RectifiedLinear:
+            CalculateSparseDelta(position, batch, stride, pUnit, pDelta, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero,
+                                 [](NNFloat a) { return Sign(a) * (a > (NNFloat)0.0); },
+                                 [](NNFloat a, NNFloat t, NNFloat count) { return Sign(a - t) * (a > (NNFloat)0.0); });
+            break;
+    }
+}
+
+// Calculates and applies sparseness penalty to hidden layers
+void kCalculateSparsenessPenalty(uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat p, NNFloat beta)
+{
+    vector<NNFloat> vPenalty(stride, (NNFloat)0.0);
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        NNFloat* pRow                           = pUnit + (uint64_t)i * stride;
+        for (uint32_t pos = 0; pos < stride; pos++)
+            vPenalty[pos]                      += pRow[pos];
+    }
+
+    for (uint32_t pos = 0; pos < stride; pos++)
+    {
+        NNFloat pi                              = vPenalty[pos] / (NNFloat)batch;
+        pi                                      = max(MIN_ACTIVATION, min(MAX_ACTIVATION, pi));
+        vPenalty[pos]                           = beta * (-p / pi + ((NNFloat)1.0 - p) / ((NNFloat)1.0 - pi));
+    }
+
+#pragma omp parallel for
+    for (int64_t i = 0; i < (int64_t)batch; i++)
+    {
+        NNFloat* pDeltaRow                      = pDelta + i * stride;
+        for (uint32_t pos = 0; pos < stride; pos++)
+            pDeltaRow[pos]                     += vPenalty[pos];
+    }
+}
+
+void kCalculateHadamardProduct(Activation activation, uint64_t size, NNFloat scale, NNFloat* pUnit, NNFloat* pDelta)
+{
+    NNFloat oneOverScale                        = (NNFloat)1.0 / scale;
+
+    switch (activation)
+    {
+        case Sigmoid:
+#pragma omp parallel for
+            for (int64_t pos = 0; pos < (int64_t)size; pos++)
+            {
+                NNFloat x                       = pUnit[pos] * oneOverScale;
+                pDelta[pos]                     = scale * x * ((NNFloat)1.0 - x) * pDelta[pos];
+            }
+            break;
+
+        case Tanh:
+#pragma omp parallel for
+            for (int64_t pos = 0; pos < (int64_t)size; pos++)
+            {
+                NNFloat x                       = pUnit[pos] * oneOverScale;
+                pDelta[pos]                     = scale * ((NNFloat)1.0 - x * x) * pDelta[pos];
+            }
+            break;
+
+        case Linear:
+            // Derivative of linear output is 1, nothing to do here
+            break;
+
+        case RectifiedLinear:
+#pragma omp parallel for
+            for (int64_t pos = 0; pos < (int64_t)size; pos++)
+            {
+                if (pUnit[pos] <= (NNFloat)0.0)
+                    pDelta[pos]                 = (NNFloat)0.0;
+            }
+            break;
+    }
+}
+
+// Squared L2 norm of each row of deltas
+static void CalculateRowMagnitudes(uint32_t batch, uint32_t stride, NNFloat* pDelta, NNFloat* pMagnitude)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        NNFloat* pDeltaRow                      = pDelta + pos * stride;
+        NNFloat r2                              = (NNFloat)0.0;
+        for (uint32_t i = 0; i < stride; i++)
+            r2                                 += pDeltaRow[i] * pDeltaRow[i];
+        pMagnitude[pos]                         = r2;
+    }
+}
+
+void kNormalizeDeltaMagnitudes(NNFloat norm, uint32_t batch, uint32_t stride, NNFloat* pDelta, NNFloat* pMagnitude)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        // Normalize vector if too large
+        NNFloat r2                              = pMagnitude[pos];
+        if (r2 > norm * norm)
+        {
+            NNFloat scale                       = norm / sqrt(r2);
+            NNFloat* pDeltaRow                  = pDelta + pos * stride;
+            for (uint32_t i = 0; i < stride; i++)
+                pDeltaRow[i]                   *= scale;
+        }
+    }
+}
+
+void kNormalizeDeltas(NNFloat norm, uint32_t batch, uint32_t stride, NNFloat* pDelta)
+{
+    vector<NNFloat> vMagnitude(batch);
+    CalculateRowMagnitudes(batch, stride, pDelta, vMagnitude.data());
+    kNormalizeDeltaMagnitudes(norm, batch, stride, pDelta, vMagnitude.data());
+}
+
+void kCalculateDeltaMagnitudes(uint32_t batch, uint32_t stride, NNFloat* pDelta, NNFloat* pMagnitude)
+{
+    CalculateRowMagnitudes(batch, stride, pDelta, pMagnitude);
+}
+
+void kCalculateMaxoutDelta(NNFloat* pSrc, NNFloat* pSrcDelta, size_t size, NNFloat beta, NNFloat* pDst, NNFloat* pDstDelta)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat delta                           = (pSrc[pos] == pDst[pos]) ? pSrcDelta[pos] : (NNFloat)0;
+        if (beta == (NNFloat)0)
+            pDstDelta[pos]                      = delta;
+        else if (delta != (NNFloat)0.0)
+            pDstDelta[pos]                      = beta * pDstDelta[pos] + delta;
+    }
+}
+
+// Explicitly instantiates the same templated functions as kDelta.cu
+template void kCalculateCrossEntropyOutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat* pData);
+template void kCalculateCrossEntropyOutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, double* pData);
+template void kCalculateCrossEntropyOutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, unsigned char* pData);
+template void kCalculateCrossEntropyOutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, char* pData);
+template void kCalculateCrossEntropyOutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pData);
+template void kCalculateCrossEntropyOutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pData);
+template void kCalculateCrossEntropyOutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int32_t* pData);
+template void kCalculateCrossEntropyOutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int64_t* pData);
+
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, double* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, unsigned char* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, char* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int32_t* pData);
+template void kCalculateScaledMarginalCrossEntropyOutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int64_t* pData);
+
+template void kCalculateL1OutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat* pData);
+template void kCalculateL1OutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, double* pData);
+template void kCalculateL1OutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, unsigned char* pData);
+template void kCalculateL1OutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, char* pData);
+template void kCalculateL1OutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pData);
+template void kCalculateL1OutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pData);
+template void kCalculateL1OutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int32_t* pData);
+template void kCalculateL1OutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int64_t* pData);
+
+template void kCalculateOutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat* pData);
+template void kCalculateOutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, double* pData);
+template void kCalculateOutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, unsigned char* pData);
+template void kCalculateOutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, char* pData);
+template void kCalculateOutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pData);
+template void kCalculateOutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pData);
+template void kCalculateOutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int32_t* pData);
+template void kCalculateOutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, int64_t* pData);
+
+
+template void kCalculateSparseAnalogOutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseAnalogOutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, bool bSparseIgnoreZero);
+
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<NNFloat>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<double>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<unsigned char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<char>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<uint32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<uint64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<int32_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, bool bSparseIgnoreZero);
+template void kCalculateSparseDataScaledMarginalCrossEntropyOutputDelta<int64_t>(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit,  NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, bool bSparseIgnoreZero);
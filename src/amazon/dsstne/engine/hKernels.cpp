@@ -0,0 +1,888 @@
+/*
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+// Host implementation of kernels.cu for HOST_ONLY builds.  Every function keeps the signature
+// and semantics of its GPU counterpart, with batch rows (or flat element ranges) split across
+// OpenMP threads.
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include <limits>
+#include <omp.h>
+
+static GpuData cData;
+
+void SetKernelsGpuData()
+{
+    cData                                       = getGpu()._data;
+}
+
+void GetKernelsGpuData()
+{
+    getGpu()._data                              = cData;
+}
+
+uint32_t CalculateBlocks(uint64_t size)
+{
+    return (size + getGpu()._threadsPerBlock - 1) / getGpu()._threadsPerBlock;
+}
+
+// Scales and biases a weight matrix previously generated
+void kScaleAndBias(NNFloat* pData, uint64_t size, NNFloat scale, NNFloat bias)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat value                           = pData[pos];
+        pData[pos]                              = scale * value - bias;
+    }
+}
+
+// Sums up to four bias vectors into each row of pUnit, replacing (bClear) or accumulating
+static void AddBiases(bool bClear, NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, NNFloat* pBias3, NNFloat* pBias4, uint32_t stride, uint32_t batch)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        NNFloat* pRow                           = pUnit + pos * stride;
+        for (uint32_t bpos = 0; bpos < stride; bpos++)
+        {
+            NNFloat bias                        = pBias1[bpos];
+            if (pBias2)
+                bias                           += pBias2[bpos];
+            if (pBias3)
+                bias                           += pBias3[bpos];
+            if (pBias4)
+                bias                           += pBias4[bpos];
+            pRow[bpos]                          = bClear ? bias : pRow[bpos] + bias;
+        }
+    }
+}
+
+void kClearUnit(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch)
+{
+    AddBiases(true, pUnit, pBias, NULL, NULL, NULL, stride, batch);
+}
+
+void kClearDualSourceUnit(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, uint32_t stride, uint32_t batch)
+{
+    AddBiases(true, pUnit, pBias1, pBias2, NULL, NULL, stride, batch);
+}
+
+void kClearTripleSourceUnit(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, NNFloat* pBias3, uint32_t stride, uint32_t batch)
+{
+    AddBiases(true, pUnit, pBias1, pBias2, pBias3, NULL, stride, batch);
+}
+
+void kClearQuadSourceUnit(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, NNFloat* pBias3, NNFloat* pBias4, uint32_t stride, uint32_t batch)
+{
+    AddBiases(true, pUnit, pBias1, pBias2, pBias3, pBias4, stride, batch);
+}
+
+void kAddBias(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch)
+{
+    AddBiases(false, pUnit, pBias, NULL, NULL, NULL, stride, batch);
+}
+
+void kAddDualBias(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, uint32_t stride, uint32_t batch)
+{
+    AddBiases(false, pUnit, pBias1, pBias2, NULL, NULL, stride, batch);
+}
+
+void kAddTripleBias(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, NNFloat* pBias3, uint32_t stride, uint32_t batch)
+{
+    AddBiases(false, pUnit, pBias1, pBias2, pBias3, NULL, stride, batch);
+}
+
+void kAddQuadBias(NNFloat* pUnit, NNFloat* pBias1, NNFloat* pBias2, NNFloat* pBias3, NNFloat* pBias4, uint32_t stride, uint32_t batch)
+{
+    AddBiases(false, pUnit, pBias1, pBias2, pBias3, pBias4, stride, batch);
+}
+
+// Column sums of a batch x width delta matrix, sums are accumulated a row at a time
+// so the inner loop runs over contiguous memory
+static void SumColumns(uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pSum)
+{
+    const uint32_t COLUMN_BLOCK                 = 256;
+    int64_t blocks                              = (width + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+#pragma omp parallel for
+    for (int64_t block = 0; block < blocks; block++)
+    {
+        uint32_t start                          = block * COLUMN_BLOCK;
+        uint32_t end                            = min(width, start + COLUMN_BLOCK);
+        for (uint32_t pos = start; pos < end; pos++)
+            pSum[pos]                           = (NNFloat)0.0;
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            NNFloat* pRow                       = pDelta + (uint64_t)i * width;
+            for (uint32_t pos = start; pos < end; pos++)
+                pSum[pos]                      += pRow[pos];
+        }
+    }
+}
+
+void kUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)width; pos++)
+        pBias[pos]                             -= alpha * vSum[pos];
+}
+
+void kCalculateTopK(NNFloat* pOutputBuffer, NNFloat *pKeyBuffer, uint32_t* pValueBuffer, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK(pOutputBuffer, pKeyBuffer, pValueBuffer, batch, width, k);
+}
+
+void kCalculateTopK(NNFloat* pOutputKey, NNFloat* pOutputValue, NNFloat *pKey, NNFloat* pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK(pOutputKey, pOutputValue, pKey, pValue, batch, width, k);
+}
+
+void kCalculateTopK(NNFloat* pOutputKey, uint32_t* pOutputValue, NNFloat *pKey, uint32_t * pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+    hCalculateTopK(pOutputKey, pOutputValue, pKey, pValue, batch, width, k);
+}
+
+void kCalculateFilteredTopK(NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k, uint64_t* pFilterStart, uint64_t* pFilterEnd, uint32_t* pFilterIndex, NNFloat* pFilterValue, NNFloat* pMask, uint32_t* pMaskRow)
+{
+    hCalculateFilteredTopK(pOutputKey, pKey, pValue, batch, width, k, pFilterStart, pFilterEnd, pFilterIndex, pFilterValue, pMask, pMaskRow);
+}
+
+void kAddBuffers(NNFloat* pDst, NNFloat* pSrc, uint64_t size)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pDst[pos]                              += pSrc[pos];
+}
+
+void kAddBuffers2D(NNFloat* pDst, uint32_t dpitch, NNFloat* pSrc, uint32_t spitch, uint32_t width, uint32_t height)
+{
+#pragma omp parallel for
+    for (int64_t y = 0; y < (int64_t)height; y++)
+    {
+        NNFloat* pDstRow                        = pDst + y * dpitch;
+        NNFloat* pSrcRow                        = pSrc + y * spitch;
+        for (uint32_t x = 0; x < width; x++)
+            pDstRow[x]                         += pSrcRow[x];
+    }
+}
+
+void kCopy2D(NNFloat* pDst, uint32_t dpitch, NNFloat* pSrc, uint32_t spitch, uint32_t width, uint32_t height)
+{
+#pragma omp parallel for
+    for (int64_t y = 0; y < (int64_t)height; y++)
+        memcpy(pDst + y * dpitch, pSrc + y * spitch, width * sizeof(NNFloat));
+}
+
+// Sorting is a stable radix sort by key in place in pKey0/pValue0, pKey1/pValue1 are scratch space
+template<typename KeyType, typename ValueType> size_t kInitSort(uint32_t items, GpuBuffer<KeyType>* pbKey, GpuBuffer<ValueType>* pbValue)
+{
+    return 0;
+}
+
+template<typename KeyType, typename ValueType> bool kSort(uint32_t items, KeyType* pKey0, KeyType* pKey1, ValueType* pValue0, ValueType* pValue1, char* pTemp, size_t tempBytes)
+{
+    return hSort(items, pKey0, pKey1, pValue0, pValue1);
+}
+
+template<typename T> void kLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint64_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        T* pDataRow                             = pData + dpos * stride;
+        for (uint32_t i = 0; i < stride; i++)
+            pRow[i]                             = pDataRow[i];
+    }
+}
+
+template<> void kLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint64_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        unsigned char* pDataRow                 = pData + dpos * stride;
+        for (uint32_t i = 0; i < stride; i++)
+            pRow[i]                             = (NNFloat)pDataRow[i] * (NNFloat)(1.0 / 256.0) - (NNFloat)0.5;
+    }
+}
+
+template<> void kLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint64_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        char* pDataRow                          = pData + dpos * stride;
+        for (uint32_t i = 0; i < stride; i++)
+            pRow[i]                             = (NNFloat)pDataRow[i] * (NNFloat)(1.0 / 128.0);
+    }
+}
+
+void kLoadSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        memset(pRow, 0, stride * sizeof(NNFloat));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+            pRow[pSparseIndex[i]]               = (NNFloat)1.0;
+    }
+}
+
+void kLoadSparseDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pRandom)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        memset(pRow, 0, stride * sizeof(NNFloat));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            if (pRandom[i] >= cData._denoising_p)
+                pRow[pSparseIndex[i]]           = cData._denoising_q;
+        }
+    }
+}
+
+template<typename T> void kLoadSparseAnalogInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        memset(pRow, 0, stride * sizeof(NNFloat));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+            pRow[pSparseIndex[i]]               = pSparseData[i];
+    }
+}
+
+template<typename T> void kLoadSparseAnalogDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pRandom)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        memset(pRow, 0, stride * sizeof(NNFloat));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            if (pRandom[i] >= cData._denoising_p)
+                pRow[pSparseIndex[i]]           = cData._denoising_q * pSparseData[i];
+        }
+    }
+}
+
+// Sparse Z accumulates one weight row per non-zero input, so each output row is a sum of
+// contiguous axpys and needs no inter-thread communication.  Rows are split into tiles of
+// SPARSE_Z_TILE outputs so one heavy example is spread across threads rather than left to
+// a single one, and the partial row being accumulated stays in L1
+static const uint32_t SPARSE_Z_TILE                 = 512;
+
+struct SparseValue
+{
+    bool operator()(uint64_t i, NNFloat& value) const
+    {
+        value                                       = (NNFloat)1.0;
+        return true;
+    }
+};
+
+template<typename T> struct SparseAnalogValue
+{
+    T*                      _pSparseData;
+    bool operator()(uint64_t i, NNFloat& value) const
+    {
+        value                                       = hDataValue(_pSparseData[i]);
+        return true;
+    }
+};
+
+struct SparseDenoisedValue
+{
+    NNFloat*                _pRandom;
+    bool operator()(uint64_t i, NNFloat& value) const
+    {
+        value                                       = cData._denoising_q;
+        return (_pRandom[i] >= cData._denoising_p);
+    }
+};
+
+template<typename T> struct SparseAnalogDenoisedValue
+{
+    T*                      _pSparseData;
+    NNFloat*                _pRandom;
+    bool operator()(uint64_t i, NNFloat& value) const
+    {
+        value                                       = hDataValue(_pSparseData[i]) * cData._denoising_q;
+        return (_pRandom[i] >= cData._denoising_p);
+    }
+};
+
+template<typename Value> static void CalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pUnit, NNFloat beta, Value sparseValue)
+{
+    const int64_t tiles                             = (stride + SPARSE_Z_TILE - 1) / SPARSE_Z_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < (int64_t)batch * tiles; task++)
+    {
+        uint32_t pos                                = task / tiles;
+        uint32_t start                              = (task % tiles) * SPARSE_Z_TILE;
+        uint32_t end                                = min(stride, start + SPARSE_Z_TILE);
+        uint32_t dpos                               = hDataPosition(cData, position + pos);
+        NNFloat* pRow                               = pUnit + (uint64_t)pos * stride;
+        if (beta == (NNFloat)0.0)
+            memset(pRow + start, 0, (end - start) * sizeof(NNFloat));
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            NNFloat value;
+            if (!sparseValue(i, value))
+                continue;
+            NNFloat* pWeightRow                     = pWeight + (uint64_t)pSparseIndex[i] * stride;
+            for (uint32_t o = start; o < end; o++)
+                pRow[o]                            += value * pWeightRow[o];
+        }
+    }
+}
+
+void kCalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pUnit, NNFloat beta)
+{
+    CalculateSparseZ(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pUnit, beta, SparseValue());
+}
+
+template<typename T> void kCalculateSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pUnit, NNFloat beta)
+{
+    SparseAnalogValue<T> sparseValue                = { pSparseData };
+    CalculateSparseZ(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pUnit, beta, sparseValue);
+}
+
+void kCalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta)
+{
+    SparseDenoisedValue sparseValue                 = { pRandom };
+    CalculateSparseZ(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pUnit, beta, sparseValue);
+}
+
+template<typename T> void kCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta)
+{
+    SparseAnalogDenoisedValue<T> sparseValue        = { pSparseData, pRandom };
+    CalculateSparseZ(position, batch, stride, pWeight, pSparseStart, pSparseEnd, pSparseIndex, pUnit, beta, sparseValue);
+}
+
+// Candidate Z is one dot product per example and candidate against the transposed weights.  Tasks
+// run candidate tile major so a shared candidate list keeps its weight rows in cache across the batch
+static const uint32_t CANDIDATE_Z_TILE              = 64;
+
+void kCalculateCandidateZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pInput, NNFloat* pTransposedWeight, NNFloat* pBias, uint64_t* pCandidateStart, uint64_t* pCandidateEnd, uint32_t* pCandidate, bool bShared, uint32_t candidateStride, NNFloat* pUnit)
+{
+    const int64_t tiles                             = (candidateStride + CANDIDATE_Z_TILE - 1) / CANDIDATE_Z_TILE;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t task = 0; task < (int64_t)batch * tiles; task++)
+    {
+        uint32_t pos                                = task % batch;
+        uint32_t start                              = (task / batch) * CANDIDATE_Z_TILE;
+        uint32_t end                                = min(candidateStride, start + CANDIDATE_Z_TILE);
+        uint32_t dpos                               = bShared ? 0 : hDataPosition(cData, position + pos);
+        uint64_t offset                             = pCandidateStart[dpos];
+        uint32_t count                              = pCandidateEnd[dpos] - offset;
+        const NNFloat* pInputRow                    = pInput + (uint64_t)pos * stride;
+        NNFloat* pRow                               = pUnit + (uint64_t)pos * candidateStride;
+        for (uint32_t j = start; j < end; j++)
+        {
+            if (j >= count)
+            {
+                pRow[j]                             = -MAX_VALUE;
+                continue;
+            }
+            uint32_t candidate                      = pCandidate[offset + j];
+            const NNFloat* pWeightRow               = pTransposedWeight + (uint64_t)candidate * stride;
+            NNFloat sum                             = (NNFloat)0.0;
+#pragma omp simd reduction(+:sum)
+            for (uint32_t i = 0; i < stride; i++)
+                sum                                += pInputRow[i] * pWeightRow[i];
+            pRow[j]                                 = pBias[candidate] + sum;
+        }
+    }
+}
+
+// The transposed matrices are built serially, which also makes the order of examples within
+// each input's column deterministic (the GPU version appends them in atomic order)
+void kCalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex)
+{
+    for (uint32_t bpos = 0; bpos < batch; bpos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + bpos);
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            uint32_t opos                       = pSparseTransposedEnd[pSparseIndex[i]]++;
+            pSparseTransposedIndex[opos]        = bpos;
+        }
+    }
+}
+
+void kCalculateSparseTransposedDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex)
+{
+    for (uint32_t bpos = 0; bpos < batch; bpos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + bpos);
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            if (pRandom[i] < cData._denoising_p)
+                continue;
+            uint32_t opos                       = pSparseTransposedEnd[pSparseIndex[i]]++;
+            pSparseTransposedIndex[opos]        = bpos;
+        }
+    }
+}
+
+template<typename T> void kCalculateSparseTransposedAnalogMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, T* pSparseTransposedData)
+{
+    for (uint32_t bpos = 0; bpos < batch; bpos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + bpos);
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            uint32_t opos                       = pSparseTransposedEnd[pSparseIndex[i]]++;
+            pSparseTransposedIndex[opos]        = bpos;
+            pSparseTransposedData[opos]         = pSparseData[i];
+        }
+    }
+}
+
+template<typename T> void kCalculateSparseTransposedAnalogDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, T* pSparseTransposedData)
+{
+    for (uint32_t bpos = 0; bpos < batch; bpos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + bpos);
+        for (uint64_t i = pSparseStart[dpos]; i < pSparseEnd[dpos]; i++)
+        {
+            if (pRandom[i] < cData._denoising_p)
+                continue;
+            uint32_t opos                       = pSparseTransposedEnd[pSparseIndex[i]]++;
+            pSparseTransposedIndex[opos]        = bpos;
+            pSparseTransposedData[opos]         = pSparseData[i];
+        }
+    }
+}
+
+// Each weight gradient row gathers the deltas of the examples that activated its input, accumulating
+// in double to stay as deterministic as the GPU's fixed point sums
+void kCalculateSparseTransposedWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pDelta, NNFloat* pWeightGradient)
+{
+    alpha                                      *= cData._denoising_q;
+#pragma omp parallel
+    {
+        vector<double> vSum(n);
+#pragma omp for schedule(dynamic)
+        for (int64_t row = 0; row < (int64_t)m; row++)
+        {
+            fill(vSum.begin(), vSum.end(), 0.0);
+            for (uint32_t i = pSparseTransposedStart[row]; i < pSparseTransposedEnd[row]; i++)
+            {
+                NNFloat* pDeltaRow              = pDelta + (uint64_t)pSparseTransposedIndex[i] * n;
+                for (uint32_t o = 0; o < n; o++)
+                    vSum[o]                    += pDeltaRow[o];
+            }
+            NNFloat* pRow                       = pWeightGradient + row * n;
+            for (uint32_t o = 0; o < n; o++)
+            {
+                NNFloat oldgradient             = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : beta * pRow[o];
+                pRow[o]                         = oldgradient + alpha * (NNFloat)vSum[o];
+            }
+        }
+    }
+}
+
+template<typename T> void kCalculateSparseTransposedAnalogWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, T* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient)
+{
+    alpha                                      *= cData._denoising_q;
+#pragma omp parallel
+    {
+        vector<double> vSum(n);
+#pragma omp for schedule(dynamic)
+        for (int64_t row = 0; row < (int64_t)m; row++)
+        {
+            fill(vSum.begin(), vSum.end(), 0.0);
+            for (uint32_t i = pSparseTransposedStart[row]; i < pSparseTransposedEnd[row]; i++)
+            {
+                NNFloat* pDeltaRow              = pDelta + (uint64_t)pSparseTransposedIndex[i] * n;
+                NNFloat value                   = hDataValue(pSparseTransposedData[i]);
+                for (uint32_t o = 0; o < n; o++)
+                    vSum[o]                    += value * pDeltaRow[o];
+            }
+            NNFloat* pRow                       = pWeightGradient + row * n;
+            for (uint32_t o = 0; o < n; o++)
+            {
+                NNFloat oldgradient             = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : beta * pRow[o];
+                pRow[o]                         = oldgradient + alpha * (NNFloat)vSum[o];
+            }
+        }
+    }
+}
+
+NNFloat kCalculateRegularizationError(NNFloat lambda, NNFloat* pWeight, uint64_t size)
+{
+    double error                                = 0.0;
+#pragma omp parallel for reduction(+:error)
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat w                               = pWeight[pos];
+        error                                  += w * w;
+    }
+    return (NNFloat)(lambda * 0.5 * error);
+}
+
+// Squared L2 norm of each of the outputStride columns of a weight matrix, rows are walked
+// in order a block of columns at a time to keep the reads contiguous
+static void CalculateColumnMagnitudes(uint32_t outputStride, uint32_t inputStride, NNFloat* pWeight, NNFloat* pMagnitude)
+{
+    const uint32_t COLUMN_BLOCK                 = 256;
+    int64_t blocks                              = (outputStride + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+#pragma omp parallel for
+    for (int64_t block = 0; block < blocks; block++)
+    {
+        uint32_t start                          = block * COLUMN_BLOCK;
+        uint32_t end                            = min(outputStride, start + COLUMN_BLOCK);
+        for (uint32_t pos = start; pos < end; pos++)
+            pMagnitude[pos]                     = (NNFloat)0.0;
+        for (uint32_t i = 0; i < inputStride; i++)
+        {
+            NNFloat* pRow                       = pWeight + (uint64_t)i * outputStride;
+            for (uint32_t pos = start; pos < end; pos++)
+                pMagnitude[pos]                += pRow[pos] * pRow[pos];
+        }
+    }
+}
+
+void kNormalizeWeightMagnitudes(NNFloat norm, uint32_t outputStride, uint32_t inputStride, NNFloat* pWeight, NNFloat* pMagnitude)
+{
+    vector<NNFloat> vScale(outputStride);
+    for (uint32_t pos = 0; pos < outputStride; pos++)
+    {
+        NNFloat r2                              = pMagnitude[pos];
+        vScale[pos]                             = (r2 > norm * norm) ? norm / sqrt(r2) : (NNFloat)1.0;
+    }
+
+#pragma omp parallel for
+    for (int64_t i = 0; i < (int64_t)inputStride; i++)
+    {
+        NNFloat* pRow                           = pWeight + i * outputStride;
+        for (uint32_t pos = 0; pos < outputStride; pos++)
+            pRow[pos]                          *= vScale[pos];
+    }
+}
+
+void kNormalizeWeights(NNFloat norm, uint32_t outputStride, uint32_t inputStride, NNFloat* pWeight)
+{
+    vector<NNFloat> vMagnitude(outputStride);
+    CalculateColumnMagnitudes(outputStride, inputStride, pWeight, vMagnitude.data());
+    kNormalizeWeightMagnitudes(norm, outputStride, inputStride, pWeight, vMagnitude.data());
+}
+
+void kCalculateWeightMagnitudes(uint32_t outputStride, uint32_t inputStride, NNFloat* pWeight, NNFloat* pMagnitude)
+{
+    CalculateColumnMagnitudes(outputStride, inputStride, pWeight, pMagnitude);
+}
+
+void kCalculateDropout(NNFloat* pUnit, NNFloat* pRandom, uint32_t batch, uint32_t stride, NNFloat p)
+{
+    curandGenerateUniform(getGpu()._RNG, pRandom, batch * stride);
+    NNFloat scale                               = (NNFloat)1.0 / ((NNFloat)1.0 - p);
+    uint64_t size                               = (uint64_t)batch * (uint64_t)stride;
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pUnit[pos]                              = (pRandom[pos] < p) ? (NNFloat)0.0 : scale * pUnit[pos];
+}
+
+void kCalculateMaxout(NNFloat* pSrc, size_t size, NNFloat* pDst)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pDst[pos]                               = max(pSrc[pos], pDst[pos]);
+}
+
+void kSGDUpdateWeights(NNFloat alpha, NNFloat lambda, uint64_t size, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        pWeight[pos]                            = w + alpha * g - alpha * lambda * w;
+    }
+}
+
+void kSGDUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        pBias[pos]                             -= alpha * sum;
+    }
+}
+
+void kMomentumUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        NNFloat v                               = pWeightVelocity[pos];
+        v                                       = mu * v + alpha * g - alpha * lambda * w;
+        pWeightVelocity[pos]                    = v;
+        pWeight[pos]                            = w + v;
+    }
+}
+
+void kMomentumUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        NNFloat v                               = pBiasVelocity[pos];
+        v                                       = mu * v - alpha * sum;
+        pBiasVelocity[pos]                      = v;
+        pBias[pos]                             += v;
+    }
+}
+
+void kAdaGradUpdateWeights(NNFloat alpha, NNFloat lambda, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        NNFloat v                               = pWeightVelocity[pos];
+        g                                      -= lambda * w;
+        v                                      += g * g;
+        pWeightVelocity[pos]                    = v;
+        pWeight[pos]                            = w + alpha * g / sqrt(max((NNFloat)0.000000001, v));
+    }
+}
+
+void kAdaGradUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        NNFloat v                               = pBiasVelocity[pos];
+        v                                      += sum * sum;
+        pBiasVelocity[pos]                      = v;
+        pBias[pos]                             -= alpha * sum / sqrt(max((NNFloat)0.000000001, v));
+    }
+}
+
+void kAdaDeltaUpdateWeights(NNFloat lambda, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeightGradientVelocity, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        NNFloat v                               = pWeightVelocity[pos];
+        NNFloat vg                              = pWeightGradientVelocity[pos];
+        g                                      -= lambda * w;
+        vg                                      = mu * vg + ((NNFloat)1.0 - mu) * g * g;
+        NNFloat dw                              = sqrt(max((NNFloat)0.000000001, v) / max((NNFloat)0.000000001, vg)) * g;
+        v                                       = mu * v + ((NNFloat)1.0 - mu) * dw * dw;
+        pWeightVelocity[pos]                    = v;
+        pWeightGradientVelocity[pos]            = vg;
+        pWeight[pos]                            = w + dw;
+    }
+}
+
+void kAdaDeltaUpdateBiases(NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBiasGradientVelocity, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        NNFloat v                               = pBiasVelocity[pos];
+        NNFloat vg                              = pBiasGradientVelocity[pos];
+        vg                                      = mu * vg + ((NNFloat)1.0 - mu) * sum * sum;
+        NNFloat dw                              = sqrt(max((NNFloat)0.000000001, v) / max((NNFloat)0.000000001, vg)) * sum;
+        v                                       = mu * v + ((NNFloat)1.0 - mu) * dw * dw;
+        pBiasVelocity[pos]                      = v;
+        pBiasGradientVelocity[pos]              = vg;
+        pBias[pos]                             -= dw;
+    }
+}
+
+void kNesterovShiftWeights(NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        pWeight[pos]                           += mu * pWeightVelocity[pos];
+}
+
+void kNesterovShiftBiases(NNFloat mu, uint32_t width, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    for (uint32_t pos = 0; pos < width; pos++)
+        pBias[pos]                             += mu * pBiasVelocity[pos];
+}
+
+void kNesterovUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        NNFloat vOld                            = pWeightVelocity[pos];
+        NNFloat vNew                            = mu * vOld + alpha * (g - lambda * w);
+        pWeightVelocity[pos]                    = vNew;
+        pWeight[pos]                            = w + vNew + mu * (vNew - vOld);
+    }
+}
+
+void kNesterovUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        NNFloat vOld                            = pBiasVelocity[pos];
+        NNFloat vNew                            = mu * vOld - alpha * sum;
+        pBiasVelocity[pos]                      = vNew;
+        pBias[pos]                             += vNew + mu * (vNew - vOld);
+    }
+}
+
+void kRMSPropUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+#pragma omp parallel for
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+    {
+        NNFloat g                               = pWeightGradient[pos];
+        NNFloat w                               = pWeight[pos];
+        NNFloat v                               = pWeightVelocity[pos];
+        g                                      -= lambda * w;
+        v                                       = mu * v + ((NNFloat)1.0 - mu) * g * g;
+        pWeightVelocity[pos]                    = v;
+        pWeight[pos]                            = w + alpha * g / sqrt(max((NNFloat)0.000000001, v));
+    }
+}
+
+void kRMSPropUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    vector<NNFloat> vSum(width);
+    SumColumns(batch, width, pDelta, vSum.data());
+    for (uint32_t pos = 0; pos < width; pos++)
+    {
+        NNFloat sum                             = vSum[pos] / (NNFloat)batch;
+        NNFloat v                               = pBiasVelocity[pos];
+        v                                       = mu * v + ((NNFloat)1.0 - mu) * sum * sum;
+        pBiasVelocity[pos]                      = v;
+        pBias[pos]                             -= alpha * sum / sqrt(max((NNFloat)0.000000001, v));
+    }
+}
+
+// Explicitly instantiates the same templated functions as kernels.cu
+template size_t kInitSort<NNFloat, NNFloat>(uint32_t items, GpuBuffer<NNFloat>* pbKey, GpuBuffer<NNFloat>* pbValue);
+template size_t kInitSort<uint32_t, NNFloat>(uint32_t items, GpuBuffer<uint32_t>* pbKey, GpuBuffer<NNFloat>* pbValue);
+template size_t kInitSort<NNFloat, uint32_t>(uint32_t items, GpuBuffer<NNFloat>* pbKey, GpuBuffer<uint32_t>* pbValue);
+template size_t kInitSort<uint32_t, uint32_t>(uint32_t items, GpuBuffer<uint32_t>* pbKey, GpuBuffer<uint32_t>* pbValue);
+template bool kSort<NNFloat, NNFloat>(uint32_t items, NNFloat* pKey0, NNFloat* pKey1, NNFloat* pValue0, NNFloat* pValue1, char* pTemp, size_t tempBytes);
+template bool kSort<NNFloat, uint32_t>(uint32_t items, NNFloat* pKey0, NNFloat* pKey1, uint32_t* pValue0, uint32_t* pValue1, char* pTemp, size_t tempBytes);
+template bool kSort<uint32_t, NNFloat>(uint32_t items, uint32_t* pKey0, uint32_t* pKey1, NNFloat* pValue0, NNFloat* pValue1, char* pTemp, size_t tempBytes);
+template bool kSort<uint32_t, uint32_t>(uint32_t items, uint32_t* pKey0, uint32_t* pKey1, uint32_t* pValue0, uint32_t* pValue1, char* pTemp, size_t tempBytes);
+
+template void kLoadSparseAnalogDenoisedInputUnit<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, NNFloat* pRandom);
+template void kLoadSparseAnalogDenoisedInputUnit<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, NNFloat* pRandom);
+
+template void kLoadSparseAnalogInputUnit<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData);
+template void kLoadSparseAnalogInputUnit<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData);
+template void kLoadSparseAnalogInputUnit<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData);
+template void kLoadSparseAnalogInputUnit<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData);
+template void kLoadSparseAnalogInputUnit<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData);
+template void kLoadSparseAnalogInputUnit<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData);
+template void kLoadSparseAnalogInputUnit<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData);
+template void kLoadSparseAnalogInputUnit<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData);
+
+template void kCalculateSparseAnalogZ<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogZ<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, NNFloat* pUnit, NNFloat beta);
+
+template void kCalculateSparseAnalogDenoisedZ<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+template void kCalculateSparseAnalogDenoisedZ<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+
+template void kCalculateSparseTransposedAnalogMatrix<NNFloat>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<double>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, double* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<unsigned char>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, unsigned char* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<char>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, char* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<uint32_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint32_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<uint64_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint64_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<int32_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int32_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogMatrix<int64_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int64_t* pSparseTransposedData);
+
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<NNFloat>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<double>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, double* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<unsigned char>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, unsigned char* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<char>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, char* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<uint32_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint32_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<uint64_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint64_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<int32_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int32_t* pSparseTransposedData);
+template void kCalculateSparseTransposedAnalogDenoisedMatrix<int64_t>(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int64_t* pSparseTransposedData);
+
+template void kCalculateSparseTransposedAnalogWeightGradient<NNFloat>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<double>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, double* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<unsigned char>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, unsigned char* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<char>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, char* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<uint32_t>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint32_t* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<uint64_t>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, uint64_t* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<int32_t>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int32_t* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+template void kCalculateSparseTransposedAnalogWeightGradient<int64_t>(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, int64_t* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+
+template void kLoadInputUnit<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template void kLoadInputUnit<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template void kLoadInputUnit<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template void kLoadInputUnit<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template void kLoadInputUnit<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template void kLoadInputUnit<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template void kLoadInputUnit<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template void kLoadInputUnit<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
@@ -0,0 +1,354 @@
+/*
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+// Host implementation of kLoss.cu for HOST_ONLY builds.  Errors are accumulated in double
+// through OpenMP reductions instead of the GPU's 64-bit fixed point accumulator.
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include <limits>
+#include <omp.h>
+
+static GpuData cData;
+
+void SetKLossGpuData()
+{
+    cData                                       = getGpu()._data;
+}
+
+void GetKLossGpuData()
+{
+    getGpu()._data                              = cData;
+}
+
+// Sums error(a) over every unit of the batch, the zero target half of a sparse error function
+template<typename ErrorFunction> static double SumRawError(uint32_t batch, uint32_t stride, NNFloat* pUnit, ErrorFunction error)
+{
+    uint64_t size                               = (uint64_t)batch * (uint64_t)stride;
+    double sum                                  = 0.0;
+#pragma omp parallel for reduction(+:sum)
+    for (int64_t pos = 0; pos < (int64_t)size; pos++)
+        sum                                    += error(pUnit[pos]);
+    return sum;
+}
+
+// Sums error(a, t, count) over the non-zero targets of each example, t is 1 when pSparseData is NULL
+// and count is the number of non-zero targets of the example
+template<typename T, typename ErrorFunction> static double SumNonZeroError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, ErrorFunction error)
+{
+    double sum                                  = 0.0;
+#pragma omp parallel for reduction(+:sum) schedule(dynamic, 16)
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint32_t dpos                           = hDataPosition(cData, position + pos);
+        uint64_t start                          = pSparseStart[dpos];
+        uint64_t end                            = pSparseEnd[dpos];
+        NNFloat count                           = (NNFloat)(end - start);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        for (uint64_t i = start; i < end; i++)
+        {
+            NNFloat t                           = pSparseData ? hDataValue(pSparseData[i]) : (NNFloat)1.0;
+            sum                                += error(pRow[pSparseIndex[i]], t, count);
+        }
+    }
+    return sum;
+}
+
+// Sums error(a, t) over a dense batch of units and targets
+template<typename T, typename ErrorFunction> static double SumError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData, ErrorFunction error)
+{
+    double sum                                  = 0.0;
+#pragma omp parallel for reduction(+:sum)
+    for (int64_t pos = 0; pos < (int64_t)batch; pos++)
+    {
+        uint64_t dpos                           = hDataPosition(cData, position + pos);
+        NNFloat* pRow                           = pUnit + pos * stride;
+        T* pDataRow                             = pData + dpos * stride;
+        for (uint32_t i = 0; i < stride; i++)
+            sum                                += error(pRow[i], hDataValue(pDataRow[i]));
+    }
+    return sum;
+}
+
+// Error functions of a single unit, Raw* is the error of a unit with a zero target and
+// NonZero* the error of a unit with target t
+static inline NNFloat RawL1Error(NNFloat a)
+{
+    return fabs(a);
+}
+
+static inline NNFloat NonZeroL1Error(NNFloat a, NNFloat t, NNFloat count)
+{
+    return fabs(a - t);
+}
+
+static inline NNFloat RawL2Error(NNFloat a)
+{
+    return (NNFloat)0.5 * a * a;
+}
+
+static inline NNFloat NonZeroL2Error(NNFloat a, NNFloat t, NNFloat count)
+{
+    return (NNFloat)0.5 * (a - t) * (a - t);
+}
+
+static inline NNFloat RawCrossEntropyError(NNFloat a)
+{
+    return -log(max(MIN_ERROR, (NNFloat)1.0 - a));
+}
+
+static inline NNFloat NonZeroCrossEntropyError(NNFloat a, NNFloat t, NNFloat count)
+{
+    return -log(max(MIN_ERROR, a));
+}
+
+static inline NNFloat RawScaledMarginalCrossEntropyError(NNFloat a)
+{
+    return (a > cData._SMCE_zeroTarget) ? -cData._SMCE_zeroScale * log(max(MIN_ERROR, (NNFloat)1.0 - a)) : (NNFloat)0.0;
+}
+
+static inline NNFloat NonZeroScaledMarginalCrossEntropyError(NNFloat a, NNFloat t, NNFloat count)
+{
+    return (a < cData._SMCE_oneTarget) ? -cData._SMCE_oneScale * t * log(max(MIN_ERROR, a)) : (NNFloat)0.0;
+}
+
+static inline NNFloat NonZeroMultinomialCrossEntropyError(NNFloat a, NNFloat t, NNFloat count)
+{
+    return -t * log(max(MIN_ERROR, a));
+}
+
+// Error of a sparse output layer, the non-zero targets replace the zero target error of their units
+// unless zero targets are ignored
+template<typename T, typename RawFunction, typename NonZeroFunction> static NNFloat SparseError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero, RawFunction raw, NonZeroFunction nonZero)
+{
+    double error                                = 0.0;
+    if (bSparseIgnoreZero)
+    {
+        error                                   = SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, nonZero);
+    }
+    else
+    {
+        error                                   = SumRawError(batch, stride, pUnit, raw);
+        error                                  += SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, 
+                                                  [&](NNFloat a, NNFloat t, NNFloat count) { return nonZero(a, t, count) - raw(a); });
+    }
+    return (NNFloat)error;
+}
+
+NNFloat kCalculateSparseL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawL1Error, NonZeroL1Error);
+}
+
+template<typename T> NNFloat kCalculateSparseAnalogL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawL1Error, NonZeroL1Error);
+}
+
+NNFloat kCalculateSparseL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawL2Error, NonZeroL2Error);
+}
+
+template<typename T> NNFloat kCalculateSparseAnalogL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, bSparseIgnoreZero, RawL2Error, NonZeroL2Error);
+}
+
+NNFloat kCalculateSparseCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawCrossEntropyError, NonZeroCrossEntropyError);
+}
+
+NNFloat kCalculateSparseScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, bool bSparseIgnoreZero)
+{
+    return SparseError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, bSparseIgnoreZero, RawScaledMarginalCrossEntropyError, NonZeroScaledMarginalCrossEntropyError);
+}
+
+// Unlike the other sparse errors, the data scaled error keeps the unscaled zero target term of each non-zero unit
+template<typename T> NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, bool bSparseIgnoreZero)
+{
+    double error                                = 0.0;
+    if (!bSparseIgnoreZero)
+        error                                   = SumRawError(batch, stride, pUnit, RawScaledMarginalCrossEntropyError);
+    error                                      += SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, 
+                                                  [](NNFloat a, NNFloat t, NNFloat count) { return NonZeroScaledMarginalCrossEntropyError(a, t, count) - RawScaledMarginalCrossEntropyError(a); });
+    return (NNFloat)error;
+}
+
+NNFloat kCalculateSparseMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex)
+{
+    return (NNFloat)SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, 
+                                    [](NNFloat a, NNFloat t, NNFloat count) { return NonZeroMultinomialCrossEntropyError(a, (NNFloat)1.0 / count, count); });
+}
+
+template<typename T> NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData)
+{
+    return (NNFloat)SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, NonZeroMultinomialCrossEntropyError);
+}
+
+NNFloat kCalculateSparseMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex)
+{
+    return (NNFloat)SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, (NNFloat*)NULL, 
+                                    [](NNFloat a, NNFloat t, NNFloat count) { return NonZeroScaledMarginalCrossEntropyError(a, (NNFloat)1.0 / count, count); });
+}
+
+template<typename T> NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData)
+{
+    return (NNFloat)SumNonZeroError(position, batch, stride, pUnit, pSparseStart, pSparseEnd, pSparseIndex, pSparseData, NonZeroScaledMarginalCrossEntropyError);
+}
+
+template<typename T> NNFloat kCalculateL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) { return fabs(a - t); });
+}
+
+template<typename T> NNFloat kCalculateL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) { return (NNFloat)0.5 * (a - t) * (a - t); });
+}
+
+template<typename T> NNFloat kCalculateCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) { return -t * log(max(MIN_ERROR, a)) - ((NNFloat)1.0 - t) * log(max(MIN_ERROR, (NNFloat)1.0 - a)); });
+}
+
+template<typename T> NNFloat kCalculateMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) { return -t * log(max(MIN_ERROR, a)); });
+}
+
+template<typename T> NNFloat kCalculateScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) -> NNFloat
+                             {
+                                 if (((t == (NNFloat)1.0) && (a < cData._SMCE_oneTarget)) || ((t == (NNFloat)0.0) && (a > cData._SMCE_zeroTarget)))
+                                     return -t * cData._SMCE_oneScale * log(max(MIN_ERROR, a)) - ((NNFloat)1.0 - t) * cData._SMCE_zeroScale * log(max(MIN_ERROR, (NNFloat)1.0 - a));
+                                 return (NNFloat)0.0;
+                             });
+}
+
+template<typename T> NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData)
+{
+    return (NNFloat)SumError(position, batch, stride, pUnit, pData, 
+                             [](NNFloat a, NNFloat t) -> NNFloat
+                             {
+                                 if ((t != (NNFloat)0.0) && (a < cData._SMCE_oneTarget))
+                                     return -t * cData._SMCE_oneScale * log(max(MIN_ERROR, a));
+                                 return (NNFloat)0.0;
+                             });
+}
+
+// Explicitly instantiates the same templated functions as kLoss.cu
+template NNFloat kCalculateL1Error<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateL1Error<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateL1Error<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateL1Error<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateL1Error<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateL1Error<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateL1Error<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateL1Error<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateL2Error<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateL2Error<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateL2Error<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateL2Error<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateL2Error<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateL2Error<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateL2Error<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateL2Error<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateScaledMarginalCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateScaledMarginalCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateMultinomialCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateMultinomialCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, double* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, unsigned char* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, char* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int32_t* pData);
+template NNFloat kCalculateMultinomialScaledMarginalCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, int64_t* pData);
+
+template NNFloat kCalculateSparseAnalogL1Error<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL1Error<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, bool bSparseIgnoreZero);
+
+template NNFloat kCalculateSparseAnalogL2Error<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseAnalogL2Error<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, bool bSparseIgnoreZero);
+
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData);
+
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData);
+template NNFloat kCalculateSparseAnalogMultinomialScaledMarginalCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData);
+
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<NNFloat>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<double>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, double* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<unsigned char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, unsigned char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<char>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, char* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<uint32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<uint64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint64_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<int32_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int32_t* pSparseData, bool bSparseIgnoreZero);
+template NNFloat kCalculateSparseDataScaledMarginalCrossEntropyError<int64_t>(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, int64_t* pSparseData, bool bSparseIgnoreZero);
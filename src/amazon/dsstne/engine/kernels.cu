@@ -464,49 +464,60 @@ kCalculateSparseZ_kernel(uint32_t position, uint32_t stride, NNFloat* pWeight, u
 __shared__ uint32_t sOpos;                                      // Shared output position
 __shared__ uint32_t sOffset[MAXSPARSE];                         // Shared set of offsets to non-zero weights
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSE datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        sOffset[pos]            = pSparseIndex[start] * stride;
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            uint32_t offset     = sOffset[i];
-            unit               += pWeight[offset + opos];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSE) ? MAXSPARSE : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            sOffset[pos]        = pSparseIndex[start] * stride;
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                uint32_t offset = sOffset[i];
+                unit           += pWeight[offset + opos];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 
@@ -526,50 +537,61 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ uint32_t sOffset[MAXSPARSEANALOG];                   // Shared set of offsets to non-zero weights
 __shared__ T sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        sOffset[pos]            = pSparseIndex[start] * stride;
-        sValue[pos]             = pSparseData[start];
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            uint32_t offset     = sOffset[i];
-            unit               += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            sOffset[pos]        = pSparseIndex[start] * stride;
+            sValue[pos]         = pSparseData[start];
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                uint32_t offset = sOffset[i];
+                unit           += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<>
@@ -581,50 +603,61 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ uint32_t sOffset[MAXSPARSEANALOG];                   // Shared set of offsets to non-zero weights
 __shared__ NNFloat sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        sOffset[pos]            = pSparseIndex[start] * stride;
-        sValue[pos]             = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 256.0);
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            uint32_t offset     = sOffset[i];
-            unit               += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            sOffset[pos]        = pSparseIndex[start] * stride;
+            sValue[pos]         = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 256.0);
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                uint32_t offset = sOffset[i];
+                unit           += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<>
@@ -636,50 +669,61 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ uint32_t sOffset[MAXSPARSEANALOG];                   // Shared set of offsets to non-zero weights
 __shared__ NNFloat sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        sOffset[pos]            = pSparseIndex[start] * stride;
-        sValue[pos]             = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 128.0);
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            uint32_t offset     = sOffset[i];
-            unit               += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            sOffset[pos]        = pSparseIndex[start] * stride;
+            sValue[pos]         = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 128.0);
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                uint32_t offset = sOffset[i];
+                unit           += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<typename T> void kCalculateSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pUnit, NNFloat beta)
@@ -710,51 +754,62 @@ kCalculateSparseDenoisedZ_kernel(uint32_t position, uint32_t stride, NNFloat* pW
 __shared__ uint32_t sOpos;                                      // Shared output position
 __shared__ uint32_t sOffset[MAXSPARSE];                         // Shared set of offsets to non-zero weights
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSE datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        NNFloat value           = pRandom[start];
-        sOffset[pos]            = (value < cData._denoising_p) ? cData._maxUint32_t : (int32_t)pSparseIndex[start] * stride;
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            int32_t offset      = sOffset[i];
-            if (offset != cData._maxUint32_t)
-                unit           += pWeight[offset + opos] * cData._denoising_q;  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSE) ? MAXSPARSE : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            NNFloat value       = pRandom[start];
+            sOffset[pos]        = (value < cData._denoising_p) ? cData._maxUint32_t : (int32_t)pSparseIndex[start] * stride;
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                int32_t offset  = sOffset[i];
+                if (offset != cData._maxUint32_t)
+                    unit       += pWeight[offset + opos] * cData._denoising_q;  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 void kCalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta)
@@ -773,52 +828,63 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ uint32_t sOffset[MAXSPARSEANALOG];                   // Shared set of offsets to non-zero weights
 __shared__ T sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        NNFloat value           = pRandom[start];
-        sOffset[pos]            = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
-        sValue[pos]             = pSparseData[start] * cData._denoising_q;
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            int32_t offset      = sOffset[i];
-            if (offset != cData._maxUint32_t)
-                unit           += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            NNFloat value       = pRandom[start];
+            sOffset[pos]        = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
+            sValue[pos]         = pSparseData[start] * cData._denoising_q;
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                int32_t offset  = sOffset[i];
+                if (offset != cData._maxUint32_t)
+                    unit       += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<>
@@ -830,52 +896,63 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ int32_t sOffset[MAXSPARSEANALOG];                    // Shared set of offsets to non-zero weights
 __shared__ NNFloat sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        NNFloat value           = pRandom[start];
-        sOffset[pos]            = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
-        sValue[pos]             = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 256.0) * cData._denoising_q;
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            int32_t offset      = sOffset[i];
-            if (offset != cData._maxUint32_t)
-                unit           += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            NNFloat value       = pRandom[start];
+            sOffset[pos]        = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
+            sValue[pos]         = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 256.0) * cData._denoising_q;
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                int32_t offset  = sOffset[i];
+                if (offset != cData._maxUint32_t)
+                    unit       += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<>
@@ -887,52 +964,63 @@ __shared__ uint32_t sOpos;                                      // Shared output
 __shared__ uint32_t sOffset[MAXSPARSEANALOG];                   // Shared set of offsets to non-zero weights
 __shared__ NNFloat sValue[MAXSPARSEANALOG];
 
-    // Read sparse indices into shared memory so they're only read once
-    sOpos                       = blockDim.x;
+    // Read sparse indices into shared memory so they're only read once.  Examples with more than
+    // MAXSPARSEANALOG datapoints are processed in chunks, later chunks accumulating onto the first
     position                    = cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x;    
     uint64_t start              = pSparseStart[position];
     uint64_t end                = pSparseEnd[position];
-    uint32_t inputs             = end - start;
-    uint32_t pos                = threadIdx.x;
-    start                      += threadIdx.x;
-    while (start < end)
-    {
-        NNFloat value           = pRandom[start];
-        sOffset[pos]            = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
-        sValue[pos]             = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 128.0) * cData._denoising_q;
-        pos                    += blockDim.x;
-        start                  += blockDim.x;
-    }
-
-    __threadfence();
-    __syncthreads();
-
-    // Cycle through all output positions
     pUnit                      += blockIdx.x * stride;
-    uint32_t opos               = threadIdx.x;
-    uint32_t tgx                = threadIdx.x & cData._warpMask;    
-    while (opos < stride)
-    {        
-        // Read all non-zero inputs
-        NNFloat unit            = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
-        for (uint32_t i = 0; i < inputs; i++)
-        {
-            uint32_t offset      = sOffset[i];
-            if (offset != cData._maxUint32_t)
-                unit           += pWeight[offset + opos] * sValue[i];  
-        }
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    do
+    {
+        uint32_t inputs         = (end - start > MAXSPARSEANALOG) ? MAXSPARSEANALOG : end - start;
+        uint64_t chunkEnd       = start + inputs;
+        sOpos                   = blockDim.x;
+        uint32_t pos            = threadIdx.x;
+        start                  += threadIdx.x;
+        while (start < chunkEnd)
+        {
+            NNFloat value       = pRandom[start];
+            sOffset[pos]        = (value < cData._denoising_p) ? cData._maxUint32_t : pSparseIndex[start] * stride;
+            sValue[pos]         = (NNFloat)pSparseData[start] * (NNFloat)(1.0 / 128.0) * cData._denoising_q;
+            pos                += blockDim.x;
+            start              += blockDim.x;
+        }
+        start                   = chunkEnd;
+
+        __threadfence();
+        __syncthreads();
+
+        // Cycle through all output positions
+        uint32_t opos           = threadIdx.x;
+        while (opos < stride)
+        {        
+            // Read all non-zero inputs
+            NNFloat unit        = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : pUnit[opos];
+            for (uint32_t i = 0; i < inputs; i++)
+            {
+                uint32_t offset  = sOffset[i];
+                if (offset != cData._maxUint32_t)
+                    unit       += pWeight[offset + opos] * sValue[i];  
+            }
         
-        // Write output
-        pUnit[opos]             = unit;
+            // Write output
+            pUnit[opos]         = unit;
     
-        // Advance to next set of outputs
-        if (tgx == 0)
-        {
-            opos                = atomicAdd(&sOpos, cData._warpSize);
+            // Advance to next set of outputs
+            if (tgx == 0)
+            {
+                opos            = atomicAdd(&sOpos, cData._warpSize);
+            }
+            opos                = __shfl(opos, 0);
+            opos               += tgx;
         }
-        opos                    = __shfl(opos, 0);
-        opos                   += tgx;
+
+        // Wait for every warp before the next chunk replaces the shared offsets
+        beta                    = (NNFloat)1.0;
+        __syncthreads();
     }
+    while (start < end);
 }
 
 template<typename T> void kCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta)
@@ -956,6 +1044,48 @@ template<> void kCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batc
     LAUNCHERROR("kCalculateSparseAnalogDenoisedZ_kernel");
 }
 
+// One warp per candidate, lanes stride across the input units of the example and the transposed
+// weight row of the candidate then reduce.  Rows past the example's candidate count are padded
+// with -MAX_VALUE so they drop out of SoftMax and top K
+__global__ void
+LAUNCH_BOUNDS()
+kCalculateCandidateZ_kernel(uint32_t position, uint32_t stride, NNFloat* pInput, NNFloat* pTransposedWeight, NNFloat* pBias, uint64_t* pCandidateStart, uint64_t* pCandidateEnd, uint32_t* pCandidate, bool bShared, uint32_t candidateStride, NNFloat* pUnit)
+{
+    position                    = bShared ? 0 : (cData._bShuffleIndices ? cData._pShuffleIndex[position + blockIdx.x] : position + blockIdx.x);
+    uint64_t start              = pCandidateStart[position];
+    uint32_t count              = pCandidateEnd[position] - start;
+    pInput                     += blockIdx.x * stride;
+    pUnit                      += blockIdx.x * candidateStride;
+    uint32_t tgx                = threadIdx.x & cData._warpMask;
+    uint32_t warps              = blockDim.x >> cData._warpBits;
+    for (uint32_t j = threadIdx.x >> cData._warpBits; j < candidateStride; j += warps)
+    {
+        NNFloat sum             = -MAX_VALUE;
+        if (j < count)
+        {
+            uint32_t candidate  = pCandidate[start + j];
+            NNFloat* pWeight    = pTransposedWeight + (uint64_t)candidate * stride;
+            sum                 = (NNFloat)0.0;
+            for (uint32_t i = tgx; i < stride; i += cData._warpSize)
+                sum            += pInput[i] * pWeight[i];
+            sum                += __shfl(sum, tgx ^ 1);
+            sum                += __shfl(sum, tgx ^ 2);
+            sum                += __shfl(sum, tgx ^ 4);
+            sum                += __shfl(sum, tgx ^ 8);
+            sum                += __shfl(sum, tgx ^ 16);
+            sum                += pBias[candidate];
+        }
+        if (tgx == 0)
+            pUnit[j]            = sum;
+    }
+}
+
+void kCalculateCandidateZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pInput, NNFloat* pTransposedWeight, NNFloat* pBias, uint64_t* pCandidateStart, uint64_t* pCandidateEnd, uint32_t* pCandidate, bool bShared, uint32_t candidateStride, NNFloat* pUnit)
+{
+    kCalculateCandidateZ_kernel<<<batch, getGpu()._threadsPerBlock>>>(position, stride, pInput, pTransposedWeight, pBias, pCandidateStart, pCandidateEnd, pCandidate, bShared, candidateStride, pUnit);
+    LAUNCHERROR("kCalculateCandidateZ_kernel");
+}
+
 __global__ void
 LAUNCH_BOUNDS()
 kCalculateSparseTransposedMatrix_kernel(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex)
@@ -1894,9 +2024,23 @@ void kRMSPropUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t wi
 }
 
 #include "bitonic.h"
+
+// Multiplies key, read from row position wpos, by the row's score mask and by its filter value if wpos has one.
+// Each thread reads increasing positions, so fpos only ever moves forward through the row's ascending filter positions
+static __device__ __forceinline__ NNFloat FilteredKey(NNFloat key, uint32_t wpos, NNFloat* pRowMask, uint64_t& fpos, uint64_t fend, uint32_t* pFilterIndex, NNFloat* pFilterValue)
+{
+    if (pRowMask)
+        key                        *= pRowMask[wpos];
+    while ((fpos < fend) && (pFilterIndex[fpos] < wpos))
+        fpos++;
+    if ((fpos < fend) && (pFilterIndex[fpos] == wpos))
+        key                        *= pFilterValue[fpos];
+    return key;
+}
+
 __global__ void
 LAUNCH_BOUNDS()
-kCalculateTopK_kernel(NNFloat* pOutputBuffer, NNFloat* pKeyBuffer, uint32_t* pValueBuffer, uint32_t batch, uint32_t width, uint32_t k)
+kCalculateTopK_kernel(NNFloat* pOutputBuffer, NNFloat* pKeyBuffer, uint32_t* pValueBuffer, uint32_t batch, uint32_t width, uint32_t k, uint64_t* pFilterStart, uint64_t* pFilterEnd, uint32_t* pFilterIndex, NNFloat* pFilterValue, NNFloat* pMask, uint32_t* pMaskRow)
 {
 __shared__ volatile NNFloat sKey[160 * 4];
 __shared__ volatile uint32_t sValue[160 * 4];
@@ -1913,6 +2057,18 @@ __shared__ volatile uint32_t sValue[160 * 4];
         volatile NNFloat* psKey     = &sKey[160 * offset];
         volatile uint32_t* psValue  = &sValue[160 * offset];
 
+        // Filter positions and score mask of this row, none without a filter
+        uint64_t fpos               = 0;
+        uint64_t fend               = 0;
+        if (pFilterStart)
+        {
+            fpos                    = pFilterStart[pos];
+            fend                    = pFilterEnd[pos];
+        }
+        NNFloat* pRowMask           = NULL;
+        if (pMask)
+            pRowMask                = pMask + (pMaskRow ? (uint64_t)pMaskRow[pos] * width : 0);
+
         // Initialize values to 
         NNFloat k0                  = -MAX_VALUE;
         NNFloat k1                  = -MAX_VALUE;
@@ -1935,25 +2091,25 @@ __shared__ volatile uint32_t sValue[160 * 4];
         uint32_t wpos               = tgx;
         if (wpos < width)
         {
-            k0                      = pOutput[wpos];
+            k0                      = FilteredKey(pOutput[wpos], wpos, pRowMask, fpos, fend, pFilterIndex, pFilterValue);
             v0                      = wpos;
         }
         wpos                       += cData._warpSize;
         if (wpos < width)
         {
-            k1                      = pOutput[wpos];
+            k1                      = FilteredKey(pOutput[wpos], wpos, pRowMask, fpos, fend, pFilterIndex, pFilterValue);
             v1                      = wpos;
         }
         wpos                       += cData._warpSize;
         if (wpos < width)
         {
-            k2                      = pOutput[wpos];
+            k2                      = FilteredKey(pOutput[wpos], wpos, pRowMask, fpos, fend, pFilterIndex, pFilterValue);
             v2                      = wpos;
         }
         wpos                       += cData._warpSize;
         if (wpos < width)
         {
-            k3                      = pOutput[wpos];
+            k3                      = FilteredKey(pOutput[wpos], wpos, pRowMask, fpos, fend, pFilterIndex, pFilterValue);
             v3                      = wpos;
         }
      
@@ -1973,7 +2129,7 @@ __shared__ volatile uint32_t sValue[160 * 4];
             uint32_t value          = wpos;
             if (wpos < width)
             {
-                key                 = pOutput[wpos];                
+                key                 = FilteredKey(pOutput[wpos], wpos, pRowMask, fpos, fend, pFilterIndex, pFilterValue);
             }
             
             // Add values > minValue to shared memory buffer
@@ -2087,7 +2243,15 @@ __shared__ volatile uint32_t sValue[160 * 4];
 void kCalculateTopK(NNFloat* pOutput, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k)
 {
     uint32_t blocks                 = (batch + 3) / 4;
-    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, k);
+    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, k, NULL, NULL, NULL, NULL, NULL, NULL);
+    LAUNCHERROR("kCalculateTopK_kernel");
+}
+
+// Top K with the sparse filter and score mask of each row applied to its keys as they are read, pOutput is left untouched
+void kCalculateFilteredTopK(NNFloat* pOutput, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k, uint64_t* pFilterStart, uint64_t* pFilterEnd, uint32_t* pFilterIndex, NNFloat* pFilterValue, NNFloat* pMask, uint32_t* pMaskRow)
+{
+    uint32_t blocks                 = (batch + 3) / 4;
+    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, k, pFilterStart, pFilterEnd, pFilterIndex, pFilterValue, pMask, pMaskRow);
     LAUNCHERROR("kCalculateTopK_kernel");
 }
 
@@ -37,6 +37,7 @@ void kUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelt
 void kCalculateTopK(NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k);
 void kCalculateTopK(NNFloat* pOutputKey, NNFloat* pOutputValue, NNFloat *pKey, NNFloat* pValue, uint32_t batch, uint32_t width, uint32_t k);
 void kCalculateTopK(NNFloat* pOutputKey, uint32_t* pOutputValue, NNFloat *pKey, uint32_t * pValue, uint32_t batch, uint32_t width, uint32_t k);
+void kCalculateFilteredTopK(NNFloat* pOutputKey, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k, uint64_t* pFilterStart, uint64_t* pFilterEnd, uint32_t* pFilterIndex, NNFloat* pFilterValue, NNFloat* pMask, uint32_t* pMaskRow);
 void kCalculateKSparse(NNFloat* pUnit, uint32_t batch, uint32_t stride, uint32_t kSparse);
 void kAddBuffers(NNFloat* pDest, NNFloat* pSrc, uint64_t size);
 void kAddBuffers2D(NNFloat* pDest, uint32_t dpitch, NNFloat* pSrc, uint32_t spitch, uint32_t width, uint32_t height);
@@ -59,6 +60,7 @@ void kCalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFlo
 template<typename T> void kCalculateSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pUnit, NNFloat beta);
 void kCalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
 template<typename T> void kCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta);
+void kCalculateCandidateZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pInput, NNFloat* pTransposedWeight, NNFloat* pBias, uint64_t* pCandidateStart, uint64_t* pCandidateEnd, uint32_t* pCandidate, bool bShared, uint32_t candidateStride, NNFloat* pUnit);
 
 // Sparse backpropagation kernels
 void kCalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex);
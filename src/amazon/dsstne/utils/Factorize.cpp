@@ -0,0 +1,187 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <netcdf>
+#include <sys/time.h>
+#include <stdexcept>
+
+#include "GpuTypes.h"
+#include "NetCDFhelper.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+using namespace std;
+
+void printUsageFactorize() {
+    cout << "Factorize: Replaces the weights into a wide fully connected layer by a low rank factorization." << endl;
+    cout << "Usage: factorize -n <network_file> -l <layer> -r <ranks> [-o <output_network_file>] [-i <input_netcdf>] [-k <top_k>] [-b <batch_size>] [-t <target_netcdf> -e <num_epochs>]" << endl;
+    cout << "    -n network_file: (required) the trained neural network in NetCDF file." << endl;
+    cout << "    -l layer: (required) the layer, usually the output layer, whose incoming weights are factorized." << endl;
+    cout << "    -r ranks: (required) comma separated ranks to try, for example 64,128,256." << endl;
+    cout << "    -o output_network_file: (optional) the factorized network to write, with _r<rank> before the extension when several ranks are given." << endl;
+    cout << "    -i input_netcdf: (optional) dataset used to measure latency and recall against the original network." << endl;
+    cout << "    -k top_k: (default = 10) the number of top units compared for recall@k, at most 128." << endl;
+    cout << "    -b batch_size: (default = 1024) the number records/input rows to process in a batch." << endl;
+    cout << "    -t target_netcdf: (optional) dataset with expected outputs, fine tunes each factorized network on it." << endl;
+    cout << "    -e num_epochs: (default = 1) the number of fine tuning passes on the full dataset." << endl;
+    cout << endl;
+}
+
+// Predicts every example and returns the seconds taken, along with the top k units of layer for each example
+static double predictTopK(NNNetwork* pNetwork, const string& layer, uint32_t k, vector<uint32_t>& vTopK) {
+    uint32_t batch = pNetwork->GetBatch();
+    GpuBuffer<NNFloat> bKey((uint64_t)batch * k);
+    GpuBuffer<uint32_t> bValue((uint64_t)batch * k);
+    vector<uint32_t> vValue((size_t)batch * k);
+    vTopK.resize((size_t)pNetwork->GetExamples() * k);
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (uint32_t pos = 0; pos < pNetwork->GetExamples(); pos += batch) {
+        pNetwork->SetPosition(pos);
+        pNetwork->PredictBatch();
+        pNetwork->CalculateTopK(layer, k, &bKey, &bValue);
+        uint32_t examples = min(batch, pNetwork->GetExamples() - pos);
+        bValue.Download(vValue.data());
+        copy(vValue.begin(), vValue.begin() + (size_t)examples * k, vTopK.begin() + (size_t)pos * k);
+    }
+    gettimeofday(&end, NULL);
+    return elapsed_time(end, start);
+}
+
+// Fraction of the reference top k units found in the top k of each example
+static double recallAtK(const vector<uint32_t>& vReference, const vector<uint32_t>& vTopK, uint32_t k) {
+    uint64_t matches = 0;
+    for (size_t pos = 0; pos < vReference.size(); pos += k) {
+        set<uint32_t> sTopK(vTopK.begin() + pos, vTopK.begin() + pos + k);
+        for (size_t j = 0; j < k; j++) {
+            matches += sTopK.count(vReference[pos + j]);
+        }
+    }
+    return vReference.size() ? (double)matches / vReference.size() : 0.0;
+}
+
+/**
+Samples argument
+./factorize -n gl.nc -l Output -r 64,128,256 -i features_input.nc -k 10
+
+reports the size, prediction time and recall@10 of gl.nc with the weights into layer Output factorized at
+ranks 64, 128 and 256, against the original network on features_input.nc
+*/
+int main(int argc, char** argv)
+{
+    if (isArgSet(argc, argv, "-h")) {
+        printUsageFactorize();
+        exit(1);
+    }
+
+    string networkFileName = getRequiredArgValue(argc, argv, "-n", "network file is not specified.", &printUsageFactorize);
+    if (! fileExists(networkFileName)) {
+        cout << "Error: Cannot read network file: " << networkFileName << endl;
+        return 1;
+    }
+    string layer = getRequiredArgValue(argc, argv, "-l", "layer is not specified.", &printUsageFactorize);
+
+    vector<uint32_t> vRank;
+    stringstream ranks(getRequiredArgValue(argc, argv, "-r", "ranks are not specified.", &printUsageFactorize));
+    string rank;
+    while (getline(ranks, rank, ',')) {
+        vRank.push_back(stoi(rank));
+    }
+
+    string outputFileName = getOptionalArgValue(argc, argv, "-o", "");
+    string inputDataFile = getOptionalArgValue(argc, argv, "-i", "");
+    string targetDataFile = getOptionalArgValue(argc, argv, "-t", "");
+    if (((inputDataFile != "") && ! fileExists(inputDataFile)) || ((targetDataFile != "") && ! fileExists(targetDataFile))) {
+        cout << "Error: Cannot read data file: " << ((inputDataFile != "") && ! fileExists(inputDataFile) ? inputDataFile : targetDataFile) << endl;
+        return 1;
+    }
+    if ((targetDataFile != "") && (inputDataFile == "")) {
+        cout << "Error: Fine tuning with -t also needs the input data with -i." << endl;
+        return 1;
+    }
+    uint32_t k = stoi(getOptionalArgValue(argc, argv, "-k", "10"));
+    uint32_t batchSize = stoi(getOptionalArgValue(argc, argv, "-b", "1024"));
+    uint32_t epochs = stoi(getOptionalArgValue(argc, argv, "-e", "1"));
+    float alpha = stof(getOptionalArgValue(argc, argv, "-alpha", "0.025f"));
+    float lambda = stof(getOptionalArgValue(argc, argv, "-lambda", "0.0001f"));
+    float mu = stof(getOptionalArgValue(argc, argv, "-mu", "0.5f"));
+
+    getGpu().Startup(argc, argv);
+    getGpu().SetRandomSeed(FIXED_SEED);
+
+    vector<NNDataSetBase*> vDataSetInput, vDataSetTarget;
+    if (inputDataFile != "") {
+        vDataSetInput = LoadNetCDF(inputDataFile);
+    }
+    if (targetDataFile != "") {
+        vDataSetTarget = LoadNetCDF(targetDataFile);
+    }
+
+    // Reference latency and top k from the original network
+    NNNetwork* pNetwork = LoadNeuralNetworkNetCDF(networkFileName, batchSize);
+    double denseTime = 0.0;
+    vector<uint32_t> vReference;
+    if (inputDataFile != "") {
+        pNetwork->LoadDataSets(vDataSetInput);
+        denseTime = predictTopK(pNetwork, layer, k, vReference);
+    }
+    delete pNetwork;
+    if (inputDataFile != "") {
+        cout << "Dense: " << denseTime << " s to predict " << vReference.size() / k << " examples" << endl;
+    }
+
+    for (auto r : vRank) {
+        pNetwork = LoadFactorizedNeuralNetworkNetCDF(networkFileName, layer, r, batchSize);
+        if (pNetwork == NULL) {
+            cout << "Error: Unable to factorize layer " << layer << " at rank " << r << endl;
+            continue;
+        }
+
+        // LoadFactorizedNeuralNetworkNetCDF has reported the weight sizes
+        if (inputDataFile != "") {
+            vector<uint32_t> vTopK;
+            pNetwork->LoadDataSets(vDataSetInput);
+            double time = predictTopK(pNetwork, layer, k, vTopK);
+            cout << "Rank " << r << ": " << time << " s to predict, recall@" << k << " " << recallAtK(vReference, vTopK, k);
+
+            if (targetDataFile != "") {
+                pNetwork->LoadDataSets(vDataSetTarget);
+                pNetwork->SetTrainingMode(SGD);
+                pNetwork->Train(epochs, alpha, lambda, mu);
+                predictTopK(pNetwork, layer, k, vTopK);
+                cout << ", recall@" << k << " " << recallAtK(vReference, vTopK, k) << " after " << epochs << " epochs of fine tuning";
+            }
+            cout << endl;
+        }
+
+        if (outputFileName != "") {
+            string fname = outputFileName;
+            if (vRank.size() > 1) {
+                size_t dot = fname.rfind('.');
+                string suffix = "_r" + to_string(r);
+                fname = (dot == string::npos) ? fname + suffix : fname.substr(0, dot) + suffix + fname.substr(dot);
+            }
+            pNetwork->SaveNetCDF(fname);
+            cout << "Factorized network written to " << fname << endl;
+        }
+        delete pNetwork;
+    }
+
+    getGpu().Shutdown();
+    return 0;
+}
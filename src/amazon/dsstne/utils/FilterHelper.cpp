@@ -18,15 +18,65 @@
 #include <string>
 #include <unordered_map>
 #include <stdexcept>
+#include <sys/time.h>
 
 #include "Utils.h"
-#include"Filters.h"
+#include "NetCDFhelper.h"
+#include "Filters.h"
 
 using namespace Json;
 using namespace std;
 
+void printUsageCompileFilters() {
+    cout << "CompileFilters: Compiles text sample filters into a binary filter file that predict maps without parsing." << endl;
+    cout << "Usage: compileFilters -f <filter_file> -o <output_feature_index> -s <samples_index> -c <compiled_filter>" << endl;
+    cout << "    -f filter_file: (required) text sample filter file or directory, as passed to predict -f." << endl;
+    cout << "    -o output_feature_index: (required) the output feature index predict will use." << endl;
+    cout << "    -s samples_index: (required) the samples index predict will use, i.e. the .samplesIndex file predict writes for the same input." << endl;
+    cout << "    -c compiled_filter: (required) the compiled filter file to write, pass it to predict -f instead of the text filters." << endl;
+    cout << endl;
+}
+
 /**
-TODO Add the helper with Test Cases
+Compiles text sample filters once so every predict run using the same feature and sample indices maps them
+instead of parsing them.  predict refuses a compiled filter whose indices do not match its own
 */
 int main(int argc, char** argv) {
+    if (isArgSet(argc, argv, "-h")) {
+        printUsageCompileFilters();
+        exit(1);
+    }
+
+    string filterFileName = getRequiredArgValue(argc, argv, "-f", "filter file is not specified.", &printUsageCompileFilters);
+    if (! fileExists(filterFileName)) {
+        cout << "Error: Cannot read filter file: " << filterFileName << endl;
+        return 1;
+    }
+    string outputIndexFileName = getRequiredArgValue(argc, argv, "-o", "output features index file is not specified.", &printUsageCompileFilters);
+    string samplesIndexFileName = getRequiredArgValue(argc, argv, "-s", "samples index file is not specified.", &printUsageCompileFilters);
+    string compiledFileName = getRequiredArgValue(argc, argv, "-c", "compiled filter file is not specified.", &printUsageCompileFilters);
+    if (SamplesFilter::isCompiledFilter(filterFileName)) {
+        cout << "Error: " << filterFileName << " is already compiled" << endl;
+        return 1;
+    }
+
+    timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    unordered_map<string, unsigned int> mOutput;
+    unordered_map<string, unsigned int> mSamples;
+    cout << "Loading output feature index from: " << outputIndexFileName << endl;
+    if (!loadIndexFromFile(mOutput, outputIndexFileName, cout)) {
+        return 1;
+    }
+    cout << "Loading samples index from: " << samplesIndexFileName << endl;
+    if (!loadIndexFromFile(mSamples, samplesIndexFileName, cout)) {
+        return 1;
+    }
+
+    SamplesFilter samplesFilter;
+    samplesFilter.loadFilter(mOutput, mSamples, filterFileName);
+    samplesFilter.saveFilter(mOutput, mSamples, compiledFileName);
+    gettimeofday(&t1, NULL);
+    cout << "Compiled " << filterFileName << " in " << elapsed_time(t1, t0) << " seconds" << endl;
+    return 0;
 }
@@ -10,7 +10,16 @@
    or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
  */
 #include <json/json.h>
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+#include <set>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -19,8 +28,6 @@
 #include <stdexcept>
 
 #include "Filters.h"
-#include "GpuTypes.h"
-#include "NNTypes.h"
 
 using namespace Json;
 using namespace std;
@@ -33,140 +40,345 @@ AbstractFilter::~AbstractFilter()
         Updates the records in the array with the filters
         x[Index] =  x[Index] * (filterValue for that index)
 */
-void AbstractFilter::updateRecords(float *xArray,unordered_map<int,float> *xFilter)
+void AbstractFilter::updateRecords(float *xArray, const unsigned int *xItem, const float *xValue, uint64_t xCount)
 {
-
-    if(xFilter != NULL && xFilter->size() >0 )
+    for (uint64_t i = 0; i < xCount; ++i)
     {
-        unordered_map<int,float>::iterator filterIter;
-        for (filterIter = xFilter->begin(); filterIter != xFilter->end(); ++filterIter)
-        {
-            int index =  filterIter->first ;
-            float value = filterIter->second;
-            xArray[ index  ] = value *  xArray[ index ];
-        }
+        xArray[ xItem[i] ] = xValue[i] * xArray[ xItem[i] ];
     }
 }
 
-void AbstractFilter::updateRecords(float *xArray,unordered_map<int,float> *xFilter, int offSet, int width)
+void AbstractFilter::updateRecords(float *xArray, const unsigned int *xItem, const float *xValue, uint64_t xCount, int offSet, int width)
 {
     /* Filter 
        @param xArray values to be filtered
+       @param xItem sorted global indices of the filter, xValue their values
        @param offSet the starting global index of current xArray
        @param width the length of xArray
     
     */
-    
 
-    if(xFilter != NULL && xFilter->size() >0 )
+    // xArray global index [offset, offSet + width), items outside of it belong to another GPU.
+    // Items are sorted so only the ones in range are visited
+    // currently value is always zero in binary inputs
+    const unsigned int *pBegin = lower_bound(xItem, xItem + xCount, (unsigned int)offSet);
+    const unsigned int *pEnd = lower_bound(pBegin, xItem + xCount, (unsigned int)(offSet + width));
+    for (const unsigned int *pItem = pBegin; pItem != pEnd; ++pItem)
     {
-        unordered_map<int,float>::iterator filterIter;
-        for (filterIter = xFilter->begin(); filterIter != xFilter->end(); ++filterIter)
-        {
-            int index =  filterIter->first ;
-            float value = filterIter->second;
-            // xArray global index [offset, offSet + width)
-            // if index is falling outside of range, not changing xArray value
-            // currently value is always zero in binary inputs
-            if (index >=offSet && index < offSet + width) { 
-                xArray[ index-offSet  ] = value *  xArray[ index-offSet ];
-            }
+        xArray[ *pItem - offSet ] = xValue[pItem - xItem] * xArray[ *pItem - offSet ];
+    }
+}
+
+
+void AbstractFilter::updateCandidateRecords(float *xArray, const unsigned int *xItem, const float *xValue, uint64_t xCount, const unsigned int *xCandidate, int count)
+{
+    /* Filter
+       @param xArray scores of the candidates
+       @param xItem sorted global indices of the filter, xValue their values
+       @param xCandidate global index of each candidate
+       @param count the length of xArray
+    */
+    if (xCount == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const unsigned int *pItem = lower_bound(xItem, xItem + xCount, xCandidate[i]);
+        if (pItem != xItem + xCount && *pItem == xCandidate[i]) {
+            xArray[ i ] = xValue[pItem - xItem] * xArray[ i ];
         }
     }
 }
 
 
+// Text filter files are split into chunks of at least this many bytes by default, parsed in parallel
+static const uint64_t FILTER_CHUNK_BYTES = 16 * 1024 * 1024;
 
-int gSamplesLoggingInterval = 10000;
+// Compiled filter files start with this header, followed by sampleStart[samples], sampleEnd[samples],
+// filterItems[entries] and filterValues[entries].  The fingerprints tie the file to the feature and
+// sample indices it was compiled with
+static const char COMPILED_FILTER_MAGIC[8] = {'D', 'S', 'S', 'T', 'N', 'E', 'S', 'F'};
+static const uint64_t COMPILED_FILTER_VERSION = 1;
 
-void SamplesFilter::loadSingleFilter(unordered_map<string, unsigned int> &xMInput,
-                                     unordered_map<string, unsigned int> &xMSamples,
-                                     vector<unordered_map<int,float>*> &sampleFilters,
-                                     const string &filePath) {
-    ifstream samplesFile(filePath);
-    timeval ts;
-    gettimeofday(&ts, NULL);
-    unordered_map<int,float>* customerSampleFilter =  NULL;
-    int samplesFilterCount = 0;
-    vector<string> filters;
-    if(samplesFile.good())
+struct CompiledFilterHeader
+{
+    char magic[8];
+    uint64_t version;
+    uint64_t samples;
+    uint64_t features;
+    uint64_t sampleFingerprint;
+    uint64_t featureFingerprint;
+    uint64_t entries;
+};
+
+/**
+Order independent 64 bit fingerprint of an index, FNV-1a of every label mixed with its index and summed
+*/
+uint64_t indexFingerprint(unordered_map<string, unsigned int> &xMIndex)
+{
+    uint64_t fingerprint = xMIndex.size();
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:fingerprint)
+    for (int64_t b = 0; b < (int64_t)xMIndex.bucket_count(); ++b)
     {
-        string line;
-        int sample = -1;
-        while(getline(samplesFile,line))
+        for (auto it = xMIndex.begin(b); it != xMIndex.end(b); ++it)
         {
-            filters = split(line, ':');
-            if(filters.size() > 0)
+            uint64_t hash = 14695981039346656037ULL;
+            for (size_t i = 0; i < it->first.size(); ++i)
             {
-                vector<string> vals =  split(filters[0],'\t');
-                if(vals.size() >0)
-                {
-                    try
-                    {
-                        sample = xMSamples.at(vals[0]);
-                        if(vals.size() > 1)
-                        {
-                            filters[0] = vals[1];
-                        }
-                    }
-                    catch (const std::out_of_range& oor)
-                    {
-                        continue;
-                    }
-                }
-            } //filters[i] is the ith Feature for that customer
+                hash = (hash ^ (unsigned char)it->first[i]) * 1099511628211ULL;
+            }
+            hash ^= (uint64_t)it->second * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 31;
+            hash *= 0xbf58476d1ce4e5b9ULL;
+            hash ^= hash >> 29;
+            fingerprint += hash;
+        }
+    }
+    return fingerprint;
+}
 
-            customerSampleFilter = new unordered_map<int,float>();
-            for(int  i =0; i < filters.size(); ++i)
+/**
+Filters parsed from one chunk of a text filter file, in file order: the filter of samples[i] is
+items/values [start[i], start[i + 1])
+*/
+struct FilterChunk
+{
+    vector<unsigned int> samples;
+    vector<uint64_t> start;
+    vector<unsigned int> items;
+    vector<float> values;
+};
+
+/**
+Parses one line $CUS    $FEATURE,$VALUE:$FEATURE,$VALUE into sampleFilter, sorted by item with repeated
+items keeping their last value.  Returns the sample index or -1 if the sample is unknown
+*/
+static int parseFilterLine(const string &line,
+                           unordered_map<string, unsigned int> &xMInput,
+                           unordered_map<string, unsigned int> &xMSamples,
+                           string &key,
+                           vector<pair<unsigned int, float> > &sampleFilter)
+{
+    // The sample is the first field up to a tab, the first item follows the tab.  Without a tab the
+    // first field is looked up both as the sample and as an item
+    size_t first = line.find(':');
+    size_t fieldEnd = (first == string::npos) ? line.size() : first;
+    size_t tab = line.find('\t');
+    if (line.empty() || (tab != string::npos && tab > fieldEnd))
+    {
+        tab = string::npos;
+    }
+    key.assign(line, 0, (tab == string::npos) ? fieldEnd : tab);
+    unordered_map<string, unsigned int>::iterator sample = xMSamples.find(key);
+    if (line.empty() || sample == xMSamples.end())
+    {
+        return -1;
+    }
+
+    sampleFilter.clear();
+    size_t pos = (tab == string::npos) ? 0 : tab + 1;
+    size_t end = (tab == string::npos) ? fieldEnd : min(fieldEnd, line.find('\t', pos));
+    while (pos <= line.size())
+    {
+        // Item is [pos, end), $FEATURE or $FEATURE,$VALUE
+        size_t comma = line.find(',', pos);
+        size_t keyEnd = (comma < end) ? comma : end;
+        key.assign(line, pos, keyEnd - pos);
+        unordered_map<string, unsigned int>::iterator item = xMInput.find(key);
+        if (item != xMInput.end())
+        {
+            float value = 0.0f;
+            if (comma < end)
             {
-                vector<string>  vals =  split(filters[i],',');
-                if(vals.size() > 0)
+                value = atof(line.c_str() + comma + 1);
+                // This is hack for reading just the recs
+                // Because the current one has date
+                if (value > 10.0)
                 {
-                    try
-                    {
-                        int key = xMInput.at(vals[0]);
-                        float value =  0.0f;
-                        if(vals.size() >1)
-                        {
-                            value =  atof(vals[1].c_str());
-                            // This is hack for reading just the recs
-                            // Because the current one has date
-                            if( value > 10.0 )
-                            {
-                                value = 0.0f;
-                            }
-                        }
-                        (*customerSampleFilter)[key] = value;
-                    }
-                    catch (const std::out_of_range& oor)
-                    {
-                        continue;
-                    }
+                    value = 0.0f;
                 }
             }
-            if(sample != -1)
-            {
-                sampleFilters[sample] = customerSampleFilter;
-                ++samplesFilterCount;
-                if(samplesFilterCount % gSamplesLoggingInterval ==0)
-                {
-                    timeval t2;
-                    gettimeofday(&t2, NULL);
-                    cout <<"Progress Parsing Filter "<< samplesFilterCount;
-                    cout <<"Time " <<  elapsed_time(t2, ts)<<endl;
-                    gettimeofday(&ts, NULL);
+            sampleFilter.push_back(make_pair(item->second, value));
+        }
 
-                }
+        if (fieldEnd >= line.size())
+        {
+            break;
+        }
+        pos = fieldEnd + 1;
+        fieldEnd = line.find(':', pos);
+        if (fieldEnd == string::npos)
+        {
+            fieldEnd = line.size();
+        }
+        end = fieldEnd;
+    }
+
+    stable_sort(sampleFilter.begin(), sampleFilter.end(),
+                [](const pair<unsigned int, float> &a, const pair<unsigned int, float> &b) { return a.first < b.first; });
+    return sample->second;
+}
+
+/**
+Parses the lines starting in [begin, end) of a text filter file into xChunk
+*/
+static void parseFilterChunk(const string &filePath, uint64_t begin, uint64_t end,
+                             unordered_map<string, unsigned int> &xMInput,
+                             unordered_map<string, unsigned int> &xMSamples,
+                             FilterChunk &xChunk)
+{
+    ifstream samplesFile(filePath);
+    string line;
+    uint64_t pos = begin;
+    if (begin > 0)
+    {
+        // Skip the line that started in the previous chunk
+        samplesFile.seekg(begin - 1);
+        getline(samplesFile, line);
+        pos = begin - 1 + line.size() + 1;
+    }
+
+    string key;
+    vector<pair<unsigned int, float> > sampleFilter;
+    while (pos < end && getline(samplesFile, line))
+    {
+        pos += line.size() + 1;
+        int sample = parseFilterLine(line, xMInput, xMSamples, key, sampleFilter);
+        if (sample == -1)
+        {
+            continue;
+        }
+        xChunk.samples.push_back(sample);
+        xChunk.start.push_back(xChunk.items.size());
+        for (size_t i = 0; i < sampleFilter.size(); ++i)
+        {
+            if (i + 1 < sampleFilter.size() && sampleFilter[i + 1].first == sampleFilter[i].first)
+            {
+                continue;
             }
+            xChunk.items.push_back(sampleFilter[i].first);
+            xChunk.values.push_back(sampleFilter[i].second);
         }
     }
-    else
+    xChunk.start.push_back(xChunk.items.size());
+}
+
+SamplesFilter::SamplesFilter() : pSampleStart(NULL), pSampleEnd(NULL), pFilterItems(NULL), pFilterValues(NULL), pMapped(NULL), mappedBytes(0),
+                                 chunkBytes(FILTER_CHUNK_BYTES)
+{
+}
+
+SamplesFilter::~SamplesFilter()
+{
+    if (pMapped != NULL)
+    {
+        munmap(pMapped, mappedBytes);
+    }
+}
+
+void SamplesFilter::loadSingleFilter(unordered_map<string, unsigned int> &xMInput,
+                                     unordered_map<string, unsigned int> &xMSamples,
+                                     const string &filePath) {
+    timeval ts;
+    gettimeofday(&ts, NULL);
+    ifstream samplesFile(filePath, ios::binary | ios::ate);
+    if(!samplesFile.good())
     {
         cout << "Unable to read the file "<< filePath<<endl;
         throw std::invalid_argument("invalid sample filters " + filePath + ", exiting...");
+    }
+    uint64_t fileSize = samplesFile.tellg();
+    samplesFile.close();
+
+    // Chunks are parsed in parallel and merged in file order, so a repeated sample still takes its last filter.
+    // The earlier filter is left unreferenced in the arrays
+    uint64_t chunks = min<uint64_t>(max<uint64_t>(1, fileSize / chunkBytes), 4 * omp_get_max_threads());
+    vector<FilterChunk> vChunk(chunks);
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t c = 0; c < (int64_t)chunks; ++c)
+    {
+        parseFilterChunk(filePath, (fileSize * c) / chunks, (fileSize * (c + 1)) / chunks, xMInput, xMSamples, vChunk[c]);
+    }
 
+    uint64_t samplesFilterCount = 0;
+    for (uint64_t c = 0; c < chunks; ++c)
+    {
+        FilterChunk &chunk = vChunk[c];
+        uint64_t base = filterItems.size();
+        filterItems.insert(filterItems.end(), chunk.items.begin(), chunk.items.end());
+        filterValues.insert(filterValues.end(), chunk.values.begin(), chunk.values.end());
+        for (size_t i = 0; i < chunk.samples.size(); ++i)
+        {
+            sampleStart[chunk.samples[i]] = base + chunk.start[i];
+            sampleEnd[chunk.samples[i]] = base + chunk.start[i + 1];
+        }
+        samplesFilterCount += chunk.samples.size();
+        chunk = FilterChunk();
     }
 
+    timeval t2;
+    gettimeofday(&t2, NULL);
+    cout << "Parsed " << samplesFilterCount << " sample filters in " << chunks << " chunks, Time " << elapsed_time(t2, ts) << endl;
+}
+
+void SamplesFilter::loadCompiledFilter(unordered_map<string, unsigned int> &xMInput,
+                                       unordered_map<string, unsigned int> &xMSamples,
+                                       const string &filePath)
+{
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::invalid_argument("unable to open compiled sample filters " + filePath);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::invalid_argument("unable to open compiled sample filters " + filePath);
+    }
+    if ((uint64_t)st.st_size < sizeof(CompiledFilterHeader))
+    {
+        close(fd);
+        throw std::invalid_argument("corrupt compiled sample filters " + filePath);
+    }
+    mappedBytes = st.st_size;
+    pMapped = mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMapped == MAP_FAILED)
+    {
+        pMapped = NULL;
+        throw std::invalid_argument("unable to map compiled sample filters " + filePath);
+    }
+
+    // Counts are bounded by the file size before computing its expected size, which could overflow otherwise
+    const CompiledFilterHeader *pHeader = (const CompiledFilterHeader *)pMapped;
+    uint64_t samples = pHeader->samples;
+    uint64_t entries = pHeader->entries;
+    if (pHeader->version != COMPILED_FILTER_VERSION ||
+        samples > mappedBytes / (2 * sizeof(uint64_t)) || entries > mappedBytes / (sizeof(unsigned int) + sizeof(float)) ||
+        mappedBytes != sizeof(CompiledFilterHeader) + 2 * samples * sizeof(uint64_t) + entries * (sizeof(unsigned int) + sizeof(float)))
+    {
+        throw std::invalid_argument("corrupt compiled sample filters " + filePath);
+    }
+    if (samples != xMSamples.size() || pHeader->features != xMInput.size() ||
+        pHeader->sampleFingerprint != indexFingerprint(xMSamples) || pHeader->featureFingerprint != indexFingerprint(xMInput))
+    {
+        throw std::invalid_argument("compiled sample filters " + filePath + " were compiled with different feature or sample indices");
+    }
+
+    pSampleStart = (const uint64_t *)(pHeader + 1);
+    pSampleEnd = pSampleStart + samples;
+    pFilterItems = (const unsigned int *)(pSampleEnd + samples);
+    pFilterValues = (const float *)(pFilterItems + entries);
+    cout << "Info:SamplesFilter mapped " << samples << " samples, " << entries << " entries from " << filePath << endl;
+}
+
+bool SamplesFilter::isCompiledFilter(const string &filePath)
+{
+    char magic[sizeof(COMPILED_FILTER_MAGIC)];
+    ifstream file(filePath, ios::binary);
+    return isFile(filePath) && file.read(magic, sizeof(magic)) && memcmp(magic, COMPILED_FILTER_MAGIC, sizeof(magic)) == 0;
 }
 
 void SamplesFilter::loadFilter(unordered_map<string, unsigned int>& xMInput,
@@ -178,20 +390,22 @@ void SamplesFilter::loadFilter(unordered_map<string, unsigned int>& xMInput,
      @param xMSamples: $CUST, $GLOBAL_INDEX_FOR_CUST
      @param filterFilePath: name of sample filter file. Samples filter should be as below:
                             $CUS    $FEATURE,$VALUE:$FEATURE,$VALUE
+                            or a filter compiled by compileFilters, which is mapped as is
      
      
 
      TODO There is a hack currently where when the value is >10.0 i am assuming to zero
      The reason is currently watch Filters have watch dates as the first Suffix
-    
- 
-     TODO:larger number of inserts time will be wasted for resizing the vector
-     and the size is the maximum of the Samples. Might not be a good  use case when we have sparse
-     Filter
     */
+    if (isCompiledFilter(filterFilePath)) {
+        loadCompiledFilter(xMInput, xMSamples, filterFilePath);
+        return;
+    }
 
-
-    samplefilters = new vector<unordered_map<int,float>*>(xMSamples.size()) ;
+    sampleStart.assign(xMSamples.size(), 0);
+    sampleEnd.assign(xMSamples.size(), 0);
+    filterItems.clear();
+    filterValues.clear();
 
     vector<string> files;
     if (listFiles(filterFilePath, false, files) == 0) {
@@ -199,58 +413,397 @@ void SamplesFilter::loadFilter(unordered_map<string, unsigned int>& xMInput,
 
         for (auto const &file: files) {
             cout << "\tLoading filter: " << file << endl;
-            loadSingleFilter(xMInput, xMSamples, *samplefilters, file);
+            loadSingleFilter(xMInput, xMSamples, file);
         }
     }
+    filterItems.shrink_to_fit();
+    filterValues.shrink_to_fit();
+    pSampleStart = sampleStart.data();
+    pSampleEnd = sampleEnd.data();
+    pFilterItems = filterItems.data();
+    pFilterValues = filterValues.data();
+
+    size_t bytes = (sampleStart.size() + sampleEnd.size()) * sizeof(uint64_t) + filterItems.size() * sizeof(unsigned int) + filterValues.size() * sizeof(float);
+    cout << "Info:SamplesFilter " << sampleStart.size() << " samples, " << filterItems.size() << " entries, " << bytes / (1024.0 * 1024.0) << " MB" << endl;
+}
 
-    cout << "Info:SamplesFilter " << samplefilters->size() <<endl;
+uint64_t SamplesFilter::loadFilterLines(unordered_map<string, unsigned int> &xMInput,
+                                        unordered_map<string, unsigned int> &xMSamples,
+                                        unordered_map<string, unsigned int> &xMNextSamples,
+                                        istream &xFilterStream)
+{
+    sampleStart.assign(xMSamples.size(), 0);
+    sampleEnd.assign(xMSamples.size(), 0);
+    filterItems.clear();
+    filterValues.clear();
+
+    // Sample numbers follow the input order, so lines of the chunk must come with non decreasing numbers.
+    // Lines of other samples are skipped until a later line settles them: before a line of the chunk or of the
+    // next chunk they can only be for samples missing from the input
+    int lastSample = (int)xMSamples.size() - 1;
+    int last = -1;
+    uint64_t dropped = 0;
+    uint64_t skipped = 0;
+    streamoff resume = xFilterStream.tellg();
+    string key;
+    vector<pair<unsigned int, float> > sampleFilter;
+    string line;
+    while (true)
+    {
+        streamoff pos = xFilterStream.tellg();
+        if (!getline(xFilterStream, line))
+        {
+            // The skipped lines after the chunk's last filter may be for samples past the next chunk and are
+            // read again by the next call, unless there is no next chunk
+            if (xMNextSamples.empty())
+            {
+                dropped += skipped;
+                resume = pos;
+            }
+            break;
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        int sample = parseFilterLine(line, xMInput, xMSamples, key, sampleFilter);
+        if (sample == -1)
+        {
+            if (last == lastSample || xMNextSamples.find(key) != xMNextSamples.end())
+            {
+                // The line belongs to a later chunk
+                dropped += skipped;
+                resume = pos;
+                break;
+            }
+            skipped++;
+            continue;
+        }
+        if (sample < last)
+        {
+            throw std::runtime_error("samples filter lines do not follow the order of the input samples");
+        }
+
+        dropped += skipped;
+        skipped = 0;
+        last = sample;
+        resume = pos + (streamoff)line.size() + 1;
+        sampleStart[sample] = filterItems.size();
+        for (size_t i = 0; i < sampleFilter.size(); ++i)
+        {
+            if (i + 1 < sampleFilter.size() && sampleFilter[i + 1].first == sampleFilter[i].first)
+            {
+                continue;
+            }
+            filterItems.push_back(sampleFilter[i].first);
+            filterValues.push_back(sampleFilter[i].second);
+        }
+        sampleEnd[sample] = filterItems.size();
+    }
+    xFilterStream.clear();
+    xFilterStream.seekg(resume);
+    pSampleStart = sampleStart.data();
+    pSampleEnd = sampleEnd.data();
+    pFilterItems = filterItems.data();
+    pFilterValues = filterValues.data();
+    return dropped;
+}
+
+void SamplesFilter::saveFilter(unordered_map<string, unsigned int> &xMInput,
+                               unordered_map<string, unsigned int> &xMSamples,
+                               const string &filePath)
+{
+    // Ranges are written back to back, dropping the entries of replaced filters
+    uint64_t samples = xMSamples.size();
+    vector<uint64_t> vStart(samples);
+    vector<uint64_t> vEnd(samples);
+    uint64_t entries = 0;
+    for (uint64_t s = 0; s < samples; ++s)
+    {
+        vStart[s] = entries;
+        entries += pSampleEnd[s] - pSampleStart[s];
+        vEnd[s] = entries;
+    }
+
+    CompiledFilterHeader header;
+    memcpy(header.magic, COMPILED_FILTER_MAGIC, sizeof(header.magic));
+    header.version = COMPILED_FILTER_VERSION;
+    header.samples = samples;
+    header.features = xMInput.size();
+    header.sampleFingerprint = indexFingerprint(xMSamples);
+    header.featureFingerprint = indexFingerprint(xMInput);
+    header.entries = entries;
+
+    ofstream file(filePath, ios::binary | ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)vStart.data(), samples * sizeof(uint64_t));
+    file.write((const char *)vEnd.data(), samples * sizeof(uint64_t));
+    for (uint64_t s = 0; s < samples; ++s)
+    {
+        file.write((const char *)(pFilterItems + pSampleStart[s]), (pSampleEnd[s] - pSampleStart[s]) * sizeof(unsigned int));
+    }
+    for (uint64_t s = 0; s < samples; ++s)
+    {
+        file.write((const char *)(pFilterValues + pSampleStart[s]), (pSampleEnd[s] - pSampleStart[s]) * sizeof(float));
+    }
+    if (!file.good())
+    {
+        throw std::runtime_error("unable to write compiled sample filters " + filePath);
+    }
+    cout << "Info:SamplesFilter wrote " << samples << " samples, " << entries << " entries to " << filePath << endl;
 }
 
 void SamplesFilter::applyFilter(float *xArray,int xSamplesIndex, int offSet, int width)
 {
-    unordered_map<int,float> *filter= (*samplefilters)[xSamplesIndex];
-    updateRecords(xArray,filter, offSet, width);
+    uint64_t start = pSampleStart[xSamplesIndex];
+    updateRecords(xArray, pFilterItems + start, pFilterValues + start, pSampleEnd[xSamplesIndex] - start, offSet, width);
+}
+
+void SamplesFilter::applyCandidateFilter(float *xArray,int xSamplesIndex, const unsigned int *xCandidate, int count)
+{
+    uint64_t start = pSampleStart[xSamplesIndex];
+    updateCandidateRecords(xArray, pFilterItems + start, pFilterValues + start, pSampleEnd[xSamplesIndex] - start, xCandidate, count);
+}
+
+void SamplesFilter::appendFilter(int xSamplesIndex, int offSet, int width, vector<unsigned int> &xItems, vector<float> &xValues)
+{
+    const unsigned int *pItem = pFilterItems + pSampleStart[xSamplesIndex];
+    const unsigned int *pLast = pFilterItems + pSampleEnd[xSamplesIndex];
+    const unsigned int *pBegin = lower_bound(pItem, pLast, (unsigned int)offSet);
+    const unsigned int *pEnd = lower_bound(pBegin, pLast, (unsigned int)(offSet + width));
+    for (const unsigned int *p = pBegin; p != pEnd; ++p)
+    {
+        xItems.push_back(*p - offSet);
+        xValues.push_back(pFilterValues[p - pFilterItems]);
+    }
 }
 
 void SamplesFilter::applyFilter(float *xArray,int xSamplesIndex)
 {
-    unordered_map<int,float> *filter= (*samplefilters)[xSamplesIndex];
-    updateRecords(xArray,filter);
+    uint64_t start = pSampleStart[xSamplesIndex];
+    updateRecords(xArray, pFilterItems + start, pFilterValues + start, pSampleEnd[xSamplesIndex] - start);
 }
 
-SamplesFilter::~SamplesFilter()
+/**
+Parses node filter items $FEATURE,$VALUE:$FEATURE,$VALUE into (global index, value) pairs.
+A feature without a value is excluded (value 0), unknown features are skipped
+*/
+static void parseNodeItems(const string &xItems, unordered_map<string, unsigned int> &xMInput, vector<pair<unsigned int, float> > &xParsed)
 {
-    vector<unordered_map<int,float>*>::iterator samplesiter;
-    for(samplesiter = samplefilters -> begin() ; samplesiter!= samplefilters->end(); ++samplesiter)
+    vector<string> items = split(xItems, ':');
+    for (size_t i = 0; i < items.size(); ++i)
     {
-        delete(*samplesiter);
+        vector<string> vals = split(items[i], ',');
+        if (vals.size() == 0)
+        {
+            continue;
+        }
+        unordered_map<string, unsigned int>::iterator it = xMInput.find(vals[0]);
+        if (it == xMInput.end())
+        {
+            continue;
+        }
+        float value = (vals.size() > 1) ? atof(vals[1].c_str()) : 0.0f;
+        xParsed.push_back(make_pair(it->second, value));
     }
-    delete(samplefilters);
+}
 
+void NodeFilter::initialize(unordered_map<string, unsigned int> &xMInput, unordered_map<string, unsigned int> &xMSamples)
+{
+    if (features == 0)
+    {
+        features = xMInput.size();
+        masks.assign(features, 1.0f);
+        sampleSegment.assign(xMSamples.size(), 0);
+    }
+}
 
+void NodeFilter::loadFilter(unordered_map<string, unsigned int> &xMInput,
+                            unordered_map<string, unsigned int> &xMSamples,
+                            string filePath)
+{
+    /**
+     @param filePath: name of node filter file (or directory of them), one or more features per line as
+                      $FEATURE,$VALUE:$FEATURE,$VALUE.  Values multiply the feature's score for every sample
+    */
+    initialize(xMInput, xMSamples);
+    vector<string> files;
+    if (listFiles(filePath, false, files) != 0)
+    {
+        throw std::invalid_argument("invalid node filters " + filePath + ", exiting...");
+    }
+    vector<pair<unsigned int, float> > items;
+    for (auto const &file: files)
+    {
+        ifstream nodeFile(file);
+        string line;
+        while (getline(nodeFile, line))
+        {
+            parseNodeItems(line, xMInput, items);
+        }
+    }
+
+    // The global filter applies to every segment
+    unsigned int segments = getSegments();
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        for (unsigned int s = 0; s < segments; ++s)
+        {
+            masks[(size_t)s * features + items[i].first] *= items[i].second;
+        }
+    }
+    cout << "Info:NodeFilter " << items.size() << " entries from " << files.size() << " files" << endl;
 }
 
-/**
-Sample Filters.json
+void NodeFilter::loadSegmentFilters(unordered_map<string, unsigned int> &xMInput,
+                                    unordered_map<string, unsigned int> &xMSamples,
+                                    const string &segmentFilterPath,
+                                    const string &sampleSegmentPath)
 {
-        "filters": [
-                {"sampleFilters": "watches","nodeFilters": "primeFilters","outputFile":"primerecs" }
-        ]
+    /**
+     @param segmentFilterPath: segment filter file (or directory), $SEGMENT    $FEATURE,$VALUE:$FEATURE,$VALUE
+     @param sampleSegmentPath: segment of each sample (or directory), $CUST    $SEGMENT
+                               samples not listed only get the global filter
+    */
+    initialize(xMInput, xMSamples);
+    vector<string> files;
+    if (listFiles(segmentFilterPath, false, files) != 0)
+    {
+        throw std::invalid_argument("invalid segment filters " + segmentFilterPath + ", exiting...");
+    }
+    vector<pair<unsigned int, float> > items;
+    for (auto const &file: files)
+    {
+        ifstream segmentFile(file);
+        string line;
+        while (getline(segmentFile, line))
+        {
+            vector<string> vals = split(line, '\t');
+            if (vals.size() < 2)
+            {
+                continue;
+            }
+
+            // A new segment starts from the global filter
+            unordered_map<string, unsigned int>::iterator it = segmentIndex.find(vals[0]);
+            unsigned int segment;
+            if (it == segmentIndex.end())
+            {
+                segment = getSegments();
+                segmentIndex[vals[0]] = segment;
+                masks.resize(masks.size() + features);
+                copy(masks.begin(), masks.begin() + features, masks.begin() + (size_t)segment * features);
+            }
+            else
+            {
+                segment = it->second;
+            }
+            items.clear();
+            parseNodeItems(vals[1], xMInput, items);
+            float *pMask = masks.data() + (size_t)segment * features;
+            for (size_t i = 0; i < items.size(); ++i)
+            {
+                pMask[items[i].first] *= items[i].second;
+            }
+        }
+    }
+
+    files.clear();
+    if (listFiles(sampleSegmentPath, false, files) != 0)
+    {
+        throw std::invalid_argument("invalid sample segments " + sampleSegmentPath + ", exiting...");
+    }
+    uint64_t assigned = 0;
+    for (auto const &file: files)
+    {
+        ifstream sampleFile(file);
+        string line;
+        while (getline(sampleFile, line))
+        {
+            vector<string> vals = split(line, '\t');
+            if (vals.size() < 2)
+            {
+                continue;
+            }
+            unordered_map<string, unsigned int>::iterator sample = xMSamples.find(vals[0]);
+            unordered_map<string, unsigned int>::iterator segment = segmentIndex.find(vals[1]);
+            if (sample != xMSamples.end() && segment != segmentIndex.end())
+            {
+                sampleSegment[sample->second] = segment->second;
+                ++assigned;
+            }
+        }
+    }
+    cout << "Info:NodeFilter " << segmentIndex.size() << " segments, " << assigned << " samples assigned, "
+         << masks.size() * sizeof(float) / (1024.0 * 1024.0) << " MB" << endl;
+}
+
+void NodeFilter::applyFilter(float *xArray, int xSamplesIndex)
+{
+    const float *pMask = getMask(sampleSegment[xSamplesIndex]);
+    for (unsigned int i = 0; i < features; ++i)
+    {
+        xArray[i] *= pMask[i];
+    }
+}
+
+void NodeFilter::applyFilter(float *xArray, int xSamplesIndex, int offSet, int width)
+{
+    // xArray covers global indices [offSet, offSet + width), which may run past the features on the last GPU
+    const float *pMask = getMask(sampleSegment[xSamplesIndex]);
+    for (int i = 0; i < width && offSet + i < (int)features; ++i)
+    {
+        xArray[i] *= pMask[offSet + i];
+    }
 }
-Takes a filters.json and parses the file and created the Filters
+
+void NodeFilter::applyCandidateFilter(float *xArray, int xSamplesIndex, const unsigned int *xCandidate, int count)
+{
+    const float *pMask = getMask(sampleSegment[xSamplesIndex]);
+    for (int i = 0; i < count; ++i)
+    {
+        if (xCandidate[i] < features)
+        {
+            xArray[i] *= pMask[xCandidate[i]];
+        }
+    }
+}
+
+/**
+Loads one entry of a filters.json, see loadFilterConfigs
 */
 FilterConfig* loadFilters(string samplesFilterFileName,string outputFileName,
                                   unordered_map<string, unsigned int>& xMInput,
-                                  unordered_map<string, unsigned int>& xMSamples)
+                                  unordered_map<string, unsigned int>& xMSamples,
+                                  string nodeFilterFileName,
+                                  string segmentFilterFileName,
+                                  string sampleSegmentFileName)
 {
    
     
     Value index;
     Reader reader;
     FilterConfig *filterConfig  = new FilterConfig();
-    SamplesFilter *samplesFilter = new SamplesFilter() ;
-    samplesFilter->loadFilter(xMInput,xMSamples,samplesFilterFileName);
-    filterConfig->setSamplesFilter(samplesFilter);
+    // Streaming predict has no sample filter up front, it sets one per chunk of samples
+    if (samplesFilterFileName != "")
+    {
+        SamplesFilter *samplesFilter = new SamplesFilter() ;
+        samplesFilter->loadFilter(xMInput,xMSamples,samplesFilterFileName);
+        filterConfig->setSamplesFilter(samplesFilter);
+    }
+    if (nodeFilterFileName != "" || segmentFilterFileName != "")
+    {
+        NodeFilter *nodeFilter = new NodeFilter();
+        if (nodeFilterFileName != "")
+        {
+            nodeFilter->loadFilter(xMInput, xMSamples, nodeFilterFileName);
+        }
+        if (segmentFilterFileName != "")
+        {
+            nodeFilter->loadSegmentFilters(xMInput, xMSamples, segmentFilterFileName, sampleSegmentFileName);
+        }
+        filterConfig->setNodeFilter(nodeFilter);
+    }
     filterConfig->setOutputFileName(outputFileName);
     //Cleaning up the existing file rather than appending the file
     FILE *fp =  fopen(outputFileName.c_str(),"w");
@@ -258,3 +811,83 @@ FilterConfig* loadFilters(string samplesFilterFileName,string outputFileName,
     return filterConfig;
 }
 
+bool isFilterConfigFile(const string &filePath)
+{
+    if (!isFile(filePath))
+    {
+        return false;
+    }
+    ifstream file(filePath);
+    char c;
+    while (file.get(c))
+    {
+        if (!isspace((unsigned char)c))
+        {
+            return c == '{';
+        }
+    }
+    return false;
+}
+
+/**
+Sample Filters.json
+{
+        "filters": [
+                {"sampleFilters": "watches","nodeFilters": "primeFilters","outputFile":"primerecs" }
+        ]
+}
+sampleFilters and nodeFilters are optional, an entry without nodeFilters gets nodeFilterFileName.  outputFile
+defaults to outputFileName, and no two entries may write the same file.  Segment filters apply to every entry
+*/
+vector<FilterConfig*> loadFilterConfigs(string filtersFileName,
+                                        string outputFileName,
+                                        unordered_map<string, unsigned int> &xMInput,
+                                        unordered_map<string, unsigned int> &xMSamples,
+                                        string nodeFilterFileName,
+                                        string segmentFilterFileName,
+                                        string sampleSegmentFileName)
+{
+    vector<FilterConfig*> vFilterConfig;
+    if (!isFilterConfigFile(filtersFileName))
+    {
+        vFilterConfig.push_back(loadFilters(filtersFileName, outputFileName, xMInput, xMSamples,
+                                            nodeFilterFileName, segmentFilterFileName, sampleSegmentFileName));
+        return vFilterConfig;
+    }
+
+    Value config;
+    Reader reader;
+    ifstream configFile(filtersFileName);
+    if (!reader.parse(configFile, config) || !config.isObject() || !config["filters"].isArray() || config["filters"].size() == 0)
+    {
+        throw std::invalid_argument("invalid filters config " + filtersFileName + ", expecting a non empty \"filters\" array");
+    }
+
+    // Validate every entry before loading any filter
+    const Value &filters = config["filters"];
+    set<string> outputFiles;
+    for (ArrayIndex i = 0; i < filters.size(); ++i)
+    {
+        const Value &filter = filters[i];
+        if (!filter.isObject())
+        {
+            throw std::invalid_argument("invalid filters config " + filtersFileName + ", every filter must be an object");
+        }
+        string outputFile = filter.get("outputFile", outputFileName).asString();
+        if (!outputFiles.insert(outputFile).second)
+        {
+            throw std::invalid_argument("invalid filters config " + filtersFileName + ", " + outputFile + " is written by more than one filter");
+        }
+    }
+
+    for (ArrayIndex i = 0; i < filters.size(); ++i)
+    {
+        const Value &filter = filters[i];
+        string outputFile = filter.get("outputFile", outputFileName).asString();
+        cout << "Loading filter configuration " << i << " writing to " << outputFile << endl;
+        vFilterConfig.push_back(loadFilters(filter.get("sampleFilters", "").asString(), outputFile, xMInput, xMSamples,
+                                            filter.get("nodeFilters", nodeFilterFileName).asString(),
+                                            segmentFilterFileName, sampleSegmentFileName));
+    }
+    return vFilterConfig;
+}
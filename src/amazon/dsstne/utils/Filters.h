@@ -11,6 +11,7 @@
  */
 #ifndef FILTERS_H
 #include <json/json.h>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <fstream>
@@ -32,54 +33,162 @@ public:
     virtual void applyFilter(float *, int, int, int) = 0;
     virtual string getFilterType() = 0;
 protected:
-    void updateRecords(float *,unordered_map<int,float> *);
-    void updateRecords(float *,unordered_map<int,float> *, int, int);
+    void updateRecords(float *, const unsigned int *, const float *, uint64_t);
+    void updateRecords(float *, const unsigned int *, const float *, uint64_t, int, int);
+    void updateCandidateRecords(float *, const unsigned int *, const float *, uint64_t, const unsigned int *, int);
 
 };
 
 class SamplesFilter : public AbstractFilter
 {
 private:
-    vector<unordered_map<int,float>*> *samplefilters;
+    // Filters of all samples in CSR form: the filter of sample s is pFilterItems/pFilterValues
+    // [pSampleStart[s], pSampleEnd[s]), sorted by item.  Samples without a filter have an empty range.
+    // The arrays are the vectors below for text filters, or point into the mapped file for compiled ones
+    vector<uint64_t> sampleStart;
+    vector<uint64_t> sampleEnd;
+    vector<unsigned int> filterItems;
+    vector<float> filterValues;
+    const uint64_t *pSampleStart;
+    const uint64_t *pSampleEnd;
+    const unsigned int *pFilterItems;
+    const float *pFilterValues;
+    void *pMapped;
+    size_t mappedBytes;
+    uint64_t chunkBytes;
 
     void loadSingleFilter(unordered_map<string, unsigned int> &xMInput,
                           unordered_map<string, unsigned int> &xMSamples,
-                          vector<unordered_map<int,float>*>&sampleFilters,
                           const string &filePath);
+    void loadCompiledFilter(unordered_map<string, unsigned int> &xMInput,
+                            unordered_map<string, unsigned int> &xMSamples,
+                            const string &filePath);
 public:
-    SamplesFilter()
+    SamplesFilter();
+    ~SamplesFilter();
+
+    void loadFilter(unordered_map<string, unsigned int> &xMInput,
+                    unordered_map<string, unsigned int> &xMSamples,
+                    string filePath);
+
+    // Writes the loaded filters as a compiled filter file, which loadFilter maps in constant time
+    // given the same feature and sample indices
+    void saveFilter(unordered_map<string, unsigned int> &xMInput,
+                    unordered_map<string, unsigned int> &xMSamples,
+                    const string &filePath);
+
+    static bool isCompiledFilter(const string &filePath);
+
+    // Text filter files are parsed in parallel, in chunks of at least this many bytes
+    void setChunkBytes(uint64_t xChunkBytes)
+    {
+        chunkBytes = (xChunkBytes > 0) ? xChunkBytes : 1;
+    }
+
+    /**
+    Loads the filters of the samples in xMSamples from the text filter lines of xFilterStream, for input
+    that is read a chunk of samples at a time.  xMSamples numbers the chunk's samples in input order,
+    xMNextSamples holds the samples of the next chunk and is empty for the last one.  Lines must follow the
+    order of the input: reading stops after the chunk's last sample or at the first line of the next chunk,
+    leaving the stream there for the next call, and std::runtime_error is thrown for a line of the chunk
+    that comes after a later sample's.  Lines of samples in neither chunk that precede a line of either are
+    for samples missing from the input, they are dropped and counted in the return value.  Lines of unknown
+    features are skipped, lines are never looked up against earlier chunks
+    */
+    uint64_t loadFilterLines(unordered_map<string, unsigned int> &xMInput,
+                             unordered_map<string, unsigned int> &xMSamples,
+                             unordered_map<string, unsigned int> &xMNextSamples,
+                             istream &xFilterStream);
+
+    void applyFilter(float *,int ) ;
+    void applyFilter(float *,int, int, int);
+    void applyCandidateFilter(float *, int, const unsigned int *, int);
+    void appendFilter(int, int, int, vector<unsigned int> &, vector<float> &);
+
+    string getFilterType()
+    {
+        return "samplesFilterType";
+    }
+};
+
+/**
+Filters shared by all samples, loaded once as a score mask over the output index instead of being
+repeated in every sample's filter: 0 excludes a feature, any other value scales its score.
+Segment filters optionally add one more mask per segment, a sample belongs to at most one segment
+and gets the global mask combined with its segment's
+*/
+class NodeFilter : public AbstractFilter
+{
+private:
+    unsigned int features;
+    // Masks of all segments, segment s is [s * features, (s + 1) * features).  Segment 0 is the
+    // global filter alone, every other segment is the global filter times its own
+    vector<float> masks;
+    unordered_map<string, unsigned int> segmentIndex;
+    vector<unsigned int> sampleSegment;
+
+    void initialize(unordered_map<string, unsigned int> &xMInput, unordered_map<string, unsigned int> &xMSamples);
+public:
+    NodeFilter() : features(0)
     {
-        samplefilters = NULL;
     }
 
     void loadFilter(unordered_map<string, unsigned int> &xMInput,
                     unordered_map<string, unsigned int> &xMSamples,
                     string filePath);
 
+    void loadSegmentFilters(unordered_map<string, unsigned int> &xMInput,
+                            unordered_map<string, unsigned int> &xMSamples,
+                            const string &segmentFilterPath,
+                            const string &sampleSegmentPath);
+
     void applyFilter(float *,int ) ;
     void applyFilter(float *,int, int, int);
+    void applyCandidateFilter(float *, int, const unsigned int *, int);
+
+    unsigned int getFeatures()
+    {
+        return features;
+    }
+
+    unsigned int getSegments()
+    {
+        return features ? masks.size() / features : 0;
+    }
+
+    unsigned int getSegment(int xSampleIndex)
+    {
+        return sampleSegment[xSampleIndex];
+    }
+
+    const float *getMask(unsigned int xSegment)
+    {
+        return masks.data() + (size_t)xSegment * features;
+    }
 
     string getFilterType()
     {
-        return "samplesFilterType";
+        return "nodeFilterType";
     }
-    ~SamplesFilter() ;
 };
 
 class FilterConfig
 {
 private:
     SamplesFilter *sampleFilter;
+    NodeFilter *nodeFilter;
     string outputFileName;
 public :
     FilterConfig()
     {
 	sampleFilter = NULL;
+	nodeFilter = NULL;
     }
 
     ~FilterConfig()
     {
 	delete(sampleFilter);
+	delete(nodeFilter);
     }
 
     void setOutputFileName(string xOutputFileName)
@@ -104,16 +213,73 @@ public :
 	    }
     }
 
+    void applySamplesCandidateFilter(float *xInput, int xSampleIndex, const unsigned int *xCandidate, int count)
+    {
+	    if(sampleFilter != NULL) {
+		    sampleFilter->applyCandidateFilter(xInput, xSampleIndex, xCandidate, count);
+	    }
+    }
+
+    void setNodeFilter(NodeFilter* xNodeFilter)
+    {
+        nodeFilter = xNodeFilter;
+    }
+
+    NodeFilter* getNodeFilter()
+    {
+        return nodeFilter;
+    }
+
+    void applyNodeCandidateFilter(float *xInput, int xSampleIndex, const unsigned int *xCandidate, int count)
+    {
+	    if(nodeFilter != NULL) {
+		    nodeFilter->applyCandidateFilter(xInput, xSampleIndex, xCandidate, count);
+	    }
+    }
+
+    // Appends the sample's filter within global indices [offSet, offSet + width) to xItems/xValues as
+    // ascending indices local to that range, for top K selection to apply while selecting
+    void appendSamplesFilter(int xSampleIndex, int offSet, int width, vector<unsigned int> &xItems, vector<float> &xValues)
+    {
+	    if(sampleFilter != NULL) {
+		    sampleFilter->appendFilter(xSampleIndex, offSet, width, xItems, xValues);
+	    }
+    }
+
 };
 
 /**
-Parses the  filterConfig file which should be a json
-and created the Filters based on the Indexes  given for the Input Layer mInput
-and sampled mSamples
+Order independent fingerprint of a feature or sample index, used to match compiled filters to their indices
+*/
+uint64_t indexFingerprint(unordered_map<string, unsigned int> &xMIndex);
+
+/**
+Loads one filter configuration, a samples filter (none if its file name is empty) and node filters based on
+the Indexes given for the Input Layer mInput and sampled mSamples, written to the output file
 */
 FilterConfig* loadFilters(string , string ,
                                   unordered_map<string, unsigned int>& ,
-                                  unordered_map<string, unsigned int>& );
+                                  unordered_map<string, unsigned int>& ,
+                                  string nodeFilterFileName = "",
+                                  string segmentFilterFileName = "",
+                                  string sampleSegmentFileName = "");
+
+/**
+Whether filePath is a filters.json rather than a samples filter, i.e. starts with a JSON object
+*/
+bool isFilterConfigFile(const string &filePath);
+
+/**
+Loads every filter configuration of a filters.json, or the single configuration of any other samples filter
+written to outputFileName.  All of them are scored from the same predictions
+*/
+vector<FilterConfig*> loadFilterConfigs(string filtersFileName,
+                                        string outputFileName,
+                                        unordered_map<string, unsigned int> &xMInput,
+                                        unordered_map<string, unsigned int> &xMSamples,
+                                        string nodeFilterFileName = "",
+                                        string segmentFilterFileName = "",
+                                        string sampleSegmentFileName = "");
 
 #define FILTERS_H
 #endif
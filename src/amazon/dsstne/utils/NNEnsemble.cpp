@@ -0,0 +1,87 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <algorithm>
+#include <stdexcept>
+
+#include "NNEnsemble.h"
+
+NNEnsemble::NNEnsemble(const vector<NNNetwork*> &xNetwork,
+                       const vector<NNFloat> &xWeight,
+                       Combine xCombine,
+                       const string &xLayer,
+                       unsigned int xDepth) :
+    vNetwork(xNetwork),
+    vWeight(xWeight),
+    combine(xCombine),
+    layer(xLayer),
+    depth(xDepth)
+{
+    if (vNetwork.empty() || vWeight.size() != vNetwork.size()) {
+        throw std::invalid_argument("an ensemble needs one weight per network");
+    }
+    NNLayer* pFirst = vNetwork[0]->GetLayer(layer);
+    if (pFirst == NULL) {
+        throw std::invalid_argument("the first network has no layer " + layer);
+    }
+    for (size_t i = 1; i < vNetwork.size(); i++) {
+        NNLayer* pLayer = vNetwork[i]->GetLayer(layer);
+        if (pLayer == NULL) {
+            throw std::invalid_argument("network " + vNetwork[i]->GetName() + " has no layer " + layer);
+        }
+        if (vNetwork[i]->GetBatch() != vNetwork[0]->GetBatch() || pLayer->GetDimensions() != pFirst->GetDimensions() ||
+            pLayer->GetLocalDimensions() != pFirst->GetLocalDimensions()) {
+            throw std::invalid_argument("layer " + layer + " of network " + vNetwork[i]->GetName() + " does not match the first network's");
+        }
+    }
+    if (combine == RankFusion && getGpu()._numprocs > 1) {
+        throw std::invalid_argument("rank fusion is single process only");
+    }
+}
+
+/**
+The first network is predicted first and scaled in place, every other network's weighted scores are then added to
+it, so no buffer beyond the networks' own is needed.  RankFusion downloads each network's scores instead and uploads
+the fused ranks
+*/
+void NNEnsemble::predictBatch()
+{
+    uint32_t position = vNetwork[0]->GetPosition();
+    uint32_t batch = vNetwork[0]->GetBatch();
+    uint64_t size = vNetwork[0]->GetBufferSize(layer);
+    uint32_t width = size / batch;
+    uint32_t rankDepth = min(depth, width);
+    NNFloat* pCombined = vNetwork[0]->GetUnitBuffer(layer);
+    if (combine == RankFusion) {
+        vUnit.resize(size);
+        vFused.assign(size, (NNFloat)0.0);
+    }
+
+    for (size_t i = 0; i < vNetwork.size(); i++) {
+        NNNetwork* pNetwork = vNetwork[i];
+        if (i > 0) {
+            pNetwork->SetPosition(position);
+        }
+        pNetwork->PredictBatch();
+        NNFloat* pUnit = pNetwork->GetUnitBuffer(layer);
+        if (combine == WeightedSum) {
+            addWeightedUnits(pCombined, pUnit, size, vWeight[i]);
+            continue;
+        }
+
+        cudaMemcpy(vUnit.data(), pUnit, size * sizeof(NNFloat), cudaMemcpyDeviceToHost);
+        addRankFusion(vUnit, batch, width, rankDepth, vWeight[i], vKey, vIndex, vFused);
+    }
+
+    if (combine == RankFusion) {
+        cudaMemcpy(pCombined, vFused.data(), size * sizeof(NNFloat), cudaMemcpyHostToDevice);
+    }
+}
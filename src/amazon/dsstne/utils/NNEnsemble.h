@@ -0,0 +1,77 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#ifndef NN_ENSEMBLE_H
+#define NN_ENSEMBLE_H
+
+#include <string>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "NNNetwork.h"
+
+using namespace std;
+
+/**
+Networks trained on the same input feature index and output feature index, predicted over one shared input
+dataset.  Each batch is predicted by every network and their recs layers are combined into the first network's,
+so filtering, top K and writing run once on the combined scores.
+
+WeightedSum adds up the weighted scores.  RankFusion scores each unit by the weighted reciprocal rank
+weight / (RANK_FUSION_OFFSET + rank) summed over the networks that rank it in their top depth, which makes networks
+with different score scales comparable.  RankFusion ranks on the host and is single process only
+*/
+class NNEnsemble
+{
+public:
+    enum Combine
+    {
+        WeightedSum,
+        RankFusion,
+    };
+
+    static const NNFloat RANK_FUSION_OFFSET;
+
+    // Throws std::invalid_argument unless every network has the first one's batch size and layer dimensions
+    NNEnsemble(const vector<NNNetwork*> &vNetwork,
+               const vector<NNFloat> &vWeight,
+               Combine combine,
+               const string &layer,
+               unsigned int depth);
+
+    // Predicts the first network's current batch with every network, the combined scores replace the first
+    // network's layer units
+    void predictBatch();
+
+    // WeightedSum step, adds weight times the size units of pUnit to pCombined, both device buffers.  The first
+    // network's units are the combined ones and are only scaled
+    static void addWeightedUnits(NNFloat* pCombined, NNFloat* pUnit, uint64_t size, NNFloat weight);
+
+    // RankFusion step, adds weight / (RANK_FUSION_OFFSET + rank) to vFused for each of the top depth units of every
+    // row of the batch x width host units vUnit, ranks counting from 1.  vKey and vIndex are scratch
+    static void addRankFusion(vector<NNFloat>& vUnit, uint32_t batch, uint32_t width, uint32_t depth, NNFloat weight,
+                              vector<NNFloat>& vKey, vector<unsigned int>& vIndex, vector<NNFloat>& vFused);
+
+private:
+    vector<NNNetwork*> vNetwork;
+    vector<NNFloat> vWeight;
+    Combine combine;
+    string layer;
+    unsigned int depth;
+
+    // Host buffers of RankFusion
+    vector<NNFloat> vUnit;
+    vector<NNFloat> vKey;
+    vector<unsigned int> vIndex;
+    vector<NNFloat> vFused;
+};
+#endif
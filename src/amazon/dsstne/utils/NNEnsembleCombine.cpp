@@ -0,0 +1,40 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include "NNEnsemble.h"
+
+// The combining steps are apart from NNEnsemble.cpp so they can be tested on plain buffers, without networks
+
+// The usual reciprocal rank fusion constant, damps the weight of the very first ranks
+const NNFloat NNEnsemble::RANK_FUSION_OFFSET = 60.0f;
+
+void NNEnsemble::addWeightedUnits(NNFloat* pCombined, NNFloat* pUnit, uint64_t size, NNFloat weight)
+{
+    if (weight != (NNFloat)1.0) {
+        kScaleAndBias(pUnit, size, weight, (NNFloat)0.0);
+    }
+    if (pUnit != pCombined) {
+        kAddBuffers(pCombined, pUnit, size);
+    }
+}
+
+void NNEnsemble::addRankFusion(vector<NNFloat>& vUnit, uint32_t batch, uint32_t width, uint32_t depth, NNFloat weight,
+                               vector<NNFloat>& vKey, vector<unsigned int>& vIndex, vector<NNFloat>& vFused)
+{
+    vKey.resize((size_t)batch * depth);
+    vIndex.resize((size_t)batch * depth);
+    hCalculateTopK(vUnit.data(), vKey.data(), vIndex.data(), batch, width, depth);
+    for (uint32_t j = 0; j < batch; j++) {
+        for (uint32_t r = 0; r < depth; r++) {
+            vFused[(size_t)j * width + vIndex[(size_t)j * depth + r]] += weight / (RANK_FUSION_OFFSET + r + 1);
+        }
+    }
+}
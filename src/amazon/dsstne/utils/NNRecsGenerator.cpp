@@ -18,11 +18,13 @@
 #include<string>
 #include<stdio.h>
 #include<cmath>
+#include<climits>
 
 #include"NNRecsGenerator.h"
 #include "GpuTypes.h"
 #include "Utils.h"
 #include "Filters.h"
+#include "RecsWriter.h"
 
 const string NNRecsGenerator::DEFAULT_LAYER_RECS_GEN_LABEL = "Output";
 const string NNRecsGenerator::DEFAULT_SCORE_PRECISION = "4.3f";
@@ -39,26 +41,151 @@ The GPU buffer is created for sorting
 and the parametes are batch size
 how many recs do you need to Sort
 The Filered location  which is used as Buffer of the Recs Generated to sort
+
+With hostTopK the top K is selected on the host from the downloaded output
+instead, which has no limit on xK and needs no TOPK_SCALAR oversampling to merge multi GPU results
+
+Sample filters are never applied to the output itself, each batch's filters are handed to the top K
+selection as per sample lists of (feature, multiplier) which it applies while selecting.  Node filters
+are score masks copied to the GPU once and applied by the same selection
+
+Process 0 hands the selected recs to a RecsWriter per output file, which formats and writes them on
+its own thread while the next batch is predicted, as text or as the binary records of RecsFile.h
 */
 NNRecsGenerator::NNRecsGenerator(unsigned int xBatchSize,
                                  unsigned int xK,
                                  unsigned int xOutputBufferSize,
                                  string layer,
-				 string precision)
+				 string precision,
+				 bool hostTopK,
+				 RecsFormat format)
 {
-    
-    pbKey           = new GpuBuffer<NNFloat>(xBatchSize* xK * TOPK_SCALAR, true);
-    pbUIValue       = new GpuBuffer<unsigned int>(xBatchSize* xK * TOPK_SCALAR, true);
-    pFilteredOutput = new GpuBuffer<NNFloat>(xOutputBufferSize, true);
+    bHostTopK = hostTopK;
+    pbFilterIndex = NULL;
+    pbFilterValue = NULL;
+    filterCapacity = 0;
+    pbNodeFilterRow = NULL;
+    bHostOutputCurrent = false;
+    if (bHostTopK) {
+        pbKey           = NULL;
+        pbUIValue       = NULL;
+        pbFilterStart   = NULL;
+        pbFilterEnd     = NULL;
+        vHostKey.resize(xBatchSize * xK);
+        vHostUIValue.resize(xBatchSize * xK);
+    } else {
+        pbKey           = new GpuBuffer<NNFloat>(xBatchSize* xK * TOPK_SCALAR, true);
+        pbUIValue       = new GpuBuffer<unsigned int>(xBatchSize* xK * TOPK_SCALAR, true);
+        pbFilterStart   = new GpuBuffer<uint64_t>(xBatchSize);
+        pbFilterEnd     = new GpuBuffer<uint64_t>(xBatchSize);
+    }
     recsGenLayerLabel = layer;
     scorePrecision = precision;
+    recsFormat = format;
 }
 
 void NNRecsGenerator::reset()
 {
     delete(pbKey);
     delete(pbUIValue);
-    delete(pFilteredOutput);
+    delete(pbFilterStart);
+    delete(pbFilterEnd);
+    delete(pbFilterIndex);
+    delete(pbFilterValue);
+    for (map<NodeFilter*, NodeFilterMasks>::iterator it = mNodeFilterMasks.begin(); it != mNodeFilterMasks.end(); it++) {
+        delete(it->second.pbMask);
+    }
+    mNodeFilterMasks.clear();
+    delete(pbNodeFilterRow);
+    for (map<string, RecsWriter*>::iterator it = mRecsWriter.begin(); it != mRecsWriter.end(); it++) {
+        delete(it->second);
+    }
+    mRecsWriter.clear();
+}
+
+/**
+Waits until every batch handed to a writer has been written out
+*/
+void NNRecsGenerator::flush()
+{
+    for (map<string, RecsWriter*>::iterator it = mRecsWriter.begin(); it != mRecsWriter.end(); it++) {
+        it->second->flush();
+    }
+}
+
+/**
+Writers are created on first use and keep their output file open from then on
+*/
+RecsWriter* NNRecsGenerator::getWriter(FilterConfig* xFilterSet, vector<string> & xCustomerIndex, vector<string> & xFeatureIndex)
+{
+    string fileName = xFilterSet->getOutputFileName();
+    map<string, RecsWriter*>::iterator it = mRecsWriter.find(fileName);
+    if (it != mRecsWriter.end()) {
+        return it->second;
+    }
+    RecsWriter* pWriter = new RecsWriter(fileName, scorePrecision, xCustomerIndex, xFeatureIndex, recsFormat);
+    mRecsWriter[fileName] = pWriter;
+    return pWriter;
+}
+
+/**
+Copies the batch's filter lists to the GPU, only the lists themselves are transferred
+*/
+void NNRecsGenerator::uploadFilters(int xBatch)
+{
+    if (vFilterItems.size() > filterCapacity) {
+        delete(pbFilterIndex);
+        delete(pbFilterValue);
+        filterCapacity = max(vFilterItems.size(), 2 * filterCapacity);
+        pbFilterIndex = new GpuBuffer<unsigned int>(filterCapacity);
+        pbFilterValue = new GpuBuffer<NNFloat>(filterCapacity);
+    }
+    cudaMemcpy(pbFilterStart->_pDevData, vFilterStart.data(), xBatch * sizeof(uint64_t), cudaMemcpyHostToDevice);
+    cudaMemcpy(pbFilterEnd->_pDevData, vFilterEnd.data(), xBatch * sizeof(uint64_t), cudaMemcpyHostToDevice);
+    if (vFilterItems.size() > 0) {
+        cudaMemcpy(pbFilterIndex->_pDevData, vFilterItems.data(), vFilterItems.size() * sizeof(unsigned int), cudaMemcpyHostToDevice);
+        cudaMemcpy(pbFilterValue->_pDevData, vFilterValues.data(), vFilterValues.size() * sizeof(NNFloat), cudaMemcpyHostToDevice);
+    }
+}
+
+/**
+Builds the node filter masks of FEATUREs [offSet, offSet + width) the first time a node filter is seen, FEATUREs
+past the end of the index are padding and left unfiltered.  The segment of each sample is only needed with more
+than one mask
+*/
+NNRecsGenerator::NodeFilterMasks& NNRecsGenerator::prepareNodeFilter(NodeFilter* xNodeFilter, int xPosition, int xBatch, int offSet, int width)
+{
+    unsigned int segments = xNodeFilter->getSegments();
+    map<NodeFilter*, NodeFilterMasks>::iterator it = mNodeFilterMasks.find(xNodeFilter);
+    if (it == mNodeFilterMasks.end()) {
+        NodeFilterMasks& masks = mNodeFilterMasks[xNodeFilter];
+        masks.vMask.assign((size_t)segments * width, 1.0f);
+        masks.pbMask = NULL;
+        for (unsigned int s = 0; s < segments; s++) {
+            const float* pMask = xNodeFilter->getMask(s);
+            for (int i = 0; i < width && offSet + i < (int)xNodeFilter->getFeatures(); i++) {
+                masks.vMask[(size_t)s * width + i] = pMask[offSet + i];
+            }
+        }
+        if (!bHostTopK) {
+            masks.pbMask = new GpuBuffer<NNFloat>(masks.vMask.size());
+            masks.pbMask->Upload(masks.vMask.data());
+            if (segments > 1 && pbNodeFilterRow == NULL) {
+                pbNodeFilterRow = new GpuBuffer<unsigned int>(pbFilterStart->_length);
+            }
+        }
+        it = mNodeFilterMasks.find(xNodeFilter);
+    }
+    if (segments > 1) {
+        vNodeFilterRow.resize(xBatch);
+        for (int j = 0; j < xBatch; j++) {
+            vNodeFilterRow[j] = xNodeFilter->getSegment(xPosition + j);
+        }
+        if (!bHostTopK) {
+            cudaMemcpy(pbNodeFilterRow->_pDevData, vNodeFilterRow.data(), xBatch * sizeof(unsigned int), cudaMemcpyHostToDevice);
+        }
+    }
+    return it->second;
 }
 
 void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
@@ -66,6 +193,31 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
                                    FilterConfig* xFilterSet,
                                    vector<string> & xCustomerIndex,
                                    vector<string> & xFeatureIndex)
+{
+    vector<FilterConfig*> vFilterSet(1, xFilterSet);
+    generateRecs(xNetwork, xK, vFilterSet, xCustomerIndex, xFeatureIndex);
+}
+
+/**
+The network predicted the batch once, each filter configuration selects its own top K from the same output
+*/
+void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
+                                   int xK,
+                                   vector<FilterConfig*> & xFilterSet,
+                                   vector<string> & xCustomerIndex,
+                                   vector<string> & xFeatureIndex)
+{
+    bHostOutputCurrent = false;
+    for (size_t i = 0; i < xFilterSet.size(); i++) {
+        generateFilterRecs(xNetwork, xK, xFilterSet[i], xCustomerIndex, xFeatureIndex);
+    }
+}
+
+void NNRecsGenerator::generateFilterRecs(NNNetwork *xNetwork,
+                                         int xK,
+                                         FilterConfig* xFilterSet,
+                                         vector<string> & xCustomerIndex,
+                                         vector<string> & xFeatureIndex)
 {
     timeval t0;
     gettimeofday(&t0, NULL);
@@ -75,6 +227,12 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
     if( lPosition + lBatch > lExamples)
         lBatch = lExamples - lPosition;
 
+    NNLayer* pLayer                = xNetwork->GetLayer(recsGenLayerLabel);
+    if (pLayer->GetCandidateStride() > 0) {
+        generateCandidateRecs(xNetwork, pLayer, xK, xFilterSet, xCustomerIndex, xFeatureIndex);
+        return;
+    }
+
     // Variables for multi GPU memory copy and sorting 
     bool bMultiGPU                           = (getGpu()._numprocs > 1);
     GpuBuffer<NNFloat>* pbMultiKey           = NULL;
@@ -87,8 +245,7 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
     cudaIpcMemHandle_t keyMemHandle;
     cudaIpcMemHandle_t valMemHandle;
     NNFloat* dOutput               = xNetwork->GetUnitBuffer(recsGenLayerLabel);
-    
-    NNLayer* pLayer                = xNetwork->GetLayer(recsGenLayerLabel);
+
     unsigned int lx, ly, lz, lw;
     tie(lx, ly, lz, lw)             = pLayer->GetDimensions();
     int lOutputStride               =  lx * ly * lz * lw;
@@ -97,15 +254,9 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
    
     // Local Stride is how many FEATUREs actually in one GPU
     int lLocalOutputStride         = llx * lly * llz * llw;
-    unsigned int outputBufferSize  = lLocalOutputStride * lBatch;
-    if(!bMultiGPU) {
-	outputBufferSize = xNetwork->GetBufferSize(recsGenLayerLabel);
-    }
-
-    float *hOutputBuffer           = (float*)malloc(sizeof(float)*outputBufferSize);
    
     // Get P2P handles to multi-gpu data on node 0
-    if (bMultiGPU)
+    if (bMultiGPU && !bHostTopK)
     {
         if (getGpu()._id == 0)
             {
@@ -131,28 +282,83 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
             }
 
     }
-    cudaMemcpy(hOutputBuffer, dOutput, outputBufferSize* sizeof(NNFloat), cudaMemcpyDeviceToHost);
-    // Iterate through all the filters and apply filters for each customer in the lBatch
-
-
-    //We dont need the memory buffer if we have only one filter as copying the memory effects performance	
     // TODO need to add a better time wrapper to measure the time duration of a  function call
     timeval timeStart;
     gettimeofday(&timeStart, NULL);
+
+    // Gather the filter of each customer in the lBatch, restricted to the FEATUREs in this GPU.
+    // offSet is the starting FEATUREs in this GPU to the first one in global FEATURE Index 
+    int offSet = getGpu()._id * lLocalOutputStride;
+    vFilterStart.resize(lBatch);
+    vFilterEnd.resize(lBatch);
+    vFilterItems.clear();
+    vFilterValues.clear();
     for ( int j =0 ; j < lBatch ; j++)
     {
 	    int custIndex =  lPosition +j;
-
-	    // offSet is the starting FEATUREs in this GPU to the first one in global FEATURE Index 
-	    int offSet = getGpu()._id*lLocalOutputStride;
-	    xFilterSet->applySamplesFilter(hOutputBuffer + j * lLocalOutputStride, custIndex, offSet, lLocalOutputStride);
+	    vFilterStart[j] = vFilterItems.size();
+	    xFilterSet->appendSamplesFilter(custIndex, offSet, lLocalOutputStride, vFilterItems, vFilterValues);
+	    vFilterEnd[j] = vFilterItems.size();
+    }
+    NodeFilter* pNodeFilter = xFilterSet->getNodeFilter();
+    NodeFilterMasks* pMasks = NULL;
+    bool bSegments = false;
+    if (pNodeFilter != NULL) {
+	    pMasks = &prepareNodeFilter(pNodeFilter, lPosition, lBatch, offSet, lLocalOutputStride);
+	    bSegments = (pNodeFilter->getSegments() > 1);
     }
 
     timeval timeEnd;
-    pFilteredOutput->Upload(hOutputBuffer);
-    // TODO: Add Node Filter support for multi GPU 
-    // Each GPU sorting its top xK * TOPK_SCALAR
-    kCalculateTopK(pFilteredOutput->_pDevData, pbKey->_pDevData, pbUIValue->_pDevData, lBatch, lLocalOutputStride, xK * TOPK_SCALAR);
+    // Row stride of the selected keys and indices
+    unsigned int kStride = bHostTopK ? xK : xK * TOPK_SCALAR;
+    if (bHostTopK) {
+	    // Select the local top xK on the host, then turn local indices into global ones
+	    if (!bHostOutputCurrent) {
+		    vHostOutput.resize((size_t)lBatch * lLocalOutputStride);
+		    cudaMemcpy(vHostOutput.data(), dOutput, vHostOutput.size() * sizeof(NNFloat), cudaMemcpyDeviceToHost);
+		    bHostOutputCurrent = true;
+	    }
+	    hCalculateFilteredTopK(vHostOutput.data(), vHostKey.data(), vHostUIValue.data(), lBatch, lLocalOutputStride, xK,
+				   vFilterStart.data(), vFilterEnd.data(), vFilterItems.data(), vFilterValues.data(),
+				   pMasks ? pMasks->vMask.data() : NULL, bSegments ? vNodeFilterRow.data() : NULL);
+	    // Rows with fewer than xK unfiltered FEATUREs are padded, UINT_MAX keeps the padding out of the recs
+	    for (int i = 0; i < lBatch * xK; i++)
+	    {
+		    vHostUIValue[i] = (vHostKey[i] == -MAX_VALUE) ? UINT_MAX : vHostUIValue[i] + offSet;
+	    }
+
+	    if (bMultiGPU) {
+		    // Gather every process's top xK on process 0 and select the final top xK out of numprocs * xK
+		    int numprocs = getGpu()._numprocs;
+		    vector<NNFloat> vGatherKey;
+		    vector<unsigned int> vGatherUIValue;
+		    if (getGpu()._id == 0) {
+			    vGatherKey.resize(numprocs * lBatch * xK);
+			    vGatherUIValue.resize(numprocs * lBatch * xK);
+		    }
+		    MPI_Gather(vHostKey.data(), lBatch * xK, MPI_NNFLOAT, vGatherKey.data(), lBatch * xK, MPI_NNFLOAT, 0, MPI_COMM_WORLD);
+		    MPI_Gather(vHostUIValue.data(), lBatch * xK, MPI_UNSIGNED, vGatherUIValue.data(), lBatch * xK, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+		    if (getGpu()._id == 0) {
+			    // Interleave into one row of numprocs * xK candidates per sample
+			    unsigned int mStride = numprocs * xK;
+			    vector<NNFloat> vMultiKey(lBatch * mStride);
+			    vector<unsigned int> vMultiUIValue(lBatch * mStride);
+			    for (int p = 0; p < numprocs; p++) {
+				    for (int j = 0; j < lBatch; j++) {
+					    memcpy(&vMultiKey[j * mStride + p * xK], &vGatherKey[(p * lBatch + j) * xK], xK * sizeof(NNFloat));
+					    memcpy(&vMultiUIValue[j * mStride + p * xK], &vGatherUIValue[(p * lBatch + j) * xK], xK * sizeof(unsigned int));
+				    }
+			    }
+			    hCalculateTopK(vMultiKey.data(), vMultiUIValue.data(), vHostKey.data(), vHostUIValue.data(), lBatch, mStride, xK);
+		    }
+	    }
+    } else {
+    uploadFilters(lBatch);
+    // Each GPU sorting its top xK * TOPK_SCALAR straight from the output layer, filtering as it goes
+    kCalculateFilteredTopK(dOutput, pbKey->_pDevData, pbUIValue->_pDevData, lBatch, lLocalOutputStride, xK * TOPK_SCALAR,
+			   pbFilterStart->_pDevData, pbFilterEnd->_pDevData,
+			   pbFilterIndex ? pbFilterIndex->_pDevData : NULL, pbFilterValue ? pbFilterValue->_pDevData : NULL,
+			   pMasks ? pMasks->pbMask->_pDevData : NULL, bSegments ? pbNodeFilterRow->_pDevData : NULL);
 
     if (bMultiGPU) {
 
@@ -180,68 +386,67 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
 	    }
 
     }
+    }
 
 
     if (getGpu()._id == 0)
     {
 
-	    const char  *fileName = xFilterSet->getOutputFileName().c_str();
 	    gettimeofday(&timeEnd, NULL);
 	    cout <<"Time Elapsed for Filtering and selecting Top " << xK << " recs"<< elapsed_time(timeEnd, timeStart) << endl;
-	    cout << "Writing to " << fileName<<endl;
-	    FILE *fp =  fopen(fileName,"a");
-	    pbKey->Download();
-	    pbUIValue->Download();
-	    NNFloat* pKey                   = pbKey->_pSysData;
-	    unsigned int* pIndex            = pbUIValue->_pSysData;
+	    RecsWriter* pWriter = getWriter(xFilterSet, xCustomerIndex, xFeatureIndex);
+	    cout << "Writing to " << pWriter->getFileName() << endl;
+	    NNFloat* pKey                   = NULL;
+	    unsigned int* pIndex            = NULL;
+	    if (bHostTopK) {
+		    pKey                        = vHostKey.data();
+		    pIndex                      = vHostUIValue.data();
+	    } else {
+		    pbKey->Download();
+		    pbUIValue->Download();
+		    pKey                        = pbKey->_pSysData;
+		    pIndex                      = pbUIValue->_pSysData;
+	    }
 
-	    if (bMultiGPU) {
+	    if (bMultiGPU && !bHostTopK) {
 		    pbUIValueCache->Download();
 		    pUIValueCache               = pbUIValueCache->_pSysData;        
 	    }
 
-	    string strFormat = "%s,%" + scorePrecision + ":";
+	    // Hand the global FEATURE index and score of each rec to the writer, formatting and writing
+	    // overlap with the next batch
+	    RecsWriter::Batch* pBatch = pWriter->getBatch();
+	    pBatch->position = lPosition;
+	    pBatch->rows = lBatch;
+	    pBatch->k = xK;
+	    pBatch->features.resize(lBatch * xK);
+	    pBatch->scores.resize(lBatch * xK);
 	    for( int j =0 ; j < lBatch ; j++)
 	    {
-		    int custIndex =  lPosition +j;
-		    fprintf(fp,"%s%c",xCustomerIndex[lPosition + j].c_str(),'\t');
 		    for(int x  = 0; x < xK; ++x)
 		    {
 			    // Single GPU case, FEATURE index is global		
-			    int finalIndex = pIndex[j* xK * TOPK_SCALAR + x];
-			    float value = pKey[j* xK * TOPK_SCALAR + x];
-			    if (bMultiGPU) {
+			    unsigned int finalIndex = pIndex[j* kStride + x];
+			    if (bMultiGPU && !bHostTopK) {
 				    // Multi GPU case. Need to do two level look up
 				    // which GPU this index comes from
 				    int gpuId = finalIndex / (xK * TOPK_SCALAR);
 				    // Local index within one GPU
-				    int localIndex = pUIValueCache[j* xK * TOPK_SCALAR + x];
-				    int globalIndex = gpuId * lLocalOutputStride + localIndex; 
-				    if (globalIndex < xFeatureIndex.size()) {
-					    fprintf(fp,strFormat.c_str(),xFeatureIndex[globalIndex].c_str(),value);
-				    } 
-
-			    } else {
-
-				    if (finalIndex < xFeatureIndex.size()) {
-					    fprintf(fp,strFormat.c_str(),xFeatureIndex[finalIndex].c_str(),value);
-				    }
+				    int localIndex = pUIValueCache[j* kStride + x];
+				    finalIndex = gpuId * lLocalOutputStride + localIndex; 
 			    }
-
+			    pBatch->features[j * xK + x] = finalIndex;
+			    pBatch->scores[j * xK + x] = pKey[j* kStride + x];
 		    }
-
-		    fprintf(fp,"\n");
 	    }
-	    fclose(fp);
+	    pWriter->submit(pBatch);
 	    gettimeofday(&timeEnd, NULL);
-	    cout <<"Time Elapsed for Writing to file" <<  elapsed_time(timeEnd,timeStart) << endl;
+	    cout <<"Time Elapsed for queuing recs for writing" <<  elapsed_time(timeEnd,timeStart) << endl;
     }
 
 
-    free(hOutputBuffer);
-
     // Delete multi-GPU data and P2P handles if multi-GPU
-    if (bMultiGPU)
+    if (bMultiGPU && !bHostTopK)
     {
 	    if (getGpu()._id != 0)
 	    {
@@ -256,3 +461,67 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
      } 
 }
 
+/**
+With candidates set on the recs layer only the candidate scores of each sample were computed
+(single process only).  Filters and the host top K run over those, and the selected positions
+are mapped back to features through the sample's candidate list.
+*/
+void NNRecsGenerator::generateCandidateRecs(NNNetwork *xNetwork,
+                                            NNLayer *xLayer,
+                                            int xK,
+                                            FilterConfig* xFilterSet,
+                                            vector<string> & xCustomerIndex,
+                                            vector<string> & xFeatureIndex)
+{
+    int lBatch                     = xNetwork->GetBatch();
+    int lExamples                  = xNetwork->GetExamples();
+    int lPosition                  = xNetwork->GetPosition();
+    if( lPosition + lBatch > lExamples)
+        lBatch = lExamples - lPosition;
+
+    unsigned int candidateStride   = xLayer->GetCandidateStride();
+    vector<NNFloat> vOutput((size_t)lBatch * candidateStride);
+    cudaMemcpy(vOutput.data(), xLayer->GetCandidateUnitBuffer(), vOutput.size() * sizeof(NNFloat), cudaMemcpyDeviceToHost);
+
+    timeval timeStart;
+    gettimeofday(&timeStart, NULL);
+    for ( int j =0 ; j < lBatch ; j++)
+    {
+	    unsigned int count;
+	    const unsigned int* pCandidate = xLayer->GetCandidates(lPosition + j, count);
+	    xFilterSet->applySamplesCandidateFilter(&vOutput[(size_t)j * candidateStride], lPosition + j, pCandidate, count);
+	    xFilterSet->applyNodeCandidateFilter(&vOutput[(size_t)j * candidateStride], lPosition + j, pCandidate, count);
+    }
+
+    vector<NNFloat> vKey((size_t)lBatch * xK);
+    vector<unsigned int> vIndex((size_t)lBatch * xK);
+    hCalculateTopK(vOutput.data(), vKey.data(), vIndex.data(), lBatch, candidateStride, xK);
+
+    timeval timeEnd;
+    gettimeofday(&timeEnd, NULL);
+    cout <<"Time Elapsed for Filtering and selecting Top " << xK << " recs from " << candidateStride << " candidates " << elapsed_time(timeEnd, timeStart) << endl;
+
+    RecsWriter* pWriter = getWriter(xFilterSet, xCustomerIndex, xFeatureIndex);
+    cout << "Writing to " << pWriter->getFileName() << endl;
+    RecsWriter::Batch* pBatch = pWriter->getBatch();
+    pBatch->position = lPosition;
+    pBatch->rows = lBatch;
+    pBatch->k = xK;
+    pBatch->features.resize(lBatch * xK);
+    pBatch->scores.resize(lBatch * xK);
+    for( int j =0 ; j < lBatch ; j++)
+    {
+	    unsigned int count;
+	    const unsigned int* pCandidate = xLayer->GetCandidates(lPosition + j, count);
+	    for(int x  = 0; x < xK; ++x)
+	    {
+		    // Positions past the candidate count are padding
+		    unsigned int candidateIndex = vIndex[j * xK + x];
+		    pBatch->features[j * xK + x] = (candidateIndex < count) ? pCandidate[candidateIndex] : UINT_MAX;
+		    pBatch->scores[j * xK + x] = vKey[j * xK + x];
+	    }
+    }
+    pWriter->submit(pBatch);
+    gettimeofday(&timeEnd, NULL);
+    cout <<"Time Elapsed for queuing recs for writing" <<  elapsed_time(timeEnd,timeStart) << endl;
+}
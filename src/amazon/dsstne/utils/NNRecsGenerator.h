@@ -17,12 +17,14 @@
 #include <iomanip>
 #include <fstream>
 #include <algorithm>
+#include <map>
 #include <netcdf>
 
 #include "GpuTypes.h"
 #include "NNTypes.h"
 #include "NNNetwork.h"
 #include "Filters.h"
+#include "RecsWriter.h"
 
 using namespace std;
 
@@ -31,10 +33,59 @@ class NNRecsGenerator
 private :
     GpuBuffer<NNFloat>* pbKey ;
     GpuBuffer<unsigned int>* pbUIValue;
-    GpuBuffer<NNFloat> *pFilteredOutput;
-    vector <GpuBuffer<NNFloat>*> *vNodeFilters;
+    GpuBuffer<uint64_t>* pbFilterStart;
+    GpuBuffer<uint64_t>* pbFilterEnd;
+    GpuBuffer<unsigned int>* pbFilterIndex;
+    GpuBuffer<NNFloat>* pbFilterValue;
+    size_t filterCapacity;
+    GpuBuffer<unsigned int>* pbNodeFilterRow;
     string recsGenLayerLabel;
     string scorePrecision;
+    RecsFormat recsFormat;
+    bool bHostTopK;
+    vector<NNFloat> vHostKey;
+    vector<unsigned int> vHostUIValue;
+    vector<NNFloat> vHostOutput;
+    // Whether vHostOutput already holds the current batch, so several filter configurations download it once
+    bool bHostOutputCurrent;
+
+    // Sample filters of the current batch, row j is vFilterItems/vFilterValues [vFilterStart[j], vFilterEnd[j])
+    vector<uint64_t> vFilterStart;
+    vector<uint64_t> vFilterEnd;
+    vector<unsigned int> vFilterItems;
+    vector<NNFloat> vFilterValues;
+
+    void uploadFilters(int batch);
+
+    // Node filter masks of every segment over this process's FEATUREs, built the first time each node filter is
+    // seen, and the segment of each sample in the current batch
+    struct NodeFilterMasks
+    {
+        vector<NNFloat> vMask;
+        GpuBuffer<NNFloat>* pbMask;
+    };
+    map<NodeFilter*, NodeFilterMasks> mNodeFilterMasks;
+    vector<unsigned int> vNodeFilterRow;
+
+    NodeFilterMasks& prepareNodeFilter(NodeFilter* nodeFilter, int position, int batch, int offSet, int width);
+
+    // One writer thread per output file, only used on process 0
+    map<string, RecsWriter*> mRecsWriter;
+
+    RecsWriter* getWriter(FilterConfig* filters, vector<string> & customerIndex, vector<string> & featureIndex);
+
+    void generateFilterRecs(NNNetwork *network,
+                            int topK,
+                            FilterConfig* filters,
+                            vector<string> & customerIndex,
+                            vector<string> & featureIndex);
+
+    void generateCandidateRecs(NNNetwork *network,
+                               NNLayer *layer,
+                               int topK,
+                               FilterConfig* filters,
+                               vector<string> & customerIndex,
+                               vector<string> & featureIndex);
     
 public:
     static const string DEFAULT_LAYER_RECS_GEN_LABEL;
@@ -45,7 +96,9 @@ public:
 		unsigned int,
 		unsigned int,
     string layer=DEFAULT_LAYER_RECS_GEN_LABEL,
-    string precision=DEFAULT_SCORE_PRECISION);
+    string precision=DEFAULT_SCORE_PRECISION,
+    bool hostTopK=false,
+    RecsFormat format=RecsText);
 
     void generateRecs(NNNetwork *network,
                       int topK,
@@ -53,9 +106,18 @@ public:
                       vector<string> & customerIndex,
                       vector<string> & featureIndex);
 
+    // Recs of the current batch for every filter configuration, each written to its own output file
+    void generateRecs(NNNetwork *network,
+                      int topK,
+                      vector<FilterConfig*> & filters,
+                      vector<string> & customerIndex,
+                      vector<string> & featureIndex);
+
     
     string getRecsLayerLabel();
 
+    void flush();
+
     void reset();
     
     ~NNRecsGenerator()
@@ -26,12 +26,12 @@ string DATASET_TYPE_ANALOG("analog");
 void printUsageNetCDFGenerator() {
     cout << "NetCDFGenerator: Converts a text dataset file into a more compressed NetCDF file." << endl;
     cout <<
-    "Usage: generateNetCDF -d <dataset_name> -i <input_text_file> -o <output_netcdf_file> -f <features_index> -s <samples_index> [-c] [-m]" <<
+    "Usage: generateNetCDF -d <dataset_name> -i <input_text_file> -o <output_netcdf_file> -f <features_index> -s <samples_index> [-c] [-m] [-a <hash_buckets> [-j <num_hashes>] [-g]]" <<
     endl;
     cout << "    -d dataset_name: (required) name for the dataset within the netcdf file." << endl;
     cout << "    -i input_text_file: (required) path to the input text file with records in data format." << endl;
     cout << "    -o output_netcdf_file: (required) path to the output netcdf file that we generate." << endl;
-    cout << "    -f features_index: (required) path to the features index file to read-from/write-to." << endl;
+    cout << "    -f features_index: (required unless -a is set) path to the features index file to read-from/write-to." << endl;
     cout << "    -s samples_index: (required) path to the samples index file to read-from/write-to." << endl;
     cout <<
     "    -m : if set, we'll merge the feature index with new features found in the input_text_file. (Cannot be used with -c)." <<
@@ -40,6 +40,9 @@ void printUsageNetCDFGenerator() {
     cout <<
     "    -t type: (default = 'indicator') the type of dataset to generate. Valid values are: ['indicator', 'analog']." <<
     endl;
+    cout << "    -a hash_buckets: if set, features are hashed into this many inputs instead of using a features index." << endl;
+    cout << "    -j num_hashes: (default = 1) the number of buckets each feature is hashed to with -a." << endl;
+    cout << "    -g : if set, hashed values get a random sign per feature and bucket. Requires -t analog." << endl;
     cout << endl;
 }
 
@@ -52,7 +55,11 @@ int main(int argc, char **argv) {
     string inputFile = getRequiredArgValue(argc, argv, "-i", "input text file to convert.", &printUsageNetCDFGenerator);
     string outputFile = getRequiredArgValue(argc, argv, "-o", "output netcdf file to generate.", &printUsageNetCDFGenerator);
     string datasetName = getRequiredArgValue(argc, argv, "-d", "dataset name for the netcdf metadata.", &printUsageNetCDFGenerator);
-    string featureIndexFile = getRequiredArgValue(argc, argv, "-f", "feature index file.", &printUsageNetCDFGenerator);
+    FeatureHashing hashing(stoi(getOptionalArgValue(argc, argv, "-a", "0")),
+                           stoi(getOptionalArgValue(argc, argv, "-j", "1")),
+                           isArgSet(argc, argv, "-g"));
+    string featureIndexFile = (hashing.buckets > 0) ? getOptionalArgValue(argc, argv, "-f", "") :
+                              getRequiredArgValue(argc, argv, "-f", "feature index file.", &printUsageNetCDFGenerator);
     string sampleIndexFile = getRequiredArgValue(argc, argv, "-s", "samples index file.", &printUsageNetCDFGenerator);
 
     bool createFeatureIndex = isArgSet(argc, argv, "-c");
@@ -80,6 +87,23 @@ int main(int argc, char **argv) {
     }
     cout << "Generating dataset of type: " << dataType << endl;
 
+    if (hashing.buckets > 0) {
+        if (createFeatureIndex || mergeFeatureIndex) {
+            cout << "Error: Hashed features (-a) do not use a feature index, -c and -m cannot be set." << endl;
+            exit(1);
+        }
+        if (hashing.hashes == 0) {
+            cout << "Error: num_hashes (-j) must be at least 1." << endl;
+            exit(1);
+        }
+        if (hashing.bSigned && dataType.compare(DATASET_TYPE_ANALOG) != 0) {
+            cout << "Error: Signed hashing (-g) needs an analog dataset (-t analog) to keep the signs." << endl;
+            exit(1);
+        }
+        cout << "Hashing features into " << hashing.buckets << " buckets with " << hashing.hashes << " hashes"
+             << (hashing.bSigned ? ", signed" : "") << endl;
+    }
+
     // maps for feature and samples index.
     unordered_map<string, unsigned int> mFeatureIndex;
     unordered_map<string, unsigned int> mSampleIndex;
@@ -99,7 +123,9 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (createFeatureIndex) {
+    if (hashing.buckets > 0) {
+        cout << "Features are hashed, no features index is loaded or written." << endl;
+    } else if (createFeatureIndex) {
         cout << "Will create a new features index file: " << featureIndexFile << endl;
     } else if (!fileExists(featureIndexFile)) {
         cout << "Error: Cannnot find a valid feature index file: " << featureIndexFile << endl;
@@ -129,11 +155,14 @@ int main(int argc, char **argv) {
                           vSparseEnd,
                           vSparseIndex,
                           vSparseData,
-                          cout)) {
+                          cout,
+                          hashing)) {
         exit(1);
     }
 
 
+    // Hashed inputs are always hash_buckets wide
+    unsigned int inputs = (hashing.buckets > 0) ? hashing.buckets : mFeatureIndex.size();
     if (dataType.compare(DATASET_TYPE_ANALOG) == 0) {
         writeNetCDFFile(vSparseStart,
                         vSparseEnd,
@@ -141,10 +170,10 @@ int main(int argc, char **argv) {
                         vSparseData,
                         outputFile,
                         datasetName,
-                        mFeatureIndex.size());
+                        inputs);
     } else {
         // Default type is to assume indicator, so we don't retain the data values in the NetCDF file.
-        writeNetCDFFile(vSparseStart, vSparseEnd, vSparseIndex, outputFile, datasetName, mFeatureIndex.size());
+        writeNetCDFFile(vSparseStart, vSparseEnd, vSparseIndex, outputFile, datasetName, inputs);
     }
 
     timeval timeEnd;
@@ -24,6 +24,7 @@
 #include <stdexcept>
 
 #include "NNEnum.h"
+#include "NetCDFhelper.h"
 #include "Utils.h"
 
 using namespace std;
@@ -84,6 +85,91 @@ void exportIndex(unordered_map<string, unsigned int> &mLabelToIndex, string inde
     outputIndexStream.close();
 }
 
+// 32-bit MurmurHash3 (x86_32) of a feature label
+static uint32_t murmurHash3(const string &key, uint32_t seed) {
+    const uint32_t c1 = 0xcc9e2d51;
+    const uint32_t c2 = 0x1b873593;
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(key.data());
+    const size_t length = key.length();
+    const size_t blocks = length / 4;
+    uint32_t h = seed;
+
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t k;
+        memcpy(&k, data + i * 4, sizeof(k));
+        k *= c1;
+        k = (k << 15) | (k >> 17);
+        k *= c2;
+        h ^= k;
+        h = (h << 13) | (h >> 19);
+        h = h * 5 + 0xe6546b64;
+    }
+
+    const unsigned char *tail = data + blocks * 4;
+    uint32_t k = 0;
+    switch (length & 3) {
+        case 3:
+            k ^= tail[2] << 16;
+            // fall through
+        case 2:
+            k ^= tail[1] << 8;
+            // fall through
+        case 1:
+            k ^= tail[0];
+            k *= c1;
+            k = (k << 15) | (k >> 17);
+            k *= c2;
+            h ^= k;
+    }
+
+    h ^= (uint32_t)length;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Seed offset of the sign hashes, so signs are independent from the bucket of the same hash
+static const uint32_t HASH_SIGN_SEED = 0x9e3779b9;
+
+void hashFeature(const std::string &featureName,
+                 float featureValue,
+                 const FeatureHashing &hashing,
+                 std::vector<unsigned int> &signals,
+                 std::vector<float> &signalValues) {
+    for (uint32_t i = 0; i < hashing.hashes; i++) {
+        signals.push_back(murmurHash3(featureName, i) % hashing.buckets);
+        if (hashing.bSigned && (murmurHash3(featureName, HASH_SIGN_SEED + i) & 1)) {
+            signalValues.push_back(-featureValue);
+        } else {
+            signalValues.push_back(featureValue);
+        }
+    }
+}
+
+// Sorts the hashed signals of one sample and sums the values of signals in the same bucket
+static void mergeHashedSignals(vector<unsigned int> &signals, vector<float> &signalValues) {
+    vector<pair<unsigned int, float>> vSignal(signals.size());
+    for (size_t i = 0; i < signals.size(); i++) {
+        vSignal[i] = make_pair(signals[i], signalValues[i]);
+    }
+    sort(vSignal.begin(), vSignal.end(),
+         [](const pair<unsigned int, float> &a, const pair<unsigned int, float> &b) { return a.first < b.first; });
+
+    signals.clear();
+    signalValues.clear();
+    for (const auto &signal : vSignal) {
+        if (!signals.empty() && signals.back() == signal.first) {
+            signalValues.back() += signal.second;
+        } else {
+            signals.push_back(signal.first);
+            signalValues.push_back(signal.second);
+        }
+    }
+}
+
 bool parseSamples(std::istream &inputStream,
                   const bool enableFeatureIndexUpdates,
                   std::unordered_map<std::string, unsigned int> &mFeatureIndex,
@@ -92,7 +178,8 @@ bool parseSamples(std::istream &inputStream,
                   bool &sampleIndexUpdated,
                   std::map<unsigned int, std::vector<unsigned int>> &mSignals,
                   std::map<unsigned int, std::vector<float>> &mSignalValues,
-                  std::ostream &outputStream) {
+                  std::ostream &outputStream,
+                  const FeatureHashing &hashing) {
     timeval tBegin;
     gettimeofday(&tBegin, NULL);
     timeval tReported = tBegin;
@@ -151,13 +238,19 @@ bool parseSamples(std::istream &inputStream,
             }
 
             string featureName = dataElems[0];
-            float featureValue = 0.0;
+            float featureValue = (hashing.buckets > 0) ? 1.0 : 0.0;
             if (numDataElems > 1) {
                 // Look for the optional value for the feature.
                 // Since value for a feature can be int or float, its safer to parse float.
                 featureValue = stof(dataElems[1]);
             }
 
+            // Hashed features need no feature index
+            if (hashing.buckets > 0) {
+                hashFeature(featureName, featureValue, hashing, signals, signalValue);
+                continue;
+            }
+
             // Look up the index for the given feature.
             unsigned int featureIndex = 0;
             try {
@@ -181,6 +274,9 @@ bool parseSamples(std::istream &inputStream,
             signalValue.push_back(featureValue);
         }
 
+        if (hashing.buckets > 0) {
+            mergeHashedSignals(signals, signalValue);
+        }
         mSignals[sampleIndex] = signals;
         mSignalValues[sampleIndex] = signalValue;
         if (mSampleIndex.size() % gLoggingRate == 0) {
@@ -211,7 +307,8 @@ bool importSamplesFromPath(const std::string &samplesPath,
                            std::vector<unsigned int> &vSparseEnd,
                            std::vector<unsigned int> &vSparseIndex,
                            std::vector<float> &vSparseData,
-                           std::ostream &outputStream) {
+                           std::ostream &outputStream,
+                           const FeatureHashing &hashing) {
 
     featureIndexUpdated = false;
     sampleIndexUpdated = false;
@@ -249,7 +346,8 @@ bool importSamplesFromPath(const std::string &samplesPath,
                               sampleIndexUpdated,
                               mSignals,
                               mSignalValues,
-                              outputStream)) {
+                              outputStream,
+                              hashing)) {
                 return false;
             }
         }
@@ -289,7 +387,8 @@ bool generateNetCDFIndexes(const std::string &samplesPath,
                            std::vector<unsigned int> &vSparseEnd,
                            std::vector<unsigned int> &vSparseIndex,
                            std::vector<float> &vSparseData,
-                           std::ostream &outputStream) {
+                           std::ostream &outputStream,
+                           const FeatureHashing &hashing) {
 
     bool featureIndexUpdated;
     bool sampleIndexUpdated;
@@ -304,7 +403,8 @@ bool generateNetCDFIndexes(const std::string &samplesPath,
               vSparseEnd,
               vSparseIndex,
               vSparseData,
-              cout)) {
+              cout,
+              hashing)) {
 
         return false;
     }
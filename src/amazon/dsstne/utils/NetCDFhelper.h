@@ -10,6 +10,8 @@
    or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
  */
 
+#pragma once
+
 #include <iosfwd>
 #include <map>
 #include <string>
@@ -55,6 +57,36 @@ bool loadIndexFromFile(std::unordered_map<std::string, unsigned int> &labelsToIn
  */
 void exportIndex(std::unordered_map<std::string, unsigned int> &mLabelToIndex, std::string indexFileName);
 
+/**
+ * Feature hashing options for parseSamples() and importSamplesFromPath(). When buckets is non-zero,
+ * raw feature labels are hashed into [0, buckets) instead of being looked up in a feature index, so
+ * no feature index is read, updated or exported and the input layer is always buckets wide.
+ *
+ * Each feature is hashed hashes times with independent seeds. If bSigned is set, each hashed value
+ * is also multiplied by a +1/-1 sign taken from another hash, which keeps collisions unbiased but
+ * needs analog data to survive. Features without a value count as 1, and features of one sample
+ * that land in the same bucket are merged by summing their values.
+ */
+struct FeatureHashing {
+    unsigned int buckets;
+    unsigned int hashes;
+    bool bSigned;
+
+    FeatureHashing(unsigned int buckets = 0, unsigned int hashes = 1, bool bSigned = false) :
+        buckets(buckets), hashes(hashes), bSigned(bSigned) {}
+};
+
+/**
+ * Appends the hashing.hashes bucket indices of featureName to signals, and featureValue (times its
+ * sign when hashing.bSigned is set) to signalValues. Uses 32-bit MurmurHash3, so buckets are the
+ * same on every run and machine.
+ */
+void hashFeature(const std::string &featureName,
+                 float featureValue,
+                 const FeatureHashing &hashing,
+                 std::vector<unsigned int> &signals,
+                 std::vector<float> &signalValues);
+
 /**
  * Parse sample data from the given input stream, and update the referenced sample/signal and
  * sample/signal-value data structures.
@@ -63,6 +95,7 @@ void exportIndex(std::unordered_map<std::string, unsigned int> &mLabelToIndex, s
  * used to seed or update a sparse data index, appropriate for generating NetCDF files.
  *
  * @see importSamplesFromPath() for more documentation about return variables
+ * @see FeatureHashing for the hashed input mode, where mFeatureIndex is left untouched
  *
  * @return  \c true if all input is processed successfully; \c false otherwise
  */
@@ -74,7 +107,8 @@ bool parseSamples(std::istream &inputStream,
                   bool &sampleIndexUpdated,
                   std::map<unsigned int, std::vector<unsigned int>> &mSignals,
                   std::map<unsigned int, std::vector<float>> &mSignalValues,
-                  std::ostream &outputStream);
+                  std::ostream &outputStream,
+                  const FeatureHashing &hashing = FeatureHashing());
 
 /**
  * Import samples from a given file or directory, and update the referenced data structures.
@@ -86,7 +120,8 @@ bool parseSamples(std::istream &inputStream,
  * and sample indices have been updated (respectively)
  *
  * If enableFeatureIndexUpdates is set, the existing feature index will be updated with any
- * new entries found. Otherwise only the samples index will be updated.
+ * new entries found. Otherwise only the samples index will be updated. With hashing enabled the
+ * feature index is ignored and featureIndexUpdated is always false.
  *
  * @return  \c true if the all input files were read successfully; \c false otherwise
  */
@@ -100,7 +135,8 @@ bool importSamplesFromPath(const std::string &samplesPath,
                            std::vector<unsigned int> &vSparseEnd,
                            std::vector<unsigned int> &vSparseIndex,
                            std::vector<float> &vSparseData,
-                           std::ostream &outputStream);
+                           std::ostream &outputStream,
+                           const FeatureHashing &hashing = FeatureHashing());
 
 /**
  * Generates a NetCDF index for a given dataset and exports them to respective files with 
@@ -115,6 +151,7 @@ bool importSamplesFromPath(const std::string &samplesPath,
  * @param outFeatureIndexFileName - the name of the file to export the feature index to.
  * @param outSampleIndexFileName - the name of tile to export the samples index to.
  * @param outputStream - output stream to be used for any status or error messages.
+ * @param hashing - if enabled, features are hashed into buckets and no feature index is exported.
  *
  * @return  \c true if the all input files were read successfully; \c false otherwise
  */
@@ -128,7 +165,8 @@ bool generateNetCDFIndexes(const std::string &samplesPath,
                            std::vector<unsigned int> &vSparseEnd,
                            std::vector<unsigned int> &vSparseIndex,
                            std::vector<float> &vSparseData,
-                           std::ostream &outputStream);
+                           std::ostream &outputStream,
+                           const FeatureHashing &hashing = FeatureHashing());
 
 /**
  * Writes an NetCDFfile for a given sparse matrix of indices and values (start of sample, end of sample, samples array) for each sample.
@@ -10,6 +10,7 @@
    or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
  */
 #include <cstdio>
+#include <climits>
 #include <algorithm>
 #include <cstring>
 #include <iostream>
@@ -30,6 +31,9 @@
 #include "NNTypes.h"
 #include "NNRecsGenerator.h"
 #include "NetCDFhelper.h"
+#include "SampleStream.h"
+#include "NNEnsemble.h"
+#include "TopKRecall.h"
 
 using namespace std;
 using namespace netCDF;
@@ -56,60 +60,185 @@ void extractNNMapsToVectors(vector<string> &vVectors,
 }
 
 /**
- * A wrapper function to convert the TSV text file into a NetCDF file. The mSignalIndex will return the mappings for
- * all instances/signals/samples/customer id that were found in the text dataset. This looks common enough to move
- * to common utils.
+ * Sparse input dataset over CSR arrays, which are swapped into the dataset.  Boolean unless signed hashing needs the values.
+ */
+NNDataSetBase* newInputDataSet(const string& dataSetName,
+                               unsigned int width,
+                               const FeatureHashing &hashing,
+                               vector<uint64_t>& vSparseStart,
+                               vector<uint64_t>& vSparseEnd,
+                               vector<uint32_t>& vSparseIndex,
+                               vector<float>& vSparseData)
+{
+    if (hashing.bSigned) {
+        return new NNDataSet<float>(dataSetName, width, NNDataSetEnums::Sparse, vSparseStart, vSparseEnd, vSparseIndex, vSparseData);
+    }
+    vector<uint32_t> vNoData;
+    return new NNDataSet<uint32_t>(dataSetName, width, NNDataSetEnums::Sparse | NNDataSetEnums::Boolean, vSparseStart, vSparseEnd, vSparseIndex, vNoData);
+}
+
+/**
+ * Parses the TSV text file straight into an in memory sparse dataset, without writing and re-reading a NetCDF file.
+ * The mSignalIndex will return the mappings for all instances/signals/samples/customer id that were found in the
+ * text dataset.
  *
  * @param inputTextFile - input text file to process.
- * @param dataSetName - the name for the dataset to store in netcdf.
- * @param outputNCDFFile - the name of the output NetCDF file that we generate.
+ * @param dataSetName - the name of the dataset, matched against the input layers of the network.
  * @param mFeatureIndex - feature index map used to translate features to indices for sparse representation.
  * @param mSignalsIndex - signals or instance index, updated as the text file is processed.
+ * @param featureIndexFile - file the feature index is exported to.
+ * @param sampleIndexFile - file the samples index is exported to.
+ * @param hashing - if enabled, features are hashed into the network inputs and mFeatureIndex is unused.
+ *
+ * @return the dataset, Boolean unless signed hashing needs the values
  */
-void convertTextToNetCDF(string inputTextFile, 
-                         string dataSetName, 
-                         string outputNCDFFile, 
-                         unordered_map<string, unsigned int> &mFeatureIndex,
-                         unordered_map<string, unsigned int> &mSignalIndex,
-                         string featureIndexFile, 
-                         string sampleIndexFile)
+NNDataSetBase* loadTextDataSet(string inputTextFile,
+                               string dataSetName,
+                               unordered_map<string, unsigned int> &mFeatureIndex,
+                               unordered_map<string, unsigned int> &mSignalIndex,
+                               string featureIndexFile,
+                               string sampleIndexFile,
+                               const FeatureHashing &hashing)
 {
     vector <unsigned int> vSparseStart;
     vector <unsigned int> vSparseEnd;
     vector <unsigned int> vSparseIndex;
     vector <float> vSparseData;
 
-    if (!generateNetCDFIndexes(inputTextFile, false, featureIndexFile, sampleIndexFile, mFeatureIndex, mSignalIndex, vSparseStart, vSparseEnd, vSparseIndex, vSparseData, cout)) {
+    if (!generateNetCDFIndexes(inputTextFile, false, featureIndexFile, sampleIndexFile, mFeatureIndex, mSignalIndex, vSparseStart, vSparseEnd, vSparseIndex, vSparseData, cout, hashing)) {
         exit(1);
     }
 
-    // Only write binary data using a single CPU
-    if (getGpu()._id==0){
-        writeNetCDFFile(vSparseStart, vSparseEnd, vSparseIndex, 
-            outputNCDFFile, dataSetName, mFeatureIndex.size());
-    }
-
-    // Delete unwanted memory now that we have produced the netCDF file.
+    // Same width and attributes writeNetCDFFile would have stored
+    unsigned int width = roundUpMaxIndex((hashing.buckets > 0) ? hashing.buckets : mFeatureIndex.size());
+    vector<uint64_t> vStart(vSparseStart.begin(), vSparseStart.end());
+    vector<uint64_t> vEnd(vSparseEnd.begin(), vSparseEnd.end());
     forceClearVector(vSparseStart);
     forceClearVector(vSparseEnd);
-    forceClearVector(vSparseIndex);
-    forceClearVector(vSparseData);
+    return newInputDataSet(dataSetName, width, hashing, vStart, vEnd, vSparseIndex, vSparseData);
+}
+
+/**
+ * Host top K indices of a layer for the current batch, used to compare approximate against exact fp32 predictions.
+ * Restricted evaluations are mapped back from candidate positions to units, padding maps to UINT_MAX.
+ */
+void calculateHostTopK(NNNetwork* pNetwork, const string& layer, unsigned int k, vector<NNFloat>& vUnit, vector<NNFloat>& vKey, vector<unsigned int>& vIndex)
+{
+    NNLayer* pLayer = pNetwork->GetLayer(layer);
+    unsigned int batch = pNetwork->GetBatch();
+    unsigned int candidateStride = pLayer->GetCandidateStride();
+    unsigned int width = (candidateStride > 0) ? candidateStride : pNetwork->GetBufferSize(layer) / batch;
+    vUnit.resize((size_t)batch * width);
+    cudaMemcpy(vUnit.data(), (candidateStride > 0) ? pLayer->GetCandidateUnitBuffer() : pNetwork->GetUnitBuffer(layer), vUnit.size() * sizeof(NNFloat), cudaMemcpyDefault);
+    calculateTopKIndices(vUnit, batch, width, k, vKey, vIndex);
+    if (candidateStride == 0)
+        return;
+
+    unsigned int examples = min(batch, pNetwork->GetExamples() - pNetwork->GetPosition());
+    for (unsigned int i = 0; i < batch; i++) {
+        unsigned int count = 0;
+        const uint32_t* pCandidate = (i < examples) ? pLayer->GetCandidates(pNetwork->GetPosition() + i, count) : NULL;
+        mapCandidateIndices(&vIndex[(size_t)i * k], k, pCandidate, count);
+    }
+}
+
+/**
+ * Loads candidate outputs for restricted evaluation of the recs layer.  Lines follow the samples filter format,
+ * $SAMPLE<tab>$FEATURE:$FEATURE..., values after a comma are ignored.  A line without a sample is a list shared by
+ * every sample that has none of its own.  Unknown samples and features are skipped.
+ */
+bool loadCandidates(const string& candidatesFileName,
+                    unordered_map<string, unsigned int>& mOutput,
+                    unordered_map<string, unsigned int>& mSignals,
+                    vector<uint64_t>& vCandidateStart,
+                    vector<uint64_t>& vCandidateEnd,
+                    vector<uint32_t>& vCandidate)
+{
+    ifstream candidatesFile(candidatesFileName);
+    if (!candidatesFile.good()) {
+        cout << "Error: Cannot read candidates file: " << candidatesFileName << endl;
+        return false;
+    }
+
+    vector<vector<uint32_t> > vSampleCandidates(mSignals.size());
+    vector<uint32_t> vSharedCandidates;
+    bool bPerSample = false;
+    string line;
+    while (getline(candidatesFile, line)) {
+        vector<string> vFields = split(line, '\t');
+        vector<uint32_t>* pCandidates = &vSharedCandidates;
+        string features = line;
+        if (vFields.size() > 1) {
+            unordered_map<string, unsigned int>::iterator sample = mSignals.find(vFields[0]);
+            if (sample == mSignals.end()) {
+                continue;
+            }
+            pCandidates = &vSampleCandidates[sample->second];
+            features = vFields[1];
+            bPerSample = true;
+        }
+        vector<string> vFeatures = split(features, ':');
+        for (size_t i = 0; i < vFeatures.size(); i++) {
+            vector<string> vals = split(vFeatures[i], ',');
+            if (vals.size() > 0) {
+                unordered_map<string, unsigned int>::iterator feature = mOutput.find(vals[0]);
+                if (feature != mOutput.end()) {
+                    pCandidates->push_back(feature->second);
+                }
+            }
+        }
+    }
+
+    vCandidateStart.clear();
+    vCandidateEnd.clear();
+    vCandidate.clear();
+    if (!bPerSample) {
+        vCandidate = vSharedCandidates;
+        vCandidateStart.push_back(0);
+        vCandidateEnd.push_back(vCandidate.size());
+        return true;
+    }
+    for (size_t i = 0; i < vSampleCandidates.size(); i++) {
+        vector<uint32_t>& vList = vSampleCandidates[i].empty() ? vSharedCandidates : vSampleCandidates[i];
+        vCandidateStart.push_back(vCandidate.size());
+        vCandidate.insert(vCandidate.end(), vList.begin(), vList.end());
+        vCandidateEnd.push_back(vCandidate.size());
+    }
+    return true;
 }
 
 void printUsagePredict() {
     cout << "Predict: Generates predictions from a trained neural network given a signals/input dataset." << endl;
-    cout << "Usage: predict -d <dataset_name> -n <network_file> -r <input_text_file> -i <input_feature_index> -o <output_feature_index> -f <filters_json> [-b <batch_size>] [-k <num_recs>] [-l layer] [-s input_signals_index] [-p score_precision]" << endl;
+    cout << "Usage: predict -d <dataset_name> -n <network_file> -r <input_text_file> -i <input_feature_index> -o <output_feature_index> -f <filters_json> [-a <hash_buckets> [-j <num_hashes>] [-g]] [-b <batch_size>] [-k <num_recs>] [-l layer] [-s input_signals_index] [-p score_precision] [-t topk_device] [-q calibration_examples] [-m index_file [-u lists] [-e probes]] [-c] [-w weight_precision] [-x candidates_file] [-v node_filter] [-y segment_filters -z sample_segments] [-F recs_format] [-S chunk_samples] [-E ensemble_weights] [-R]" << endl;
+    cout << "    -a hash_buckets: hash input features into this many inputs instead of using input_feature_index. Must match generateNetCDF -a for the training data." << endl;
     cout << "    -b batch_size: (default = 1024) the number records/input rows to process in a batch." << endl;
+    cout << "    -c: with -q or -m, also run exact fp32 predictions and report recall@num_recs of the approximate predictions against them. With -q only the examples after the calibration set are compared." << endl;
     cout << "    -d dataset_name: (required) name for the dataset within the netcdf file." << endl;
-    cout << "    -f samples filterFileName ." << endl;
-    cout << "    -i input_feature_index: (required) path to the feature index file, used to tranform input signals to correct input feature vector." << endl;
+    cout << "    -E ensemble_weights: (default = equal weights summing to 1) with several network files, comma separated weight of each network's scores." << endl;
+    cout << "    -e probes: (default = stored in index_file) index lists searched per sample with -m. More probes raise recall and latency." << endl;
+    cout << "    -f samples filterFileName, or a filters.json of several {\"sampleFilters\", \"nodeFilters\", \"outputFile\"} configurations, all scored from one prediction of each batch. An entry without outputFile writes to -s, one without nodeFilters uses -v." << endl;
+    cout << "    -F recs_format: (default = text) text, fp32 or fp16. fp32 and fp16 write fixed width binary records of sample, item and score numbers instead of text, recsToText converts them back." << endl;
+    cout << "    -g: with -a, signed hashing, must match generateNetCDF -g for the training data." << endl;
+    cout << "    -i input_feature_index: (required unless -a is set) path to the feature index file, used to tranform input signals to correct input feature vector." << endl;
+    cout << "    -j num_hashes: (default = 1) with -a, the number of buckets each feature is hashed to." << endl;
     cout << "    -k num_recs: (default = 100) The number of predictions (sorted by score to generate). Ignored if -l flag is used." << endl;
     cout << "    -l layer: (default = Output) the network layer to use for predictions. If specified, the raw scores for each node in the layer is output in order." << endl;
-    cout << "    -n network_file: (required) the trained neural network in NetCDF file." << endl;
+    cout << "    -m index_file: score only the output features retrieved from this approximate top K index. Single process only." << endl;
+    cout << "    -n network_file: (required) the trained neural network in NetCDF file. Several comma separated networks with the same input and output feature indices are predicted as an ensemble over one parsed input, their scores are combined before filtering and top K. Ensembles cannot be combined with -c, -m or -x." << endl;
     cout << "    -o output_feature_index: (required) path to the feature index file, used to tranform the network output feature vector to appropriate features." << endl;
     cout << "    -p score_precision: (default = 4.3f) precision of the scores in output" << endl;
+    cout << "    -q calibration_examples: quantize fully connected weights to INT8 after calibrating on the first calibration_examples inputs. Host builds only." << endl;
+    cout << "    -R: combine ensemble scores by weighted reciprocal rank fusion instead of a weighted sum. Single process only." << endl;
     cout << "    -r input_text_file: (required) path to the file with input signal to use to generate predictions (i.e. recommendations)." << endl;
     cout << "    -s filename (required) . to put the output recs to." << endl;
+    cout << "    -S chunk_samples: stream input_text_file and the samples filter chunk_samples samples at a time, so memory does not grow with the input. The filter must list samples in input order. No samples index is written. Single process, text recs only, cannot be combined with -c, -q, -x or -y." << endl;
+    cout << "    -t topk_device: (default = gpu) where to select the top num_recs, gpu or host. host has no limit on num_recs and is used automatically when num_recs >= 128." << endl;
+    cout << "    -u lists: build index_file from the Output weights with this many lists before predicting, instead of loading it." << endl;
+    cout << "    -v node_filter: features filtered for every sample, $FEATURE,$VALUE:$FEATURE,$VALUE per line. The score is multiplied by the value, a feature without a value is never recommended." << endl;
+    cout << "    -w weight_precision: (default = fp32) fp32, fp16 or bf16 storage for fully connected weights, accumulation stays fp32. Host builds only." << endl;
+    cout << "    -x candidates_file: only score these output features, one line per sample as $SAMPLE<tab>$FEATURE:$FEATURE... or one shared line of features. Single process only." << endl;
+    cout << "    -y segment_filters: features filtered for every sample of a segment, $SEGMENT<tab>$FEATURE,$VALUE:$FEATURE,$VALUE per line, on top of node_filter." << endl;
+    cout << "    -z sample_segments: the segment of each sample for -y, one line per sample as $SAMPLE<tab>$SEGMENT." << endl;
     cout << endl;
 }
 
@@ -131,17 +260,44 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    string inputIndexFileName = getRequiredArgValue(argc, argv, "-i", "input features index file is not specified.", &printUsagePredict);
-    if (! fileExists(inputIndexFileName)) {
+    FeatureHashing hashing(stoi(getOptionalArgValue(argc, argv, "-a", "0")),
+                           stoi(getOptionalArgValue(argc, argv, "-j", "1")),
+                           isArgSet(argc, argv, "-g"));
+    if (hashing.buckets > 0 && hashing.hashes == 0) {
+        cout << "Error: num_hashes (-j) must be at least 1." << endl;
+        return 1;
+    }
+    string inputIndexFileName = (hashing.buckets > 0) ? "" :
+        getRequiredArgValue(argc, argv, "-i", "input features index file is not specified.", &printUsagePredict);
+    if ((hashing.buckets == 0) && ! fileExists(inputIndexFileName)) {
         cout << "Error: Cannot read input feature index file: " << inputIndexFileName << endl;
         return 1;
     }
 
     string networkFileName = getRequiredArgValue(argc, argv, "-n", "network file is not specified.", &printUsagePredict);
-    if (! fileExists(networkFileName)) {
-        cout << "Error: Cannot read network file: " << networkFileName << endl;
+    vector<string> vNetworkFileName = split(networkFileName, ',');
+    for (size_t i = 0; i < vNetworkFileName.size(); i++) {
+        if (! fileExists(vNetworkFileName[i])) {
+            cout << "Error: Cannot read network file: " << vNetworkFileName[i] << endl;
+            return 1;
+        }
+    }
+    if (vNetworkFileName.empty()) {
+        cout << "Error: network file is not specified." << endl;
         return 1;
     }
+    vector<NNFloat> vEnsembleWeight(vNetworkFileName.size(), (NNFloat)1.0 / vNetworkFileName.size());
+    if (isArgSet(argc, argv, "-E")) {
+        vector<string> vWeight = split(getOptionalArgValue(argc, argv, "-E", ""), ',');
+        if (vWeight.size() != vNetworkFileName.size()) {
+            cout << "Error: -E needs one weight per network file, got " << vWeight.size() << " for " << vNetworkFileName.size() << endl;
+            return 1;
+        }
+        for (size_t i = 0; i < vWeight.size(); i++) {
+            vEnsembleWeight[i] = stof(vWeight[i]);
+        }
+    }
+    bool bRankFusion = isArgSet(argc, argv, "-R");
 
     string outputIndexFileName = getRequiredArgValue(argc, argv, "-o", "output features index file is not specified.", &printUsagePredict);
     if (! fileExists(outputIndexFileName)) {
@@ -163,59 +319,159 @@ int main(int argc, char** argv)
     unsigned int batchSize =  stoi(getOptionalArgValue(argc, argv, "-b", "1024"));
 
     unsigned int topK =  stoi(getOptionalArgValue(argc, argv, "-k", "100"));
-    if (topK >=128 ) {
-	cout << "Error :Optimized topk Only works for top 128 . "<< topK<< " is greater" <<endl;
+    string topKDevice = getOptionalArgValue(argc, argv, "-t", "gpu");
+    if (topKDevice != "gpu" && topKDevice != "host") {
+	cout << "Error: Unknown topk_device " << topKDevice << ", must be gpu or host" << endl;
 	return 1;
     }
+    bool bHostTopK = (topKDevice == "host");
+    if (topK >=128 && !bHostTopK) {
+	cout << "Info: Optimized gpu topk only works for top 128, " << topK << " is greater. Using host topk" << endl;
+	bHostTopK = true;
+    }
 
     string scoreFormat = getOptionalArgValue(argc, argv, "-p", NNRecsGenerator::DEFAULT_SCORE_PRECISION);
+    string recsFormatName = getOptionalArgValue(argc, argv, "-F", "text");
+    RecsFormat recsFormat = RecsText;
+    if (recsFormatName == "fp32") {
+        recsFormat = RecsFP32;
+    } else if (recsFormatName == "fp16") {
+        recsFormat = RecsFP16;
+    } else if (recsFormatName != "text") {
+        cout << "Error: Unknown recs_format " << recsFormatName << ", must be text, fp32 or fp16" << endl;
+        return 1;
+    }
+
+    bool bQuantize = isArgSet(argc, argv, "-q");
+    unsigned int calibrationExamples = stoi(getOptionalArgValue(argc, argv, "-q", "1024"));
+    bool bParity = isArgSet(argc, argv, "-c");
+    string weightPrecision = getOptionalArgValue(argc, argv, "-w", "fp32");
+    if (weightPrecision != "fp32" && weightPrecision != "fp16" && weightPrecision != "bf16") {
+        cout << "Error: Unknown weight_precision " << weightPrecision << ", must be fp32, fp16 or bf16" << endl;
+        return 1;
+    }
+    string indexFileName = getOptionalArgValue(argc, argv, "-m", "");
+    bool bBuildIndex = isArgSet(argc, argv, "-u");
+    unsigned int indexLists = stoi(getOptionalArgValue(argc, argv, "-u", "1024"));
+    bool bProbes = isArgSet(argc, argv, "-e");
+    unsigned int indexProbes = stoi(getOptionalArgValue(argc, argv, "-e", "8"));
+    if ((bBuildIndex || bProbes) && indexFileName == "") {
+        cout << "Error: -u and -e require -m index_file" << endl;
+        return 1;
+    }
+    if (bParity && !bQuantize && indexFileName == "") {
+        cout << "Error: -c requires -q calibration_examples or -m index_file" << endl;
+        return 1;
+    }
+    string candidatesFileName = getOptionalArgValue(argc, argv, "-x", "");
+    if (candidatesFileName != "" && bParity) {
+        cout << "Error: -c compares full output layers and cannot be combined with -x" << endl;
+        return 1;
+    }
+    if (candidatesFileName != "" && indexFileName != "") {
+        cout << "Error: -x and -m both choose the output features to score and cannot be combined" << endl;
+        return 1;
+    }
+    // Each of these changes which units of the output layer a network computes
+    if (vNetworkFileName.size() > 1 && (bParity || indexFileName != "" || candidatesFileName != "")) {
+        cout << "Error: an ensemble of networks cannot be combined with -c, -m or -x" << endl;
+        return 1;
+    }
+    string nodeFilterFileName = getOptionalArgValue(argc, argv, "-v", "");
+    if (nodeFilterFileName != "" && ! fileExists(nodeFilterFileName)) {
+        cout << "Error: Cannot read node filter file: " << nodeFilterFileName << endl;
+        return 1;
+    }
+    string segmentFilterFileName = getOptionalArgValue(argc, argv, "-y", "");
+    string sampleSegmentFileName = getOptionalArgValue(argc, argv, "-z", "");
+    if ((segmentFilterFileName == "") != (sampleSegmentFileName == "")) {
+        cout << "Error: -y segment_filters and -z sample_segments must be given together" << endl;
+        return 1;
+    }
+    bool bStream = isArgSet(argc, argv, "-S");
+    unsigned int chunkSamples = stoi(getOptionalArgValue(argc, argv, "-S", "1000000"));
+    if (bStream) {
+        // Each of these needs every sample up front
+        if (bQuantize || bParity || candidatesFileName != "" || segmentFilterFileName != "" || recsFormat != RecsText) {
+            cout << "Error: -S cannot be combined with -c, -q, -x, -y or binary recs_format" << endl;
+            return 1;
+        }
+        if (chunkSamples == 0) {
+            cout << "Error: chunk_samples (-S) must be at least 1" << endl;
+            return 1;
+        }
+        if (!isFile(filtersFileName) || SamplesFilter::isCompiledFilter(filtersFileName) || isFilterConfigFile(filtersFileName)) {
+            cout << "Error: -S reads the samples filter as it goes and needs a single text filter file, not " << filtersFileName << endl;
+            return 1;
+        }
+    }
 
 
     // Initialize GPU network
     getGpu().Startup(argc, argv);
     getGpu().SetRandomSeed(FIXED_SEED);
+    if (bStream && getGpu()._numprocs > 1) {
+        cout << "Error: -S is single process only" << endl;
+        getGpu().Shutdown();
+        return 1;
+    }
 
     // Start timing loading of data and network.
     timeval timePreProcessingStart;
     gettimeofday(&timePreProcessingStart, NULL);
 
     unordered_map<string, unsigned int> mInput;
-    cout << "Loading input feature index from: " << inputIndexFileName << endl;
-    if (!loadIndexFromFile(mInput, inputIndexFileName, cout)) {
-        exit(1);
+    if (hashing.buckets > 0) {
+        cout << "Hashing input features into " << hashing.buckets << " buckets" << endl;
+    } else {
+        cout << "Loading input feature index from: " << inputIndexFileName << endl;
+        if (!loadIndexFromFile(mInput, inputIndexFileName, cout)) {
+            exit(1);
+        }
     }
 
-    // Load the dataset text file and geneate the NetCDF
+    // Load the dataset text file straight into memory
     unordered_map<string, unsigned int> mSignals;
-    string inputNetCDFFileName;
 
     // Ensure we don't override other dataset files (i.e. from training)
     string dataSetFilesPrefix = dataSetName + "_predict";
-    inputNetCDFFileName.assign(dataSetFilesPrefix + NETCDF_FILE_EXTENTION);
 
     string featureIndexFile = dataSetFilesPrefix + ".featuresIndex";
     string sampleIndexFile = dataSetFilesPrefix + ".samplesIndex";
-    convertTextToNetCDF(recsFileName,
-		    dataSetName,
-		    inputNetCDFFileName,
-		    mInput,
-		    mSignals,
-		    featureIndexFile,
-		    sampleIndexFile);
-    // TODO: We should look at avoiding generating/re-reading the netCDF since we have parsed it.
-    // TODO: convertTextToNetCDF needs a better name. Now it parse the text into NetCDF file and write them out. A function should have all input/output
-    // variables defined in the interface
+    vector <NNDataSetBase*> vDataSetInput;
+    if (!bStream) {
+        vDataSetInput.push_back(loadTextDataSet(recsFileName,
+		        dataSetName,
+		        mInput,
+		        mSignals,
+		        featureIndexFile,
+		        sampleIndexFile,
+		        hashing));
+    }
 
     // Load the filter set
-    if(getGpu()._id == 0 ){
-        cout << "Number of network input nodes: " << mInput.size() << endl;
+    if(getGpu()._id == 0 && !bStream){
+        cout << "Number of network input nodes: " << ((hashing.buckets > 0) ? hashing.buckets : mInput.size()) << endl;
         cout << "Number of entries to generate predictions for: " << mSignals.size() << endl;
         CWMetric::updateMetrics("Signals_Size", mSignals.size());
     }
 
-    vector <NNDataSetBase*> vDataSetInput = LoadNetCDF(inputNetCDFFileName);
-    NNNetwork* pNetwork = LoadNeuralNetworkNetCDF(networkFileName, batchSize);
-    pNetwork->LoadDataSets(vDataSetInput);
+    // Every network of an ensemble shares the one input dataset
+    vector<NNNetwork*> vNetwork;
+    for (size_t i = 0; i < vNetworkFileName.size(); i++) {
+        NNNetwork* pMember = LoadNeuralNetworkNetCDF(vNetworkFileName[i], batchSize);
+        vNetwork.push_back(pMember);
+        pMember->LoadDataSets(vDataSetInput);
+        if (weightPrecision != "fp32" && !pMember->SetWeightPrecision(weightPrecision == "fp16" ? NNWeight::FP16 : NNWeight::BF16)) {
+            cout << "Error: Unable to set weight precision " << weightPrecision << endl;
+            return 1;
+        }
+        if (bQuantize && !pMember->Quantize(calibrationExamples)) {
+            cout << "Error: Unable to quantize network " << vNetworkFileName[i] << endl;
+            return 1;
+        }
+    }
+    NNNetwork* pNetwork = vNetwork[0];
 
     // Generate an ordered vector of the signals/samples index, so that output are correctly labeled.
     vector<string> vSignals(mSignals.size());
@@ -231,10 +487,50 @@ int main(int argc, char** argv)
     
     vector<string> vOutput(mOutput.size());
     extractNNMapsToVectors(vOutput, mOutput);
-    FilterConfig* vFilterSet = loadFilters(filtersFileName,recsOutputFileName, mOutput, mSignals);
-    // Delete the unwanted memory
-    mInput.clear();
-    mOutput.clear();
+    // Streamed chunks bring their own sample filters
+    vector<FilterConfig*> vFilterSet = loadFilterConfigs(bStream ? "" : filtersFileName,recsOutputFileName, mOutput, mSignals,
+                                                         nodeFilterFileName, segmentFilterFileName, sampleSegmentFileName);
+    if (candidatesFileName != "") {
+        vector<uint64_t> vCandidateStart, vCandidateEnd;
+        vector<uint32_t> vCandidate;
+        cout << "Loading candidates from: " << candidatesFileName << endl;
+        if (!loadCandidates(candidatesFileName, mOutput, mSignals, vCandidateStart, vCandidateEnd, vCandidate) ||
+            !pNetwork->SetCandidates("Output", vCandidateStart, vCandidateEnd, vCandidate)) {
+            cout << "Error: Unable to set candidates from " << candidatesFileName << endl;
+            return 1;
+        }
+    }
+    NNIndex* pIndex = NULL;
+    if (indexFileName != "") {
+        if (bBuildIndex) {
+            cout << "Building index with " << indexLists << " lists into: " << indexFileName << endl;
+            pIndex = pNetwork->BuildIndex("Output", indexLists);
+            if (pIndex != NULL && !pIndex->Save(indexFileName)) {
+                return 1;
+            }
+        } else {
+            cout << "Loading index from: " << indexFileName << endl;
+            pIndex = NNIndex::Load(indexFileName);
+        }
+        if (pIndex != NULL && bProbes) {
+            pIndex->SetProbes(indexProbes);
+        }
+        if (pIndex == NULL || !pNetwork->SetIndex("Output", pIndex)) {
+            cout << "Error: Unable to use index " << indexFileName << endl;
+            return 1;
+        }
+        cout << "Searching " << pIndex->GetProbes() << " of " << pIndex->GetLists() << " index lists per sample" << endl;
+    }
+    unsigned int inputWidth = roundUpMaxIndex((hashing.buckets > 0) ? hashing.buckets : mInput.size());
+    SampleStream* pStream = NULL;
+    if (bStream) {
+        cout << "Streaming " << recsFileName << " in chunks of " << chunkSamples << " samples" << endl;
+        pStream = new SampleStream(recsFileName, filtersFileName, chunkSamples, mInput, mOutput, hashing);
+    } else {
+        // Delete the unwanted memory, the stream keeps using the indices
+        mInput.clear();
+        mOutput.clear();
+    }
     mSignals.clear();
 
     timeval timePreProcessingEnd;
@@ -249,38 +545,130 @@ int main(int argc, char** argv)
     unsigned int lBatch            = pNetwork->GetBatch();
     unsigned int outputBufferSize  = pNetwork->GetBufferSize(recsGenLayerLabel);
 
-    NNRecsGenerator *nnRecsGenerator = new NNRecsGenerator(lBatch, topK, outputBufferSize, recsGenLayerLabel, scoreFormat);
+    NNRecsGenerator *nnRecsGenerator = new NNRecsGenerator(lBatch, topK, outputBufferSize, recsGenLayerLabel, scoreFormat, bHostTopK, recsFormat);
+
+    // The ensemble combines into the first network's output, recs are generated from it as for a single network
+    NNEnsemble* pEnsemble = NULL;
+    if (vNetwork.size() > 1) {
+        try {
+            pEnsemble = new NNEnsemble(vNetwork, vEnsembleWeight, bRankFusion ? NNEnsemble::RankFusion : NNEnsemble::WeightedSum,
+                                       recsGenLayerLabel, topK * NNRecsGenerator::TOPK_SCALAR);
+        } catch (const std::invalid_argument &e) {
+            cout << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
 
     timeval timeRecsGenerationStart;
     gettimeofday(&timeRecsGenerationStart, NULL);
 
+    // Approximate (INT8 and/or index) recall against exact fp32, INT8 is measured only on examples not used for calibration
+    vector<NNFloat> vParityUnit, vParityKey;
+    vector<unsigned int> vReferenceIndex, vApproximateIndex;
+    unsigned long long int parityMatches = 0;
+    unsigned long long int parityExamples = 0;
+
     timeval timeProgressReporterStart;
     gettimeofday(&timeProgressReporterStart, NULL);
-    for (unsigned long long int pos = 0; pos < pNetwork->GetExamples(); pos += pNetwork->GetBatch())
-    {
-        cout << "Predicting from position "<< pos << endl;
-
-        pNetwork->SetPosition(pos);
-        pNetwork->PredictBatch();
-        nnRecsGenerator->generateRecs(pNetwork, topK, vFilterSet, vSignals, vOutput);
-        if((pos % INTERVAL_REPORT_PROGRESS) < pNetwork->GetBatch()  && (pos/INTERVAL_REPORT_PROGRESS) > 0 && getGpu()._id == 0) {
-            timeval timeProgressReporterEnd;
-            gettimeofday(&timeProgressReporterEnd, NULL);
-	    cout << "Elapsed time after " << pos <<" is "<<elapsed_time(timeProgressReporterEnd, timeProgressReporterStart)<<endl;
-            CWMetric::updateMetrics("Prediction_Time_Progress", elapsed_time(timeProgressReporterEnd, timeProgressReporterStart));
-            CWMetric::updateMetrics("Prediction_Progress",(unsigned int)pos);
-            gettimeofday(&timeProgressReporterStart,NULL);
+    unsigned long long int examples = 0;
+    SampleChunk* pChunk = NULL;
+    while (true) {
+        if (pStream != NULL) {
+            // Parsing runs ahead on the stream's thread, at most one chunk is predicted and QUEUE_DEPTH more are waiting
+            SampleChunk* pNext = NULL;
+            try {
+                pNext = pStream->next();
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << endl;
+                return 1;
+            }
+            // The writer labels recs with the samples of the previous chunk until they are all written
+            nnRecsGenerator->flush();
+            vFilterSet[0]->setSamplesFilter(NULL);
+            delete pChunk;
+            for (size_t i = 0; i < vNetwork.size(); i++)
+                vNetwork[i]->ClearDataSets();
+            for (size_t d = 0; d < vDataSetInput.size(); d++)
+                delete vDataSetInput[d];
+            vDataSetInput.clear();
+            pChunk = pNext;
+            if (pChunk == NULL)
+                break;
+            vSignals.swap(pChunk->vSamples);
+            vFilterSet[0]->setSamplesFilter(pChunk->pSamplesFilter);
+            vDataSetInput.push_back(newInputDataSet(dataSetName, inputWidth, hashing, pChunk->vSparseStart, pChunk->vSparseEnd, pChunk->vSparseIndex, pChunk->vSparseData));
+            for (size_t i = 0; i < vNetwork.size(); i++)
+                vNetwork[i]->LoadDataSets(vDataSetInput);
+            cout << "Predicting " << vSignals.size() << " samples from sample " << pChunk->firstSample << endl;
         }
+        for (unsigned long long int pos = 0; pos < pNetwork->GetExamples(); pos += pNetwork->GetBatch())
+        {
+            cout << "Predicting from position "<< pos << endl;
+
+            pNetwork->SetPosition(pos);
+            bool bParityBatch = bParity && (!bQuantize || pos >= calibrationExamples);
+            if (bParityBatch) {
+                if (bQuantize)
+                    pNetwork->SetQuantized(false);
+                if (pIndex != NULL)
+                    pNetwork->SetIndex(recsGenLayerLabel, NULL);
+                pNetwork->PredictBatch();
+                calculateHostTopK(pNetwork, recsGenLayerLabel, topK, vParityUnit, vParityKey, vReferenceIndex);
+                if (bQuantize)
+                    pNetwork->SetQuantized(true);
+                if (pIndex != NULL)
+                    pNetwork->SetIndex(recsGenLayerLabel, pIndex);
+            }
+            if (pEnsemble != NULL)
+                pEnsemble->predictBatch();
+            else
+                pNetwork->PredictBatch();
+            if (bParityBatch) {
+                calculateHostTopK(pNetwork, recsGenLayerLabel, topK, vParityUnit, vParityKey, vApproximateIndex);
+                unsigned int batch = min((unsigned long long int)pNetwork->GetBatch(), pNetwork->GetExamples() - pos);
+                parityMatches += countTopKMatches(vReferenceIndex, vApproximateIndex, batch, topK);
+                parityExamples += batch;
+            }
+            nnRecsGenerator->generateRecs(pNetwork, topK, vFilterSet, vSignals, vOutput);
+            if((pos % INTERVAL_REPORT_PROGRESS) < pNetwork->GetBatch()  && (pos/INTERVAL_REPORT_PROGRESS) > 0 && getGpu()._id == 0) {
+                timeval timeProgressReporterEnd;
+                gettimeofday(&timeProgressReporterEnd, NULL);
+                cout << "Elapsed time after " << pos <<" is "<<elapsed_time(timeProgressReporterEnd, timeProgressReporterStart)<<endl;
+                CWMetric::updateMetrics("Prediction_Time_Progress", elapsed_time(timeProgressReporterEnd, timeProgressReporterStart));
+                CWMetric::updateMetrics("Prediction_Progress",(unsigned int)pos);
+                gettimeofday(&timeProgressReporterStart,NULL);
+            }
 
+        }
+        examples += pNetwork->GetExamples();
+        if (pStream == NULL)
+            break;
     }
+    // Recs of the last batches may still be with the writer
+    nnRecsGenerator->flush();
     timeval timeRecsGenerationEnd;
     gettimeofday(&timeRecsGenerationEnd, NULL);
     if (getGpu()._id == 0) {
         CWMetric::updateMetrics("Prediction_Time", elapsed_time(timeRecsGenerationEnd, timeRecsGenerationStart));
-        cout << "Total time for Generating recs for " << pNetwork->GetExamples() << " was " <<  elapsed_time(timeRecsGenerationEnd, timeRecsGenerationStart) << endl;}
+        cout << "Total time for Generating recs for " << examples << " was " <<  elapsed_time(timeRecsGenerationEnd, timeRecsGenerationStart) << endl;
+        if (bParity) {
+            string approximation = bQuantize ? (pIndex != NULL ? "INT8 + index" : "INT8") : "Index";
+            if (parityExamples > 0)
+                cout << approximation << " recall@" << topK << " against exact fp32 on " << parityExamples << " examples: " << (double)parityMatches / ((double)parityExamples * topK) << endl;
+            else
+                cout << approximation << " parity: no examples after the " << calibrationExamples << " used for calibration" << endl;
+        }
+    }
 
+    if (pStream != NULL && pStream->getUnmatchedFilters() > 0) {
+        cout << "Warning: " << pStream->getUnmatchedFilters() << " samples filter lines matched no streamed sample, the filter must follow the order of the input" << endl;
+    }
+    delete pStream;
     delete(nnRecsGenerator);
-    delete pNetwork;
+    delete pEnsemble;
+    for (size_t i = 0; i < vNetwork.size(); i++)
+        delete vNetwork[i];
+    delete pIndex;
     getGpu().Shutdown();
     return 0;
 }
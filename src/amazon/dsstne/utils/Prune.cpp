@@ -0,0 +1,137 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <netcdf>
+#include <sys/time.h>
+#include <stdexcept>
+
+#include "GpuTypes.h"
+#include "NetCDFhelper.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+using namespace std;
+
+void printUsagePrune() {
+    cout << "Prune: Magnitude prunes the fully connected weights of a trained network." << endl;
+    cout << "Usage: prune -n <network_file> -o <output_network_file> [-t <threshold>] [-k <keep_fraction>] [-l <input_layer>:<output_layer>] [-i <input_netcdf>] [-b <batch_size>]" << endl;
+    cout << "    -n network_file: (required) the trained neural network in NetCDF file." << endl;
+    cout << "    -o output_network_file: (required) the pruned neural network NetCDF file to write." << endl;
+    cout << "    -t threshold: (default = 0) blocks of 8 outputs whose largest weight magnitude is below threshold are removed." << endl;
+    cout << "    -k keep_fraction: (default = 1) fraction of the remaining blocks kept, the ones with the largest norms." << endl;
+    cout << "    -l input_layer:output_layer: (default = all) only prune the weights between these two layers." << endl;
+    cout << "    -i input_netcdf: (optional) dataset used to time predictions with the dense and pruned weights." << endl;
+    cout << "    -b batch_size: (default = 1024) the number records/input rows to process in a batch when timing." << endl;
+    cout << endl;
+}
+
+// Seconds to predict every example of the loaded data sets
+static double timePredictions(NNNetwork* pNetwork) {
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (uint32_t pos = 0; pos < pNetwork->GetExamples(); pos += pNetwork->GetBatch()) {
+        pNetwork->SetPosition(pos);
+        pNetwork->PredictBatch();
+    }
+    gettimeofday(&end, NULL);
+    return elapsed_time(end, start);
+}
+
+/**
+Samples argument
+./prune -n network.nc -o pruned.nc -t 0.01 -k 0.1 -i input.nc
+
+removes every block of 8 outputs with no weight above 0.01 in magnitude, then keeps 10% of the remaining
+blocks of each fully connected weight matrix, and reports the prediction time over input.nc before and after
+*/
+int main(int argc, char** argv)
+{
+    if (isArgSet(argc, argv, "-h")) {
+        printUsagePrune();
+        exit(1);
+    }
+
+    string networkFileName = getRequiredArgValue(argc, argv, "-n", "network file is not specified.", &printUsagePrune);
+    if (! fileExists(networkFileName)) {
+        cout << "Error: Cannot read network file: " << networkFileName << endl;
+        return 1;
+    }
+
+    string outputFileName = getRequiredArgValue(argc, argv, "-o", "output network file is not specified.", &printUsagePrune);
+    if (fileExists(outputFileName)) {
+        cout << "Error: Output network file already exists: " << outputFileName << endl;
+        return 1;
+    }
+
+    NNFloat threshold = stof(getOptionalArgValue(argc, argv, "-t", "0"));
+    NNFloat keepFraction = stof(getOptionalArgValue(argc, argv, "-k", "1"));
+    if ((threshold < (NNFloat)0.0) || (keepFraction < (NNFloat)0.0) || (keepFraction > (NNFloat)1.0)) {
+        cout << "Error: threshold must be non-negative and keep_fraction between 0 and 1." << endl;
+        return 1;
+    }
+
+    string layers = getOptionalArgValue(argc, argv, "-l", "");
+    string inputLayer, outputLayer;
+    if (layers != "") {
+        size_t colon = layers.find(':');
+        if (colon == string::npos) {
+            cout << "Error: Expected -l input_layer:output_layer, got " << layers << endl;
+            return 1;
+        }
+        inputLayer = layers.substr(0, colon);
+        outputLayer = layers.substr(colon + 1);
+    }
+
+    string inputDataFile = getOptionalArgValue(argc, argv, "-i", "");
+    if ((inputDataFile != "") && ! fileExists(inputDataFile)) {
+        cout << "Error: Cannot read input data file: " << inputDataFile << endl;
+        return 1;
+    }
+    unsigned int batchSize = stoi(getOptionalArgValue(argc, argv, "-b", "1024"));
+
+    getGpu().Startup(argc, argv);
+    getGpu().SetRandomSeed(FIXED_SEED);
+    NNNetwork* pNetwork = LoadNeuralNetworkNetCDF(networkFileName, batchSize);
+
+    double denseTime = 0.0;
+    if (inputDataFile != "") {
+        vector<NNDataSetBase*> vDataSetInput = LoadNetCDF(inputDataFile);
+        pNetwork->LoadDataSets(vDataSetInput);
+        denseTime = timePredictions(pNetwork);
+    }
+
+    bool bResult = (inputLayer != "") ? pNetwork->Prune(inputLayer, outputLayer, threshold, keepFraction) : pNetwork->Prune(threshold, keepFraction);
+    if (!bResult) {
+        cout << "Error: Unable to prune network " << networkFileName << endl;
+        delete pNetwork;
+        getGpu().Shutdown();
+        return 1;
+    }
+
+    // Pruned weights only run block sparse on host builds
+    if (inputDataFile != "") {
+        double prunedTime = timePredictions(pNetwork);
+        cout << "Prediction time over " << pNetwork->GetExamples() << " examples: " << denseTime << " s dense, " << prunedTime << " s pruned" << endl;
+    }
+
+    pNetwork->SaveNetCDF(outputFileName);
+    cout << "Pruned network written to " << outputFileName << endl;
+    delete pNetwork;
+    getGpu().Shutdown();
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstring>
+#include <stdexcept>
+
+#include "HostHalf.h"
+#include "RecsFile.h"
+
+const char RECS_FILE_MAGIC[8] = {'D', 'S', 'S', 'T', 'N', 'E', 'R', 'C'};
+const uint32_t RECS_FILE_VERSION = 1;
+const uint32_t RECS_NO_ITEM = 0xffffffff;
+
+// Records are read through a buffer of this size
+static const size_t RECS_READ_BUFFER_BYTES = 16 * 1024 * 1024;
+
+RecsReader::RecsReader(const string &xFileName) :
+    fileName(xFileName),
+    records(0)
+{
+    fp = fopen(fileName.c_str(), "rb");
+    if (fp == NULL) {
+        throw std::invalid_argument("unable to open recs file " + fileName);
+    }
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, RECS_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != RECS_FILE_VERSION || (header.scoreBytes != sizeof(float) && header.scoreBytes != sizeof(uint16_t))) {
+        fclose(fp);
+        throw std::invalid_argument(fileName + " is not a binary recs file");
+    }
+    setvbuf(fp, NULL, _IOFBF, RECS_READ_BUFFER_BYTES);
+    fseek(fp, 0, SEEK_END);
+    records = ((uint64_t)ftell(fp) - sizeof(header)) / header.getRecordBytes();
+    fseek(fp, sizeof(header), SEEK_SET);
+    vRecord.resize(header.getRecordBytes());
+}
+
+RecsReader::~RecsReader()
+{
+    fclose(fp);
+}
+
+bool RecsReader::read(uint32_t &sample, uint32_t* pItems, float* pScores)
+{
+    size_t bytes = fread(vRecord.data(), 1, vRecord.size(), fp);
+    if (bytes == 0) {
+        return false;
+    }
+    if (bytes != vRecord.size()) {
+        throw std::runtime_error("truncated record in recs file " + fileName);
+    }
+    const char* p = vRecord.data();
+    memcpy(&sample, p, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+    memcpy(pItems, p, header.k * sizeof(uint32_t));
+    p += header.k * sizeof(uint32_t);
+    if (header.scoreBytes == sizeof(float)) {
+        memcpy(pScores, p, header.k * sizeof(float));
+    } else {
+        for (uint32_t x = 0; x < header.k; x++) {
+            uint16_t h;
+            memcpy(&h, p + x * sizeof(uint16_t), sizeof(uint16_t));
+            pScores[x] = hHalfToFloat(h);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#ifndef RECS_FILE_H
+#define RECS_FILE_H
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+Binary recs files, written by predict -F fp32 or -F fp16.  A RecsFileHeader is followed by fixed width
+records, one per sample:
+
+    uint32_t sample;            the sample's number in the samples index
+    uint32_t items[k];          feature index numbers, best first, RECS_NO_ITEM past the last rec
+    float or fp16 scores[k];    score of each item, 0 past the last rec
+
+All values are little endian
+*/
+enum RecsFormat
+{
+    RecsText,
+    RecsFP32,
+    RecsFP16,
+};
+
+struct RecsFileHeader
+{
+    char magic[8];              // RECS_FILE_MAGIC
+    uint32_t version;
+    uint32_t k;                 // items per record
+    uint32_t scoreBytes;        // 4 for fp32 scores, 2 for fp16
+    uint32_t reserved;
+    uint64_t samples;           // size of the samples index the records refer to
+    uint64_t features;          // size of the feature index the items refer to
+
+    uint64_t getRecordBytes() const
+    {
+        return sizeof(uint32_t) + (uint64_t)k * (sizeof(uint32_t) + scoreBytes);
+    }
+};
+
+extern const char RECS_FILE_MAGIC[8];
+extern const uint32_t RECS_FILE_VERSION;
+extern const uint32_t RECS_NO_ITEM;
+
+/**
+Reads binary recs files record by record, scores are returned as floats whatever their width on disk
+*/
+class RecsReader
+{
+private:
+    string fileName;
+    FILE* fp;
+    RecsFileHeader header;
+    uint64_t records;
+    vector<char> vRecord;
+
+public:
+    // Throws std::invalid_argument if the file cannot be read or is not a recs file
+    RecsReader(const string &fileName);
+
+    ~RecsReader();
+
+    const RecsFileHeader& getHeader() const
+    {
+        return header;
+    }
+
+    uint64_t getRecords() const
+    {
+        return records;
+    }
+
+    /**
+    Reads the next record into pItems and pScores, k entries each.  Returns false at the end of the
+    file, throws std::runtime_error on a truncated record
+    */
+    bool read(uint32_t &sample, uint32_t* pItems, float* pScores);
+};
+#endif
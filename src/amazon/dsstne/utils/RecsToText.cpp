@@ -0,0 +1,121 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdexcept>
+#include <sys/time.h>
+
+#include "Utils.h"
+#include "NetCDFhelper.h"
+#include "NNRecsGenerator.h"
+#include "RecsFile.h"
+#include "RecsWriter.h"
+
+using namespace std;
+
+void printUsageRecsToText() {
+    cout << "RecsToText: Converts binary recs written by predict -F fp32 or -F fp16 to predict's text output." << endl;
+    cout << "Usage: recsToText -r <recs_file> -o <output_feature_index> -s <samples_index> -t <text_file> [-p score_precision]" << endl;
+    cout << "    -o output_feature_index: (required) the output feature index predict used." << endl;
+    cout << "    -p score_precision: (default = 4.3f) precision of the scores in the text." << endl;
+    cout << "    -r recs_file: (required) the binary recs predict wrote." << endl;
+    cout << "    -s samples_index: (required) the samples index predict used, i.e. the .samplesIndex file predict writes." << endl;
+    cout << "    -t text_file: (required) the text recs file to write." << endl;
+    cout << endl;
+}
+
+/**
+Reads the indices once and turns every record into one $SAMPLE<tab>$FEATURE,$SCORE: line, the same
+text predict writes without -F.  fp16 scores are printed from their fp16 value
+*/
+int main(int argc, char** argv) {
+    if (isArgSet(argc, argv, "-h")) {
+        printUsageRecsToText();
+        exit(1);
+    }
+
+    string recsFileName = getRequiredArgValue(argc, argv, "-r", "recs file is not specified.", &printUsageRecsToText);
+    string outputIndexFileName = getRequiredArgValue(argc, argv, "-o", "output features index file is not specified.", &printUsageRecsToText);
+    string samplesIndexFileName = getRequiredArgValue(argc, argv, "-s", "samples index file is not specified.", &printUsageRecsToText);
+    string textFileName = getRequiredArgValue(argc, argv, "-t", "text file is not specified.", &printUsageRecsToText);
+    string scorePrecision = getOptionalArgValue(argc, argv, "-p", NNRecsGenerator::DEFAULT_SCORE_PRECISION);
+
+    timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    unordered_map<string, unsigned int> mOutput;
+    unordered_map<string, unsigned int> mSamples;
+    cout << "Loading output feature index from: " << outputIndexFileName << endl;
+    if (!loadIndexFromFile(mOutput, outputIndexFileName, cout)) {
+        return 1;
+    }
+    cout << "Loading samples index from: " << samplesIndexFileName << endl;
+    if (!loadIndexFromFile(mSamples, samplesIndexFileName, cout)) {
+        return 1;
+    }
+    vector<string> vOutput(mOutput.size());
+    for (unordered_map<string, unsigned int>::iterator it = mOutput.begin(); it != mOutput.end(); it++) {
+        vOutput[it->second] = it->first;
+    }
+    vector<string> vSamples(mSamples.size());
+    for (unordered_map<string, unsigned int>::iterator it = mSamples.begin(); it != mSamples.end(); it++) {
+        vSamples[it->second] = it->first;
+    }
+
+    RecsReader reader(recsFileName);
+    const RecsFileHeader &header = reader.getHeader();
+    if (header.samples != vSamples.size() || header.features != vOutput.size()) {
+        cout << "Error: " << recsFileName << " was written with " << header.samples << " samples and " << header.features
+             << " features, the indices have " << vSamples.size() << " and " << vOutput.size() << endl;
+        return 1;
+    }
+
+    FILE* fp = fopen(textFileName.c_str(), "w");
+    if (fp == NULL) {
+        cout << "Error: Cannot write text file: " << textFileName << endl;
+        return 1;
+    }
+    ScoreFormat scoreFormat(scorePrecision);
+    vector<uint32_t> vItems(header.k);
+    vector<float> vScores(header.k);
+    uint32_t sample;
+    string line;
+    while (reader.read(sample, vItems.data(), vScores.data())) {
+        if (sample >= vSamples.size()) {
+            cout << "Error: " << recsFileName << " has a record for unknown sample " << sample << endl;
+            return 1;
+        }
+        line.clear();
+        line += vSamples[sample];
+        line += '\t';
+        for (uint32_t x = 0; x < header.k; x++) {
+            // RECS_NO_ITEM marks the padding after the last rec
+            if (vItems[x] < vOutput.size()) {
+                line += vOutput[vItems[x]];
+                line += ',';
+                scoreFormat.append(line, vScores[x]);
+                line += ':';
+            }
+        }
+        line += '\n';
+        fwrite(line.data(), 1, line.size(), fp);
+    }
+    if (fclose(fp) != 0) {
+        cout << "Error: Cannot write text file: " << textFileName << endl;
+        return 1;
+    }
+    gettimeofday(&t1, NULL);
+    cout << "Converted " << reader.getRecords() << " records to " << textFileName << " in " << elapsed_time(t1, t0) << " seconds" << endl;
+    return 0;
+}
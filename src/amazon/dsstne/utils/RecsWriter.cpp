@@ -0,0 +1,280 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "HostHalf.h"
+#include "RecsWriter.h"
+
+const unsigned int RecsWriter::QUEUE_DEPTH = 4;
+const size_t RecsWriter::BUFFER_BYTES = 16 * 1024 * 1024;
+
+// Largest precision whose power of ten times any float is still exact in a double (24 + 21 bits)
+static const int MAX_FIXED_PRECISION = 9;
+// Scores this large or larger go through snprintf so scaled values always fit a long long
+static const double MAX_FIXED_SCORE = 1e9;
+
+/**
+Only [width][.precision]f is taken by the fast path.  Without a precision printf uses 6 digits
+*/
+ScoreFormat::ScoreFormat(const string &xPrecision) :
+    format("%" + xPrecision),
+    bFixed(false),
+    width(0),
+    precision(6),
+    scale(1)
+{
+    size_t i = 0;
+    while (i < xPrecision.size() && isdigit(xPrecision[i])) {
+        width = width * 10 + (xPrecision[i++] - '0');
+    }
+    if (i < xPrecision.size() && xPrecision[i] == '.') {
+        precision = 0;
+        while (++i < xPrecision.size() && isdigit(xPrecision[i])) {
+            precision = precision * 10 + (xPrecision[i] - '0');
+        }
+    }
+    bFixed = (i + 1 == xPrecision.size() && xPrecision[i] == 'f' && xPrecision[0] != '0' &&
+              width <= 64 && precision <= MAX_FIXED_PRECISION);
+    for (int p = 0; p < precision && bFixed; p++) {
+        scale *= 10;
+    }
+}
+
+/**
+The scaled score is exact, so rounding it to nearest even in the current rounding mode rounds the
+same way printf rounds the exact decimal value of the float
+*/
+void ScoreFormat::append(string &out, float value) const
+{
+    if (!bFixed || !std::isfinite(value) || fabs(value) >= MAX_FIXED_SCORE) {
+        char text[128];
+        int length = snprintf(text, sizeof(text), format.c_str(), value);
+        if (length >= (int)sizeof(text)) {
+            vector<char> vText(length + 1);
+            snprintf(vText.data(), vText.size(), format.c_str(), value);
+            out.append(vText.data(), length);
+        } else if (length > 0) {
+            out.append(text, length);
+        }
+        return;
+    }
+
+    unsigned long long scaled = (unsigned long long)nearbyint(fabs((double)value) * scale);
+    char text[32];
+    char* pEnd = text + sizeof(text);
+    char* p = pEnd;
+    for (int d = 0; d < precision; d++) {
+        *--p = '0' + scaled % 10;
+        scaled /= 10;
+    }
+    if (precision > 0) {
+        *--p = '.';
+    }
+    do {
+        *--p = '0' + scaled % 10;
+        scaled /= 10;
+    } while (scaled > 0);
+    if (std::signbit(value)) {
+        *--p = '-';
+    }
+    if (pEnd - p < width) {
+        out.append(width - (pEnd - p), ' ');
+    }
+    out.append(p, pEnd - p);
+}
+
+RecsWriter::RecsWriter(const string &xFileName,
+                       const string &xPrecision,
+                       const vector<string> &xCustomerIndex,
+                       const vector<string> &xFeatureIndex,
+                       RecsFormat xFormat) :
+    fileName(xFileName),
+    scoreFormat(xPrecision),
+    customerIndex(xCustomerIndex),
+    featureIndex(xFeatureIndex),
+    format(xFormat),
+    bWriting(false),
+    bFailed(false),
+    bDone(false)
+{
+    fp = fopen(fileName.c_str(), "a");
+    if (fp == NULL) {
+        throw std::runtime_error("unable to open recs output " + fileName);
+    }
+    fseek(fp, 0, SEEK_END);
+    bHeader = (ftell(fp) > 0);
+    memset(&header, 0, sizeof(header));
+    buffer.reserve(BUFFER_BYTES + BUFFER_BYTES / 16);
+    for (unsigned int i = 0; i < QUEUE_DEPTH; i++) {
+        vBatch.push_back(new Batch());
+        freeBatches.push_back(vBatch.back());
+    }
+    writer = thread(&RecsWriter::run, this);
+}
+
+RecsWriter::~RecsWriter()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        bDone = true;
+    }
+    changed.notify_all();
+    writer.join();
+    fclose(fp);
+    for (size_t i = 0; i < vBatch.size(); i++) {
+        delete vBatch[i];
+    }
+}
+
+RecsWriter::Batch* RecsWriter::getBatch()
+{
+    unique_lock<mutex> guard(lock);
+    while (freeBatches.empty()) {
+        changed.wait(guard);
+    }
+    Batch* batch = freeBatches.front();
+    freeBatches.pop_front();
+    return batch;
+}
+
+void RecsWriter::submit(Batch* batch)
+{
+    {
+        unique_lock<mutex> guard(lock);
+        pendingBatches.push_back(batch);
+    }
+    changed.notify_all();
+}
+
+void RecsWriter::flush()
+{
+    unique_lock<mutex> guard(lock);
+    while (!pendingBatches.empty() || bWriting) {
+        changed.wait(guard);
+    }
+    if (bFailed) {
+        throw std::runtime_error("unable to write recs to " + fileName);
+    }
+}
+
+/**
+Text collects in one large buffer which goes out in a single fwrite whenever it fills up, or when
+the queue runs dry so a flush leaves nothing behind
+*/
+void RecsWriter::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        while (pendingBatches.empty() && !bDone) {
+            changed.wait(guard);
+        }
+        if (pendingBatches.empty()) {
+            break;
+        }
+        Batch* batch = pendingBatches.front();
+        pendingBatches.pop_front();
+        bWriting = true;
+        guard.unlock();
+
+        bool bWritten = (format == RecsText) ? write(batch) : writeBinary(batch);
+        guard.lock();
+        bool bIdle = pendingBatches.empty();
+        guard.unlock();
+        if (bIdle && !buffer.empty()) {
+            bWritten = (fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size()) && bWritten;
+            bWritten = (fflush(fp) == 0) && bWritten;
+            buffer.clear();
+        }
+
+        guard.lock();
+        bFailed = bFailed || !bWritten;
+        freeBatches.push_back(batch);
+        bWriting = false;
+        changed.notify_all();
+    }
+}
+
+bool RecsWriter::write(const Batch* batch)
+{
+    bool bWritten = true;
+    for (unsigned int j = 0; j < batch->rows; j++) {
+        buffer += customerIndex[batch->position + j];
+        buffer += '\t';
+        for (unsigned int x = 0; x < batch->k; x++) {
+            unsigned int feature = batch->features[j * batch->k + x];
+            if (feature < featureIndex.size()) {
+                buffer += featureIndex[feature];
+                buffer += ',';
+                scoreFormat.append(buffer, batch->scores[j * batch->k + x]);
+                buffer += ':';
+            }
+        }
+        buffer += '\n';
+        if (buffer.size() >= BUFFER_BYTES) {
+            bWritten = (fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size()) && bWritten;
+            buffer.clear();
+        }
+    }
+    return bWritten;
+}
+
+/**
+The header records K of the first batch, every later batch must have the same K
+*/
+bool RecsWriter::writeBinary(const Batch* batch)
+{
+    bool bWritten = true;
+    if (header.k == 0) {
+        memcpy(header.magic, RECS_FILE_MAGIC, sizeof(header.magic));
+        header.version = RECS_FILE_VERSION;
+        header.k = batch->k;
+        header.scoreBytes = (format == RecsFP16) ? sizeof(uint16_t) : sizeof(float);
+        header.samples = customerIndex.size();
+        header.features = featureIndex.size();
+        if (!bHeader) {
+            buffer.append((const char*)&header, sizeof(header));
+            bHeader = true;
+        }
+    }
+    if (batch->k != header.k) {
+        return false;
+    }
+
+    for (unsigned int j = 0; j < batch->rows; j++) {
+        uint32_t sample = batch->position + j;
+        buffer.append((const char*)&sample, sizeof(sample));
+        for (unsigned int x = 0; x < batch->k; x++) {
+            uint32_t item = batch->features[j * batch->k + x];
+            if (item >= featureIndex.size()) {
+                item = RECS_NO_ITEM;
+            }
+            buffer.append((const char*)&item, sizeof(item));
+        }
+        for (unsigned int x = 0; x < batch->k; x++) {
+            float score = (batch->features[j * batch->k + x] < featureIndex.size()) ? batch->scores[j * batch->k + x] : 0.0f;
+            if (format == RecsFP16) {
+                uint16_t half = hFloatToHalf(score);
+                buffer.append((const char*)&half, sizeof(half));
+            } else {
+                buffer.append((const char*)&score, sizeof(score));
+            }
+        }
+        if (buffer.size() >= BUFFER_BYTES) {
+            bWritten = (fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size()) && bWritten;
+            buffer.clear();
+        }
+    }
+    return bWritten;
+}
@@ -0,0 +1,120 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#ifndef RECS_WRITER_H
+#define RECS_WRITER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "RecsFile.h"
+
+using namespace std;
+
+/**
+Formats scores with a printf style precision such as "4.3f".  Plain fixed point formats (width and
+precision, no flags) are formatted with integer arithmetic into exactly the text printf would produce,
+anything else goes through snprintf
+*/
+class ScoreFormat
+{
+private:
+    string format;
+    bool bFixed;
+    int width;
+    int precision;
+    long long scale;
+
+public:
+    ScoreFormat(const string &precision);
+
+    void append(string &out, float value) const;
+};
+
+/**
+Writes recs to one file from a dedicated thread, so the next batch is predicted while the previous
+one is formatted and written.  Batches go through a bounded queue, the caller only blocks once
+QUEUE_DEPTH batches are waiting.  The file is opened in append mode once and stays open until the
+writer is deleted.  RecsFP32 and RecsFP16 write the binary records of RecsFile.h instead of text,
+the header goes out with the first batch of an empty file
+*/
+class RecsWriter
+{
+public:
+    /**
+    Recs of samples [position, position + rows), row j holds k (feature, score) pairs at j * k.
+    Features past the end of the feature index are padding and skipped
+    */
+    struct Batch
+    {
+        unsigned int position;
+        unsigned int rows;
+        unsigned int k;
+        vector<unsigned int> features;
+        vector<float> scores;
+    };
+
+    static const unsigned int QUEUE_DEPTH;
+    static const size_t BUFFER_BYTES;
+
+    RecsWriter(const string &fileName,
+               const string &precision,
+               const vector<string> &customerIndex,
+               const vector<string> &featureIndex,
+               RecsFormat format=RecsText);
+
+    ~RecsWriter();
+
+    // Returns an empty batch to fill in, blocks while QUEUE_DEPTH batches are waiting to be written
+    Batch* getBatch();
+
+    // Hands a batch from getBatch to the writer thread
+    void submit(Batch* batch);
+
+    // Waits until every submitted batch is in the file, throws if any write failed
+    void flush();
+
+    const string& getFileName() const
+    {
+        return fileName;
+    }
+
+private:
+    string fileName;
+    ScoreFormat scoreFormat;
+    const vector<string> &customerIndex;
+    const vector<string> &featureIndex;
+    RecsFormat format;
+    FILE* fp;
+    string buffer;
+    RecsFileHeader header;
+    bool bHeader;
+
+    vector<Batch*> vBatch;
+    deque<Batch*> freeBatches;
+    deque<Batch*> pendingBatches;
+    bool bWriting;
+    bool bFailed;
+    bool bDone;
+    mutex lock;
+    condition_variable changed;
+    thread writer;
+
+    void run();
+    bool write(const Batch* batch);
+    bool writeBinary(const Batch* batch);
+};
+#endif
@@ -0,0 +1,224 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <stdexcept>
+
+#include "Utils.h"
+#include "SampleStream.h"
+
+const unsigned int SampleStream::QUEUE_DEPTH = 2;
+
+SampleStream::SampleStream(const string &inputPath,
+                           const string &samplesFilterPath,
+                           unsigned int xChunkSamples,
+                           unordered_map<string, unsigned int> &xMFeatureIndex,
+                           unordered_map<string, unsigned int> &xMOutput,
+                           const FeatureHashing &xHashing) :
+    file(0),
+    chunkSamples(xChunkSamples),
+    mFeatureIndex(xMFeatureIndex),
+    mOutput(xMOutput),
+    hashing(xHashing),
+    samples(0),
+    droppedFilters(0),
+    unmatchedFilters(0),
+    bEnd(false),
+    bDone(false)
+{
+    if (chunkSamples == 0) {
+        throw std::invalid_argument("chunks need at least one sample");
+    }
+    if (listFiles(inputPath, false, vFiles) != 0 || vFiles.empty()) {
+        throw std::invalid_argument("unable to read input " + inputPath);
+    }
+    if (samplesFilterPath != "") {
+        filterStream.open(samplesFilterPath);
+        if (!filterStream.is_open()) {
+            throw std::invalid_argument("unable to read sample filters " + samplesFilterPath);
+        }
+    }
+    parser = thread(&SampleStream::run, this);
+}
+
+SampleStream::~SampleStream()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        bDone = true;
+    }
+    changed.notify_all();
+    parser.join();
+    for (size_t i = 0; i < chunks.size(); i++) {
+        delete chunks[i];
+    }
+}
+
+SampleChunk* SampleStream::next()
+{
+    unique_lock<mutex> guard(lock);
+    while (chunks.empty() && !bEnd) {
+        changed.wait(guard);
+    }
+    if (chunks.empty()) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        return NULL;
+    }
+    SampleChunk* chunk = chunks.front();
+    chunks.pop_front();
+    changed.notify_all();
+    return chunk;
+}
+
+uint64_t SampleStream::getUnmatchedFilters()
+{
+    unique_lock<mutex> guard(lock);
+    return unmatchedFilters;
+}
+
+/**
+Parses ahead until QUEUE_DEPTH chunks wait, then sleeps until one is taken.  A chunk is queued once the
+next one is parsed, its filter lines end where the next chunk's begin.  Filter lines dropped along the way
+and left over after the last chunk are counted, they belong to samples missing from the input
+*/
+void SampleStream::run()
+{
+    SampleChunk* held = NULL;
+    try {
+        unordered_map<string, unsigned int> mHeldSamples;
+        while (true) {
+            {
+                unique_lock<mutex> guard(lock);
+                while (chunks.size() >= QUEUE_DEPTH && !bDone) {
+                    changed.wait(guard);
+                }
+                if (bDone) {
+                    delete held;
+                    return;
+                }
+            }
+            unordered_map<string, unsigned int> mSamples;
+            SampleChunk* chunk = parse(mSamples);
+            if (held != NULL) {
+                if (filterStream.is_open()) {
+                    held->pSamplesFilter = new SamplesFilter();
+                    droppedFilters += held->pSamplesFilter->loadFilterLines(mOutput, mHeldSamples, mSamples,
+                                                                            filterStream);
+                }
+                {
+                    unique_lock<mutex> guard(lock);
+                    chunks.push_back(held);
+                }
+                held = NULL;
+                changed.notify_all();
+            }
+            if (chunk == NULL) {
+                break;
+            }
+            held = chunk;
+            mHeldSamples.swap(mSamples);
+        }
+
+        uint64_t unmatched = droppedFilters;
+        string line;
+        while (filterStream.is_open() && getline(filterStream, line)) {
+            if (!line.empty()) {
+                unmatched++;
+            }
+        }
+        unique_lock<mutex> guard(lock);
+        unmatchedFilters = unmatched;
+    } catch (const std::exception &e) {
+        unique_lock<mutex> guard(lock);
+        error = e.what();
+    }
+    delete held;
+    {
+        unique_lock<mutex> guard(lock);
+        bEnd = true;
+    }
+    changed.notify_all();
+}
+
+/**
+Reads the next chunkSamples lines and parses them with the sample index mSamples of their own, so sample
+numbers are local to the chunk, the chunk's samples filter is left to run().  A sample repeated within the
+chunk keeps its last line like parseSamples does, repeats across chunks are predicted once per chunk
+*/
+SampleChunk* SampleStream::parse(unordered_map<string, unsigned int> &mSamples)
+{
+    string text;
+    string line;
+    unsigned int lines = 0;
+    while (lines < chunkSamples && readLine(line)) {
+        if (!line.empty()) {
+            text += line;
+            text += '\n';
+            lines++;
+        }
+    }
+    if (lines == 0) {
+        return NULL;
+    }
+
+    map<unsigned int, vector<unsigned int> > mSignals;
+    map<unsigned int, vector<float> > mSignalValues;
+    bool featureIndexUpdated = false;
+    bool sampleIndexUpdated = false;
+    {
+        istringstream chunkStream(text);
+        string().swap(text);
+        if (!parseSamples(chunkStream, false, mFeatureIndex, mSamples, featureIndexUpdated, sampleIndexUpdated,
+                          mSignals, mSignalValues, cout, hashing)) {
+            throw std::runtime_error("unable to parse input samples");
+        }
+    }
+
+    SampleChunk* chunk = new SampleChunk();
+    chunk->firstSample = samples;
+    chunk->vSamples.resize(mSamples.size());
+    for (unordered_map<string, unsigned int>::iterator it = mSamples.begin(); it != mSamples.end(); it++) {
+        chunk->vSamples[it->second] = it->first;
+    }
+    for (map<unsigned int, vector<unsigned int> >::iterator it = mSignals.begin(); it != mSignals.end(); it++) {
+        vector<float> &signalValues = mSignalValues[it->first];
+        chunk->vSparseStart.push_back(chunk->vSparseIndex.size());
+        chunk->vSparseIndex.insert(chunk->vSparseIndex.end(), it->second.begin(), it->second.end());
+        chunk->vSparseData.insert(chunk->vSparseData.end(), signalValues.begin(), signalValues.end());
+        chunk->vSparseEnd.push_back(chunk->vSparseIndex.size());
+    }
+    samples += chunk->vSamples.size();
+    return chunk;
+}
+
+/**
+Next line of the input, moving on to the next file at the end of each one
+*/
+bool SampleStream::readLine(string &line)
+{
+    while (!getline(inputStream, line)) {
+        if (file == vFiles.size()) {
+            return false;
+        }
+        inputStream.close();
+        inputStream.clear();
+        inputStream.open(vFiles[file]);
+        if (!inputStream.is_open()) {
+            throw std::runtime_error("unable to read input " + vFiles[file]);
+        }
+        file++;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "NetCDFhelper.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+One chunk of input samples in CSR form, sample i of the chunk is vSparseIndex/vSparseData
+[vSparseStart[i], vSparseEnd[i]) and is labeled vSamples[i].  vSparseData holds the feature values as
+parseSamples reads them
+*/
+struct SampleChunk
+{
+    uint64_t firstSample;               // samples read before this chunk
+    vector<string> vSamples;
+    vector<uint64_t> vSparseStart;
+    vector<uint64_t> vSparseEnd;
+    vector<uint32_t> vSparseIndex;
+    vector<float> vSparseData;
+    SamplesFilter* pSamplesFilter;      // filters of the chunk's samples, NULL without a sample filter
+
+    SampleChunk() : firstSample(0), pSamplesFilter(NULL)
+    {
+    }
+
+    ~SampleChunk()
+    {
+        delete pSamplesFilter;
+    }
+};
+
+/**
+Reads a text input dataset (a file or a directory of files) and its sample filter as chunks of at most
+chunkSamples samples, so predict's memory does not grow with the number of samples.  Chunks are parsed
+on a dedicated thread while earlier chunks are predicted, at most QUEUE_DEPTH parsed chunks wait to be
+taken.  The sample filter must list samples in the order of the input, see SamplesFilter::loadFilterLines,
+so the filters of a chunk are loaded once the next chunk has been parsed
+*/
+class SampleStream
+{
+public:
+    static const unsigned int QUEUE_DEPTH;
+
+    SampleStream(const string &inputPath,
+                 const string &samplesFilterPath,
+                 unsigned int chunkSamples,
+                 unordered_map<string, unsigned int> &mFeatureIndex,
+                 unordered_map<string, unsigned int> &mOutput,
+                 const FeatureHashing &hashing);
+
+    ~SampleStream();
+
+    /**
+    Returns the next chunk, owned by the caller, or NULL once the input is exhausted.  Blocks while the
+    chunk is parsed, throws std::runtime_error if the input cannot be read
+    */
+    SampleChunk* next();
+
+    // Lines of the sample filter that matched no chunk, known once next() has returned NULL
+    uint64_t getUnmatchedFilters();
+
+private:
+    vector<string> vFiles;
+    size_t file;
+    ifstream inputStream;
+    ifstream filterStream;
+    unsigned int chunkSamples;
+    unordered_map<string, unsigned int> &mFeatureIndex;
+    unordered_map<string, unsigned int> &mOutput;
+    FeatureHashing hashing;
+    uint64_t samples;
+    uint64_t droppedFilters;
+    uint64_t unmatchedFilters;
+
+    deque<SampleChunk*> chunks;
+    string error;
+    bool bEnd;
+    bool bDone;
+    mutex lock;
+    condition_variable changed;
+    thread parser;
+
+    void run();
+    SampleChunk* parse(unordered_map<string, unsigned int> &mSamples);
+    bool readLine(string &line);
+};
+#endif
@@ -0,0 +1,46 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <algorithm>
+#include <climits>
+#include <iterator>
+
+#include "TopKRecall.h"
+
+void calculateTopKIndices(vector<NNFloat>& vUnit, unsigned int batch, unsigned int width, unsigned int k,
+                          vector<NNFloat>& vKey, vector<unsigned int>& vIndex)
+{
+    vKey.resize((size_t)batch * k);
+    vIndex.resize((size_t)batch * k);
+    hCalculateTopK(vUnit.data(), vKey.data(), vIndex.data(), batch, width, k);
+}
+
+void mapCandidateIndices(unsigned int* pIndex, unsigned int k, const uint32_t* pCandidate, unsigned int count)
+{
+    for (unsigned int j = 0; j < k; j++) {
+        pIndex[j] = (pIndex[j] < count) ? pCandidate[pIndex[j]] : UINT_MAX;
+    }
+}
+
+uint64_t countTopKMatches(vector<unsigned int>& vReference, vector<unsigned int>& vApproximate, unsigned int rows, unsigned int k)
+{
+    uint64_t matches = 0;
+    for (unsigned int i = 0; i < rows; i++) {
+        vector<unsigned int>::iterator pReference = vReference.begin() + (size_t)i * k;
+        vector<unsigned int>::iterator pApproximate = vApproximate.begin() + (size_t)i * k;
+        sort(pReference, pReference + k);
+        sort(pApproximate, pApproximate + k);
+        vector<unsigned int> vCommon;
+        set_intersection(pReference, pReference + k, pApproximate, pApproximate + k, back_inserter(vCommon));
+        matches += vCommon.size() - count(vCommon.begin(), vCommon.end(), UINT_MAX);
+    }
+    return matches;
+}
@@ -0,0 +1,42 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#ifndef TOPK_RECALL_H
+#define TOPK_RECALL_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+
+using namespace std;
+
+/**
+ * Host top K of each row of a batch x width copy of a layer's units, the selection predict uses to compare
+ * approximate against exact fp32 predictions.  Rows with fewer than k units are padded with -MAX_VALUE and 0.
+ */
+void calculateTopKIndices(vector<NNFloat>& vUnit, unsigned int batch, unsigned int width, unsigned int k,
+                          vector<NNFloat>& vKey, vector<unsigned int>& vIndex);
+
+/**
+ * Maps a row of k top K candidate positions back to units.  Positions at or past count are padding and map
+ * to UINT_MAX.
+ */
+void mapCandidateIndices(unsigned int* pIndex, unsigned int k, const uint32_t* pCandidate, unsigned int count);
+
+/**
+ * Number of units in the reference top K of the first rows that the approximate top K also holds, recall is
+ * this divided by rows * k.  Sorts each row of both in place, UINT_MAX padding never matches.
+ */
+uint64_t countTopKMatches(vector<unsigned int>& vReference, vector<unsigned int>& vApproximate, unsigned int rows, unsigned int k);
+
+#endif
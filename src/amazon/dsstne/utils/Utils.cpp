@@ -212,14 +212,12 @@ double elapsed_time(timeval x, timeval y)
 
 bool isDirectory(const string &dirname) {
     struct stat buf;
-    stat(dirname.c_str(), &buf);
-    return S_ISDIR(buf.st_mode);
+    return stat(dirname.c_str(), &buf) == 0 && S_ISDIR(buf.st_mode);
 }
 
 bool isFile(const string &filename) {
     struct stat buf;
-    stat(filename.c_str(), &buf);
-    return S_ISREG(buf.st_mode);
+    return stat(filename.c_str(), &buf) == 0 && S_ISREG(buf.st_mode);
 }
 
 int listFiles(const string &dirname, const bool recursive, vector<string> &files) {
@@ -0,0 +1,172 @@
+// Host sort and shuffle benchmark
+//
+// Usage: sortbench [items ...]
+//
+// Defaults to 1M, 100M and 1B items.  Also times the SIMD bitonic networks against std::sort on 16
+// to 256 pair blocks, set DSSTNE_HOST_SIMD=avx2 to time AVX2 on an AVX-512 machine, and filtered top K
+// with items excluded for every sample through a node filter mask versus through every sample's filter.  Sorting N items needs 16 * N bytes of system memory (double
+// buffered keys and values), so 1B items needs a 16GB+ machine.
+
+// STL
+#include <string>
+#include <random>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include "Utils.h"
+
+using namespace std;
+
+void benchmarkSort(const size_t items) {
+
+  cout << "BENCHMARK items=" << items << " threads=" << omp_get_max_threads() << endl;
+  timeval t0, t1;
+
+  // Radix sort of random keys, what ShuffleIndices does on the GPU
+  {
+    HostSort<unsigned int, unsigned int> sort(items);
+    mt19937 rng(12345);
+    for (size_t i = 0; i < items; i++) {
+      sort.GetKeyPointer()[i] = rng();
+      sort.GetValuePointer()[i] = i;
+    }
+    gettimeofday(&t0, NULL);
+    sort.Sort();
+    gettimeofday(&t1, NULL);
+    double seconds = elapsed_time(t1, t0);
+    cout << "HostSort<unsigned int, unsigned int>: " << seconds << "s, " << (items / seconds) * 1.0e-6 << " Mitems/s" << endl;
+  }
+
+  // Direct parallel Fisher-Yates
+  {
+    vector<unsigned int> vIndex(items);
+    gettimeofday(&t0, NULL);
+    hShuffleIndices(&vIndex[0], items, 12345);
+    gettimeofday(&t1, NULL);
+    double seconds = elapsed_time(t1, t0);
+    cout << "hShuffleIndices: " << seconds << "s, " << (items / seconds) * 1.0e-6 << " Mitems/s" << endl;
+
+    // Serial Fisher-Yates for reference
+    for (size_t i = 0; i < items; i++) {
+      vIndex[i] = i;
+    }
+    mt19937_64 rng(12345);
+    gettimeofday(&t0, NULL);
+    shuffle(vIndex.begin(), vIndex.end(), rng);
+    gettimeofday(&t1, NULL);
+    seconds = elapsed_time(t1, t0);
+    cout << "std::shuffle: " << seconds << "s, " << (items / seconds) * 1.0e-6 << " Mitems/s" << endl;
+  }
+}
+
+bool compareKey(const pair<NNFloat, unsigned int>& a, const pair<NNFloat, unsigned int>& b) {
+  return a.first < b.first;
+}
+
+void benchmarkBitonic(const size_t block) {
+
+  const size_t BLOCKS = 100000;
+  timeval t0, t1;
+  mt19937 rng(12345);
+  vector<NNFloat> vKey(block * BLOCKS);
+  vector<unsigned int> vValue(block * BLOCKS);
+  vector<pair<NNFloat, unsigned int> > vPair(block * BLOCKS);
+  for (size_t i = 0; i < block * BLOCKS; i++) {
+    vKey[i] = (NNFloat)rng() / (NNFloat)mt19937::max();
+    vValue[i] = i;
+    vPair[i] = make_pair(vKey[i], (unsigned int)i);
+  }
+
+  gettimeofday(&t0, NULL);
+  for (size_t b = 0; b < BLOCKS; b++) {
+    hBitonicSort(&vKey[b * block], &vValue[b * block], block);
+  }
+  gettimeofday(&t1, NULL);
+  double bitonic = elapsed_time(t1, t0);
+
+  gettimeofday(&t0, NULL);
+  for (size_t b = 0; b < BLOCKS; b++) {
+    sort(vPair.begin() + b * block, vPair.begin() + (b + 1) * block, compareKey);
+  }
+  gettimeofday(&t1, NULL);
+  double stl = elapsed_time(t1, t0);
+  cout << "block=" << block << " hBitonicSort: " << bitonic * 1.0e9 / BLOCKS << "ns std::sort: " << stl * 1.0e9 / BLOCKS << "ns speedup: " << stl / bitonic << endl;
+}
+
+void benchmarkNodeFilter(const size_t width, const size_t excluded) {
+
+  const size_t BATCH = 256;
+  const size_t TOP_K = 100;
+  timeval t0, t1;
+  mt19937 rng(12345);
+  vector<NNFloat> vOutput(BATCH * width);
+  for (size_t i = 0; i < vOutput.size(); i++) {
+    vOutput[i] = (NNFloat)rng() / (NNFloat)mt19937::max();
+  }
+
+  // The same excluded items, once as a node filter mask and once copied into every sample's filter
+  vector<unsigned int> vExcluded(excluded);
+  vector<NNFloat> vMask(width, 1.f);
+  for (size_t i = 0; i < excluded; i++) {
+    vExcluded[i] = (i * width) / excluded;
+    vMask[vExcluded[i]] = 0.f;
+  }
+  vector<uint64_t> vFilterStart(BATCH);
+  vector<uint64_t> vFilterEnd(BATCH);
+  vector<unsigned int> vFilterIndex;
+  vector<NNFloat> vFilterValue;
+  for (size_t i = 0; i < BATCH; i++) {
+    vFilterStart[i] = vFilterIndex.size();
+    vFilterIndex.insert(vFilterIndex.end(), vExcluded.begin(), vExcluded.end());
+    vFilterValue.insert(vFilterValue.end(), excluded, 0.f);
+    vFilterEnd[i] = vFilterIndex.size();
+  }
+  vector<uint64_t> vEmpty(BATCH, 0);
+
+  vector<NNFloat> vKey(BATCH * TOP_K);
+  vector<unsigned int> vValue(BATCH * TOP_K);
+  vector<NNFloat> vMaskKey(BATCH * TOP_K);
+  vector<unsigned int> vMaskValue(BATCH * TOP_K);
+  gettimeofday(&t0, NULL);
+  hCalculateFilteredTopK(&vOutput[0], &vKey[0], &vValue[0], BATCH, width, TOP_K, &vFilterStart[0], &vFilterEnd[0], &vFilterIndex[0], &vFilterValue[0]);
+  gettimeofday(&t1, NULL);
+  double perSample = elapsed_time(t1, t0);
+  gettimeofday(&t0, NULL);
+  hCalculateFilteredTopK(&vOutput[0], &vMaskKey[0], &vMaskValue[0], BATCH, width, TOP_K, &vEmpty[0], &vEmpty[0], NULL, NULL, &vMask[0]);
+  gettimeofday(&t1, NULL);
+  double mask = elapsed_time(t1, t0);
+
+  // Filter memory is what the per sample emulation multiplies by the number of samples
+  size_t perSampleBytes = excluded * (sizeof(unsigned int) + sizeof(NNFloat));
+  cout << "width=" << width << " excluded=" << excluded << " per sample filters: " << perSample * 1.0e3 << "ms, " << perSampleBytes << " bytes/sample"
+       << " node filter: " << mask * 1.0e3 << "ms, " << width * sizeof(NNFloat) << " bytes total"
+       << " speedup: " << perSample / mask << (((vKey == vMaskKey) && (vValue == vMaskValue)) ? "" : " MISMATCH") << endl;
+}
+
+int main(int argc, char** argv) {
+  for (size_t block = 16; block <= 256; block <<= 1) {
+    benchmarkBitonic(block);
+  }
+
+  benchmarkNodeFilter(100000, 100);
+  benchmarkNodeFilter(100000, 10000);
+  benchmarkNodeFilter(1000000, 1000);
+  benchmarkNodeFilter(1000000, 100000);
+
+  vector<size_t> vItems;
+  for (int i = 1; i < argc; i++) {
+    vItems.push_back(atol(argv[i]));
+  }
+  if (vItems.empty()) {
+    vItems.push_back(1000000);
+    vItems.push_back(100000000);
+    vItems.push_back(1000000000);
+  }
+
+  for (size_t i = 0; i < vItems.size(); i++) {
+    benchmarkSort(vItems[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Sparse input layer benchmark
+//
+// Usage: sparsebench [heavyDatapoints ...]
+//
+// Times the fast sparse Z kernel against the dense fallback (expand the batch with kLoadSparseInputUnit,
+// then one SGEMM) on a skewed synthetic batch where 1 in 16 examples carries heavyDatapoints inputs and
+// the rest 32.  Heavy examples above the shared memory limit are chunked by the fast kernel, this shows
+// where that stops paying off against the dense path.  Defaults to 0.5x, 1x, 4x and 16x the limit.
+
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "kernels.h"
+#include "Utils.h"
+
+using namespace std;
+
+void benchmarkSparse(const size_t heavyDatapoints) {
+
+  const size_t BATCH = 256;
+  const size_t INPUTS = 100000;
+  const size_t OUTPUTS = 512;
+  const size_t LIGHT = 32;
+  const size_t HEAVY_EVERY = 16;
+  const int ITERATIONS = 10;
+
+  vector<uint64_t> vSparseStart(BATCH);
+  vector<uint64_t> vSparseEnd(BATCH);
+  vector<uint32_t> vSparseIndex;
+  for (size_t i = 0; i < BATCH; i++) {
+    const size_t datapoints = (i % HEAVY_EVERY == 0) ? heavyDatapoints : LIGHT;
+    vSparseStart[i] = vSparseIndex.size();
+    for (size_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)INPUTS - 1));
+    }
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+
+  GpuBuffer<uint64_t>* pbSparseStart = new GpuBuffer<uint64_t>(BATCH);
+  GpuBuffer<uint64_t>* pbSparseEnd = new GpuBuffer<uint64_t>(BATCH);
+  GpuBuffer<uint32_t>* pbSparseIndex = new GpuBuffer<uint32_t>(vSparseIndex.size());
+  GpuBuffer<NNFloat>* pbWeight = new GpuBuffer<NNFloat>(INPUTS * OUTPUTS);
+  GpuBuffer<NNFloat>* pbInput = new GpuBuffer<NNFloat>(BATCH * INPUTS);
+  GpuBuffer<NNFloat>* pbUnit = new GpuBuffer<NNFloat>(BATCH * OUTPUTS);
+  pbSparseStart->Upload(&vSparseStart[0]);
+  pbSparseEnd->Upload(&vSparseEnd[0]);
+  pbSparseIndex->Upload(&vSparseIndex[0]);
+
+  timeval t0, t1;
+  gettimeofday(&t0, NULL);
+  for (int i = 0; i < ITERATIONS; i++) {
+    kCalculateSparseZ(0, BATCH, OUTPUTS, pbWeight->_pDevData, pbSparseStart->_pDevData, pbSparseEnd->_pDevData, pbSparseIndex->_pDevData, pbUnit->_pDevData, (NNFloat)0.0);
+  }
+  cudaDeviceSynchronize();
+  gettimeofday(&t1, NULL);
+  double sparse = elapsed_time(t1, t0) / ITERATIONS;
+
+  // Dense fallback, exactly what NNLayer does when _bFastSparse is false
+  const NNFloat sgemm_alpha = (NNFloat)1.0;
+  const NNFloat sgemm_beta = (NNFloat)0.0;
+  gettimeofday(&t0, NULL);
+  for (int i = 0; i < ITERATIONS; i++) {
+    kLoadSparseInputUnit(0, BATCH, INPUTS, pbInput->_pDevData, pbSparseStart->_pDevData, pbSparseEnd->_pDevData, pbSparseIndex->_pDevData);
+    cublasSgemm(getGpu()._cuBLASHandle, CUBLAS_OP_N, CUBLAS_OP_N, OUTPUTS, BATCH, INPUTS, &sgemm_alpha, pbWeight->_pDevData, OUTPUTS, pbInput->_pDevData, INPUTS, &sgemm_beta, pbUnit->_pDevData, OUTPUTS);
+  }
+  cudaDeviceSynchronize();
+  gettimeofday(&t1, NULL);
+  double dense = elapsed_time(t1, t0) / ITERATIONS;
+
+  cout << "heavy=" << heavyDatapoints << " maxDatapoints/maxSparse=" << (double)heavyDatapoints / getGpu()._maxSparse
+       << " kCalculateSparseZ: " << sparse * 1.0e3 << "ms dense: " << dense * 1.0e3 << "ms speedup: " << dense / sparse << endl;
+
+  delete pbSparseStart;
+  delete pbSparseEnd;
+  delete pbSparseIndex;
+  delete pbWeight;
+  delete pbInput;
+  delete pbUnit;
+}
+
+int main(int argc, char** argv) {
+  getGpu().Startup(argc, argv);
+  getGpu().SetRandomSeed(12345);
+  getGpu()._data._bShuffleIndices = false;
+  getGpu().CopyConstants();
+
+  vector<size_t> vHeavy;
+  for (int i = 1; i < argc; i++) {
+    vHeavy.push_back(atol(argv[i]));
+  }
+  if (vHeavy.empty()) {
+    vHeavy.push_back(getGpu()._maxSparse / 2);
+    vHeavy.push_back(getGpu()._maxSparse);
+    vHeavy.push_back(4 * getGpu()._maxSparse);
+    vHeavy.push_back(16 * getGpu()._maxSparse);
+  }
+
+  for (size_t i = 0; i < vHeavy.size(); i++) {
+    benchmarkSparse(vHeavy[i]);
+  }
+  getGpu().Shutdown();
+  return 0;
+}
@@ -0,0 +1,143 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "kernels.h"
+#include "Utils.h"
+
+using namespace std;
+
+// Candidate lists of random length up to maxCandidates per example, or a single shared list.  Scores
+// past an example's candidate count must be padded with -MAX_VALUE
+bool testCandidateZ(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t maxCandidates, const bool bShared) {
+
+  cout << "TEST kCalculateCandidateZ with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " maxCandidates=" << maxCandidates << " shared=" << bShared << endl;
+
+  const double EPS = 1.e-5;
+  const uint32_t lists = bShared ? 1 : batch;
+  vector<uint64_t> vCandidateStart(lists), vCandidateEnd(lists);
+  vector<uint32_t> vCandidate;
+  uint32_t candidateStride = 1;
+  for (size_t i = 0; i < lists; i++) {
+    const uint32_t count = bShared ? maxCandidates : rand(0, (int)maxCandidates);
+    vCandidateStart[i] = vCandidate.size();
+    for (size_t j = 0; j < count; j++) {
+      vCandidate.push_back(rand(0, (int)outputs - 1));
+    }
+    vCandidateEnd[i] = vCandidate.size();
+    candidateStride = max(candidateStride, count);
+  }
+  vector<NNFloat> vInput((size_t)batch * inputs);
+  for (size_t i = 0; i < vInput.size(); i++) {
+    vInput[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vBias(outputs);
+  for (size_t i = 0; i < vBias.size(); i++) {
+    vBias[i] = rand(-1.f, 1.f);
+  }
+
+  // The kernel reads [outputs][inputs] weights, the reference the usual [inputs][outputs] layout
+  vector<NNFloat> vTransposedWeight(vWeight.size());
+  for (size_t i = 0; i < inputs; i++) {
+    for (size_t o = 0; o < outputs; o++) {
+      vTransposedWeight[o * inputs + i] = vWeight[i * outputs + o];
+    }
+  }
+
+  GpuBuffer<NNFloat>* pbInput = new GpuBuffer<NNFloat>(vInput.size());
+  GpuBuffer<NNFloat>* pbTransposedWeight = new GpuBuffer<NNFloat>(vTransposedWeight.size());
+  GpuBuffer<NNFloat>* pbBias = new GpuBuffer<NNFloat>(vBias.size());
+  GpuBuffer<uint64_t>* pbCandidateStart = new GpuBuffer<uint64_t>(vCandidateStart.size());
+  GpuBuffer<uint64_t>* pbCandidateEnd = new GpuBuffer<uint64_t>(vCandidateEnd.size());
+  GpuBuffer<uint32_t>* pbCandidate = new GpuBuffer<uint32_t>(max(vCandidate.size(), (size_t)1));
+  GpuBuffer<NNFloat>* pbUnit = new GpuBuffer<NNFloat>((size_t)batch * candidateStride);
+  pbInput->Upload(&vInput[0]);
+  pbTransposedWeight->Upload(&vTransposedWeight[0]);
+  pbBias->Upload(&vBias[0]);
+  pbCandidateStart->Upload(&vCandidateStart[0]);
+  pbCandidateEnd->Upload(&vCandidateEnd[0]);
+  if (vCandidate.size() > 0) {
+    pbCandidate->Upload(&vCandidate[0]);
+  }
+
+  kCalculateCandidateZ(0, batch, inputs, pbInput->_pDevData, pbTransposedWeight->_pDevData, pbBias->_pDevData, pbCandidateStart->_pDevData,
+                       pbCandidateEnd->_pDevData, pbCandidate->_pDevData, bShared, candidateStride, pbUnit->_pDevData);
+  vector<NNFloat> vUnit((size_t)batch * candidateStride);
+  pbUnit->Download(&vUnit[0]);
+
+  delete pbInput;
+  delete pbTransposedWeight;
+  delete pbBias;
+  delete pbCandidateStart;
+  delete pbCandidateEnd;
+  delete pbCandidate;
+  delete pbUnit;
+
+  int countError = 0;
+  double maxError = 0.0;
+  for (size_t i = 0; i < batch; i++) {
+    const size_t list = bShared ? 0 : i;
+    const uint32_t count = vCandidateEnd[list] - vCandidateStart[list];
+    for (size_t j = 0; j < candidateStride; j++) {
+      const NNFloat unit = vUnit[i * candidateStride + j];
+      if (j >= count) {
+        if (unit != -MAX_VALUE) {
+          countError++;
+        }
+        continue;
+      }
+      const uint32_t candidate = vCandidate[vCandidateStart[list] + j];
+      double expected = vBias[candidate];
+      double scale = 1.0;
+      for (size_t k = 0; k < inputs; k++) {
+        expected += (double)vInput[i * inputs + k] * vWeight[k * outputs + candidate];
+        scale += fabs((double)vInput[i * inputs + k] * vWeight[k * outputs + candidate]);
+      }
+      const double error = fabs(unit - expected) / scale;
+      maxError = max(maxError, error);
+      if (error > EPS) {
+        countError++;
+      }
+    }
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestCandidates : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestCandidateZ()
+    {
+      getGpu()._data._bShuffleIndices = false;
+      getGpu().CopyConstants();
+      {
+        bool result = testCandidateZ(64, 256, 20000, 300, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with per example candidates", result);
+      }
+      {
+        bool result = testCandidateZ(33, 257, 5001, 1000, true);
+        CPPUNIT_ASSERT_MESSAGE("failed with shared candidates", result);
+      }
+      {
+        bool result = testCandidateZ(16, 128, 1000, 1, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with empty candidate lists", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestCandidates);
+    CPPUNIT_TEST(TestCandidateZ);
+    CPPUNIT_TEST_SUITE_END();
+};
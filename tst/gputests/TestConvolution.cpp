@@ -0,0 +1,298 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <cstdlib>
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+#include "TestReference.h"
+
+using namespace std;
+
+// Shape of a 2D or 3D convolution test, 2D convolutions leave the last entry of the spatial arrays unused
+struct ConvolutionTestShape {
+  int batch;
+  int inChannels;
+  int outChannels;
+  int dims;
+  int in[3];
+  int filter[3];
+  int pad[3];
+  int stride[3];
+  int dilation[3];
+  cudnnConvolutionMode_t mode;
+};
+
+// Forward, backward filter and backward data of one convolution straight from their definitions in double
+// precision, with every spatial dimension padded out to 3D
+void referenceConvolution(const ConvolutionTestShape& shape, const int* out, const vector<NNFloat>& vX, const vector<NNFloat>& vW, const vector<NNFloat>& vDy,
+                          vector<double>& vY, vector<double>& vDw, vector<double>& vDx) {
+  int in[3] = { 1, 1, 1 }, filter[3] = { 1, 1, 1 }, pad[3] = { 0, 0, 0 }, stride[3] = { 1, 1, 1 }, dilation[3] = { 1, 1, 1 }, out3[3] = { 1, 1, 1 };
+  for (int d = 0; d < shape.dims; d++) {
+    const int d3 = 3 - shape.dims + d;
+    in[d3] = shape.in[d];
+    filter[d3] = shape.filter[d];
+    pad[d3] = shape.pad[d];
+    stride[d3] = shape.stride[d];
+    dilation[d3] = shape.dilation[d];
+    out3[d3] = out[d];
+  }
+  const size_t inSize = (size_t)in[0] * in[1] * in[2];
+  const size_t outSize = (size_t)out3[0] * out3[1] * out3[2];
+  const size_t filterSize = (size_t)filter[0] * filter[1] * filter[2];
+  vY.assign((size_t)shape.batch * shape.outChannels * outSize, 0.0);
+  vDw.assign((size_t)shape.outChannels * shape.inChannels * filterSize, 0.0);
+  vDx.assign((size_t)shape.batch * shape.inChannels * inSize, 0.0);
+  const bool bFlip = (shape.mode == CUDNN_CONVOLUTION);
+  for (int n = 0; n < shape.batch; n++) {
+    for (int k = 0; k < shape.outChannels; k++) {
+      for (int c = 0; c < shape.inChannels; c++) {
+        for (size_t o = 0; o < outSize; o++) {
+          const int o0 = o / (out3[1] * out3[2]), o1 = (o / out3[2]) % out3[1], o2 = o % out3[2];
+          const size_t y = ((size_t)n * shape.outChannels + k) * outSize + o;
+          for (size_t f = 0; f < filterSize; f++) {
+            const int f0 = f / (filter[1] * filter[2]), f1 = (f / filter[2]) % filter[1], f2 = f % filter[2];
+            const int i0 = o0 * stride[0] - pad[0] + (bFlip ? filter[0] - 1 - f0 : f0) * dilation[0];
+            const int i1 = o1 * stride[1] - pad[1] + (bFlip ? filter[1] - 1 - f1 : f1) * dilation[1];
+            const int i2 = o2 * stride[2] - pad[2] + (bFlip ? filter[2] - 1 - f2 : f2) * dilation[2];
+            if ((i0 < 0) || (i0 >= in[0]) || (i1 < 0) || (i1 >= in[1]) || (i2 < 0) || (i2 >= in[2])) {
+              continue;
+            }
+            const size_t x = ((size_t)n * shape.inChannels + c) * inSize + ((size_t)i0 * in[1] + i1) * in[2] + i2;
+            const size_t w = ((size_t)k * shape.inChannels + c) * filterSize + f;
+            vY[y] += (double)vX[x] * vW[w];
+            vDw[w] += (double)vDy[y] * vX[x];
+            vDx[x] += (double)vDy[y] * vW[w];
+          }
+        }
+      }
+    }
+  }
+}
+
+// Packed descriptors of the convolution, yDim receives the output dimensions
+void createConvolutionDescriptors(const ConvolutionTestShape& shape, cudnnTensorDescriptor_t& xDesc, cudnnFilterDescriptor_t& wDesc,
+                                  cudnnConvolutionDescriptor_t& convDesc, cudnnTensorDescriptor_t& yDesc, int* yDim) {
+  const int nbDims = shape.dims + 2;
+  cudnnCreateTensorDescriptor(&xDesc);
+  cudnnCreateTensorDescriptor(&yDesc);
+  cudnnCreateFilterDescriptor(&wDesc);
+  cudnnCreateConvolutionDescriptor(&convDesc);
+  int xDim[5] = { shape.batch, shape.inChannels }, wDim[5] = { shape.outChannels, shape.inChannels }, xStride[5], yStride[5];
+  for (int d = 0; d < shape.dims; d++) {
+    xDim[d + 2] = shape.in[d];
+    wDim[d + 2] = shape.filter[d];
+  }
+  xStride[nbDims - 1] = 1;
+  for (int d = nbDims - 2; d >= 0; d--) {
+    xStride[d] = xStride[d + 1] * xDim[d + 1];
+  }
+  cudnnSetTensorNdDescriptor(xDesc, CUDNN_DATA_FLOAT, nbDims, xDim, xStride);
+  cudnnSetFilterNdDescriptor(wDesc, CUDNN_DATA_FLOAT, CUDNN_TENSOR_NCHW, nbDims, wDim);
+  cudnnSetConvolutionNdDescriptor(convDesc, shape.dims, shape.pad, shape.stride, shape.dilation, shape.mode, CUDNN_DATA_FLOAT);
+  cudnnGetConvolutionNdForwardOutputDim(convDesc, xDesc, wDesc, nbDims, yDim);
+  yStride[nbDims - 1] = 1;
+  for (int d = nbDims - 2; d >= 0; d--) {
+    yStride[d] = yStride[d + 1] * yDim[d + 1];
+  }
+  cudnnSetTensorNdDescriptor(yDesc, CUDNN_DATA_FLOAT, nbDims, yDim, yStride);
+}
+
+void destroyConvolutionDescriptors(cudnnTensorDescriptor_t xDesc, cudnnFilterDescriptor_t wDesc, cudnnConvolutionDescriptor_t convDesc, cudnnTensorDescriptor_t yDesc) {
+  cudnnDestroyConvolutionDescriptor(convDesc);
+  cudnnDestroyFilterDescriptor(wDesc);
+  cudnnDestroyTensorDescriptor(xDesc);
+  cudnnDestroyTensorDescriptor(yDesc);
+}
+
+// Runs all three passes of the host convolution with one algorithm and compares them to the reference.
+// workSpaceImages > 0 shrinks the GEMM workspace to that many images so the batch is processed in chunks
+bool testConvolution(const ConvolutionTestShape& shape, const bool bGemm, const int workSpaceImages) {
+
+  cout << "TEST cudnnConvolution with parameters: " << "dims=" << shape.dims << " batch=" << shape.batch << " inChannels=" << shape.inChannels
+       << " outChannels=" << shape.outChannels << " flip=" << (shape.mode == CUDNN_CONVOLUTION) << " gemm=" << bGemm << " workSpaceImages=" << workSpaceImages << endl;
+
+  const double EPS = 1.e-4;
+  const float alpha = 1.5f, beta = 0.5f;
+  cudnnTensorDescriptor_t xDesc, yDesc;
+  cudnnFilterDescriptor_t wDesc;
+  cudnnConvolutionDescriptor_t convDesc;
+  int yDim[5];
+  createConvolutionDescriptors(shape, xDesc, wDesc, convDesc, yDesc, yDim);
+
+  size_t inSize = 1, outSize = 1, filterSize = 1;
+  for (int d = 0; d < shape.dims; d++) {
+    inSize *= shape.in[d];
+    outSize *= yDim[d + 2];
+    filterSize *= shape.filter[d];
+  }
+  vector<NNFloat> vX((size_t)shape.batch * shape.inChannels * inSize), vDx(vX.size());
+  vector<NNFloat> vY((size_t)shape.batch * shape.outChannels * outSize), vDy(vY.size());
+  vector<NNFloat> vW((size_t)shape.outChannels * shape.inChannels * filterSize), vDw(vW.size());
+  for (size_t i = 0; i < vX.size(); i++) {
+    vX[i] = rand(-1.f, 1.f);
+    vDx[i] = rand(-1.f, 1.f);
+  }
+  for (size_t i = 0; i < vY.size(); i++) {
+    vY[i] = rand(-1.f, 1.f);
+    vDy[i] = rand(-1.f, 1.f);
+  }
+  for (size_t i = 0; i < vW.size(); i++) {
+    vW[i] = rand(-1.f, 1.f);
+    vDw[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vReferenceY, vReferenceDw, vReferenceDx;
+  referenceConvolution(shape, yDim + 2, vX, vW, vDy, vReferenceY, vReferenceDw, vReferenceDx);
+  vector<double> vExpectedY(vY.size()), vExpectedDw(vDw.size()), vExpectedDx(vDx.size());
+  for (size_t i = 0; i < vY.size(); i++) {
+    vExpectedY[i] = alpha * vReferenceY[i] + beta * vY[i];
+  }
+  for (size_t i = 0; i < vDw.size(); i++) {
+    vExpectedDw[i] = alpha * vReferenceDw[i] + beta * vDw[i];
+  }
+  for (size_t i = 0; i < vDx.size(); i++) {
+    vExpectedDx[i] = alpha * vReferenceDx[i] + beta * vDx[i];
+  }
+
+  cudnnConvolutionFwdAlgo_t forwardAlgo = bGemm ? CUDNN_CONVOLUTION_FWD_ALGO_GEMM : CUDNN_CONVOLUTION_FWD_ALGO_DIRECT;
+  cudnnConvolutionBwdFilterAlgo_t filterAlgo = bGemm ? CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1 : CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0;
+  cudnnConvolutionBwdDataAlgo_t dataAlgo = bGemm ? CUDNN_CONVOLUTION_BWD_DATA_ALGO_1 : CUDNN_CONVOLUTION_BWD_DATA_ALGO_0;
+  size_t forwardBytes, filterBytes, dataBytes;
+  cudnnGetConvolutionForwardWorkspaceSize(getGpu()._cuDNNHandle, xDesc, wDesc, convDesc, yDesc, forwardAlgo, &forwardBytes);
+  cudnnGetConvolutionBackwardFilterWorkspaceSize(getGpu()._cuDNNHandle, xDesc, yDesc, convDesc, wDesc, filterAlgo, &filterBytes);
+  cudnnGetConvolutionBackwardDataWorkspaceSize(getGpu()._cuDNNHandle, wDesc, yDesc, convDesc, xDesc, dataAlgo, &dataBytes);
+  size_t workSpaceBytes = max(forwardBytes, max(filterBytes, dataBytes));
+  if (workSpaceImages > 0) {
+    // The whole batch fits in the default workspace, so one image takes batch times less
+    workSpaceBytes = workSpaceBytes / shape.batch * workSpaceImages;
+  }
+
+  GpuBuffer<NNFloat>* pbX = new GpuBuffer<NNFloat>(vX.size());
+  GpuBuffer<NNFloat>* pbDx = new GpuBuffer<NNFloat>(vDx.size());
+  GpuBuffer<NNFloat>* pbY = new GpuBuffer<NNFloat>(vY.size());
+  GpuBuffer<NNFloat>* pbDy = new GpuBuffer<NNFloat>(vDy.size());
+  GpuBuffer<NNFloat>* pbW = new GpuBuffer<NNFloat>(vW.size());
+  GpuBuffer<NNFloat>* pbDw = new GpuBuffer<NNFloat>(vDw.size());
+  GpuBuffer<NNFloat>* pbWorkSpace = new GpuBuffer<NNFloat>(max(workSpaceBytes / sizeof(NNFloat), (size_t)1));
+  pbX->Upload(&vX[0]);
+  pbDx->Upload(&vDx[0]);
+  pbY->Upload(&vY[0]);
+  pbDy->Upload(&vDy[0]);
+  pbW->Upload(&vW[0]);
+  pbDw->Upload(&vDw[0]);
+  cudnnStatus_t forwardStatus = cudnnConvolutionForward(getGpu()._cuDNNHandle, &alpha, xDesc, pbX->_pDevData, wDesc, pbW->_pDevData, convDesc, forwardAlgo,
+                                                        pbWorkSpace->_pDevData, workSpaceBytes, &beta, yDesc, pbY->_pDevData);
+  cudnnStatus_t filterStatus = cudnnConvolutionBackwardFilter(getGpu()._cuDNNHandle, &alpha, xDesc, pbX->_pDevData, yDesc, pbDy->_pDevData, convDesc, filterAlgo,
+                                                              pbWorkSpace->_pDevData, workSpaceBytes, &beta, wDesc, pbDw->_pDevData);
+  cudnnStatus_t dataStatus = cudnnConvolutionBackwardData(getGpu()._cuDNNHandle, &alpha, wDesc, pbW->_pDevData, yDesc, pbDy->_pDevData, convDesc, dataAlgo,
+                                                          pbWorkSpace->_pDevData, workSpaceBytes, &beta, xDesc, pbDx->_pDevData);
+  pbY->Download(&vY[0]);
+  pbDw->Download(&vDw[0]);
+  pbDx->Download(&vDx[0]);
+  delete pbX;
+  delete pbDx;
+  delete pbY;
+  delete pbDy;
+  delete pbW;
+  delete pbDw;
+  delete pbWorkSpace;
+  destroyConvolutionDescriptors(xDesc, wDesc, convDesc, yDesc);
+
+  int countError = (forwardStatus != CUDNN_STATUS_SUCCESS) + (filterStatus != CUDNN_STATUS_SUCCESS) + (dataStatus != CUDNN_STATUS_SUCCESS);
+  countError += countRelativeErrors("forward", vY, vExpectedY, EPS);
+  countError += countRelativeErrors("backward filter", vDw, vExpectedDw, EPS);
+  countError += countRelativeErrors("backward data", vDx, vExpectedDx, EPS);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+// DSSTNE_HOST_CONV forces either algorithm for every pass, without it the choice is the timing run's
+bool testConvolutionAlgorithm(const ConvolutionTestShape& shape, const char* pAlgo) {
+
+  cout << "TEST cudnnGetConvolution*Algorithm with DSSTNE_HOST_CONV=" << (pAlgo ? pAlgo : "") << endl;
+
+  cudnnTensorDescriptor_t xDesc, yDesc;
+  cudnnFilterDescriptor_t wDesc;
+  cudnnConvolutionDescriptor_t convDesc;
+  int yDim[5];
+  createConvolutionDescriptors(shape, xDesc, wDesc, convDesc, yDesc, yDim);
+
+  if (pAlgo) {
+    setenv("DSSTNE_HOST_CONV", pAlgo, 1);
+  }
+  cudnnConvolutionFwdAlgo_t forwardAlgo;
+  cudnnConvolutionBwdFilterAlgo_t filterAlgo;
+  cudnnConvolutionBwdDataAlgo_t dataAlgo;
+  cudnnGetConvolutionForwardAlgorithm(getGpu()._cuDNNHandle, xDesc, wDesc, convDesc, yDesc, CUDNN_CONVOLUTION_FWD_PREFER_FASTEST, 0, &forwardAlgo);
+  cudnnGetConvolutionBackwardFilterAlgorithm(getGpu()._cuDNNHandle, xDesc, yDesc, convDesc, wDesc, CUDNN_CONVOLUTION_BWD_FILTER_PREFER_FASTEST, 0, &filterAlgo);
+  cudnnGetConvolutionBackwardDataAlgorithm(getGpu()._cuDNNHandle, wDesc, yDesc, convDesc, xDesc, CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST, 0, &dataAlgo);
+  unsetenv("DSSTNE_HOST_CONV");
+  destroyConvolutionDescriptors(xDesc, wDesc, convDesc, yDesc);
+
+  int countError = 0;
+  if (pAlgo) {
+    const bool bGemm = (string(pAlgo) == "gemm");
+    countError += (forwardAlgo != (bGemm ? CUDNN_CONVOLUTION_FWD_ALGO_GEMM : CUDNN_CONVOLUTION_FWD_ALGO_DIRECT));
+    countError += (filterAlgo != (bGemm ? CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1 : CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0));
+    countError += (dataAlgo != (bGemm ? CUDNN_CONVOLUTION_BWD_DATA_ALGO_1 : CUDNN_CONVOLUTION_BWD_DATA_ALGO_0));
+  } else {
+    countError += (forwardAlgo != CUDNN_CONVOLUTION_FWD_ALGO_GEMM) && (forwardAlgo != CUDNN_CONVOLUTION_FWD_ALGO_DIRECT);
+    countError += (filterAlgo != CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1) && (filterAlgo != CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0);
+    countError += (dataAlgo != CUDNN_CONVOLUTION_BWD_DATA_ALGO_1) && (dataAlgo != CUDNN_CONVOLUTION_BWD_DATA_ALGO_0);
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestConvolution : public CppUnit::TestFixture
+{
+public:             // Interface
+    // Every shape runs with direct convolution, im2col + GEMM over the whole batch and GEMM one image at a time
+    bool            testAlgorithms(const ConvolutionTestShape& shape)
+    {
+      return testConvolution(shape, false, 0) && testConvolution(shape, true, 0) && testConvolution(shape, true, 1);
+    }
+
+    void            TestConvolution2D()
+    {
+      {
+        const ConvolutionTestShape shape = { 3, 3, 4, 2, { 9, 8 }, { 3, 3 }, { 1, 1 }, { 1, 1 }, { 1, 1 }, CUDNN_CROSS_CORRELATION };
+        CPPUNIT_ASSERT_MESSAGE("failed with same padding", testAlgorithms(shape));
+      }
+      {
+        const ConvolutionTestShape shape = { 3, 2, 5, 2, { 11, 10 }, { 3, 2 }, { 2, 1 }, { 2, 3 }, { 2, 1 }, CUDNN_CONVOLUTION };
+        CPPUNIT_ASSERT_MESSAGE("failed with padding, stride, dilation and a flipped filter", testAlgorithms(shape));
+      }
+      {
+        const ConvolutionTestShape shape = { 2, 1, 3, 2, { 6, 7 }, { 5, 5 }, { 0, 0 }, { 1, 1 }, { 1, 1 }, CUDNN_CROSS_CORRELATION };
+        CPPUNIT_ASSERT_MESSAGE("failed without padding", testAlgorithms(shape));
+      }
+    }
+
+    void            TestConvolution3D()
+    {
+      const ConvolutionTestShape shape = { 2, 2, 3, 3, { 5, 6, 7 }, { 2, 3, 3 }, { 1, 0, 1 }, { 2, 1, 2 }, { 1, 2, 1 }, CUDNN_CROSS_CORRELATION };
+      CPPUNIT_ASSERT_MESSAGE("failed in 3D", testAlgorithms(shape));
+    }
+
+    void            TestConvolutionAlgorithm()
+    {
+      const ConvolutionTestShape shape = { 4, 3, 4, 2, { 9, 8 }, { 3, 3 }, { 1, 1 }, { 1, 1 }, { 1, 1 }, CUDNN_CROSS_CORRELATION };
+      CPPUNIT_ASSERT_MESSAGE("failed forcing direct convolution", testConvolutionAlgorithm(shape, "direct"));
+      CPPUNIT_ASSERT_MESSAGE("failed forcing im2col + GEMM", testConvolutionAlgorithm(shape, "gemm"));
+      CPPUNIT_ASSERT_MESSAGE("failed timing the algorithms", testConvolutionAlgorithm(shape, NULL));
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestConvolution);
+    CPPUNIT_TEST(TestConvolution2D);
+    CPPUNIT_TEST(TestConvolution3D);
+    CPPUNIT_TEST(TestConvolutionAlgorithm);
+    CPPUNIT_TEST_SUITE_END();
+};
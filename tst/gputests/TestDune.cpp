@@ -5,6 +5,19 @@
 #include <string>
 
 #include "TestSort.cpp"
+#include "TestSparse.cpp"
+#include "TestQuantize.cpp"
+#include "TestHalf.cpp"
+#include "TestCandidates.cpp"
+#include "TestIndex.cpp"
+#include "TestPrune.cpp"
+#include "TestFactorize.cpp"
+#include "TestPooling.cpp"
+#include "TestEnsemble.cpp"
+#ifdef HOST_ONLY
+// Compares the host convolution algorithms, which cuDNN does not provide
+#include "TestConvolution.cpp"
+#endif
 
 /**
  * In order to write a new test case, create a Test<File>.cpp and write the test
@@ -21,6 +34,18 @@ int main() {
     getGpu().CopyConstants();
     CppUnit::TextUi::TestRunner runner;
     runner.addTest(TestSort::suite());
+    runner.addTest(TestSparse::suite());
+    runner.addTest(TestQuantize::suite());
+    runner.addTest(TestHalf::suite());
+    runner.addTest(TestCandidates::suite());
+    runner.addTest(TestIndex::suite());
+    runner.addTest(TestPrune::suite());
+    runner.addTest(TestFactorize::suite());
+    runner.addTest(TestPooling::suite());
+    runner.addTest(TestEnsemble::suite());
+#ifdef HOST_ONLY
+    runner.addTest(TestConvolution::suite());
+#endif
     const bool result = runner.run();
     getGpu().Shutdown();
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
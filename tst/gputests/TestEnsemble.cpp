@@ -0,0 +1,121 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include "NNEnsemble.h"
+
+using namespace std;
+
+// Recs layer units of three networks for a batch of 2 and 6 outputs, each network ranks the outputs differently
+static const uint32_t ENSEMBLE_BATCH = 2;
+static const uint32_t ENSEMBLE_WIDTH = 6;
+static const NNFloat ENSEMBLE_UNIT[3][ENSEMBLE_BATCH * ENSEMBLE_WIDTH] = {
+  {0.1f, 0.9f, 0.4f, 0.2f, 0.7f, 0.3f,   0.6f, 0.1f, 0.3f, 0.8f, 0.0f, 0.5f},
+  {0.8f, 0.2f, 0.5f, 0.1f, 0.6f, 0.0f,   0.2f, 0.7f, 0.1f, 0.4f, 0.9f, 0.3f},
+  {0.3f, 0.45f, 0.9f, 0.6f, 0.1f, 0.2f,  0.5f, 0.3f, 0.2f, 0.1f, 0.4f, 0.8f},
+};
+static const NNFloat ENSEMBLE_WEIGHT[3] = {0.5f, 1.0f, 2.0f};
+
+// Counts combined scores further than EPS from the expected ones, and rows whose top k is not the expected one
+int countEnsembleErrors(vector<NNFloat>& vCombined, const NNFloat* pExpected, const unsigned int* pExpectedTopK, const uint32_t k) {
+  const NNFloat EPS = 1.e-6f;
+  int countError = 0;
+  for (size_t i = 0; i < vCombined.size(); i++) {
+    if (fabs(vCombined[i] - pExpected[i]) > EPS) {
+      countError++;
+    }
+  }
+  vector<NNFloat> vKey(ENSEMBLE_BATCH * k);
+  vector<unsigned int> vIndex(ENSEMBLE_BATCH * k);
+  hCalculateTopK(vCombined.data(), vKey.data(), vIndex.data(), ENSEMBLE_BATCH, ENSEMBLE_WIDTH, k);
+  for (size_t i = 0; i < vIndex.size(); i++) {
+    if (vIndex[i] != pExpectedTopK[i]) {
+      countError++;
+      break;
+    }
+  }
+  return countError;
+}
+
+// The first network's units are scaled in place, the other networks' weighted units are added to them
+bool testEnsembleWeightedSum() {
+
+  cout << "TEST NNEnsemble weighted sum" << endl;
+
+  const size_t size = ENSEMBLE_BATCH * ENSEMBLE_WIDTH;
+  vector<GpuBuffer<NNFloat>*> vbUnit;
+  for (size_t n = 0; n < 3; n++) {
+    vbUnit.push_back(new GpuBuffer<NNFloat>(size));
+    vbUnit[n]->Upload((NNFloat*)ENSEMBLE_UNIT[n]);
+  }
+  for (size_t n = 0; n < 3; n++) {
+    NNEnsemble::addWeightedUnits(vbUnit[0]->_pDevData, vbUnit[n]->_pDevData, size, ENSEMBLE_WEIGHT[n]);
+  }
+  vector<NNFloat> vCombined(size);
+  vbUnit[0]->Download(vCombined.data());
+  for (size_t n = 0; n < 3; n++) {
+    delete vbUnit[n];
+  }
+
+  // 0.5 * first + second + 2 * third
+  const NNFloat expected[size] = {1.45f, 1.55f, 2.5f, 1.4f, 1.15f, 0.55f,
+                                  1.5f, 1.35f, 0.65f, 1.0f, 1.7f, 2.15f};
+  const unsigned int expectedTopK[ENSEMBLE_BATCH * 3] = {2, 1, 0,
+                                                         5, 4, 0};
+  int countError = countEnsembleErrors(vCombined, expected, expectedTopK, 3);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+// Each network adds weight / (60 + rank) to its top 3 outputs, ranks counting from 1
+bool testEnsembleRankFusion() {
+
+  cout << "TEST NNEnsemble rank fusion" << endl;
+
+  const size_t size = ENSEMBLE_BATCH * ENSEMBLE_WIDTH;
+  vector<NNFloat> vFused(size, (NNFloat)0.0);
+  vector<NNFloat> vUnit, vKey;
+  vector<unsigned int> vIndex;
+  for (size_t n = 0; n < 3; n++) {
+    vUnit.assign(ENSEMBLE_UNIT[n], ENSEMBLE_UNIT[n] + size);
+    NNEnsemble::addRankFusion(vUnit, ENSEMBLE_BATCH, ENSEMBLE_WIDTH, 3, ENSEMBLE_WEIGHT[n], vKey, vIndex, vFused);
+  }
+
+  // Top 3 of row 0 are 1, 4, 2 / 0, 4, 2 / 2, 3, 1 and of row 1 3, 0, 5 / 4, 1, 3 / 5, 0, 4
+  const NNFloat expected[size] = {1.0f / 61, 0.5f / 61 + 2.0f / 63, 0.5f / 63 + 1.0f / 63 + 2.0f / 61, 2.0f / 62, 0.5f / 62 + 1.0f / 62, 0.0f,
+                                  0.5f / 62 + 2.0f / 62, 1.0f / 62, 0.0f, 0.5f / 61 + 1.0f / 63, 1.0f / 61 + 2.0f / 63, 0.5f / 63 + 2.0f / 61};
+  const unsigned int expectedTopK[ENSEMBLE_BATCH * 3] = {2, 1, 3,
+                                                         4, 5, 0};
+  int countError = countEnsembleErrors(vFused, expected, expectedTopK, 3);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestEnsemble : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestEnsembleWeightedSum()
+    {
+      bool result = testEnsembleWeightedSum();
+      CPPUNIT_ASSERT_MESSAGE("failed weighted sum of known units", result);
+    }
+
+    void            TestEnsembleRankFusion()
+    {
+      bool result = testEnsembleRankFusion();
+      CPPUNIT_ASSERT_MESSAGE("failed rank fusion of known units", result);
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestEnsemble);
+    CPPUNIT_TEST(TestEnsembleWeightedSum);
+    CPPUNIT_TEST(TestEnsembleRankFusion);
+    CPPUNIT_TEST_SUITE_END();
+};
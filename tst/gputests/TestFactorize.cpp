@@ -0,0 +1,88 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+using namespace std;
+
+// W = U V + noise with U [inputs][trueRank] and V [trueRank][outputs].  The rank factorization must reproduce W
+// to within maxError in relative Frobenius norm, and its reported energy must match the error it makes
+bool testFactorize(const uint32_t inputs, const uint32_t outputs, const uint32_t trueRank, const uint32_t rank, const float noise, const double maxError) {
+
+  cout << "TEST FactorizeWeights with parameters: " << "inputs=" << inputs << " outputs=" << outputs << " trueRank=" << trueRank
+       << " rank=" << rank << " noise=" << noise << endl;
+
+  vector<NNFloat> vU((size_t)inputs * trueRank), vV((size_t)trueRank * outputs);
+  for (size_t i = 0; i < vU.size(); i++) {
+    vU[i] = rand(-1.f, 1.f);
+  }
+  for (size_t i = 0; i < vV.size(); i++) {
+    vV[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < inputs; i++) {
+    for (size_t o = 0; o < outputs; o++) {
+      double sum = rand(-noise, noise);
+      for (size_t j = 0; j < trueRank; j++) {
+        sum += (double)vU[i * trueRank + j] * vV[j * outputs + o];
+      }
+      vWeight[i * outputs + o] = (NNFloat)sum;
+    }
+  }
+
+  vector<NNFloat> vLeft, vRight;
+  NNFloat energy = (NNFloat)0.0;
+  if (!FactorizeWeights(inputs, outputs, &vWeight[0], rank, vLeft, vRight, &energy)) {
+    cout << "ERROR; factorization failed" << endl;
+    return false;
+  }
+
+  double error = 0.0, total = 0.0;
+  for (size_t i = 0; i < inputs; i++) {
+    for (size_t o = 0; o < outputs; o++) {
+      double sum = 0.0;
+      for (size_t j = 0; j < rank; j++) {
+        sum += (double)vLeft[i * rank + j] * vRight[j * outputs + o];
+      }
+      error += (sum - vWeight[i * outputs + o]) * (sum - vWeight[i * outputs + o]);
+      total += (double)vWeight[i * outputs + o] * vWeight[i * outputs + o];
+    }
+  }
+  const double relativeError = sqrt(error / total);
+  const bool bEnergy = fabs((1.0 - energy) - error / total) < 1.e-3;
+  const bool bPass = (relativeError <= maxError) && bEnergy;
+  cout << (bPass ? "PASS; " : "ERROR; ") << "relative error " << relativeError << " energy " << energy << endl;
+  return bPass;
+}
+
+//----------------------------------------------------------------------------
+class TestFactorize : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestFactorizeWeights()
+    {
+      {
+        bool result = testFactorize(256, 5000, 32, 32, 0.0f, 1.e-4);
+        CPPUNIT_ASSERT_MESSAGE("failed recovering an exactly low rank matrix", result);
+      }
+      {
+        bool result = testFactorize(300, 2001, 64, 64, 0.01f, 0.01);
+        CPPUNIT_ASSERT_MESSAGE("failed with noise", result);
+      }
+      {
+        bool result = testFactorize(128, 1000, 128, 32, 0.0f, 1.0);
+        CPPUNIT_ASSERT_MESSAGE("failed truncating a full rank matrix", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestFactorize);
+    CPPUNIT_TEST(TestFactorizeWeights);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -0,0 +1,164 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include "Utils.h"
+#include "TestReference.h"
+
+using namespace std;
+
+// Known encodings, including round to nearest even, subnormals and fp16 overflow
+bool testConvertWeights() {
+
+  cout << "TEST hConvertWeights" << endl;
+
+  const NNFloat vValue[]        = { 1.0f, -2.0f, 65504.0f, 70000.0f, 5.9604644775390625e-8f, 1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f, 1.0f + 1.0f / 256.0f };
+  const uint16_t vHalf[]        = { 0x3c00, 0xc000, 0x7bff, 0x7c00, 0x0001, 0x3c00, 0x3c02, 0x3c04 };
+  const uint16_t vBF16[]        = { 0x3f80, 0xc000, 0x4780, 0x4789, 0x3380, 0x3f80, 0x3f80, 0x3f80 };
+  const uint32_t outputs        = sizeof(vValue) / sizeof(NNFloat);
+  vector<uint16_t> vWeight(hHalfSize(1, outputs));
+
+  int countError = 0;
+  hConvertWeights(1, outputs, vValue, &vWeight[0], HalfFP16);
+  for (uint32_t o = 0; o < outputs; o++) {
+    if (vWeight[o] != vHalf[o]) {
+      cout << "fp16 " << vValue[o] << " expected " << hex << vHalf[o] << " got " << vWeight[o] << dec << endl;
+      countError++;
+    }
+  }
+  hConvertWeights(1, outputs, vValue, &vWeight[0], HalfBF16);
+  for (uint32_t o = 0; o < outputs; o++) {
+    if (vWeight[o] != vBF16[o]) {
+      cout << "bf16 " << vValue[o] << " expected " << hex << vBF16[o] << " got " << vWeight[o] << dec << endl;
+      countError++;
+    }
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+// Errors are measured against the sum of absolute terms, bf16 keeps 8 bits of mantissa
+bool testHalfGemm(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const HalfFormat format) {
+
+  cout << "TEST hHalfGemm with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs << " bf16=" << (format == HalfBF16) << endl;
+
+  const double EPS = (format == HalfFP16) ? 1.e-3 : 1.e-2;
+  vector<NNFloat> vInput((size_t)batch * inputs);
+  for (size_t i = 0; i < vInput.size(); i++) {
+    vInput[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vExpected, vScale;
+  referenceGemm(batch, inputs, outputs, vInput, vWeight, vUnit, vExpected, vScale);
+
+  vector<uint16_t> vHalfWeight(hHalfSize(inputs, outputs));
+  hConvertWeights(inputs, outputs, &vWeight[0], &vHalfWeight[0], format);
+  hHalfGemm(batch, outputs, inputs, &vInput[0], &vHalfWeight[0], format, &vUnit[0]);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+bool testHalfSparseZ(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t datapoints, const bool bAnalog, const HalfFormat format) {
+
+  cout << "TEST hCalculateHalfSparseZ with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " datapoints=" << datapoints << " analog=" << bAnalog << " bf16=" << (format == HalfBF16) << endl;
+
+  const double EPS = (format == HalfFP16) ? 1.e-3 : 1.e-2;
+  vector<uint64_t> vSparseStart(batch), vSparseEnd(batch);
+  vector<uint32_t> vSparseIndex;
+  vector<NNFloat> vSparseData;
+  for (size_t i = 0; i < batch; i++) {
+    vSparseStart[i] = vSparseIndex.size();
+    for (size_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)inputs - 1));
+      vSparseData.push_back(rand(-1.f, 1.f));
+    }
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  // Run with beta = 1 on top of the initial units
+  vector<double> vExpected, vScale;
+  referenceSparseZ(batch, outputs, vSparseStart, vSparseEnd, vSparseIndex, bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, vWeight, vUnit, vExpected, vScale);
+
+  vector<uint16_t> vHalfWeight(hHalfSize(inputs, outputs));
+  hConvertWeights(inputs, outputs, &vWeight[0], &vHalfWeight[0], format);
+  hCalculateHalfSparseZ(0, batch, outputs, &vHalfWeight[0], format, &vSparseStart[0], &vSparseEnd[0], &vSparseIndex[0],
+                        bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, &vUnit[0], (NNFloat)1.0);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestHalf : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestConvertWeights()
+    {
+      bool result = testConvertWeights();
+      CPPUNIT_ASSERT_MESSAGE("failed converting weights", result);
+    }
+
+    void            TestHalfGemm()
+    {
+      {
+        bool result = testHalfGemm(1, 256, 512, HalfFP16);
+        CPPUNIT_ASSERT_MESSAGE("failed fp16 with a single example", result);
+      }
+      {
+        bool result = testHalfGemm(37, 257, 1001, HalfFP16);
+        CPPUNIT_ASSERT_MESSAGE("failed fp16 with unaligned sizes", result);
+      }
+      {
+        bool result = testHalfGemm(37, 257, 1001, HalfBF16);
+        CPPUNIT_ASSERT_MESSAGE("failed bf16 with unaligned sizes", result);
+      }
+    }
+
+    void            TestHalfSparseZ()
+    {
+      getGpu()._data._bShuffleIndices = false;
+      {
+        bool result = testHalfSparseZ(64, 20000, 384, 20, false, HalfFP16);
+        CPPUNIT_ASSERT_MESSAGE("failed fp16 with boolean inputs", result);
+      }
+      {
+        bool result = testHalfSparseZ(33, 5000, 1001, 50, true, HalfBF16);
+        CPPUNIT_ASSERT_MESSAGE("failed bf16 with analog inputs", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestHalf);
+    CPPUNIT_TEST(TestConvertWeights);
+    CPPUNIT_TEST(TestHalfGemm);
+    CPPUNIT_TEST(TestHalfSparseZ);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -0,0 +1,247 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+#include <cstdio>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+#include "TopKRecall.h"
+
+using namespace std;
+
+// Output weight columns are drawn around clusters random centers, as trained item embeddings tend to be,
+// and queries around random centers
+void clusteredIndexData(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t clusters,
+                        vector<NNFloat>& vWeight, vector<NNFloat>& vBias, vector<NNFloat>& vQuery) {
+  vector<NNFloat> vCenter((size_t)clusters * inputs);
+  for (size_t i = 0; i < vCenter.size(); i++) {
+    vCenter[i] = rand(-1.f, 1.f);
+  }
+  vWeight.resize((size_t)inputs * outputs);
+  vBias.resize(outputs);
+  for (size_t o = 0; o < outputs; o++) {
+    const size_t c = rand(0, (int)clusters - 1);
+    for (size_t i = 0; i < inputs; i++) {
+      vWeight[i * outputs + o] = vCenter[c * inputs + i] + rand(-0.1f, 0.1f);
+    }
+    vBias[o] = rand(-0.1f, 0.1f);
+  }
+  vQuery.resize((size_t)batch * inputs);
+  for (size_t b = 0; b < batch; b++) {
+    const size_t c = rand(0, (int)clusters - 1);
+    for (size_t i = 0; i < inputs; i++) {
+      vQuery[b * inputs + i] = vCenter[c * inputs + i] + rand(-0.5f, 0.5f);
+    }
+  }
+}
+
+// Recall@k is the fraction of the exact top k inner products (weights plus bias) of clustered outputs
+// found among the candidates of probes lists
+bool testIndexRecall(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t clusters, const uint32_t lists,
+                     const uint32_t probes, const uint32_t k, const double minRecall) {
+
+  cout << "TEST NNIndex recall with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " clusters=" << clusters << " lists=" << lists << " probes=" << probes << " k=" << k << endl;
+
+  vector<NNFloat> vWeight, vBias, vQuery;
+  clusteredIndexData(batch, inputs, outputs, clusters, vWeight, vBias, vQuery);
+
+  NNIndex* pIndex = NNIndex::Build(inputs, outputs, &vWeight[0], &vBias[0], lists);
+  pIndex->SetProbes(probes);
+  vector<uint64_t> vCandidateStart, vCandidateEnd;
+  vector<uint32_t> vCandidate;
+  pIndex->Search(batch, &vQuery[0], vCandidateStart, vCandidateEnd, vCandidate);
+  delete pIndex;
+
+  uint64_t matches = 0;
+  uint64_t candidates = 0;
+  vector<pair<NNFloat, uint32_t> > vScore(outputs);
+  for (size_t b = 0; b < batch; b++) {
+    for (uint32_t o = 0; o < outputs; o++) {
+      double score = vBias[o];
+      for (size_t i = 0; i < inputs; i++) {
+        score += (double)vQuery[b * inputs + i] * vWeight[i * outputs + o];
+      }
+      vScore[o] = make_pair((NNFloat)-score, o);
+    }
+    partial_sort(vScore.begin(), vScore.begin() + k, vScore.end());
+    set<uint32_t> sCandidate(vCandidate.begin() + vCandidateStart[b], vCandidate.begin() + vCandidateEnd[b]);
+    for (size_t j = 0; j < k; j++) {
+      matches += sCandidate.count(vScore[j].second);
+    }
+    candidates += vCandidateEnd[b] - vCandidateStart[b];
+  }
+  const double recall = (double)matches / ((double)batch * k);
+  cout << (recall >= minRecall ? "PASS; " : "ERROR; ") << "recall@" << k << " " << recall << " average candidates " << (double)candidates / batch << endl;
+  return (recall >= minRecall);
+}
+
+// Recall as predict's parity check computes it, the top k of the candidate units mapped back to outputs
+// against the exact top k, through the same helpers.  It must agree with the fraction of the exact top k
+// found among the candidates, and be 1 when every list is probed
+bool testIndexParityRecall(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t clusters, const uint32_t lists,
+                           const uint32_t probes, const uint32_t k, const double minRecall) {
+
+  cout << "TEST NNIndex parity recall with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " clusters=" << clusters << " lists=" << lists << " probes=" << probes << " k=" << k << endl;
+
+  vector<NNFloat> vWeight, vBias, vQuery;
+  clusteredIndexData(batch, inputs, outputs, clusters, vWeight, vBias, vQuery);
+
+  NNIndex* pIndex = NNIndex::Build(inputs, outputs, &vWeight[0], &vBias[0], lists);
+  pIndex->SetProbes(probes);
+  vector<uint64_t> vCandidateStart, vCandidateEnd;
+  vector<uint32_t> vCandidate;
+  pIndex->Search(batch, &vQuery[0], vCandidateStart, vCandidateEnd, vCandidate);
+  delete pIndex;
+
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t b = 0; b < batch; b++) {
+    for (uint32_t o = 0; o < outputs; o++) {
+      double score = vBias[o];
+      for (size_t i = 0; i < inputs; i++) {
+        score += (double)vQuery[b * inputs + i] * vWeight[i * outputs + o];
+      }
+      vUnit[b * outputs + o] = (NNFloat)score;
+    }
+  }
+
+  // Candidate units are laid out at the widest candidate list, padded with -MAX_VALUE like a restricted layer
+  uint32_t stride = 0;
+  for (size_t b = 0; b < batch; b++) {
+    stride = max(stride, (uint32_t)(vCandidateEnd[b] - vCandidateStart[b]));
+  }
+  vector<NNFloat> vCandidateUnit((size_t)batch * stride, -MAX_VALUE);
+  for (size_t b = 0; b < batch; b++) {
+    for (uint64_t j = vCandidateStart[b]; j < vCandidateEnd[b]; j++) {
+      vCandidateUnit[b * stride + j - vCandidateStart[b]] = vUnit[b * outputs + vCandidate[j]];
+    }
+  }
+
+  vector<NNFloat> vKey;
+  vector<unsigned int> vReferenceIndex, vApproximateIndex;
+  calculateTopKIndices(vCandidateUnit, batch, stride, k, vKey, vApproximateIndex);
+  for (size_t b = 0; b < batch; b++) {
+    mapCandidateIndices(&vApproximateIndex[b * k], k, &vCandidate[vCandidateStart[b]], vCandidateEnd[b] - vCandidateStart[b]);
+  }
+  calculateTopKIndices(vUnit, batch, outputs, k, vKey, vReferenceIndex);
+
+  uint64_t expected = 0;
+  for (size_t b = 0; b < batch; b++) {
+    set<uint32_t> sCandidate(vCandidate.begin() + vCandidateStart[b], vCandidate.begin() + vCandidateEnd[b]);
+    for (size_t j = 0; j < k; j++) {
+      expected += sCandidate.count(vReferenceIndex[b * k + j]);
+    }
+  }
+  const uint64_t matches = countTopKMatches(vReferenceIndex, vApproximateIndex, batch, k);
+  const double recall = (double)matches / ((double)batch * k);
+  const bool bPass = (matches == expected) && (recall >= minRecall);
+  cout << (bPass ? "PASS; " : "ERROR; ") << "recall@" << k << " " << recall << " expected " << (double)expected / ((double)batch * k) << endl;
+  return bPass;
+}
+
+// Probing every list must return each output exactly once, before and after a save/load round trip
+bool testIndexExhaustive(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t lists) {
+
+  cout << "TEST NNIndex exhaustive search with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " lists=" << lists << endl;
+
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vQuery((size_t)batch * inputs);
+  for (size_t i = 0; i < vQuery.size(); i++) {
+    vQuery[i] = rand(-1.f, 1.f);
+  }
+
+  const string fname = "TestIndex.idx";
+  NNIndex* pIndex = NNIndex::Build(inputs, outputs, &vWeight[0], NULL, lists);
+  pIndex->SetProbes(lists);
+  bool bSaved = pIndex->Save(fname);
+  NNIndex* pLoadedIndex = NNIndex::Load(fname);
+  remove(fname.c_str());
+
+  int countError = 0;
+  if (!bSaved || (pLoadedIndex == NULL) || (pLoadedIndex->GetProbes() != pIndex->GetProbes()) || (pLoadedIndex->GetLists() != pIndex->GetLists())) {
+    cout << "ERROR; index did not survive a save/load round trip" << endl;
+    delete pIndex;
+    delete pLoadedIndex;
+    return false;
+  }
+
+  vector<uint64_t> vCandidateStart, vCandidateEnd, vLoadedStart, vLoadedEnd;
+  vector<uint32_t> vCandidate, vLoadedCandidate;
+  pIndex->Search(batch, &vQuery[0], vCandidateStart, vCandidateEnd, vCandidate);
+  pLoadedIndex->Search(batch, &vQuery[0], vLoadedStart, vLoadedEnd, vLoadedCandidate);
+  delete pIndex;
+  delete pLoadedIndex;
+
+  if ((vCandidate != vLoadedCandidate) || (vCandidateStart != vLoadedStart) || (vCandidateEnd != vLoadedEnd)) {
+    countError++;
+  }
+  for (size_t b = 0; b < batch; b++) {
+    vector<uint32_t> vList(vCandidate.begin() + vCandidateStart[b], vCandidate.begin() + vCandidateEnd[b]);
+    sort(vList.begin(), vList.end());
+    if (vList.size() != outputs) {
+      countError++;
+      continue;
+    }
+    for (uint32_t o = 0; o < outputs; o++) {
+      if (vList[o] != o) {
+        countError++;
+        break;
+      }
+    }
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestIndex : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestIndexExhaustive()
+    {
+      {
+        bool result = testIndexExhaustive(16, 64, 5001, 50);
+        CPPUNIT_ASSERT_MESSAGE("failed probing every list", result);
+      }
+      {
+        bool result = testIndexExhaustive(3, 17, 10, 32);
+        CPPUNIT_ASSERT_MESSAGE("failed with more lists than outputs", result);
+      }
+    }
+
+    void            TestIndexRecall()
+    {
+      {
+        bool result = testIndexRecall(64, 64, 20000, 100, 100, 3, 10, 0.9);
+        CPPUNIT_ASSERT_MESSAGE("failed recall on clustered outputs", result);
+      }
+    }
+
+    void            TestIndexParityRecall()
+    {
+      {
+        bool result = testIndexParityRecall(64, 64, 20000, 100, 100, 3, 10, 0.9);
+        CPPUNIT_ASSERT_MESSAGE("failed parity recall on clustered outputs", result);
+      }
+      {
+        bool result = testIndexParityRecall(16, 32, 3001, 20, 40, 40, 16, 1.0);
+        CPPUNIT_ASSERT_MESSAGE("failed parity recall probing every list", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestIndex);
+    CPPUNIT_TEST(TestIndexExhaustive);
+    CPPUNIT_TEST(TestIndexRecall);
+    CPPUNIT_TEST(TestIndexParityRecall);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -0,0 +1,283 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+#include "TestReference.h"
+
+using namespace std;
+
+// 2D pooling of an NCHW tensor against a double precision reference, with padding and alpha/beta blending.
+// Max pooling sends each delta to the first maximum of its window, average pooling spreads it over the
+// window count
+bool testPooling(const cudnnPoolingMode_t mode, const int batch, const int channels, const int height, const int width,
+                 const int windowH, const int windowW, const int padH, const int padW, const int strideH, const int strideW) {
+
+  cout << "TEST cudnnPoolingForward/Backward with parameters: " << "mode=" << mode << " batch=" << batch << " channels=" << channels
+       << " input=" << height << "x" << width << " window=" << windowH << "x" << windowW << " padding=" << padH << "x" << padW
+       << " stride=" << strideH << "x" << strideW << endl;
+
+  const double EPS = 1.e-5;
+  const float alpha = 1.5f, beta = 0.5f;
+  const int outH = 1 + (height + 2 * padH - windowH) / strideH;
+  const int outW = 1 + (width + 2 * padW - windowW) / strideW;
+  const size_t planes = (size_t)batch * channels;
+  vector<NNFloat> vX(planes * height * width), vDx(vX.size());
+  vector<NNFloat> vY(planes * outH * outW), vDy(vY.size());
+  for (size_t i = 0; i < vX.size(); i++) {
+    vX[i] = rand(-1.f, 1.f);
+    vDx[i] = rand(-1.f, 1.f);
+  }
+  for (size_t i = 0; i < vY.size(); i++) {
+    vY[i] = rand(-1.f, 1.f);
+    vDy[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vExpectedY(vY.size()), vExpectedDx(vDx.begin(), vDx.end());
+  for (size_t i = 0; i < vExpectedDx.size(); i++) {
+    vExpectedDx[i] *= beta;
+  }
+  for (size_t p = 0; p < planes; p++) {
+    const NNFloat* pX = &vX[p * height * width];
+    double* pDx = &vExpectedDx[p * height * width];
+    for (int oh = 0; oh < outH; oh++) {
+      for (int ow = 0; ow < outW; ow++) {
+        const int h0 = max(oh * strideH - padH, 0), h1 = min(oh * strideH - padH + windowH, height);
+        const int w0 = max(ow * strideW - padW, 0), w1 = min(ow * strideW - padW + windowW, width);
+        const size_t o = (p * outH + oh) * outW + ow;
+        const double delta = alpha * vDy[o];
+        double value;
+        if (mode == CUDNN_POOLING_MAX) {
+          int argmax = h0 * width + w0;
+          for (int h = h0; h < h1; h++) {
+            for (int w = w0; w < w1; w++) {
+              if (pX[h * width + w] > pX[argmax]) {
+                argmax = h * width + w;
+              }
+            }
+          }
+          value = pX[argmax];
+          pDx[argmax] += delta;
+        } else {
+          const int count = (mode == CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING) ? windowH * windowW : (h1 - h0) * (w1 - w0);
+          double sum = 0.0;
+          for (int h = h0; h < h1; h++) {
+            for (int w = w0; w < w1; w++) {
+              sum += pX[h * width + w];
+              pDx[h * width + w] += delta / count;
+            }
+          }
+          value = sum / count;
+        }
+        vExpectedY[o] = alpha * value + beta * vY[o];
+      }
+    }
+  }
+
+  cudnnTensorDescriptor_t xDesc, yDesc;
+  cudnnPoolingDescriptor_t poolingDesc;
+  cudnnCreateTensorDescriptor(&xDesc);
+  cudnnCreateTensorDescriptor(&yDesc);
+  cudnnCreatePoolingDescriptor(&poolingDesc);
+  cudnnSetTensor4dDescriptor(xDesc, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, batch, channels, height, width);
+  cudnnSetTensor4dDescriptor(yDesc, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, batch, channels, outH, outW);
+  const int window[2] = { windowH, windowW }, padding[2] = { padH, padW }, stride[2] = { strideH, strideW };
+  cudnnSetPoolingNdDescriptor(poolingDesc, mode, CUDNN_PROPAGATE_NAN, 2, window, padding, stride);
+
+  GpuBuffer<NNFloat>* pbX = new GpuBuffer<NNFloat>(vX.size());
+  GpuBuffer<NNFloat>* pbDx = new GpuBuffer<NNFloat>(vDx.size());
+  GpuBuffer<NNFloat>* pbY = new GpuBuffer<NNFloat>(vY.size());
+  GpuBuffer<NNFloat>* pbDy = new GpuBuffer<NNFloat>(vDy.size());
+  pbX->Upload(&vX[0]);
+  pbDx->Upload(&vDx[0]);
+  pbY->Upload(&vY[0]);
+  pbDy->Upload(&vDy[0]);
+  cudnnStatus_t forwardStatus = cudnnPoolingForward(getGpu()._cuDNNHandle, poolingDesc, &alpha, xDesc, pbX->_pDevData, &beta, yDesc, pbY->_pDevData);
+  cudnnStatus_t backwardStatus = cudnnPoolingBackward(getGpu()._cuDNNHandle, poolingDesc, &alpha, yDesc, pbY->_pDevData, yDesc, pbDy->_pDevData,
+                                                      xDesc, pbX->_pDevData, &beta, xDesc, pbDx->_pDevData);
+  pbY->Download(&vY[0]);
+  pbDx->Download(&vDx[0]);
+  delete pbX;
+  delete pbDx;
+  delete pbY;
+  delete pbDy;
+  cudnnDestroyPoolingDescriptor(poolingDesc);
+  cudnnDestroyTensorDescriptor(xDesc);
+  cudnnDestroyTensorDescriptor(yDesc);
+
+  int countError = (forwardStatus != CUDNN_STATUS_SUCCESS) + (backwardStatus != CUDNN_STATUS_SUCCESS);
+  countError += countRelativeErrors("forward", vY, vExpectedY, EPS);
+  countError += countRelativeErrors("backward", vDx, vExpectedDx, EPS);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+// Cross channel LRN of x over the channel window [c - (n - 1) / 2, c + n / 2] in double precision
+void referenceLRN(const vector<double>& vX, const int batch, const int channels, const int spatial,
+                  const unsigned int n, const double lrnAlpha, const double lrnBeta, const double lrnK, vector<double>& vY) {
+  vY.resize(vX.size());
+  const int lo = (n - 1) / 2, hi = n / 2;
+  for (int b = 0; b < batch; b++) {
+    for (int c = 0; c < channels; c++) {
+      for (int s = 0; s < spatial; s++) {
+        double sum = 0.0;
+        for (int j = max(c - lo, 0); j <= min(c + hi, channels - 1); j++) {
+          const double x = vX[((size_t)b * channels + j) * spatial + s];
+          sum += x * x;
+        }
+        const size_t i = ((size_t)b * channels + c) * spatial + s;
+        vY[i] = vX[i] * pow(lrnK + lrnAlpha / n * sum, -lrnBeta);
+      }
+    }
+  }
+}
+
+// LRN forward against the reference and backward against central differences of the reference, so the
+// gradient is checked without restating its formula.  More spatial positions than one host block of 64
+bool testLRN(const int batch, const int channels, const int height, const int width, const unsigned int n) {
+
+  cout << "TEST cudnnLRNCrossChannelForward/Backward with parameters: " << "batch=" << batch << " channels=" << channels
+       << " input=" << height << "x" << width << " n=" << n << endl;
+
+  const double EPS = 1.e-4;
+  const double lrnAlpha = 0.5, lrnBeta = 0.75, lrnK = 2.0;
+  const float alpha = 1.5f, beta = 0.5f;
+  const int spatial = height * width;
+  vector<NNFloat> vX((size_t)batch * channels * spatial), vY(vX.size()), vDy(vX.size()), vDx(vX.size());
+  for (size_t i = 0; i < vX.size(); i++) {
+    vX[i] = rand(-2.f, 2.f);
+    vY[i] = rand(-1.f, 1.f);
+    vDy[i] = rand(-1.f, 1.f);
+    vDx[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vReferenceX(vX.begin(), vX.end()), vReferenceY;
+  referenceLRN(vReferenceX, batch, channels, spatial, n, lrnAlpha, lrnBeta, lrnK, vReferenceY);
+  vector<double> vExpectedY(vY.size()), vExpectedDx(vDx.size());
+  for (size_t i = 0; i < vY.size(); i++) {
+    vExpectedY[i] = alpha * vReferenceY[i] + beta * vY[i];
+  }
+
+  // d(sum of dy * y) / dx, only the channels of the same sample and position move with x[i]
+  const double h = 1.e-4;
+  vector<double> vPlus, vMinus;
+  for (size_t i = 0; i < vX.size(); i++) {
+    const double x = vReferenceX[i];
+    vReferenceX[i] = x + h;
+    referenceLRN(vReferenceX, batch, channels, spatial, n, lrnAlpha, lrnBeta, lrnK, vPlus);
+    vReferenceX[i] = x - h;
+    referenceLRN(vReferenceX, batch, channels, spatial, n, lrnAlpha, lrnBeta, lrnK, vMinus);
+    vReferenceX[i] = x;
+    const size_t sample = i / ((size_t)channels * spatial);
+    const size_t s = i % spatial;
+    double gradient = 0.0;
+    for (int c = 0; c < channels; c++) {
+      const size_t j = (sample * channels + c) * spatial + s;
+      gradient += vDy[j] * (vPlus[j] - vMinus[j]) / (2.0 * h);
+    }
+    vExpectedDx[i] = alpha * gradient + beta * vDx[i];
+  }
+
+  cudnnTensorDescriptor_t desc;
+  cudnnLRNDescriptor_t lrnDesc;
+  cudnnCreateTensorDescriptor(&desc);
+  cudnnCreateLRNDescriptor(&lrnDesc);
+  cudnnSetTensor4dDescriptor(desc, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, batch, channels, height, width);
+  cudnnSetLRNDescriptor(lrnDesc, n, lrnAlpha, lrnBeta, lrnK);
+
+  // Backward reads y = LRN(x), so it runs on the unblended forward result
+  vector<NNFloat> vLRN(vX.size());
+  for (size_t i = 0; i < vLRN.size(); i++) {
+    vLRN[i] = (NNFloat)vReferenceY[i];
+  }
+  GpuBuffer<NNFloat>* pbX = new GpuBuffer<NNFloat>(vX.size());
+  GpuBuffer<NNFloat>* pbY = new GpuBuffer<NNFloat>(vY.size());
+  GpuBuffer<NNFloat>* pbLRN = new GpuBuffer<NNFloat>(vLRN.size());
+  GpuBuffer<NNFloat>* pbDy = new GpuBuffer<NNFloat>(vDy.size());
+  GpuBuffer<NNFloat>* pbDx = new GpuBuffer<NNFloat>(vDx.size());
+  pbX->Upload(&vX[0]);
+  pbY->Upload(&vY[0]);
+  pbLRN->Upload(&vLRN[0]);
+  pbDy->Upload(&vDy[0]);
+  pbDx->Upload(&vDx[0]);
+  cudnnStatus_t forwardStatus = cudnnLRNCrossChannelForward(getGpu()._cuDNNHandle, lrnDesc, CUDNN_LRN_CROSS_CHANNEL_DIM1, &alpha, desc, pbX->_pDevData,
+                                                            &beta, desc, pbY->_pDevData);
+  cudnnStatus_t backwardStatus = cudnnLRNCrossChannelBackward(getGpu()._cuDNNHandle, lrnDesc, CUDNN_LRN_CROSS_CHANNEL_DIM1, &alpha, desc, pbLRN->_pDevData,
+                                                              desc, pbDy->_pDevData, desc, pbX->_pDevData, &beta, desc, pbDx->_pDevData);
+  pbY->Download(&vY[0]);
+  pbDx->Download(&vDx[0]);
+  delete pbX;
+  delete pbY;
+  delete pbLRN;
+  delete pbDy;
+  delete pbDx;
+  cudnnDestroyLRNDescriptor(lrnDesc);
+  cudnnDestroyTensorDescriptor(desc);
+
+  int countError = (forwardStatus != CUDNN_STATUS_SUCCESS) + (backwardStatus != CUDNN_STATUS_SUCCESS);
+  countError += countRelativeErrors("forward", vY, vExpectedY, EPS);
+  countError += countRelativeErrors("backward", vDx, vExpectedDx, EPS);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestPooling : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestMaxPooling()
+    {
+      {
+        bool result = testPooling(CUDNN_POOLING_MAX, 2, 3, 6, 6, 2, 2, 0, 0, 2, 2);
+        CPPUNIT_ASSERT_MESSAGE("failed with disjoint windows", result);
+      }
+      {
+        bool result = testPooling(CUDNN_POOLING_MAX, 2, 3, 7, 6, 3, 2, 1, 1, 2, 2);
+        CPPUNIT_ASSERT_MESSAGE("failed with padding", result);
+      }
+      {
+        bool result = testPooling(CUDNN_POOLING_MAX, 1, 4, 9, 8, 3, 3, 1, 1, 1, 1);
+        CPPUNIT_ASSERT_MESSAGE("failed with overlapping windows", result);
+      }
+    }
+
+    void            TestAveragePooling()
+    {
+      {
+        bool result = testPooling(CUDNN_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING, 2, 3, 7, 6, 3, 2, 1, 1, 2, 2);
+        CPPUNIT_ASSERT_MESSAGE("failed excluding padding", result);
+      }
+      {
+        bool result = testPooling(CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING, 2, 3, 7, 6, 3, 2, 1, 1, 2, 2);
+        CPPUNIT_ASSERT_MESSAGE("failed including padding", result);
+      }
+      {
+        bool result = testPooling(CUDNN_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING, 1, 4, 9, 8, 3, 3, 1, 1, 1, 1);
+        CPPUNIT_ASSERT_MESSAGE("failed with overlapping windows", result);
+      }
+    }
+
+    void            TestLRN()
+    {
+      {
+        bool result = testLRN(2, 7, 9, 9, 5);
+        CPPUNIT_ASSERT_MESSAGE("failed with n = 5", result);
+      }
+      {
+        bool result = testLRN(1, 6, 3, 5, 4);
+        CPPUNIT_ASSERT_MESSAGE("failed with an even window", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestPooling);
+    CPPUNIT_TEST(TestMaxPooling);
+    CPPUNIT_TEST(TestAveragePooling);
+    CPPUNIT_TEST(TestLRN);
+    CPPUNIT_TEST_SUITE_END();
+};
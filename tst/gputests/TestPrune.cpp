@@ -0,0 +1,180 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include "Utils.h"
+#include "TestReference.h"
+
+using namespace std;
+
+// Random weights with roughly the given fraction of non-zero 8 output blocks
+void randomPrunedWeights(const uint32_t inputs, const uint32_t outputs, const float density, vector<NNFloat>& vWeight) {
+  vWeight.resize((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  hPruneWeights(inputs, outputs, &vWeight[0], (NNFloat)0.0, density);
+}
+
+// Pruning must keep exactly the requested fraction of blocks, the ones with the largest norms, and drop
+// every block below the threshold
+bool testPruneWeights() {
+
+  cout << "TEST hPruneWeights" << endl;
+
+  const uint32_t inputs = 3, outputs = 20;
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < inputs; i++) {
+    for (size_t o = 0; o < outputs; o++) {
+      vWeight[i * outputs + o] = (NNFloat)(i * outputs + o + 1) / 100.0f;
+    }
+  }
+
+  int countError = 0;
+  // 9 blocks of up to 8 outputs, the three blocks of input 0 all have a largest weight below 0.25
+  vector<NNFloat> vThreshold(vWeight);
+  uint64_t kept = hPruneWeights(inputs, outputs, &vThreshold[0], (NNFloat)0.25, (NNFloat)1.0);
+  for (size_t i = 0; i < vThreshold.size(); i++) {
+    if ((vThreshold[i] == 0.0f) != (i < outputs)) {
+      countError++;
+    }
+  }
+  countError += (kept != 6);
+
+  // Keeping a third of the blocks leaves the three with the largest weights, the blocks of input 2
+  vector<NNFloat> vDensity(vWeight);
+  kept = hPruneWeights(inputs, outputs, &vDensity[0], (NNFloat)0.0, (NNFloat)(1.0 / 3.0));
+  for (size_t i = 0; i < vDensity.size(); i++) {
+    if ((vDensity[i] == 0.0f) != (i < 2 * outputs)) {
+      countError++;
+    }
+  }
+  countError += (kept != 3);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+bool testPrunedGemm(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const float density) {
+
+  cout << "TEST hPrunedGemm with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs << " density=" << density << endl;
+
+  const double EPS = 1.e-5;
+  vector<NNFloat> vWeight;
+  randomPrunedWeights(inputs, outputs, density, vWeight);
+  vector<NNFloat> vInput((size_t)batch * inputs);
+  for (size_t i = 0; i < vInput.size(); i++) {
+    vInput[i] = max(rand(-0.5f, 1.f), 0.f);
+  }
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vExpected, vScale;
+  referenceGemm(batch, inputs, outputs, vInput, vWeight, vUnit, vExpected, vScale);
+
+  vector<uint64_t> vRowStart;
+  vector<uint32_t> vColumn;
+  vector<NNFloat> vPrunedWeight;
+  hBuildPrunedWeights(inputs, outputs, &vWeight[0], vRowStart, vColumn, vPrunedWeight);
+  hPrunedGemm(batch, outputs, inputs, &vInput[0], &vRowStart[0], vColumn.size() ? &vColumn[0] : NULL, vPrunedWeight.size() ? &vPrunedWeight[0] : NULL, &vUnit[0]);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << " blocks " << vColumn.size() << endl;
+  return (countError == 0);
+}
+
+bool testPrunedSparseZ(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t datapoints, const bool bAnalog, const float density) {
+
+  cout << "TEST hCalculatePrunedSparseZ with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " datapoints=" << datapoints << " analog=" << bAnalog << " density=" << density << endl;
+
+  const double EPS = 1.e-5;
+  vector<uint64_t> vSparseStart(batch), vSparseEnd(batch);
+  vector<uint32_t> vSparseIndex;
+  vector<NNFloat> vSparseData;
+  for (size_t i = 0; i < batch; i++) {
+    vSparseStart[i] = vSparseIndex.size();
+    for (size_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)inputs - 1));
+      vSparseData.push_back(rand(-1.f, 1.f));
+    }
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+  vector<NNFloat> vWeight;
+  randomPrunedWeights(inputs, outputs, density, vWeight);
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  // Run with beta = 1 on top of the initial units
+  vector<double> vExpected, vScale;
+  referenceSparseZ(batch, outputs, vSparseStart, vSparseEnd, vSparseIndex, bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, vWeight, vUnit, vExpected, vScale);
+
+  vector<uint64_t> vRowStart;
+  vector<uint32_t> vColumn;
+  vector<NNFloat> vPrunedWeight;
+  hBuildPrunedWeights(inputs, outputs, &vWeight[0], vRowStart, vColumn, vPrunedWeight);
+  hCalculatePrunedSparseZ(0, batch, outputs, inputs, &vRowStart[0], &vColumn[0], &vPrunedWeight[0], &vSparseStart[0], &vSparseEnd[0], &vSparseIndex[0],
+                          bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, &vUnit[0], (NNFloat)1.0);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << " blocks " << vColumn.size() << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestPrune : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestPruneWeights()
+    {
+      bool result = testPruneWeights();
+      CPPUNIT_ASSERT_MESSAGE("failed pruning weights", result);
+    }
+
+    void            TestPrunedGemm()
+    {
+      {
+        bool result = testPrunedGemm(1, 256, 512, 0.1f);
+        CPPUNIT_ASSERT_MESSAGE("failed with a single example", result);
+      }
+      {
+        bool result = testPrunedGemm(37, 257, 1001, 0.25f);
+        CPPUNIT_ASSERT_MESSAGE("failed with unaligned sizes", result);
+      }
+      {
+        bool result = testPrunedGemm(5, 64, 300, 0.0f);
+        CPPUNIT_ASSERT_MESSAGE("failed with every block pruned", result);
+      }
+    }
+
+    void            TestPrunedSparseZ()
+    {
+      getGpu()._data._bShuffleIndices = false;
+      {
+        bool result = testPrunedSparseZ(64, 20000, 384, 20, false, 0.1f);
+        CPPUNIT_ASSERT_MESSAGE("failed with boolean inputs", result);
+      }
+      {
+        bool result = testPrunedSparseZ(33, 5000, 1001, 50, true, 0.5f);
+        CPPUNIT_ASSERT_MESSAGE("failed with analog inputs", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestPrune);
+    CPPUNIT_TEST(TestPruneWeights);
+    CPPUNIT_TEST(TestPrunedGemm);
+    CPPUNIT_TEST(TestPrunedSparseZ);
+    CPPUNIT_TEST_SUITE_END();
+};
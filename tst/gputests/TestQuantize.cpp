@@ -0,0 +1,313 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "HostKernels.h"
+#include "NNNetwork.h"
+#include "Utils.h"
+#include "TestReference.h"
+#include "TopKRecall.h"
+
+using namespace std;
+
+// Compares the INT8 host kernels against an fp64 reference.  Weights and activations are each rounded
+// to 1/254 of their range, so errors are measured against the sum of absolute terms like TestSparse
+bool testQuantizedGemm(const uint32_t batch, const uint32_t inputs, const uint32_t outputs) {
+
+  cout << "TEST hQuantizedGemm with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs << endl;
+
+  const double EPS = 1.e-2;
+  vector<NNFloat> vInput((size_t)batch * inputs);
+  NNFloat maxInput = (NNFloat)0.0;
+  for (size_t i = 0; i < vInput.size(); i++) {
+    vInput[i] = max(rand(-0.5f, 1.f), 0.f);
+    maxInput = max(maxInput, vInput[i]);
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  vector<double> vExpected, vScale;
+  referenceGemm(batch, inputs, outputs, vInput, vWeight, vUnit, vExpected, vScale);
+
+  vector<int8_t> vQuantizedWeight(hQuantizedSize(inputs, outputs));
+  vector<NNFloat> vWeightScale(hQuantizedStride(outputs));
+  hQuantizeWeights(inputs, outputs, &vWeight[0], &vQuantizedWeight[0], &vWeightScale[0]);
+  hQuantizedGemm(batch, outputs, inputs, &vInput[0], maxInput / (NNFloat)127.0, &vQuantizedWeight[0], &vWeightScale[0], &vUnit[0]);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+bool testQuantizedSparseZ(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const uint32_t datapoints, const bool bAnalog) {
+
+  cout << "TEST hCalculateQuantizedSparseZ with parameters: " << "batch=" << batch << " inputs=" << inputs << " outputs=" << outputs
+       << " datapoints=" << datapoints << " analog=" << bAnalog << endl;
+
+  const double EPS = 1.e-2;
+  vector<uint64_t> vSparseStart(batch), vSparseEnd(batch);
+  vector<uint32_t> vSparseIndex;
+  vector<NNFloat> vSparseData;
+  for (size_t i = 0; i < batch; i++) {
+    vSparseStart[i] = vSparseIndex.size();
+    for (size_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)inputs - 1));
+      vSparseData.push_back(rand(-1.f, 1.f));
+    }
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+  vector<NNFloat> vWeight((size_t)inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vUnit((size_t)batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  // Run with beta = 1 on top of the initial units
+  vector<double> vExpected, vScale;
+  referenceSparseZ(batch, outputs, vSparseStart, vSparseEnd, vSparseIndex, bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, vWeight, vUnit, vExpected, vScale);
+
+  vector<int8_t> vQuantizedWeight(hQuantizedSize(inputs, outputs));
+  vector<NNFloat> vWeightScale(hQuantizedStride(outputs));
+  hQuantizeWeights(inputs, outputs, &vWeight[0], &vQuantizedWeight[0], &vWeightScale[0]);
+  hCalculateQuantizedSparseZ(0, batch, outputs, &vQuantizedWeight[0], &vWeightScale[0], &vSparseStart[0], &vSparseEnd[0], &vSparseIndex[0],
+                             bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, &vUnit[0], (NNFloat)1.0);
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+// Recall of predict's parity check on hand made units.  Candidate rows shorter than k are padded with
+// UINT_MAX, which must not count as a match even when both sides are padded
+bool testParityRecall() {
+
+  cout << "TEST parity recall on known units" << endl;
+
+  const unsigned int batch = 2;
+  const unsigned int width = 6;
+  const unsigned int k = 3;
+  const NNFloat reference[batch * width] = {0.9f, 0.1f, 0.8f, 0.3f, 0.7f, 0.2f,
+                                            0.1f, 0.5f, 0.4f, 0.6f, 0.05f, 0.3f};
+  const NNFloat approximate[batch * width] = {0.9f, 0.1f, 0.2f, 0.8f, 0.7f, 0.3f,
+                                              0.6f, 0.1f, 0.2f, 0.3f, 0.5f, 0.4f};
+  vector<NNFloat> vKey;
+  vector<NNFloat> vUnit(reference, reference + batch * width);
+  vector<unsigned int> vReferenceIndex;
+  calculateTopKIndices(vUnit, batch, width, k, vKey, vReferenceIndex);
+  vUnit.assign(approximate, approximate + batch * width);
+  vector<unsigned int> vApproximateIndex;
+  calculateTopKIndices(vUnit, batch, width, k, vKey, vApproximateIndex);
+  // {0, 2, 4} against {0, 3, 4} and {1, 2, 3} against {0, 4, 5}
+  uint64_t matches = countTopKMatches(vReferenceIndex, vApproximateIndex, batch, k);
+  int countError = (matches != 2);
+
+  // Restricted to candidates {2, 0} and {3} in a candidate stride of 4
+  const unsigned int stride = 4;
+  const NNFloat candidate[batch * stride] = {0.8f, 0.9f, -MAX_VALUE, -MAX_VALUE,
+                                             0.6f, -MAX_VALUE, -MAX_VALUE, -MAX_VALUE};
+  const uint32_t candidates0[] = {2, 0};
+  const uint32_t candidates1[] = {3};
+  vUnit.assign(candidate, candidate + batch * stride);
+  vector<unsigned int> vCandidateIndex;
+  calculateTopKIndices(vUnit, batch, stride, k, vKey, vCandidateIndex);
+  mapCandidateIndices(&vCandidateIndex[0], k, candidates0, 2);
+  mapCandidateIndices(&vCandidateIndex[k], k, candidates1, 1);
+  vector<unsigned int> vPaddedIndex(vCandidateIndex);
+  matches = countTopKMatches(vPaddedIndex, vCandidateIndex, batch, k);
+  countError += (matches != 3);
+  matches = countTopKMatches(vReferenceIndex, vCandidateIndex, batch, k);
+  countError += (matches != 3);
+
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+// Boolean sparse data set with datapoints random features per example
+NNDataSetBase* newQuantizeDataSet(const string& name, const uint32_t examples, const uint32_t width, const uint32_t datapoints) {
+  vector<uint64_t> vSparseStart(examples), vSparseEnd(examples);
+  vector<uint32_t> vSparseIndex, vNoData;
+  for (uint32_t i = 0; i < examples; i++) {
+    vSparseStart[i] = vSparseIndex.size();
+    for (uint32_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)width - 1));
+    }
+    sort(vSparseIndex.begin() + vSparseStart[i], vSparseIndex.end());
+    vSparseIndex.erase(unique(vSparseIndex.begin() + vSparseStart[i], vSparseIndex.end()), vSparseIndex.end());
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+  return new NNDataSet<uint32_t>(name, width, NNDataSetEnums::Sparse | NNDataSetEnums::Boolean, vSparseStart, vSparseEnd, vSparseIndex, vNoData);
+}
+
+// Sparse input, two dense ReLU layers of hidden units and a sigmoid output, so Quantize covers both the
+// sparse Z and the gemm INT8 paths
+NNNetwork* newQuantizeNetwork(const uint32_t hidden, const uint32_t batch, vector<NNDataSetBase*>& vDataSet) {
+  const string fileName = "quantize_test.json";
+  {
+    ofstream config(fileName);
+    config << "{ \"Version\" : 0.7, \"Name\" : \"Quantize\", \"Kind\" : \"FeedForward\", \"ErrorFunction\" : \"CrossEntropy\",\n"
+           << "  \"Layers\" : [\n"
+           << "    { \"Name\" : \"Input\", \"Kind\" : \"Input\", \"N\" : \"auto\", \"DataSet\" : \"input\", \"Sparse\" : true },\n"
+           << "    { \"Name\" : \"Hidden1\", \"Kind\" : \"Hidden\", \"Type\" : \"FullyConnected\", \"N\" : " << hidden << ", \"Activation\" : \"Relu\" },\n"
+           << "    { \"Name\" : \"Hidden2\", \"Kind\" : \"Hidden\", \"Type\" : \"FullyConnected\", \"N\" : " << hidden << ", \"Activation\" : \"Relu\" },\n"
+           << "    { \"Name\" : \"Output\", \"Kind\" : \"Output\", \"Type\" : \"FullyConnected\", \"N\" : \"auto\", \"DataSet\" : \"output\", \"Activation\" : \"Sigmoid\" }\n"
+           << "  ]\n"
+           << "}\n";
+  }
+  NNNetwork* pNetwork = LoadNeuralNetworkJSON(fileName, batch, vDataSet);
+  remove(fileName.c_str());
+  if (pNetwork != NULL) {
+    pNetwork->LoadDataSets(vDataSet);
+  }
+  return pNetwork;
+}
+
+// Network level INT8 inference the way predict -q -c runs it: calibrate on the first examples, then compare
+// the top K of INT8 PredictBatch against fp32 on the rest
+bool testQuantizedNetwork(const uint32_t inputs, const uint32_t hidden, const uint32_t outputs, const unsigned int k) {
+
+  cout << "TEST NNNetwork::Quantize with parameters: " << "inputs=" << inputs << " hidden=" << hidden << " outputs=" << outputs << " k=" << k << endl;
+
+  const double MIN_RECALL = 0.9;
+  const uint32_t examples = 512;
+  const uint32_t batch = 64;
+  const uint32_t calibrationExamples = 256;
+  vector<NNDataSetBase*> vDataSet;
+  vDataSet.push_back(newQuantizeDataSet("input", examples, inputs, 40));
+  vDataSet.push_back(newQuantizeDataSet("output", examples, outputs, 10));
+  NNNetwork* pNetwork = newQuantizeNetwork(hidden, batch, vDataSet);
+  int countError = (pNetwork == NULL);
+  uint64_t matches = 0;
+  uint64_t parityExamples = 0;
+  if (pNetwork != NULL) {
+    countError += !pNetwork->Quantize(calibrationExamples);
+    countError += !pNetwork->GetWeight("Input", "Hidden1")->IsQuantized();
+    countError += !pNetwork->GetWeight("Hidden1", "Hidden2")->IsQuantized();
+    countError += !pNetwork->GetWeight("Hidden2", "Output")->IsQuantized();
+
+    vector<NNFloat> vUnit(batch * outputs), vKey;
+    vector<unsigned int> vReferenceIndex, vApproximateIndex;
+    for (uint32_t pos = calibrationExamples; pos < examples; pos += batch) {
+      pNetwork->SetPosition(pos);
+      pNetwork->SetQuantized(false);
+      pNetwork->PredictBatch();
+      memcpy(vUnit.data(), pNetwork->GetUnitBuffer("Output"), vUnit.size() * sizeof(NNFloat));
+      calculateTopKIndices(vUnit, batch, outputs, k, vKey, vReferenceIndex);
+      pNetwork->SetQuantized(true);
+      pNetwork->PredictBatch();
+      memcpy(vUnit.data(), pNetwork->GetUnitBuffer("Output"), vUnit.size() * sizeof(NNFloat));
+      calculateTopKIndices(vUnit, batch, outputs, k, vKey, vApproximateIndex);
+      matches += countTopKMatches(vReferenceIndex, vApproximateIndex, batch, k);
+      parityExamples += batch;
+    }
+  }
+  const double recall = parityExamples ? (double)matches / ((double)parityExamples * k) : 0.0;
+  countError += (recall < MIN_RECALL);
+
+  delete pNetwork;
+  for (size_t i = 0; i < vDataSet.size(); i++) {
+    delete vDataSet[i];
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " recall " << recall << endl;
+  return (countError == 0);
+}
+
+// Layers with more than QUANT_MAX_INPUTS inputs could overflow the int32 sums and must keep their fp32
+// weights, the rest of the network is still quantized
+bool testQuantizeKeepsWideLayers() {
+
+  cout << "TEST NNNetwork::Quantize with " << QUANT_MAX_INPUTS + 1 << " inputs" << endl;
+
+  const uint32_t examples = 64;
+  vector<NNDataSetBase*> vDataSet;
+  vDataSet.push_back(newQuantizeDataSet("input", examples, QUANT_MAX_INPUTS + 1, 40));
+  vDataSet.push_back(newQuantizeDataSet("output", examples, 64, 10));
+  NNNetwork* pNetwork = newQuantizeNetwork(16, 32, vDataSet);
+  int countError = (pNetwork == NULL);
+  if (pNetwork != NULL) {
+    countError += !pNetwork->Quantize(examples);
+    countError += pNetwork->GetWeight("Input", "Hidden1")->IsQuantized();
+    countError += !pNetwork->GetWeight("Hidden1", "Hidden2")->IsQuantized();
+    countError += !pNetwork->GetWeight("Hidden2", "Output")->IsQuantized();
+  }
+
+  delete pNetwork;
+  for (size_t i = 0; i < vDataSet.size(); i++) {
+    delete vDataSet[i];
+  }
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+//----------------------------------------------------------------------------
+class TestQuantize : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestQuantizedGemm()
+    {
+      {
+        bool result = testQuantizedGemm(1, 256, 512);
+        CPPUNIT_ASSERT_MESSAGE("failed with a single example", result);
+      }
+      {
+        bool result = testQuantizedGemm(37, 257, 1001);
+        CPPUNIT_ASSERT_MESSAGE("failed with unaligned sizes", result);
+      }
+    }
+
+    void            TestQuantizedSparseZ()
+    {
+      getGpu()._data._bShuffleIndices = false;
+      {
+        bool result = testQuantizedSparseZ(64, 20000, 384, 20, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with boolean inputs", result);
+      }
+      {
+        bool result = testQuantizedSparseZ(33, 5000, 1001, 50, true);
+        CPPUNIT_ASSERT_MESSAGE("failed with analog inputs", result);
+      }
+    }
+
+    void            TestParityRecall()
+    {
+      bool result = testParityRecall();
+      CPPUNIT_ASSERT_MESSAGE("failed recall of known units", result);
+    }
+
+    void            TestQuantizedNetwork()
+    {
+      {
+        bool result = testQuantizedNetwork(2000, 128, 1000, 10);
+        CPPUNIT_ASSERT_MESSAGE("failed recall against fp32", result);
+      }
+      {
+        bool result = testQuantizeKeepsWideLayers();
+        CPPUNIT_ASSERT_MESSAGE("failed to keep a layer too wide for INT8 in fp32", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestQuantize);
+    CPPUNIT_TEST(TestQuantizedGemm);
+    CPPUNIT_TEST(TestQuantizedSparseZ);
+    CPPUNIT_TEST(TestParityRecall);
+    CPPUNIT_TEST(TestQuantizedNetwork);
+    CPPUNIT_TEST_SUITE_END();
+};
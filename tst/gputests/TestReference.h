@@ -0,0 +1,79 @@
+#ifndef TEST_REFERENCE_H
+#define TEST_REFERENCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+
+// Counts the entries of vValue further than EPS from the double precision vExpected, relative to the
+// expected magnitude
+inline int countRelativeErrors(const char* name, const std::vector<NNFloat>& vValue, const std::vector<double>& vExpected, const double EPS) {
+  int countError = 0;
+  double maxError = 0.0;
+  for (size_t i = 0; i < vValue.size(); i++) {
+    const double error = fabs(vValue[i] - vExpected[i]) / (1.0 + fabs(vExpected[i]));
+    maxError = std::max(maxError, error);
+    if (error > EPS) {
+      countError++;
+    }
+  }
+  std::cout << name << " countError " << countError << " maxError " << maxError << std::endl;
+  return countError;
+}
+
+// Double precision vUnit plus the batch x inputs vInput times the inputs x outputs vWeight.  vScale is 1 plus
+// the sum of absolute terms, the magnitude the errors of rounded weights and activations grow with
+inline void referenceGemm(const uint32_t batch, const uint32_t inputs, const uint32_t outputs, const std::vector<NNFloat>& vInput,
+                          const std::vector<NNFloat>& vWeight, const std::vector<NNFloat>& vUnit,
+                          std::vector<double>& vExpected, std::vector<double>& vScale) {
+  vExpected.assign(vUnit.begin(), vUnit.end());
+  vScale.assign(vUnit.size(), 1.0);
+  for (size_t i = 0; i < batch; i++) {
+    for (size_t j = 0; j < inputs; j++) {
+      for (size_t o = 0; o < outputs; o++) {
+        vExpected[i * outputs + o] += (double)vInput[i * inputs + j] * vWeight[j * outputs + o];
+        vScale[i * outputs + o] += fabs((double)vInput[i * inputs + j] * vWeight[j * outputs + o]);
+      }
+    }
+  }
+}
+
+// Double precision sparse Z with beta = 1 on top of vUnit, boolean inputs when pSparseData is NULL.  vScale
+// as for referenceGemm
+inline void referenceSparseZ(const uint32_t batch, const uint32_t outputs, const std::vector<uint64_t>& vSparseStart,
+                             const std::vector<uint64_t>& vSparseEnd, const std::vector<uint32_t>& vSparseIndex, const NNFloat* pSparseData,
+                             const std::vector<NNFloat>& vWeight, const std::vector<NNFloat>& vUnit,
+                             std::vector<double>& vExpected, std::vector<double>& vScale) {
+  vExpected.assign(vUnit.begin(), vUnit.end());
+  vScale.assign(vUnit.size(), 1.0);
+  for (size_t i = 0; i < batch; i++) {
+    for (uint64_t j = vSparseStart[i]; j < vSparseEnd[i]; j++) {
+      const double value = (pSparseData != NULL) ? pSparseData[j] : 1.0;
+      for (size_t o = 0; o < outputs; o++) {
+        vExpected[i * outputs + o] += value * vWeight[vSparseIndex[j] * outputs + o];
+        vScale[i * outputs + o] += fabs(value * vWeight[vSparseIndex[j] * outputs + o]);
+      }
+    }
+  }
+}
+
+// Counts the entries of vValue further than EPS from vExpected relative to vScale
+inline int countScaledErrors(const std::vector<NNFloat>& vValue, const std::vector<double>& vExpected, const std::vector<double>& vScale,
+                             const double EPS, double& maxError) {
+  int countError = 0;
+  maxError = 0.0;
+  for (size_t i = 0; i < vValue.size(); i++) {
+    const double error = fabs(vValue[i] - vExpected[i]) / vScale[i];
+    maxError = std::max(maxError, error);
+    if (error > EPS) {
+      countError++;
+    }
+  }
+  return countError;
+}
+
+#endif
@@ -3,11 +3,13 @@
 #include "cppunit/ui/text/TestRunner.h"
 #include "cppunit/TestAssert.h"
 // STL
+#include <algorithm>
 #include <string>
 
 #include "GpuTypes.h"
 #include "NNTypes.h"
 #include "kernels.h"
+#include "HostKernels.h"
 #include "Utils.h"
 
 
@@ -205,6 +207,333 @@ bool testTopK(const size_t batch = 128, const size_t topK = 128, const size_t nF
   return ret;
 }
 
+bool testHostTopK(const size_t batch = 128, const size_t topK = 128, const size_t nFeatures = 1024) {
+
+  cout << "TEST hCalculateTopK with parameters: " << "batch=" << batch << " topK=" << topK << " nFeatures=" << nFeatures << endl;
+  bool ret = true;
+
+  const size_t STRIDE = ((nFeatures + 127) >> 7) << 7;
+  timeval t0, t1;
+
+  vector<NNFloat> vTarget(batch * STRIDE);
+  vector<NNFloat> vOutput(batch * STRIDE);
+  vector<NNFloat> vKey(batch * topK);
+  vector<NNFloat> vFValue(batch * topK);
+  vector<unsigned int> vUIValue(batch * topK);
+
+  randData(&vTarget[0], &vOutput[0], batch, nFeatures, STRIDE);
+
+  // run test 1, positions as values
+  gettimeofday(&t0, NULL);
+  hCalculateTopK(&vOutput[0], &vKey[0], &vUIValue[0], batch, STRIDE, topK);
+  gettimeofday(&t1, NULL);
+  cout << "Host top K: " << elapsed_time(t1, t0) << endl;
+
+  // run test 2, values gathered from target
+  hCalculateTopK(&vOutput[0], &vTarget[0], &vKey[0], &vFValue[0], batch, STRIDE, topK);
+
+  // Validate against a CPU partial sort of the whole STRIDE wide rows, zeroes past nFeatures included.  The host
+  // top K orders tied keys by ascending position, so keys, positions and gathered values must all match exactly,
+  // padding past STRIDE included
+  {
+    vector<unsigned int> vOrder(STRIDE);
+    int countKeyError = 0;
+    int countValueError = 0;
+    float cpuSort = 0.f;
+
+    for (size_t i = 0; i < batch; i++) {
+      const NNFloat* pOutput = &vOutput[i * STRIDE];
+      const NNFloat* pTarget = &vTarget[i * STRIDE];
+
+      gettimeofday(&t0, NULL);
+      for (size_t o = 0; o < STRIDE; o++) {
+        vOrder[o] = o;
+      }
+      partial_sort(vOrder.begin(), vOrder.begin() + min(topK, STRIDE), vOrder.end(), [pOutput](unsigned int a, unsigned int b) {
+        return (pOutput[a] > pOutput[b]) || ((pOutput[a] == pOutput[b]) && (a < b));
+      });
+      gettimeofday(&t1, NULL);
+      cpuSort += elapsed_time(t1, t0);
+
+      for (size_t k = 0; k < topK; k++) {
+        const bool bPadding = (k >= STRIDE);
+        const NNFloat key = bPadding ? -MAX_VALUE : pOutput[vOrder[k]];
+        const unsigned int position = bPadding ? 0 : vOrder[k];
+        const NNFloat value = bPadding ? (NNFloat)0.0 : pTarget[vOrder[k]];
+        countKeyError += (vKey[i * topK + k] != key);
+        countValueError += (vUIValue[i * topK + k] != position);
+        countValueError += (vFValue[i * topK + k] != value);
+      }
+    }
+    cout << "CPU sort: " << cpuSort << endl;
+
+    if (countKeyError || countValueError) {
+      cout << "ERROR hCalculateTopK; ";
+      ret = false;
+    } else {
+      cout << "PASS hCalculateTopK; ";
+    }
+    cout << "countKeyError " << countKeyError << " countValueError " << countValueError << endl;
+  }
+
+  return ret;
+}
+
+bool testFilteredTopK(const size_t batch = 128, const size_t topK = 128, const size_t nFeatures = 1024, const size_t nFilters = 16, const size_t nSegments = 0) {
+
+  cout << "TEST kCalculateFilteredTopK with parameters: " << "batch=" << batch << " topK=" << topK << " nFeatures=" << nFeatures << " nFilters=" << nFilters << " nSegments=" << nSegments << endl;
+
+  const size_t STRIDE = ((nFeatures + 127) >> 7) << 7;
+  vector<NNFloat> vTarget(batch * STRIDE);
+  vector<NNFloat> vOutput(batch * STRIDE);
+  randData(&vTarget[0], &vOutput[0], batch, nFeatures, STRIDE);
+
+  // Per row filters in CSR form: zeroes (exclusions) and boosts, always covering the first and last position
+  vector<uint64_t> vFilterStart(batch);
+  vector<uint64_t> vFilterEnd(batch);
+  vector<unsigned int> vFilterIndex;
+  vector<NNFloat> vFilterValue;
+  for (size_t i = 0; i < batch; i++) {
+    vector<unsigned int> vPos;
+    vPos.push_back(0);
+    vPos.push_back(STRIDE - 1);
+    for (size_t f = 0; f < nFilters; f++) {
+      vPos.push_back(rand(0, STRIDE - 1));
+    }
+    sort(vPos.begin(), vPos.end());
+    vPos.erase(unique(vPos.begin(), vPos.end()), vPos.end());
+    vFilterStart[i] = vFilterIndex.size();
+    for (size_t f = 0; f < vPos.size(); f++) {
+      vFilterIndex.push_back(vPos[f]);
+      vFilterValue.push_back((f % 3) ? 0.f : 2.f);
+    }
+    vFilterEnd[i] = vFilterIndex.size();
+  }
+
+  // Node filter masks excluding or halving about one feature in eight, rows take turns between them
+  vector<NNFloat> vMask(nSegments * STRIDE, 1.f);
+  vector<unsigned int> vMaskRow(batch);
+  for (size_t i = 0; i < vMask.size(); i++) {
+    int r = rand(0, 15);
+    vMask[i] = (r == 0) ? 0.f : ((r == 1) ? 0.5f : 1.f);
+  }
+  for (size_t i = 0; i < batch; i++) {
+    vMaskRow[i] = nSegments ? i % nSegments : 0;
+  }
+  NNFloat* pMask = nSegments ? &vMask[0] : NULL;
+  unsigned int* pMaskRow = (nSegments > 1) ? &vMaskRow[0] : NULL;
+
+  // Reference: filter the rows, then select
+  vector<NNFloat> vFiltered(vOutput);
+  for (size_t i = 0; i < batch; i++) {
+    for (size_t j = 0; pMask && j < STRIDE; j++) {
+      vFiltered[i * STRIDE + j] *= vMask[vMaskRow[i] * STRIDE + j];
+    }
+    for (uint64_t f = vFilterStart[i]; f < vFilterEnd[i]; f++) {
+      vFiltered[i * STRIDE + vFilterIndex[f]] *= vFilterValue[f];
+    }
+  }
+  vector<NNFloat> vExpectedKey(batch * topK);
+  vector<unsigned int> vExpectedValue(batch * topK);
+  hCalculateTopK(&vFiltered[0], &vExpectedKey[0], &vExpectedValue[0], batch, STRIDE, topK);
+
+  // Host selection must match exactly and leave the output alone
+  vector<NNFloat> vKey(batch * topK);
+  vector<unsigned int> vValue(batch * topK);
+  vector<NNFloat> vCopy(vOutput);
+  hCalculateFilteredTopK(&vOutput[0], &vKey[0], &vValue[0], batch, STRIDE, topK, &vFilterStart[0], &vFilterEnd[0], &vFilterIndex[0], &vFilterValue[0], pMask, pMaskRow);
+  int countHostError = (vOutput != vCopy);
+  for (size_t i = 0; i < batch * topK; i++) {
+    if ((vKey[i] != vExpectedKey[i]) || (vValue[i] != vExpectedValue[i])) {
+      countHostError++;
+    }
+  }
+  cout << (countHostError ? "ERROR hCalculateFilteredTopK; " : "PASS hCalculateFilteredTopK; ") << "countError " << countHostError << endl;
+
+  // Device selection, only the keys are compared as the GPU sort is not stable on ties
+  GpuBuffer<NNFloat>* pbOutput = new GpuBuffer<NNFloat>(batch * STRIDE);
+  GpuBuffer<NNFloat>* pbKey = new GpuBuffer<NNFloat>(batch * topK, true);
+  GpuBuffer<unsigned int>* pbValue = new GpuBuffer<unsigned int>(batch * topK, true);
+  GpuBuffer<uint64_t>* pbFilterStart = new GpuBuffer<uint64_t>(batch);
+  GpuBuffer<uint64_t>* pbFilterEnd = new GpuBuffer<uint64_t>(batch);
+  GpuBuffer<unsigned int>* pbFilterIndex = new GpuBuffer<unsigned int>(vFilterIndex.size());
+  GpuBuffer<NNFloat>* pbFilterValue = new GpuBuffer<NNFloat>(vFilterValue.size());
+  GpuBuffer<NNFloat>* pbMask = nSegments ? new GpuBuffer<NNFloat>(vMask.size()) : NULL;
+  GpuBuffer<unsigned int>* pbMaskRow = new GpuBuffer<unsigned int>(batch);
+  pbOutput->Upload(&vOutput[0]);
+  pbFilterStart->Upload(&vFilterStart[0]);
+  pbFilterEnd->Upload(&vFilterEnd[0]);
+  pbFilterIndex->Upload(&vFilterIndex[0]);
+  pbFilterValue->Upload(&vFilterValue[0]);
+  if (pbMask) {
+    pbMask->Upload(pMask);
+  }
+  pbMaskRow->Upload(&vMaskRow[0]);
+  kCalculateFilteredTopK(pbOutput->_pDevData, pbKey->_pDevData, pbValue->_pDevData, batch, STRIDE, topK,
+                         pbFilterStart->_pDevData, pbFilterEnd->_pDevData, pbFilterIndex->_pDevData, pbFilterValue->_pDevData,
+                         pbMask ? pbMask->_pDevData : NULL, pMaskRow ? pbMaskRow->_pDevData : NULL);
+  pbKey->Download();
+  pbValue->Download();
+  pbOutput->Download(&vCopy[0]);
+  int countDeviceError = (vOutput != vCopy);
+  for (size_t i = 0; i < batch * topK; i++) {
+    if ((pbKey->_pSysData[i] != vExpectedKey[i]) || (vFiltered[(i / topK) * STRIDE + pbValue->_pSysData[i]] != pbKey->_pSysData[i])) {
+      countDeviceError++;
+    }
+  }
+  cout << (countDeviceError ? "ERROR kCalculateFilteredTopK; " : "PASS kCalculateFilteredTopK; ") << "countError " << countDeviceError << endl;
+
+  delete pbOutput;
+  delete pbKey;
+  delete pbValue;
+  delete pbFilterStart;
+  delete pbFilterEnd;
+  delete pbFilterIndex;
+  delete pbFilterValue;
+  delete pbMask;
+  delete pbMaskRow;
+
+  return (countHostError == 0) && (countDeviceError == 0);
+}
+
+inline unsigned int randKey(unsigned int minKey, unsigned int maxKey) {
+  return rand((int)minKey, (int)maxKey);
+}
+
+inline NNFloat randKey(NNFloat minKey, NNFloat maxKey) {
+  return rand(minKey, maxKey);
+}
+
+template<typename KeyType> bool testHostRadixSort(const size_t items, const KeyType minKey, const KeyType maxKey) {
+
+  cout << "TEST HostSort with parameters: " << "items=" << items << " keyBytes=" << sizeof(KeyType) << endl;
+  timeval t0, t1;
+
+  HostSort<KeyType, unsigned int> sort(items);
+  vector<pair<KeyType, unsigned int> > vExpected(items);
+  for (size_t i = 0; i < items; i++) {
+    KeyType key = randKey(minKey, maxKey);
+    sort.GetKeyPointer()[i] = key;
+    sort.GetValuePointer()[i] = i;
+    vExpected[i] = make_pair(key, (unsigned int)i);
+  }
+
+  gettimeofday(&t0, NULL);
+  sort.Sort();
+  gettimeofday(&t1, NULL);
+  cout << "Host radix sort: " << elapsed_time(t1, t0) << endl;
+
+  // Radix sort is stable so ties must keep their input order
+  stable_sort(vExpected.begin(), vExpected.end());
+  int countError = 0;
+  for (size_t i = 0; i < items; i++) {
+    if ((sort.GetKeyPointer()[i] != vExpected[i].first) || (sort.GetValuePointer()[i] != vExpected[i].second)) {
+      countError++;
+    }
+  }
+  cout << (countError ? "ERROR HostSort; " : "PASS HostSort; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+bool testHostShuffle(const size_t items) {
+
+  cout << "TEST hShuffleIndices with parameters: " << "items=" << items << endl;
+  timeval t0, t1;
+
+  vector<unsigned int> vIndex(items);
+  vector<unsigned int> vRepeat(items);
+  gettimeofday(&t0, NULL);
+  hShuffleIndices(&vIndex[0], items, 12345);
+  gettimeofday(&t1, NULL);
+  cout << "Host shuffle: " << elapsed_time(t1, t0) << endl;
+  hShuffleIndices(&vRepeat[0], items, 12345);
+
+  // Must be a permutation, reproducible from the seed, and not the identity
+  vector<bool> vSeen(items, false);
+  int countError = 0;
+  size_t fixedPoints = 0;
+  for (size_t i = 0; i < items; i++) {
+    if ((vIndex[i] >= items) || vSeen[vIndex[i]] || (vIndex[i] != vRepeat[i])) {
+      countError++;
+    } else {
+      vSeen[vIndex[i]] = true;
+    }
+    fixedPoints += (vIndex[i] == i);
+  }
+  if ((items > 16) && (fixedPoints > items / 2)) {
+    countError++;
+  }
+  cout << (countError ? "ERROR hShuffleIndices; " : "PASS hShuffleIndices; ") << "countError " << countError << " fixedPoints " << fixedPoints << endl;
+  return (countError == 0);
+}
+
+bool testHostBitonicSort(const size_t items, const bool bDescending, const int range) {
+
+  cout << "TEST hBitonicSort with parameters: " << "items=" << items << " descending=" << bDescending << " range=" << range << endl;
+
+  vector<NNFloat> vKey(items);
+  vector<unsigned int> vValue(items);
+  vector<pair<NNFloat, unsigned int> > vExpected(items);
+  for (size_t i = 0; i < items; i++) {
+    vKey[i] = rand(0, range);
+    vValue[i] = i;
+    vExpected[i] = make_pair(vKey[i], (unsigned int)i);
+  }
+  hBitonicSort(&vKey[0], &vValue[0], items, bDescending);
+
+  // Keys must match std::sort exactly, values may come in any order within tied keys
+  sort(vExpected.begin(), vExpected.end());
+  if (bDescending) {
+    reverse(vExpected.begin(), vExpected.end());
+  }
+  int countError = 0;
+  vector<pair<NNFloat, unsigned int> > vResult(items);
+  for (size_t i = 0; i < items; i++) {
+    if (vKey[i] != vExpected[i].first) {
+      countError++;
+    }
+    vResult[i] = make_pair(vKey[i], vValue[i]);
+  }
+  sort(vExpected.begin(), vExpected.end());
+  sort(vResult.begin(), vResult.end());
+  if (vResult != vExpected) {
+    countError++;
+  }
+  cout << (countError ? "ERROR hBitonicSort; " : "PASS hBitonicSort; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
+bool testHostBitonicMerge(const size_t itemsA, const size_t itemsB) {
+
+  cout << "TEST hBitonicMerge with parameters: " << "itemsA=" << itemsA << " itemsB=" << itemsB << endl;
+
+  vector<NNFloat> vKey(itemsA + itemsB);
+  vector<unsigned int> vValue(itemsA + itemsB);
+  for (size_t i = 0; i < itemsA + itemsB; i++) {
+    vKey[i] = rand(0, 1000);
+  }
+  sort(vKey.begin(), vKey.begin() + itemsA);
+  sort(vKey.begin() + itemsA, vKey.end());
+
+  // Values encode the key so pairs can be checked after the merge
+  for (size_t i = 0; i < itemsA + itemsB; i++) {
+    vValue[i] = vKey[i] * 10;
+  }
+  vector<NNFloat> vMergedKey(itemsA + itemsB);
+  vector<unsigned int> vMergedValue(itemsA + itemsB);
+  hBitonicMerge(&vKey[0], &vValue[0], itemsA, &vKey[itemsA], &vValue[itemsA], itemsB, &vMergedKey[0], &vMergedValue[0]);
+
+  sort(vKey.begin(), vKey.end());
+  int countError = 0;
+  for (size_t i = 0; i < itemsA + itemsB; i++) {
+    if ((vMergedKey[i] != vKey[i]) || (vMergedValue[i] != (unsigned int)(vMergedKey[i] * 10))) {
+      countError++;
+    }
+  }
+  cout << (countError ? "ERROR hBitonicMerge; " : "PASS hBitonicMerge; ") << "countError " << countError << endl;
+  return (countError == 0);
+}
+
 //----------------------------------------------------------------------------
 class TestSort : public CppUnit::TestFixture
 {
@@ -247,10 +576,114 @@ public:             // Interface
         CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 64, TOP_K = 32", result);
       }
     }
+
+    void            TestHostSort()
+    {
+      {
+        const size_t BATCH = 128;
+        const size_t TOP_K = 128;
+        const size_t N_FEATURES = 100000;
+        bool result = testHostTopK(BATCH, TOP_K, N_FEATURES);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 100000, TOP_K = 128", result);
+      }
+      {
+        const size_t BATCH = 128;
+        const size_t TOP_K = 500;
+        const size_t N_FEATURES = 100000;
+        bool result = testHostTopK(BATCH, TOP_K, N_FEATURES);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 100000, TOP_K = 500", result);
+      }
+      {
+        const size_t BATCH = 32;
+        const size_t TOP_K = 1000;
+        const size_t N_FEATURES = 1000000;
+        bool result = testHostTopK(BATCH, TOP_K, N_FEATURES);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 1000000, TOP_K = 1000", result);
+      }
+      {
+        const size_t BATCH = 128;
+        const size_t TOP_K = 100;
+        const size_t N_FEATURES = 64;
+        bool result = testHostTopK(BATCH, TOP_K, N_FEATURES);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 64, TOP_K = 100", result);
+      }
+      {
+        const size_t BATCH = 16;
+        const size_t TOP_K = 200;
+        const size_t N_FEATURES = 64;
+        bool result = testHostTopK(BATCH, TOP_K, N_FEATURES);
+        CPPUNIT_ASSERT_MESSAGE("failed with rows shorter than TOP_K = 200", result);
+      }
+    }
+
+    void            TestFilteredTopK()
+    {
+      {
+        bool result = testFilteredTopK(128, 128, 1024, 16);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 1024, TOP_K = 128", result);
+      }
+      {
+        bool result = testFilteredTopK(128, 32, 100000, 200);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 100000, TOP_K = 32", result);
+      }
+      {
+        bool result = testFilteredTopK(128, 1, 64, 60);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 64, TOP_K = 1", result);
+      }
+      {
+        bool result = testFilteredTopK(128, 128, 1024, 16, 1);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 1024, TOP_K = 128, one node filter", result);
+      }
+      {
+        bool result = testFilteredTopK(128, 32, 100000, 200, 5);
+        CPPUNIT_ASSERT_MESSAGE("failed with N_FEATURES = 100000, TOP_K = 32, five segments", result);
+      }
+    }
+
+    void            TestHostRadixSort()
+    {
+      {
+        bool result = testHostRadixSort<unsigned int>(1000, 0, 100);
+        CPPUNIT_ASSERT_MESSAGE("failed with ITEMS = 1000, unsigned int keys", result);
+      }
+      {
+        bool result = testHostRadixSort<unsigned int>(1000000, 0, RAND_MAX - 1);
+        CPPUNIT_ASSERT_MESSAGE("failed with ITEMS = 1000000, unsigned int keys", result);
+      }
+      {
+        bool result = testHostRadixSort<NNFloat>(1000000, -1000.f, 1000.f);
+        CPPUNIT_ASSERT_MESSAGE("failed with ITEMS = 1000000, NNFloat keys", result);
+      }
+      {
+        bool result = testHostShuffle(1000);
+        CPPUNIT_ASSERT_MESSAGE("failed with ITEMS = 1000, shuffle", result);
+      }
+      {
+        bool result = testHostShuffle(10000000);
+        CPPUNIT_ASSERT_MESSAGE("failed with ITEMS = 10000000, shuffle", result);
+      }
+    }
+
+    void            TestHostBitonicSort()
+    {
+      const size_t ITEMS[] = {1, 7, 16, 100, 256, 257, 1000, 5000};
+      for (size_t i = 0; i < sizeof(ITEMS) / sizeof(ITEMS[0]); i++) {
+        bool result = testHostBitonicSort(ITEMS[i], false, 1000000) && testHostBitonicSort(ITEMS[i], true, 10);
+        CPPUNIT_ASSERT_MESSAGE("failed hBitonicSort", result);
+      }
+      {
+        bool result = testHostBitonicMerge(256, 256) && testHostBitonicMerge(100, 37) && testHostBitonicMerge(0, 50);
+        CPPUNIT_ASSERT_MESSAGE("failed hBitonicMerge", result);
+      }
+    }
     
 public:
     CPPUNIT_TEST_SUITE(TestSort);
     CPPUNIT_TEST(TestCPU_GPUSort);
+    CPPUNIT_TEST(TestHostSort);
+    CPPUNIT_TEST(TestFilteredTopK);
+    CPPUNIT_TEST(TestHostRadixSort);
+    CPPUNIT_TEST(TestHostBitonicSort);
     CPPUNIT_TEST_SUITE_END();
     
 };
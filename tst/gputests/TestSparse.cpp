@@ -0,0 +1,132 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <string>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "kernels.h"
+#include "Utils.h"
+#include "TestReference.h"
+
+using namespace std;
+
+// Builds a skewed CSR batch: most examples have lightDatapoints inputs, every heavyEvery'th example has
+// heavyDatapoints, enough to overflow the fast sparse kernels' shared memory
+void skewedSparseData(vector<uint64_t>& vSparseStart, vector<uint64_t>& vSparseEnd, vector<uint32_t>& vSparseIndex, vector<NNFloat>& vSparseData,
+                      const size_t batch, const size_t inputs, const size_t lightDatapoints, const size_t heavyDatapoints, const size_t heavyEvery) {
+  vSparseStart.resize(batch);
+  vSparseEnd.resize(batch);
+  vSparseIndex.clear();
+  vSparseData.clear();
+  for (size_t i = 0; i < batch; i++) {
+    const size_t datapoints = (i % heavyEvery == 0) ? heavyDatapoints : lightDatapoints;
+    vSparseStart[i] = vSparseIndex.size();
+    for (size_t j = 0; j < datapoints; j++) {
+      vSparseIndex.push_back(rand(0, (int)inputs - 1));
+      vSparseData.push_back(rand(-1.f, 1.f));
+    }
+    vSparseEnd[i] = vSparseIndex.size();
+  }
+}
+
+// Runs sparse Z over a CSR batch with beta = 1 and compares it to a double precision CPU reference
+bool checkSparseZ(vector<uint64_t>& vSparseStart, vector<uint64_t>& vSparseEnd, vector<uint32_t>& vSparseIndex, vector<NNFloat>& vSparseData,
+                  const size_t inputs, const size_t outputs, const bool bAnalog) {
+
+  const float EPS = 1.e-5;
+  const size_t batch = vSparseStart.size();
+  vector<NNFloat> vWeight(inputs * outputs);
+  for (size_t i = 0; i < vWeight.size(); i++) {
+    vWeight[i] = rand(-1.f, 1.f);
+  }
+  vector<NNFloat> vUnit(batch * outputs);
+  for (size_t i = 0; i < vUnit.size(); i++) {
+    vUnit[i] = rand(-1.f, 1.f);
+  }
+
+  // CPU reference, run with beta = 1 on top of the initial units so accumulation across chunks is covered.
+  // Errors are measured against the sum of absolute terms since heavy rows add thousands of them
+  vector<double> vExpected, vScale;
+  referenceSparseZ(batch, outputs, vSparseStart, vSparseEnd, vSparseIndex, bAnalog ? &vSparseData[0] : (const NNFloat*)NULL, vWeight, vUnit, vExpected, vScale);
+
+  GpuBuffer<uint64_t>* pbSparseStart = new GpuBuffer<uint64_t>(vSparseStart.size());
+  GpuBuffer<uint64_t>* pbSparseEnd = new GpuBuffer<uint64_t>(vSparseEnd.size());
+  GpuBuffer<uint32_t>* pbSparseIndex = new GpuBuffer<uint32_t>(vSparseIndex.size());
+  GpuBuffer<NNFloat>* pbSparseData = new GpuBuffer<NNFloat>(vSparseData.size());
+  GpuBuffer<NNFloat>* pbWeight = new GpuBuffer<NNFloat>(vWeight.size());
+  GpuBuffer<NNFloat>* pbUnit = new GpuBuffer<NNFloat>(vUnit.size());
+  pbSparseStart->Upload(&vSparseStart[0]);
+  pbSparseEnd->Upload(&vSparseEnd[0]);
+  pbSparseIndex->Upload(&vSparseIndex[0]);
+  pbSparseData->Upload(&vSparseData[0]);
+  pbWeight->Upload(&vWeight[0]);
+  pbUnit->Upload(&vUnit[0]);
+
+  if (bAnalog) {
+    kCalculateSparseAnalogZ(0, batch, outputs, pbWeight->_pDevData, pbSparseStart->_pDevData, pbSparseEnd->_pDevData, pbSparseIndex->_pDevData, pbSparseData->_pDevData, pbUnit->_pDevData, (NNFloat)1.0);
+  } else {
+    kCalculateSparseZ(0, batch, outputs, pbWeight->_pDevData, pbSparseStart->_pDevData, pbSparseEnd->_pDevData, pbSparseIndex->_pDevData, pbUnit->_pDevData, (NNFloat)1.0);
+  }
+  pbUnit->Download(&vUnit[0]);
+
+  delete pbSparseStart;
+  delete pbSparseEnd;
+  delete pbSparseIndex;
+  delete pbSparseData;
+  delete pbWeight;
+  delete pbUnit;
+
+  double maxError;
+  const int countError = countScaledErrors(vUnit, vExpected, vScale, EPS, maxError);
+  cout << (countError ? "ERROR; " : "PASS; ") << "countError " << countError << " maxError " << maxError << endl;
+  return (countError == 0);
+}
+
+bool testSparseZ(const size_t batch, const size_t inputs, const size_t outputs, const size_t lightDatapoints, const size_t heavyDatapoints, const size_t heavyEvery, const bool bAnalog) {
+
+  cout << "TEST " << (bAnalog ? "kCalculateSparseAnalogZ" : "kCalculateSparseZ") << " with parameters: " << "batch=" << batch << " outputs=" << outputs
+       << " light=" << lightDatapoints << " heavy=" << heavyDatapoints << " heavyEvery=" << heavyEvery << endl;
+
+  vector<uint64_t> vSparseStart, vSparseEnd;
+  vector<uint32_t> vSparseIndex;
+  vector<NNFloat> vSparseData;
+  skewedSparseData(vSparseStart, vSparseEnd, vSparseIndex, vSparseData, batch, inputs, lightDatapoints, heavyDatapoints, heavyEvery);
+  return checkSparseZ(vSparseStart, vSparseEnd, vSparseIndex, vSparseData, inputs, outputs, bAnalog);
+}
+
+//----------------------------------------------------------------------------
+class TestSparse : public CppUnit::TestFixture
+{
+public:             // Interface
+    void            TestSkewedSparseZ()
+    {
+      getGpu()._data._bShuffleIndices = false;
+      getGpu().CopyConstants();
+      const uint32_t maxSparse = getGpu()._maxSparse;
+      const uint32_t maxSparseAnalog = getGpu()._maxSparseAnalog;
+      {
+        bool result = testSparseZ(64, 20000, 384, 20, 20, 1, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with light examples only", result);
+      }
+      {
+        bool result = testSparseZ(64, 20000, 384, 20, 3 * maxSparse + 17, 16, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with heavy examples", result);
+      }
+      {
+        bool result = testSparseZ(64, 20000, 384, 20, maxSparse, 8, false);
+        CPPUNIT_ASSERT_MESSAGE("failed with examples exactly filling shared memory", result);
+      }
+      {
+        bool result = testSparseZ(64, 20000, 384, 20, 2 * maxSparseAnalog + 5, 16, true);
+        CPPUNIT_ASSERT_MESSAGE("failed with heavy analog examples", result);
+      }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestSparse);
+    CPPUNIT_TEST(TestSkewedSparseZ);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -0,0 +1,273 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestAssert.h>
+
+#include "Filters.h"
+
+using namespace std;
+
+class TestFilters : public CppUnit::TestFixture
+{
+    // Feature indices are not in the order features appear in the filter lines
+    unordered_map<string, unsigned int> mFeatures = {{"a", 3}, {"b", 0}, {"c", 4}, {"d", 1}, {"e", 2}};
+    unordered_map<string, unsigned int> mSamples = {{"s0", 0}, {"s1", 1}, {"s2", 2}, {"s3", 3}};
+
+    /**
+    Checks every sample's filter, applied over all features, over two ranges split at feature 2 and appended for
+    top K selection, against the expected value of each filtered feature
+    */
+    void checkSamplesFilter(SamplesFilter &filter, const vector<map<string, float> > &expected) {
+        const unsigned int features = mFeatures.size();
+        for (unsigned int s = 0; s < expected.size(); s++) {
+            vector<float> vExpected(features, 1.0f);
+            for (auto const &item : expected[s]) {
+                vExpected[mFeatures[item.first]] = item.second;
+            }
+
+            vector<float> vScores(features, 1.0f);
+            filter.applyFilter(vScores.data(), s);
+            CPPUNIT_ASSERT(vExpected == vScores);
+
+            vScores.assign(features, 1.0f);
+            filter.applyFilter(vScores.data(), s, 0, 2);
+            filter.applyFilter(vScores.data() + 2, s, 2, features - 2);
+            CPPUNIT_ASSERT(vExpected == vScores);
+
+            vector<unsigned int> vItems;
+            vector<float> vValues;
+            filter.appendFilter(s, 1, features - 1, vItems, vValues);
+            CPPUNIT_ASSERT_EQUAL(vItems.size(), vValues.size());
+            size_t count = 0;
+            for (auto const &item : expected[s]) {
+                count += (mFeatures[item.first] >= 1);
+            }
+            CPPUNIT_ASSERT_EQUAL(count, vItems.size());
+            for (size_t i = 0; i < vItems.size(); i++) {
+                CPPUNIT_ASSERT(i == 0 || vItems[i - 1] < vItems[i]);
+                CPPUNIT_ASSERT_EQUAL(vExpected[vItems[i] + 1], vValues[i]);
+            }
+        }
+    }
+
+    // s0 repeats c, the last value wins.  s1 has no filter, s2's second line replaces its first, x and s9
+    // are unknown
+    void writeSamplesFilter(const string &fileName) {
+        ofstream filter(fileName);
+        filter << "s0\tc,0.5:a,0.25:c,0.75:b\n"
+               << "s2\te,0.5\n"
+               << "s3\tb,2:d:x,0.5\n"
+               << "s9\ta,0.5\n"
+               << "s2\ta,3\n";
+    }
+
+    vector<map<string, float> > expectedSamplesFilter() {
+        return {{{"a", 0.25f}, {"b", 0.0f}, {"c", 0.75f}},
+                {},
+                {{"a", 3.0f}},
+                {{"b", 2.0f}, {"d", 0.0f}}};
+    }
+
+public:
+    void TestSamplesFilterLines() {
+        const string filterFileName = "filters_test_samples.txt";
+        writeSamplesFilter(filterFileName);
+        SamplesFilter filter;
+        filter.loadFilter(mFeatures, mSamples, filterFileName);
+        remove(filterFileName.c_str());
+        checkSamplesFilter(filter, expectedSamplesFilter());
+    }
+
+    void TestFilterChunkBoundaries() {
+        const string filterFileName = "filters_test_samples.txt";
+        writeSamplesFilter(filterFileName);
+        ifstream file(filterFileName, ios::binary | ios::ate);
+        const uint64_t fileSize = file.tellg();
+
+        // Every chunk size moves the chunk boundaries, which must neither drop nor split a line
+        for (uint64_t chunkBytes = 1; chunkBytes <= fileSize; chunkBytes++) {
+            SamplesFilter filter;
+            filter.setChunkBytes(chunkBytes);
+            filter.loadFilter(mFeatures, mSamples, filterFileName);
+            checkSamplesFilter(filter, expectedSamplesFilter());
+        }
+        remove(filterFileName.c_str());
+    }
+
+    void TestCompiledFilterRoundTrip() {
+        const string filterFileName = "filters_test_samples.txt";
+        const string compiledFileName = "filters_test_samples.bin";
+        writeSamplesFilter(filterFileName);
+        {
+            SamplesFilter filter;
+            filter.loadFilter(mFeatures, mSamples, filterFileName);
+            filter.saveFilter(mFeatures, mSamples, compiledFileName);
+        }
+        CPPUNIT_ASSERT(SamplesFilter::isCompiledFilter(compiledFileName));
+        CPPUNIT_ASSERT(!SamplesFilter::isCompiledFilter(filterFileName));
+        remove(filterFileName.c_str());
+        {
+            SamplesFilter filter;
+            filter.loadFilter(mFeatures, mSamples, compiledFileName);
+            checkSamplesFilter(filter, expectedSamplesFilter());
+        }
+
+        // Indices of the same sizes but other labels or numbers
+        unordered_map<string, unsigned int> mOtherSamples = {{"s0", 1}, {"s1", 0}, {"s2", 2}, {"s3", 3}};
+        unordered_map<string, unsigned int> mOtherFeatures = {{"a", 3}, {"b", 0}, {"c", 4}, {"d", 1}, {"f", 2}};
+        {
+            SamplesFilter filter;
+            CPPUNIT_ASSERT_THROW(filter.loadFilter(mFeatures, mOtherSamples, compiledFileName), std::invalid_argument);
+        }
+        {
+            SamplesFilter filter;
+            CPPUNIT_ASSERT_THROW(filter.loadFilter(mOtherFeatures, mSamples, compiledFileName), std::invalid_argument);
+        }
+
+        // Truncated to the magic alone, shorter than the header, and missing the last value
+        string compiled;
+        {
+            ifstream file(compiledFileName, ios::binary);
+            compiled.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+        const size_t sizes[] = {8, compiled.size() - sizeof(float)};
+        for (size_t size : sizes) {
+            {
+                ofstream file(compiledFileName, ios::binary | ios::trunc);
+                file.write(compiled.data(), size);
+            }
+            SamplesFilter filter;
+            CPPUNIT_ASSERT_THROW(filter.loadFilter(mFeatures, mSamples, compiledFileName), std::invalid_argument);
+        }
+        remove(compiledFileName.c_str());
+    }
+
+    void TestLoadFilterConfigs() {
+        const string configFileName = "filters_test.json";
+        const string watchesFileName = "filters_test_watches.txt";
+        const string primeFileName = "filters_test_prime.txt";
+        {
+            ofstream config(configFileName);
+            config << "{\"filters\": [\n"
+                   << "  {\"sampleFilters\": \"" << watchesFileName << "\", \"outputFile\": \"filters_test_recs_watches\"},\n"
+                   << "  {\"nodeFilters\": \"" << primeFileName << "\", \"outputFile\": \"filters_test_recs_prime\"},\n"
+                   << "  {\"sampleFilters\": \"" << watchesFileName << "\", \"nodeFilters\": \"" << primeFileName << "\"}\n"
+                   << "]}\n";
+            ofstream watches(watchesFileName);
+            watches << "s1\tp,0.5\n";
+            ofstream prime(primeFileName);
+            prime << "q\n";
+        }
+        unordered_map<string, unsigned int> mOutput = {{"p", 0}, {"q", 1}};
+        unordered_map<string, unsigned int> mSamples = {{"s0", 0}, {"s1", 1}};
+
+        CPPUNIT_ASSERT(isFilterConfigFile(configFileName));
+        CPPUNIT_ASSERT(!isFilterConfigFile(watchesFileName));
+        vector<FilterConfig*> vFilterConfig = loadFilterConfigs(configFileName, "filters_test_recs", mOutput, mSamples);
+        CPPUNIT_ASSERT_EQUAL((size_t)3, vFilterConfig.size());
+        CPPUNIT_ASSERT_EQUAL(string("filters_test_recs_watches"), vFilterConfig[0]->getOutputFileName());
+        CPPUNIT_ASSERT_EQUAL(string("filters_test_recs_prime"), vFilterConfig[1]->getOutputFileName());
+        CPPUNIT_ASSERT_EQUAL(string("filters_test_recs"), vFilterConfig[2]->getOutputFileName());
+
+        // Scores of s1 under each configuration
+        const float expected[3][2] = {{0.5f, 1.0f}, {1.0f, 0.0f}, {0.5f, 0.0f}};
+        for (size_t c = 0; c < vFilterConfig.size(); c++) {
+            float scores[2] = {1.0f, 1.0f};
+            vFilterConfig[c]->applySamplesFilter(scores, 1, 0, 2);
+            if (vFilterConfig[c]->getNodeFilter() != NULL) {
+                vFilterConfig[c]->getNodeFilter()->applyFilter(scores, 1);
+            }
+            CPPUNIT_ASSERT_EQUAL(expected[c][0], scores[0]);
+            CPPUNIT_ASSERT_EQUAL(expected[c][1], scores[1]);
+            delete vFilterConfig[c];
+        }
+
+        // Two configurations may not write the same file
+        {
+            ofstream config(configFileName);
+            config << "{\"filters\": [{\"sampleFilters\": \"" << watchesFileName << "\"}, {}]}\n";
+        }
+        CPPUNIT_ASSERT_THROW(loadFilterConfigs(configFileName, "filters_test_recs", mOutput, mSamples), std::invalid_argument);
+
+        const char* files[] = {"filters_test.json", "filters_test_watches.txt", "filters_test_prime.txt", "filters_test_recs",
+                               "filters_test_recs_watches", "filters_test_recs_prime"};
+        for (const char* file : files) {
+            remove(file);
+        }
+    }
+
+    void TestNodeFilterSegments() {
+        const string nodeFileName = "filters_test_node.txt";
+        const string segmentFileName = "filters_test_segments.txt";
+        const string sampleSegmentFileName = "filters_test_sample_segments.txt";
+        {
+            ofstream node(nodeFileName);
+            node << "a\nb,0.5:x\n";
+            // seg1 takes two lines, x is an unknown feature
+            ofstream segment(segmentFileName);
+            segment << "seg1\tc,0.5:e\nseg2\ta,2:x\nseg1\td,0.25\n";
+            // seg9 and s9 are unknown, s3 is not listed
+            ofstream sampleSegment(sampleSegmentFileName);
+            sampleSegment << "s0\tseg1\ns1\tseg9\ns2\tseg2\ns9\tseg1\n";
+        }
+        NodeFilter filter;
+        filter.loadFilter(mFeatures, mSamples, nodeFileName);
+        filter.loadSegmentFilters(mFeatures, mSamples, segmentFileName, sampleSegmentFileName);
+        NodeFilter missing;
+        CPPUNIT_ASSERT_THROW(missing.loadFilter(mFeatures, mSamples, "filters_test_missing.txt"), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(missing.loadSegmentFilters(mFeatures, mSamples, segmentFileName, "filters_test_missing.txt"), std::invalid_argument);
+        remove(nodeFileName.c_str());
+        remove(segmentFileName.c_str());
+        remove(sampleSegmentFileName.c_str());
+
+        // Masks in index order b, d, e, a, c.  Every segment starts from the global mask
+        const vector<vector<float> > expected = {{0.5f, 1.0f, 1.0f, 0.0f, 1.0f},
+                                                 {0.5f, 0.25f, 0.0f, 0.0f, 0.5f},
+                                                 {0.5f, 1.0f, 1.0f, 0.0f, 1.0f}};
+        CPPUNIT_ASSERT_EQUAL(5u, filter.getFeatures());
+        CPPUNIT_ASSERT_EQUAL(3u, filter.getSegments());
+        for (unsigned int s = 0; s < expected.size(); s++) {
+            CPPUNIT_ASSERT(expected[s] == vector<float>(filter.getMask(s), filter.getMask(s) + 5));
+        }
+        const unsigned int segments[] = {1, 0, 2, 0};
+        for (unsigned int s = 0; s < 4; s++) {
+            CPPUNIT_ASSERT_EQUAL(segments[s], filter.getSegment(s));
+
+            vector<float> vScores(5, 1.0f);
+            filter.applyFilter(vScores.data(), s);
+            CPPUNIT_ASSERT(expected[segments[s]] == vScores);
+
+            // The last GPU's range may run past the features
+            vScores.assign(6, 1.0f);
+            filter.applyFilter(vScores.data(), s, 0, 3);
+            filter.applyFilter(vScores.data() + 3, s, 3, 3);
+            CPPUNIT_ASSERT_EQUAL(1.0f, vScores[5]);
+            vScores.resize(5);
+            CPPUNIT_ASSERT(expected[segments[s]] == vScores);
+
+            // Candidates past the features are left alone
+            const unsigned int candidates[] = {4, 1, 7};
+            float candidateScores[] = {1.0f, 1.0f, 1.0f};
+            filter.applyCandidateFilter(candidateScores, s, candidates, 3);
+            CPPUNIT_ASSERT_EQUAL(expected[segments[s]][4], candidateScores[0]);
+            CPPUNIT_ASSERT_EQUAL(expected[segments[s]][1], candidateScores[1]);
+            CPPUNIT_ASSERT_EQUAL(1.0f, candidateScores[2]);
+        }
+    }
+
+    CPPUNIT_TEST_SUITE(TestFilters);
+    CPPUNIT_TEST(TestLoadFilterConfigs);
+    CPPUNIT_TEST(TestSamplesFilterLines);
+    CPPUNIT_TEST(TestFilterChunkBoundaries);
+    CPPUNIT_TEST(TestCompiledFilterRoundTrip);
+    CPPUNIT_TEST(TestNodeFilterSegments);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <map>
 #include <string>
 #include <sstream>
@@ -106,6 +107,60 @@ public:
             outputStream.str().find("Error") != string::npos);
     }
 
+    void TestParseSamplesWithHashing() {
+        stringstream inputStream;
+        inputStream << "sample1\tfeature1,2:feature2:feature3,3\n";
+        inputStream << "sample2\tfeature1:feature4\n";
+
+        unordered_map<string, unsigned int> mFeatureIndex;
+        unordered_map<string, unsigned int> mSampleIndex;
+        bool featureIndexUpdated = false;
+        bool sampleIndexUpdated = false;
+        map<unsigned int, vector<unsigned int>> mSignals;
+        map<unsigned int, vector<float>> mSignalValues;
+        stringstream outputStream;
+        const FeatureHashing hashing(64, 2, true);
+        CPPUNIT_ASSERT(parseSamples(inputStream, true, mFeatureIndex, mSampleIndex, featureIndexUpdated, sampleIndexUpdated,
+                                    mSignals, mSignalValues, outputStream, hashing));
+        CPPUNIT_ASSERT_MESSAGE("Hashed features should not touch the feature index",
+            !featureIndexUpdated && mFeatureIndex.empty());
+        CPPUNIT_ASSERT(sampleIndexUpdated && mSampleIndex.size() == 2);
+
+        // Hashing each feature on its own gives the expected merged buckets of a sample
+        map<unsigned int, float> expected;
+        vector<unsigned int> signals;
+        vector<float> signalValues;
+        hashFeature("feature1", 2.0f, hashing, signals, signalValues);
+        hashFeature("feature2", 1.0f, hashing, signals, signalValues);
+        hashFeature("feature3", 3.0f, hashing, signals, signalValues);
+        CPPUNIT_ASSERT(signals.size() == 6);
+        for (size_t i = 0; i < signals.size(); i++) {
+            CPPUNIT_ASSERT_MESSAGE("Hashed feature should be within buckets", signals[i] < hashing.buckets);
+            CPPUNIT_ASSERT_MESSAGE("Signed hashing should only flip the sign of the value",
+                fabs(signalValues[i]) == 1.0f || fabs(signalValues[i]) == 2.0f || fabs(signalValues[i]) == 3.0f);
+            expected[signals[i]] += signalValues[i];
+        }
+
+        const vector<unsigned int> &sampleSignals = mSignals[mSampleIndex["sample1"]];
+        const vector<float> &sampleValues = mSignalValues[mSampleIndex["sample1"]];
+        CPPUNIT_ASSERT_MESSAGE("Each bucket of a sample should appear once", sampleSignals.size() == expected.size());
+        for (size_t i = 0; i < sampleSignals.size(); i++) {
+            CPPUNIT_ASSERT(expected.count(sampleSignals[i]) == 1);
+            CPPUNIT_ASSERT(expected[sampleSignals[i]] == sampleValues[i]);
+        }
+    }
+
+    void TestHashFeatureIsStable() {
+        vector<unsigned int> signals;
+        vector<float> signalValues;
+        hashFeature("110510", 1.0f, FeatureHashing(1 << 20), signals, signalValues);
+        hashFeature("110510", 1.0f, FeatureHashing(1 << 20), signals, signalValues);
+        hashFeature("121019", 1.0f, FeatureHashing(1 << 20), signals, signalValues);
+        CPPUNIT_ASSERT(signals.size() == 3);
+        CPPUNIT_ASSERT_MESSAGE("Same feature should hash to the same bucket", signals[0] == signals[1]);
+        CPPUNIT_ASSERT_MESSAGE("Unsigned hashing should keep the value", signalValues[0] == 1.0f && signalValues[2] == 1.0f);
+    }
+
     CPPUNIT_TEST_SUITE(TestNetCDFhelper);
     CPPUNIT_TEST(TestLoadIndexWithValidInput);
     CPPUNIT_TEST(TestLoadIndexWithDuplicateEntry);
@@ -113,6 +168,8 @@ public:
     CPPUNIT_TEST(TestLoadIndexWithMissingLabel);
     CPPUNIT_TEST(TestLoadIndexWithMissingLabelAndTab);
     CPPUNIT_TEST(TestLoadIndexWithExtraTab);
+    CPPUNIT_TEST(TestParseSamplesWithHashing);
+    CPPUNIT_TEST(TestHashFeatureIsStable);
     CPPUNIT_TEST_SUITE_END();
 };
 
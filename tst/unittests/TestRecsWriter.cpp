@@ -0,0 +1,130 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestAssert.h>
+
+#include "HostHalf.h"
+#include "RecsFile.h"
+#include "RecsWriter.h"
+
+using namespace std;
+
+class TestRecsWriter : public CppUnit::TestFixture
+{
+public:
+    void TestScoreFormatMatchesPrintf() {
+        const char* formats[] = {"4.3f", "8.5f", ".2f", "f", "10.0f", "3.9f", "g", "-6.2f", "012.3f"};
+        const float values[] = {0.0f, -0.0f, 0.125f, 0.0005f, -0.0004f, 1.0f / 3.0f, 2.5f, -99.995f,
+                                123456.789f, 1e9f, -3e12f, 1e-20f};
+        for (const char* format : formats) {
+            ScoreFormat scoreFormat(format);
+            string printfFormat = string("%") + format;
+            for (float value : values) {
+                string formatted;
+                scoreFormat.append(formatted, value);
+                char expected[128];
+                snprintf(expected, sizeof(expected), printfFormat.c_str(), value);
+                CPPUNIT_ASSERT_EQUAL_MESSAGE(printfFormat, string(expected), formatted);
+            }
+        }
+    }
+
+    void TestWriterWritesBatchesInOrder() {
+        const string fileName = "recs_writer_test.txt";
+        vector<string> customerIndex = {"c0", "c1", "c2"};
+        vector<string> featureIndex = {"f0", "f1", "f2"};
+        remove(fileName.c_str());
+        {
+            RecsWriter writer(fileName, "4.3f", customerIndex, featureIndex);
+            for (unsigned int position = 0; position < 3; position++) {
+                RecsWriter::Batch* batch = writer.getBatch();
+                batch->position = position;
+                batch->rows = 1;
+                batch->k = 2;
+                // Features past the end of the index are padding
+                batch->features = {2 - position, 3};
+                batch->scores = {0.5f * position, 1.0f};
+                writer.submit(batch);
+            }
+            writer.flush();
+        }
+
+        ifstream file(fileName);
+        stringstream contents;
+        contents << file.rdbuf();
+        CPPUNIT_ASSERT_EQUAL(string("c0\tf2,0.000:\nc1\tf1,0.500:\nc2\tf0,1.000:\n"), contents.str());
+        remove(fileName.c_str());
+    }
+
+    void TestBinaryRecsRoundTrip() {
+        const string fileName = "recs_writer_test.bin";
+        vector<string> customerIndex = {"c0", "c1", "c2"};
+        vector<string> featureIndex = {"f0", "f1", "f2"};
+        const RecsFormat formats[] = {RecsFP32, RecsFP16};
+        for (RecsFormat format : formats) {
+            remove(fileName.c_str());
+            {
+                RecsWriter writer(fileName, "4.3f", customerIndex, featureIndex, format);
+                for (unsigned int position = 0; position < 3; position += 2) {
+                    RecsWriter::Batch* batch = writer.getBatch();
+                    batch->position = position;
+                    batch->rows = (position == 0) ? 2 : 1;
+                    batch->k = 2;
+                    batch->features.assign(batch->rows * 2, 3);
+                    batch->scores.assign(batch->rows * 2, 9.0f);
+                    for (unsigned int j = 0; j < batch->rows; j++) {
+                        batch->features[j * 2] = 2 - position - j;
+                        batch->scores[j * 2] = 0.1f * (position + j);
+                    }
+                    writer.submit(batch);
+                }
+                writer.flush();
+            }
+
+            RecsReader reader(fileName);
+            CPPUNIT_ASSERT_EQUAL((uint32_t)2, reader.getHeader().k);
+            CPPUNIT_ASSERT_EQUAL((uint64_t)3, reader.getHeader().samples);
+            CPPUNIT_ASSERT_EQUAL((uint64_t)3, reader.getHeader().features);
+            CPPUNIT_ASSERT_EQUAL((uint64_t)3, reader.getRecords());
+            uint32_t sample;
+            uint32_t items[2];
+            float scores[2];
+            for (uint32_t j = 0; j < 3; j++) {
+                CPPUNIT_ASSERT(reader.read(sample, items, scores));
+                float expected = 0.1f * j;
+                if (format == RecsFP16) {
+                    expected = hHalfToFloat(hFloatToHalf(expected));
+                }
+                CPPUNIT_ASSERT_EQUAL(j, sample);
+                CPPUNIT_ASSERT_EQUAL(2 - j, items[0]);
+                CPPUNIT_ASSERT_EQUAL(expected, scores[0]);
+                CPPUNIT_ASSERT_EQUAL(RECS_NO_ITEM, items[1]);
+                CPPUNIT_ASSERT_EQUAL(0.0f, scores[1]);
+            }
+            CPPUNIT_ASSERT(!reader.read(sample, items, scores));
+        }
+        remove(fileName.c_str());
+    }
+
+    void TestHalfConversion() {
+        const float values[] = {0.0f, 1.0f, -2.5f, 0.1f, 65504.0f, 6.0e-8f, 1e-3f};
+        for (float value : values) {
+            float half = hHalfToFloat(hFloatToHalf(value));
+            CPPUNIT_ASSERT(fabs(half - value) <= fabs(value) / 1024.0f + 6.0e-8f);
+        }
+        CPPUNIT_ASSERT(std::isinf(hHalfToFloat(hFloatToHalf(1e6f))));
+    }
+
+    CPPUNIT_TEST_SUITE(TestRecsWriter);
+    CPPUNIT_TEST(TestScoreFormatMatchesPrintf);
+    CPPUNIT_TEST(TestWriterWritesBatchesInOrder);
+    CPPUNIT_TEST(TestBinaryRecsRoundTrip);
+    CPPUNIT_TEST(TestHalfConversion);
+    CPPUNIT_TEST_SUITE_END();
+};
@@ -0,0 +1,187 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestAssert.h>
+
+#include "Filters.h"
+#include "SampleStream.h"
+
+using namespace std;
+
+class TestSampleStream : public CppUnit::TestFixture
+{
+public:
+    void TestChunksFollowInput() {
+        const string inputFileName = "sample_stream_test.txt";
+        {
+            ofstream input(inputFileName);
+            input << "s0\ta:b\n\ns1\tb\ns2\tc,2\ns3\tx\ns4\ta:c\n";
+        }
+        unordered_map<string, unsigned int> mFeatureIndex = {{"a", 0}, {"b", 1}, {"c", 2}};
+        unordered_map<string, unsigned int> mOutput;
+        SampleStream stream(inputFileName, "", 2, mFeatureIndex, mOutput, FeatureHashing());
+
+        vector<string> vSamples;
+        vector<unsigned int> vFeatures;
+        uint64_t expectedFirst = 0;
+        SampleChunk* pChunk;
+        while ((pChunk = stream.next()) != NULL) {
+            CPPUNIT_ASSERT(pChunk->vSamples.size() <= 2);
+            CPPUNIT_ASSERT_EQUAL(expectedFirst, pChunk->firstSample);
+            CPPUNIT_ASSERT(pChunk->pSamplesFilter == NULL);
+            for (size_t i = 0; i < pChunk->vSamples.size(); i++) {
+                vSamples.push_back(pChunk->vSamples[i]);
+                for (uint64_t j = pChunk->vSparseStart[i]; j < pChunk->vSparseEnd[i]; j++) {
+                    vFeatures.push_back(pChunk->vSparseIndex[j]);
+                }
+                // Samples are separated in the flattened features
+                vFeatures.push_back(99);
+            }
+            expectedFirst += pChunk->vSamples.size();
+            delete pChunk;
+        }
+        remove(inputFileName.c_str());
+
+        CPPUNIT_ASSERT((vector<string>{"s0", "s1", "s2", "s3", "s4"}) == vSamples);
+        // Unknown features are dropped, the sample is kept
+        CPPUNIT_ASSERT((vector<unsigned int>{0, 1, 99, 1, 99, 2, 99, 99, 0, 2, 99}) == vFeatures);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, stream.getUnmatchedFilters());
+    }
+
+    void TestFiltersFollowChunks() {
+        const string inputFileName = "sample_stream_test.txt";
+        const string filterFileName = "sample_stream_test_filter.txt";
+        {
+            ofstream input(inputFileName);
+            input << "s0\ta\ns1\ta\ns2\ta\ns3\ta\ns4\ta\n";
+            // s1 and s2 have no filter, s9 is not in the input
+            ofstream filter(filterFileName);
+            filter << "s0\tp,0.5\ns3\tq\ns4\tp:q\ns9\tp\n";
+        }
+        unordered_map<string, unsigned int> mFeatureIndex = {{"a", 0}};
+        unordered_map<string, unsigned int> mOutput = {{"p", 0}, {"q", 1}};
+        SampleStream stream(inputFileName, filterFileName, 2, mFeatureIndex, mOutput, FeatureHashing());
+
+        vector<unsigned int> vFiltered;
+        SampleChunk* pChunk;
+        while ((pChunk = stream.next()) != NULL) {
+            CPPUNIT_ASSERT(pChunk->pSamplesFilter != NULL);
+            for (size_t i = 0; i < pChunk->vSamples.size(); i++) {
+                float scores[2] = {1.0f, 1.0f};
+                pChunk->pSamplesFilter->applyFilter(scores, i, 0, 2);
+                vFiltered.push_back((scores[0] != 1.0f) + 2 * (scores[1] != 1.0f));
+            }
+            delete pChunk;
+        }
+        remove(inputFileName.c_str());
+        remove(filterFileName.c_str());
+
+        CPPUNIT_ASSERT((vector<unsigned int>{1, 0, 0, 2, 3}) == vFiltered);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)1, stream.getUnmatchedFilters());
+    }
+
+    void TestFilterOfMissingSample() {
+        const string inputFileName = "sample_stream_test.txt";
+        const string filterFileName = "sample_stream_test_filter.txt";
+        {
+            ofstream input(inputFileName);
+            input << "s0\ta\ns1\ta\ns2\ta\ns3\ta\ns4\ta\ns5\ta\n";
+            // s7 and s8 are not in the input and must not hold back the filters of s3 and s5
+            ofstream filter(filterFileName);
+            filter << "s0\tp,0.5\ns7\tp\ns8\tq\ns3\tq\ns5\tp:q\ns9\tp\n";
+        }
+        unordered_map<string, unsigned int> mFeatureIndex = {{"a", 0}};
+        unordered_map<string, unsigned int> mOutput = {{"p", 0}, {"q", 1}};
+        SampleStream stream(inputFileName, filterFileName, 2, mFeatureIndex, mOutput, FeatureHashing());
+
+        vector<unsigned int> vFiltered;
+        SampleChunk* pChunk;
+        while ((pChunk = stream.next()) != NULL) {
+            for (size_t i = 0; i < pChunk->vSamples.size(); i++) {
+                float scores[2] = {1.0f, 1.0f};
+                pChunk->pSamplesFilter->applyFilter(scores, i, 0, 2);
+                vFiltered.push_back((scores[0] != 1.0f) + 2 * (scores[1] != 1.0f));
+            }
+            delete pChunk;
+        }
+        remove(inputFileName.c_str());
+        remove(filterFileName.c_str());
+
+        CPPUNIT_ASSERT((vector<unsigned int>{1, 0, 0, 2, 0, 3}) == vFiltered);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)3, stream.getUnmatchedFilters());
+    }
+
+    void TestFilterGapsPastChunk() {
+        const string inputFileName = "sample_stream_test.txt";
+        const string filterFileName = "sample_stream_test_filter.txt";
+        {
+            ofstream input(inputFileName);
+            input << "s0\ta\ns1\ta\ns2\ta\ns3\ta\ns4\ta\ns5\ta\n";
+            // Each gap of samples missing from the input is longer than a chunk, s3 has no filter
+            ofstream filter(filterFileName);
+            filter << "s0\tp\nm1\tp\nm2\tq\nm3\tp\ns1\tq\nm4\tp\nm5\tp\nm6\tq\ns2\tp\n"
+                   << "m7\tp\nm8\tq\nm9\tp\ns4\tq\nm10\tp\nm11\tp\nm12\tq\ns5\tp:q\nm13\tp\n";
+        }
+        unordered_map<string, unsigned int> mFeatureIndex = {{"a", 0}};
+        unordered_map<string, unsigned int> mOutput = {{"p", 0}, {"q", 1}};
+        SampleStream stream(inputFileName, filterFileName, 2, mFeatureIndex, mOutput, FeatureHashing());
+
+        vector<unsigned int> vFiltered;
+        SampleChunk* pChunk;
+        while ((pChunk = stream.next()) != NULL) {
+            for (size_t i = 0; i < pChunk->vSamples.size(); i++) {
+                float scores[2] = {1.0f, 1.0f};
+                pChunk->pSamplesFilter->applyFilter(scores, i, 0, 2);
+                vFiltered.push_back((scores[0] != 1.0f) + 2 * (scores[1] != 1.0f));
+            }
+            delete pChunk;
+        }
+        remove(inputFileName.c_str());
+        remove(filterFileName.c_str());
+
+        CPPUNIT_ASSERT((vector<unsigned int>{1, 2, 1, 0, 2, 3}) == vFiltered);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)13, stream.getUnmatchedFilters());
+    }
+
+    void TestFiltersOutOfOrder() {
+        const string inputFileName = "sample_stream_test.txt";
+        const string filterFileName = "sample_stream_test_filter.txt";
+        {
+            ofstream input(inputFileName);
+            input << "s0\ta\ns1\ta\ns2\ta\n";
+            ofstream filter(filterFileName);
+            filter << "s1\tp\ns0\tq\n";
+        }
+        unordered_map<string, unsigned int> mFeatureIndex = {{"a", 0}};
+        unordered_map<string, unsigned int> mOutput = {{"p", 0}, {"q", 1}};
+        SampleStream stream(inputFileName, filterFileName, 2, mFeatureIndex, mOutput, FeatureHashing());
+
+        bool thrown = false;
+        try {
+            SampleChunk* pChunk;
+            while ((pChunk = stream.next()) != NULL) {
+                delete pChunk;
+            }
+        } catch (const std::runtime_error &e) {
+            thrown = true;
+        }
+        remove(inputFileName.c_str());
+        remove(filterFileName.c_str());
+
+        CPPUNIT_ASSERT(thrown);
+    }
+
+    CPPUNIT_TEST_SUITE(TestSampleStream);
+    CPPUNIT_TEST(TestChunksFollowInput);
+    CPPUNIT_TEST(TestFiltersFollowChunks);
+    CPPUNIT_TEST(TestFilterOfMissingSample);
+    CPPUNIT_TEST(TestFilterGapsPastChunk);
+    CPPUNIT_TEST(TestFiltersOutOfOrder);
+    CPPUNIT_TEST_SUITE_END();
+};
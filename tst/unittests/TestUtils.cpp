@@ -15,8 +15,19 @@ public:
         result = isNetCDFfile("network.nic");
         CPPUNIT_ASSERT(!result);
     }
+
+    void TestMissingPath()
+    {
+        const string missing = "utils_test_missing";
+        CPPUNIT_ASSERT(!isFile(missing));
+        CPPUNIT_ASSERT(!isDirectory(missing));
+        vector<string> files;
+        CPPUNIT_ASSERT(listFiles(missing, false, files) != 0);
+        CPPUNIT_ASSERT(files.empty());
+    }
     
     CPPUNIT_TEST_SUITE(TestUtils);
     CPPUNIT_TEST(TestIsNetCDFfile);
+    CPPUNIT_TEST(TestMissingPath);
     CPPUNIT_TEST_SUITE_END();
 };
@@ -6,6 +6,9 @@
 // Test files
 #include "TestNetCDFhelper.cpp"
 #include "TestUtils.cpp"
+#include "TestRecsWriter.cpp"
+#include "TestSampleStream.cpp"
+#include "TestFilters.cpp"
 
 //
 // In order to write a new test case, create a Test<File>.cpp and write the
@@ -20,5 +23,8 @@ int main()
     CppUnit::TextUi::TestRunner runner;
     runner.addTest(TestNetCDFhelper::suite());
     runner.addTest(TestUtils::suite());
+    runner.addTest(TestRecsWriter::suite());
+    runner.addTest(TestSampleStream::suite());
+    runner.addTest(TestFilters::suite());
     return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
 }